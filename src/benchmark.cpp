@@ -0,0 +1,1829 @@
+/*********************************************************************************************************************
+ *
+ * benchmark.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "benchmark.h"
+
+#include "trimesh.h"
+#include "meshcache.h"
+#include "parallel.h"
+#include "meshcodec.h"
+#include "meshlayout.h"
+#include "simdkernels.h"
+#include "meshnormals.h"
+#include "vertexcache.h"
+#include "spatialsort.h"
+#include "halfedge.h"
+#include "meshsimplify.h"
+#include "lodselection.h"
+#include "bvh.h"
+#include "meshlets.h"
+#include "clusterculling.h"
+#include "occlusionbuffer.h"
+#include "rangeallocator.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <functional>
+#include <random>
+#include <limits>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+
+/*
+ * Run a function several times and return the best time (in ms)
+ */
+static double timeBest(const std::function<void()>& _func, int _nbRuns = 3)
+{
+    double best = 1e30;
+    for (int i = 0; i < _nbRuns; i++)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        _func();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+    return best;
+}
+
+
+/*
+ * OBJ import: legacy parser vs single-pass parser vs parallel parser with increasing thread counts
+ */
+static int benchOBJ(const std::string& _filename, unsigned _maxThreads)
+{
+    TriMesh mesh;
+
+    mesh.setLegacyOBJParser(true);
+    double legacyTime = timeBest([&]() { mesh.readFile(_filename); });
+    mesh.setLegacyOBJParser(false);
+    double singlePassTime = timeBest([&]() { mesh.readFile(_filename); });
+
+    std::cout << "[BENCH] OBJ import " << _filename << std::endl
+              << "  legacy      : " << legacyTime << " ms" << std::endl
+              << "  single-pass : " << singlePassTime << " ms (x" << legacyTime / singlePassTime << ")" << std::endl;
+
+    // 1 thread uses the sequential parser, so speedups are relative to it
+    for (unsigned nbThreads = 2; nbThreads <= _maxThreads; nbThreads *= 2)
+    {
+        double time = timeBest([&]() { mesh.readFile(_filename, nbThreads); });
+        std::cout << "  parallel " << nbThreads << "t : " << time << " ms (speedup x" << singlePassTime / time << ")" << std::endl;
+    }
+    return 0;
+}
+
+
+/*
+ * Import of any supported file format (OBJ, STL, ...)
+ */
+static int benchImport(const std::string& _filename, unsigned _nbThreads)
+{
+    TriMesh mesh;
+    double time = timeBest([&]() { mesh.readFile(_filename, _nbThreads); });
+
+    size_t nbTriangles = mesh.getIndexView().size() / 3;
+    double fileSize = 0.0;
+    uint64_t hash, size;
+    if (MeshCache::hashFile(_filename, hash, size))
+        fileSize = (double)size / (1024.0 * 1024.0);
+
+    std::cout << "[BENCH] Import " << _filename << ": " << time << " ms (" << fileSize / (time * 1e-3) << " MB/s, "
+              << (double)nbTriangles / (time * 1e-3) << " triangles/s)" << std::endl;
+    return 0;
+}
+
+
+/*
+ * Startup: cold parse vs reload from binary cache (arrays read from the mapping, or copied out of it)
+ */
+static int benchCache(const std::string& _filename)
+{
+    TriMesh mesh;
+    double parseTime = timeBest([&]() { mesh.readFile(_filename); });
+
+    // build cache
+    mesh.setUseCache(true);
+    if (!mesh.readFile(_filename))
+        return 1;
+
+    double cachedTime = timeBest([&]() { mesh.readFile(_filename); });
+    if (!mesh.isMapped())
+        std::cerr << "[BENCH] mesh not read from the cache" << std::endl;
+
+    // arrays copied out of the mapping, as when the mesh is modified after the reload
+    double copiedTime = timeBest([&]()
+    {
+        mesh.readFile(_filename);
+        mesh.takeVertices();
+        mesh.takeNormals();
+        mesh.takeIndices();
+        mesh.takeTexCoords();
+        mesh.takeColors();
+    });
+
+    double mappedTime = timeBest([&]() 
+    {
+        uint64_t size, time;
+        MeshCache cache;
+        MeshCache::statFile(_filename, size, time);
+        if (!cache.open(_filename + ".meshcache") || !cache.isValidFor(_filename, size, time))
+            std::cerr << "[BENCH] invalid cache" << std::endl;
+    });
+
+    // validation by content, as done when the write time of the source changed
+    double hashTime = timeBest([&]()
+    {
+        uint64_t hash, size;
+        MeshCache::hashFile(_filename, hash, size);
+    });
+
+    std::cout << "[BENCH] Mesh cache " << _filename << std::endl
+              << "  cold parse         : " << parseTime << " ms" << std::endl
+              << "  cache -> TriMesh   : " << cachedTime << " ms (x" << parseTime / cachedTime << ", arrays read from the mapping)" << std::endl
+              << "  ... + copy out     : " << copiedTime << " ms (x" << parseTime / copiedTime << ")" << std::endl
+              << "  cache mmap only    : " << mappedTime << " ms (x" << parseTime / mappedTime << ")" << std::endl
+              << "  source hash        : " << hashTime << " ms (skipped while size and write time match)" << std::endl;
+    return 0;
+}
+
+
+/*
+ * Mesh generated procedurally, to benchmark large meshes without input file
+ */
+class ProceduralMesh : public TriMesh
+{
+    public:
+
+        /*
+         * Torus with _n x _n vertices and 2 x _n x _n triangles
+         */
+        void makeTorus(unsigned _n)
+        {
+            const float twoPi = 6.28318530718f;
+            clear();
+            m_vertices.resize((size_t)_n * _n);
+            m_normals.resize((size_t)_n * _n);
+            for (unsigned i = 0; i < _n; i++)
+            {
+                for (unsigned j = 0; j < _n; j++)
+                {
+                    float u = twoPi * (float)i / (float)_n, v = twoPi * (float)j / (float)_n;
+                    glm::vec3 normal(std::cos(u) * std::cos(v), std::sin(u) * std::cos(v), std::sin(v));
+                    m_vertices[i * _n + j] = glm::vec3(std::cos(u), std::sin(u), 0.0f) + 0.3f * normal;
+                    m_normals[i * _n + j] = normal;
+                }
+            }
+            m_indices.reserve((size_t)_n * _n * 6);
+            for (unsigned i = 0; i < _n; i++)
+            {
+                for (unsigned j = 0; j < _n; j++)
+                {
+                    uint32_t a = i * _n + j, b = ((i + 1) % _n) * _n + j;
+                    uint32_t c = ((i + 1) % _n) * _n + (j + 1) % _n, d = i * _n + (j + 1) % _n;
+                    m_indices.insert(m_indices.end(), { a, b, c, a, c, d });
+                }
+            }
+            computeAABB();
+        }
+
+        /*
+         * Disc of _n triangles around a single vertex of valence _n (e.g., the pole of a scanned or revolved mesh)
+         */
+        void makeFan(unsigned _n)
+        {
+            const float twoPi = 6.28318530718f;
+            clear();
+            m_vertices.push_back(glm::vec3(0.0f));
+            for (unsigned i = 0; i < _n; i++)
+                m_vertices.push_back(glm::vec3(std::cos(twoPi * (float)i / (float)_n), std::sin(twoPi * (float)i / (float)_n), 0.0f));
+            for (unsigned i = 0; i < _n; i++)
+                m_indices.insert(m_indices.end(), { 0, 1 + i, 1 + (i + 1) % _n });
+            computeNormals();
+            computeAABB();
+        }
+
+        /*
+         * Shuffle vertices (e.g., to emulate a scanner or an exporter that stores them in arbitrary order)
+         */
+        void shuffleVertices(unsigned _seed)
+        {
+            detachCache();
+            std::mt19937 rng(_seed);
+            std::vector<uint32_t> remap(m_vertices.size());
+            for (size_t v = 0; v < remap.size(); v++)
+                remap[v] = (uint32_t)v;
+            std::shuffle(remap.begin(), remap.end(), rng);
+            for (uint32_t& index : m_indices)
+                index = remap[index];
+            remapVertexArray(m_vertices, remap);
+            remapVertexArray(m_normals, remap);
+        }
+
+        /*
+         * Shuffle triangles (e.g., to emulate an exporter that does not care about vertex locality)
+         */
+        void shuffleTriangles(unsigned _seed)
+        {
+            detachCache(INDEX_ARRAY);
+            std::mt19937 rng(_seed);
+            for (size_t t = m_indices.size() / 3; t > 1; t--)
+            {
+                size_t other = rng() % t;
+                std::swap_ranges(m_indices.begin() + 3 * (t - 1), m_indices.begin() + 3 * t, m_indices.begin() + 3 * other);
+            }
+        }
+};
+
+
+/*
+ * Load the mesh of a benchmark: _filename can be "torus" to use a procedural mesh of _torusSize x _torusSize vertices
+ */
+static bool loadBenchMesh(const std::string& _filename, unsigned _torusSize, unsigned _nbThreads, ProceduralMesh& _mesh)
+{
+    if (_filename == "torus")
+    {
+        _mesh.makeTorus(_torusSize);
+        return true;
+    }
+    return _mesh.readFile(_filename, _nbThreads);
+}
+
+
+/*
+ * Compressed mesh format: compression ratio, encode/decode speed and measured error
+ * _filename can be "torus" to use a procedural mesh (1M vertices)
+ */
+static int benchCodec(const std::string& _filename, float _maxError)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1024, 1, mesh))
+        return 1;
+
+    double sourceSize = 0.0;
+    if (_filename != "torus")
+    {
+        uint64_t hash, size;
+        if (MeshCache::hashFile(_filename, hash, size))
+            sourceSize = (double)size;
+    }
+    std::span<const glm::vec3> vertices = mesh.getVertexView(), normals = mesh.getNormalView(), colors = mesh.getColorView();
+    std::span<const glm::vec2> texcoords = mesh.getTexCoordView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+
+    MeshCodecParams params;
+    params.maxPositionError = _maxError;
+
+    // size without the vertex cache reordering, to measure its effect on the compression ratio
+    std::vector<uint8_t> encoded;
+    params.optimizeVertexCache = false;
+    if (!MeshCodec::encode(vertices, normals, texcoords, colors, indices, params, encoded))
+    {
+        std::cerr << "[BENCH] encoding failed (max error below what " << MeshCodec::MAX_POSITION_BITS << " bits per axis can hold?)" << std::endl;
+        return 1;
+    }
+    size_t unorderedSize = encoded.size();
+
+    params.optimizeVertexCache = true;
+    double encodeTime = timeBest([&]() { MeshCodec::encode(vertices, normals, texcoords, colors, indices, params, encoded); });
+
+    MeshCodecHeader header;
+    std::vector<glm::vec3> decVertices, decNormals, decColors;
+    std::vector<glm::vec2> decTexcoords;
+    std::vector<uint32_t> decIndices;
+    bool valid = true;
+    double decodeTime = timeBest([&]() 
+    {
+        valid = MeshCodec::decode(encoded.data(), encoded.size(), header, decVertices, decNormals, decTexcoords, decColors, decIndices);
+    });
+    if (!valid || decIndices.size() != indices.size())
+    {
+        std::cerr << "[BENCH] decoding failed" << std::endl;
+        return 1;
+    }
+
+    // triangles and vertices are reordered by the codec: compare triangle corners, in the (deterministic) triangle
+    // order of the vertex cache optimization
+    std::vector<uint32_t> reorderedIndices(indices.size());
+    ::optimizeVertexCache(indices, vertices.size(), MeshCodec::VERTEX_CACHE_SIZE, reorderedIndices);
+    indices = reorderedIndices;
+    float maxPositionError = 0.0f, maxNormalAngle = 0.0f;
+    for (size_t k = 0; k < indices.size(); k++)
+    {
+        glm::vec3 diff = glm::abs(decVertices[decIndices[k]] - vertices[indices[k]]);
+        maxPositionError = std::max(maxPositionError, std::max(diff.x, std::max(diff.y, diff.z)));
+        if (!decNormals.empty() && normals.size() == vertices.size())
+        {
+            float cosAngle = glm::dot(decNormals[decIndices[k]], glm::normalize(normals[indices[k]]));
+            maxNormalAngle = std::max(maxNormalAngle, std::acos(std::min(1.0f, cosAngle)) * 57.2957795f);
+        }
+    }
+
+    // same mesh with shuffled triangles (e.g., an exporter that does not care about vertex locality)
+    ProceduralMesh shuffled = mesh;
+    shuffled.shuffleTriangles(1);
+    std::vector<uint8_t> shuffledEncoded;
+    size_t shuffledSizes[2] = {};
+    for (int reorder = 0; reorder < 2; reorder++)
+    {
+        params.optimizeVertexCache = reorder != 0;
+        MeshCodec::encode(shuffled.getVertexView(), shuffled.getNormalView(), shuffled.getTexCoordView(), shuffled.getColorView(),
+                          shuffled.getIndexView(), params, shuffledEncoded);
+        shuffledSizes[reorder] = shuffledEncoded.size();
+    }
+
+    double rawSize = (double)(vertices.size_bytes() + normals.size_bytes() + texcoords.size_bytes() + colors.size_bytes() + indices.size_bytes());
+    std::cout << "[BENCH] Mesh codec " << _filename << " (" << vertices.size() << " vertices, " << indices.size() / 3 << " triangles)" << std::endl
+              << "  encoded size   : " << encoded.size() << " bytes (x" << rawSize / (double)encoded.size() << " vs raw binary";
+    if (sourceSize > 0.0)
+        std::cout << ", x" << sourceSize / (double)encoded.size() << " vs source file";
+    std::cout << ")" << std::endl
+              << "  ratio vs raw   : x" << rawSize / (double)unorderedSize << " -> x" << rawSize / (double)encoded.size()
+              << " with vertex cache reordering (source order)" << std::endl
+              << "                   x" << rawSize / (double)shuffledSizes[0] << " -> x" << rawSize / (double)shuffledSizes[1]
+              << " with vertex cache reordering (shuffled triangles)" << std::endl
+              << "  bits/triangle  : " << 8.0 * (double)encoded.size() / (double)std::max<size_t>(indices.size() / 3, 1) << std::endl
+              << "  encode         : " << encodeTime << " ms" << std::endl
+              << "  decode         : " << decodeTime << " ms (" << rawSize / (decodeTime * 1e6) << " GB/s of raw data)" << std::endl
+              << "  position error : " << maxPositionError << " (bits per axis " << header.positionBits[0] << "/" << header.positionBits[1] << "/" << header.positionBits[2] << ")" << std::endl
+              << "  normal error   : " << maxNormalAngle << " deg" << std::endl;
+    return 0;
+}
+
+
+/*
+ * Read a memory counter of the process from /proc/self/status (e.g., "VmRSS", "VmHWM"), in bytes (0 if not available)
+ */
+static size_t readMemoryCounter(const std::string& _key)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, _key.size() + 1, _key + ":") == 0)
+            return (size_t)std::stoull(line.substr(_key.size() + 1)) * 1024;
+    }
+    return 0;
+}
+
+
+/*
+ * Reset the peak RSS (VmHWM) of the process (Linux only)
+ */
+static void resetPeakMemory()
+{
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+
+/*
+ * Stand-in for glBufferData() (no GL context in benchmark mode): read every byte of the array
+ */
+static uint64_t simulateUpload(const void* _data, size_t _size)
+{
+    const unsigned char* bytes = (const unsigned char*)_data;
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < _size; i += 64)
+        checksum += bytes[i];
+    return checksum;
+}
+
+
+/*
+ * Peak memory when uploading a mesh: copy-out getters vs views vs moving the arrays out of the mesh
+ */
+static int benchMemory(size_t _nbVertices)
+{
+    unsigned gridSize = (unsigned)std::ceil(std::sqrt((double)_nbVertices));
+    ProceduralMesh mesh;
+    mesh.makeTorus(gridSize);
+    double meshMB = (double)(mesh.getVertexView().size_bytes() + mesh.getNormalView().size_bytes() + mesh.getIndexView().size_bytes()) / (1024.0 * 1024.0);
+
+    uint64_t checksum = 0;
+    struct Result { double time; double peakMB; };
+    auto measure = [&](const std::function<void()>& _upload)
+    {
+        size_t baseline = readMemoryCounter("VmRSS");
+        resetPeakMemory();
+        auto startTime = std::chrono::steady_clock::now();
+        _upload();
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        size_t peak = readMemoryCounter("VmHWM");
+        return Result { time, (peak > baseline) ? (double)(peak - baseline) / (1024.0 * 1024.0) : 0.0 };
+    };
+
+    Result copyResult = measure([&]()
+    {
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<uint32_t> indices;
+        mesh.getVertices(vertices);
+        mesh.getNormals(normals);
+        mesh.getIndices(indices);
+        checksum += simulateUpload(vertices.data(), vertices.size() * sizeof(glm::vec3));
+        checksum += simulateUpload(normals.data(), normals.size() * sizeof(glm::vec3));
+        checksum += simulateUpload(indices.data(), indices.size() * sizeof(uint32_t));
+    });
+
+    Result viewResult = measure([&]()
+    {
+        checksum += simulateUpload(mesh.getVertexView().data(), mesh.getVertexView().size_bytes());
+        checksum += simulateUpload(mesh.getNormalView().data(), mesh.getNormalView().size_bytes());
+        checksum += simulateUpload(mesh.getIndexView().data(), mesh.getIndexView().size_bytes());
+    });
+
+    Result moveResult = measure([&]()
+    {
+        std::vector<glm::vec3> vertices = mesh.takeVertices();
+        std::vector<glm::vec3> normals = mesh.takeNormals();
+        std::vector<uint32_t> indices = mesh.takeIndices();
+        checksum += simulateUpload(vertices.data(), vertices.size() * sizeof(glm::vec3));
+        checksum += simulateUpload(normals.data(), normals.size() * sizeof(glm::vec3));
+        checksum += simulateUpload(indices.data(), indices.size() * sizeof(uint32_t));
+    });
+
+    std::cout << "[BENCH] Mesh upload memory (" << (size_t)gridSize * gridSize << " vertices, mesh arrays: " << meshMB << " MB, checksum " << checksum << ")" << std::endl;
+    if (readMemoryCounter("VmHWM") == 0)
+        std::cout << "  (peak memory is not available on this platform)" << std::endl;
+    std::cout << "  copy-out getters : " << copyResult.time << " ms, peak " << meshMB + copyResult.peakMB << " MB" << std::endl
+              << "  views            : " << viewResult.time << " ms, peak " << meshMB + viewResult.peakMB << " MB" << std::endl
+              << "  move out         : " << moveResult.time << " ms, peak " << meshMB + moveResult.peakMB << " MB (CPU copy released after upload)" << std::endl;
+    return 0;
+}
+
+
+/*
+ * AABB, normals and upload preparation with a given vertex storage layout
+ */
+template<typename Layout>
+static void benchLayout(const TriMesh& _mesh, uint64_t& _checksum)
+{
+    LayoutMesh<Layout> mesh;
+    mesh.assign(_mesh.getVertexView(), _mesh.getNormalView(), _mesh.getIndexView());
+
+    double aabbTime = timeBest([&]() { mesh.computeAABB(); }, 5);
+    double normalsTime = timeBest([&]() { mesh.computeNormals(); });
+
+    // upload cost: conversion (if any) + reading every buffer once (stand-in for glBufferData)
+    std::vector<float> scratch;
+    double uploadTime = timeBest([&]()
+    {
+        VertexUploadViews views = mesh.getUploadViews(scratch);
+        _checksum += simulateUpload(views.position.data, views.position.bufferSize);
+        if (views.normal.data != views.position.data)
+            _checksum += simulateUpload(views.normal.data, views.normal.bufferSize);
+    });
+
+    glm::vec3 bBoxMin = mesh.getBBoxMin(), bBoxMax = mesh.getBBoxMax();
+    std::cout << "  " << Layout::NAME << std::string(8 - std::string(Layout::NAME).size(), ' ')
+              << ": AABB " << aabbTime << " ms, normals " << normalsTime << " ms, upload " << uploadTime << " ms"
+              << " (AABB [" << bBoxMin.x << " " << bBoxMin.y << " " << bBoxMin.z << "] [" << bBoxMax.x << " " << bBoxMax.y << " " << bBoxMax.z << "])" << std::endl;
+}
+
+
+/*
+ * Vertex storage layouts: arrays of vec3 (TriMesh) vs interleaved (AoS) vs coordinate streams (SoA)
+ */
+static int benchLayouts(size_t _nbVertices)
+{
+    ProceduralMesh mesh;
+    mesh.makeTorus((unsigned)std::ceil(std::sqrt((double)_nbVertices)));
+
+    uint64_t checksum = 0;
+    std::cout << "[BENCH] Vertex storage layouts (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+    benchLayout<ArrayLayout>(mesh, checksum);
+    benchLayout<InterleavedLayout>(mesh, checksum);
+    benchLayout<SoALayout>(mesh, checksum);
+    std::cout << "  (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
+
+
+/*
+ * SIMD kernels: AABB and normals throughput for each instruction set supported by the CPU, compared to scalar results
+ */
+static int benchSimd(size_t _nbVertices)
+{
+    ProceduralMesh mesh;
+    mesh.makeTorus((unsigned)std::ceil(std::sqrt((double)_nbVertices)));
+    std::span<const glm::vec3> positions = mesh.getVertexView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+    double nbVertices = (double)positions.size();
+
+    SimdISA defaultISA = getSimdISA();
+    std::vector<glm::vec3> scalarNormals(positions.size()), normals(positions.size());
+    glm::vec3 scalarMin, scalarMax;
+
+    std::cout << "[BENCH] SIMD kernels (" << positions.size() << " vertices, " << indices.size() / 3 << " triangles, best ISA: "
+              << getSimdISAName(getSupportedSimdISA()) << ")" << std::endl;
+    for (int i = 0; i <= (int)getSupportedSimdISA(); i++)
+    {
+        SimdISA isa = setSimdISA((SimdISA)i);
+        glm::vec3 bBoxMin, bBoxMax;
+        double aabbTime = timeBest([&]() { simdComputeAABB(positions, bBoxMin, bBoxMax); }, 5);
+        double normalsTime = timeBest([&]() { simdComputeNormals(positions, indices, normals); });
+
+        if (isa == SimdISA::SCALAR)
+        {
+            scalarMin = bBoxMin;
+            scalarMax = bBoxMax;
+            scalarNormals = normals;
+        }
+        float maxDiff = 0.0f;
+        for (size_t v = 0; v < normals.size(); v++)
+        {
+            glm::vec3 diff = glm::abs(normals[v] - scalarNormals[v]);
+            maxDiff = std::max(maxDiff, std::max(diff.x, std::max(diff.y, diff.z)));
+        }
+        bool identical = (std::memcmp(normals.data(), scalarNormals.data(), normals.size() * sizeof(glm::vec3)) == 0)
+                      && bBoxMin == scalarMin && bBoxMax == scalarMax;
+
+        std::cout << "  " << getSimdISAName(isa) << std::string(8 - std::string(getSimdISAName(isa)).size(), ' ')
+                  << ": AABB " << aabbTime << " ms (" << nbVertices / (aabbTime * 1e3) << " Mvertices/s), normals " << normalsTime << " ms ("
+                  << nbVertices / (normalsTime * 1e3) << " Mvertices/s), ";
+        if (identical)
+            std::cout << "bit-identical to scalar" << std::endl;
+        else
+            std::cout << "max diff to scalar: " << maxDiff << std::endl;
+    }
+    setSimdISA(defaultISA);
+    return 0;
+}
+
+
+/*
+ * Parallel normals: adjacency build + gather with 1 to N threads, for each weighting, compared to the sequential scatter
+ */
+static int benchNormals(size_t _nbVertices, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    mesh.makeTorus((unsigned)std::ceil(std::sqrt((double)_nbVertices)));
+    std::span<const glm::vec3> positions = mesh.getVertexView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+
+    std::vector<glm::vec3> scatterNormals(positions.size()), referenceNormals(positions.size()), normals(positions.size());
+    double scatterTime = timeBest([&]() { simdComputeNormals(positions, indices, scatterNormals); });
+
+    std::cout << "[BENCH] Parallel normals (" << positions.size() << " vertices, " << indices.size() / 3 << " triangles)" << std::endl
+              << "  sequential scatter (" << getSimdISAName(getSimdISA()) << ") : " << scatterTime << " ms" << std::endl;
+
+    for (NormalWeighting weighting : { NormalWeighting::AREA, NormalWeighting::ANGLE })
+    {
+        double singleThreadTime = 0.0;
+        // 1, 2, 4, ... threads, and _maxThreads
+        for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+        {
+            VertexAdjacency adjacency;
+            double adjacencyTime = timeBest([&]() { buildVertexAdjacency(positions.size(), indices, nbThreads, adjacency); });
+            double gatherTime = timeBest([&]() { computeVertexNormals(positions, indices, adjacency, weighting, nbThreads, normals); });
+            double time = adjacencyTime + gatherTime;
+
+            // determinism: every thread count must give the 1-thread result
+            if (nbThreads == 1)
+            {
+                singleThreadTime = time;
+                referenceNormals = normals;
+            }
+            bool deterministic = std::memcmp(normals.data(), referenceNormals.data(), normals.size() * sizeof(glm::vec3)) == 0;
+
+            std::cout << "  " << (weighting == NormalWeighting::AREA ? "area " : "angle") << " " << nbThreads << "t : "
+                      << time << " ms (adjacency " << adjacencyTime << " ms, gather " << gatherTime << " ms, speedup x" << singleThreadTime / time << ")"
+                      << (deterministic ? "" : " NOT DETERMINISTIC");
+            if (weighting == NormalWeighting::AREA)
+                std::cout << (std::memcmp(normals.data(), scatterNormals.data(), normals.size() * sizeof(glm::vec3)) == 0 ? ", identical to scatter" : ", differs from scatter");
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Vertex cache optimization: ACMR / ATVR of simulated FIFO and LRU caches before and after reordering
+ * _filename can be "torus" to use a procedural mesh (1M vertices) with shuffled triangles
+ */
+static int benchVertexCache(const std::string& _filename)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1024, 1, mesh))
+        return 1;
+    if (_filename == "torus")
+        mesh.shuffleTriangles(1);
+
+    const unsigned cacheSizes[] = { 16, 32 };
+    auto printStats = [&](const char* _label)
+    {
+        std::cout << "  " << _label;
+        for (unsigned cacheSize : cacheSizes)
+        {
+            VertexCacheStats fifo = simulateVertexCache(mesh.getIndexView(), mesh.getVertexView().size(), cacheSize, VertexCacheModel::FIFO);
+            VertexCacheStats lru = simulateVertexCache(mesh.getIndexView(), mesh.getVertexView().size(), cacheSize, VertexCacheModel::LRU);
+            std::cout << " | FIFO " << cacheSize << ": ACMR " << fifo.acmr << " ATVR " << fifo.atvr
+                      << " | LRU " << cacheSize << ": ACMR " << lru.acmr << " ATVR " << lru.atvr;
+        }
+        std::cout << std::endl;
+    };
+
+    std::cout << "[BENCH] Vertex cache optimization " << _filename << " (" << mesh.getVertexView().size() << " vertices, "
+              << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+    printStats("original :");
+
+    auto startTime = std::chrono::steady_clock::now();
+    mesh.optimizeVertexCache(16);
+    double cacheTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    printStats("optimized:");
+
+    startTime = std::chrono::steady_clock::now();
+    mesh.optimizeVertexFetch();
+    double fetchTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "  triangle reordering " << cacheTime << " ms (including 2 simulations), vertex reordering " << fetchTime << " ms" << std::endl;
+    return 0;
+}
+
+
+/*
+ * Hardware cache misses of the calling thread (Linux perf events, if allowed by the system)
+ */
+class CacheMissCounter
+{
+    public:
+
+        CacheMissCounter() : m_fd(-1)
+        {
+#ifdef __linux__
+            perf_event_attr attributes = {};
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            m_fd = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#ifdef __linux__
+            if (m_fd >= 0)
+                close(m_fd);
+#endif
+        }
+
+        bool isAvailable() const { return m_fd >= 0; }
+
+        /*
+         * Number of misses during a function call (0 if not available)
+         */
+        uint64_t count(const std::function<void()>& _func)
+        {
+            uint64_t misses = 0;
+#ifdef __linux__
+            if (m_fd >= 0)
+            {
+                ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+                _func();
+                ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(m_fd, &misses, sizeof(misses)) != sizeof(misses))
+                    misses = 0;
+                return misses;
+            }
+#endif
+            _func();
+            return misses;
+        }
+
+    private:
+
+        int m_fd;   // perf event file descriptor (-1 if not available)
+};
+
+
+/*
+ * Set-associative LRU data cache with 64-byte lines, to count misses independently of the hardware
+ */
+class CacheSimulator
+{
+    public:
+
+        CacheSimulator(size_t _sizeBytes, unsigned _nbWays)
+            : m_nbSets(_sizeBytes / (64 * _nbWays)), m_nbWays(_nbWays), m_lines(m_nbSets * _nbWays, UINT64_MAX), m_nbMisses(0)
+        { }
+
+        void access(const void* _address)
+        {
+            uint64_t line = (uint64_t)(uintptr_t)_address / 64;
+            uint64_t* set = m_lines.data() + (line % m_nbSets) * m_nbWays;      // most recent first
+            unsigned way = 0;
+            while (way < m_nbWays && set[way] != line)
+                way++;
+            if (way == m_nbWays)
+            {
+                m_nbMisses++;
+                way = m_nbWays - 1;
+            }
+            std::copy_backward(set, set + way, set + way + 1);
+            set[0] = line;
+        }
+
+        size_t getNbMisses() const { return m_nbMisses; }
+
+    private:
+
+        size_t m_nbSets;
+        unsigned m_nbWays;
+        std::vector<uint64_t> m_lines;
+        size_t m_nbMisses;
+};
+
+
+/*
+ * Morton-order sort of vertices and triangles: sort time, then cache misses and run time of normals
+ * and one-ring neighbourhood queries before / after sorting
+ * _filename can be "torus" to use a procedural mesh (4M vertices) with shuffled vertices and triangles
+ */
+static int benchSpatialSort(const std::string& _filename, unsigned _nbThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 2048, _nbThreads, mesh))
+        return 1;
+    if (_filename == "torus")
+    {
+        mesh.shuffleVertices(1);
+        mesh.shuffleTriangles(2);
+    }
+
+    CacheMissCounter hardwareCounter;
+    std::cout << "[BENCH] Spatial sort " << _filename << " (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3
+              << " triangles, " << _nbThreads << " threads)" << std::endl;
+    if (!hardwareCounter.isAvailable())
+        std::cout << "  (hardware cache counters not available, only simulated misses are reported)" << std::endl;
+
+    auto measure = [&](const char* _label)
+    {
+        std::span<const glm::vec3> positions = mesh.getVertexView();
+        std::span<const uint32_t> indices = mesh.getIndexView();
+
+        // simulated L2-sized cache (1 MB, 16 ways) on the position fetches of the normals pass
+        CacheSimulator simulator(1 << 20, 16);
+        for (uint32_t index : indices)
+            simulator.access(&positions[index]);
+
+        double normalsTime = timeBest([&]() { mesh.computeNormals(); });
+        uint64_t normalsMisses = hardwareCounter.count([&]() { mesh.computeNormals(); });
+        double parallelNormalsTime = timeBest([&]() { mesh.computeNormals(NormalWeighting::AREA, _nbThreads); });
+
+        // neighbourhood query: average of the one-ring of every vertex (e.g., a Laplacian smoothing step)
+        VertexAdjacency adjacency;
+        buildVertexAdjacency(positions.size(), indices, _nbThreads, adjacency);
+        std::vector<glm::vec3> smoothed(positions.size());
+        auto oneRing = [&]()
+        {
+            parallelFor(0, positions.size(), _nbThreads, [&](size_t _first, size_t _last, unsigned)
+            {
+                for (size_t v = _first; v < _last; v++)
+                {
+                    glm::vec3 sum(0.0f);
+                    for (uint32_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++)
+                    {
+                        uint32_t t = adjacency.corners[i] / 3, k = adjacency.corners[i] % 3;
+                        sum += positions[indices[3 * t + (k + 1) % 3]] + positions[indices[3 * t + (k + 2) % 3]];
+                    }
+                    uint32_t count = adjacency.offsets[v + 1] - adjacency.offsets[v];
+                    smoothed[v] = (count != 0) ? sum / (2.0f * (float)count) : positions[v];
+                }
+            });
+        };
+        double oneRingTime = timeBest(oneRing);
+        uint64_t oneRingMisses = hardwareCounter.count(oneRing);
+
+        std::cout << "  " << _label << ": normals " << normalsTime << " ms (" << _nbThreads << " threads: " << parallelNormalsTime
+                  << " ms), one-ring " << oneRingTime << " ms, simulated misses " << simulator.getNbMisses() / 1000 << "K";
+        if (hardwareCounter.isAvailable())
+            std::cout << ", hardware misses normals " << normalsMisses / 1000 << "K one-ring " << oneRingMisses / 1000 << "K";
+        std::cout << std::endl;
+    };
+
+    measure("original");
+    double sort30Time = 0.0;
+    {
+        ProceduralMesh copy = mesh;
+        sort30Time = timeBest([&]() { copy.sortSpatially(30, _nbThreads); }, 1);
+    }
+    double sort63Time = timeBest([&]() { mesh.sortSpatially(63, _nbThreads); }, 1);
+    std::cout << "  sort (Morton codes + radix sort + remap): 30 bits " << sort30Time << " ms, 63 bits " << sort63Time << " ms" << std::endl;
+    measure("sorted  ");
+    return 0;
+}
+
+
+/*
+ * Half-edge construction with 1 to N threads, then a check of the twins
+ * _filename can be "torus" to use a procedural mesh (5M vertices, 10M triangles), or "fan" (a vertex of valence 1M)
+ */
+static int benchHalfEdges(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (_filename == "fan")
+        mesh.makeFan(1 << 20);
+    else if (!loadBenchMesh(_filename, 2237, _maxThreads, mesh))
+        return 1;
+
+    std::cout << "[BENCH] Half-edges " << _filename << " (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+
+    HalfEdgeMesh halfEdges;
+    double singleThreadTime = 0.0;
+    // 1, 2, 4, ... threads, and _maxThreads
+    for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+    {
+        double time = timeBest([&]() { halfEdges.build(mesh.getIndexView(), mesh.getVertexView().size(), nbThreads); });
+        if (nbThreads == 1)
+            singleThreadTime = time;
+        std::cout << "  " << nbThreads << "t : " << time << " ms (speedup x" << singleThreadTime / time << ")" << std::endl;
+    }
+    std::cout << "  boundary half-edges: " << halfEdges.getNbBoundaryEdges() << ", non-manifold edges: " << halfEdges.getNbNonManifoldEdges()
+              << ", non-manifold vertices: " << halfEdges.getNbNonManifoldVertices() << std::endl;
+
+    // each twin is the opposite half-edge of the same edge
+    size_t nbWrongTwins = 0;
+    for (uint32_t h = 0; h < (uint32_t)halfEdges.getNbHalfEdges(); h++)
+    {
+        uint32_t twin = halfEdges.twin(h);
+        if (twin != HalfEdgeMesh::INVALID && (halfEdges.twin(twin) != h || halfEdges.from(twin) != halfEdges.to(h) || halfEdges.to(twin) != halfEdges.from(h)))
+            nbWrongTwins++;
+    }
+    std::cout << "  twins check: " << ((nbWrongTwins == 0) ? "OK" : "FAILED") << std::endl;
+    return (nbWrongTwins == 0) ? 0 : 1;
+}
+
+
+/*
+ * LOD chain generation with 1 to N threads
+ * _filename can be "torus" to use a procedural mesh (1M vertices, 2M triangles)
+ */
+static int benchLODs(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1000, _maxThreads, mesh))
+        return 1;
+
+    std::cout << "[BENCH] LODs " << _filename << " (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+
+    const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    MeshSimplifier simplifier;
+    std::vector<MeshLOD> reference, lods;
+    double singleThreadTime = 0.0;
+    // 1, 2, 4, ... threads, and _maxThreads
+    for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+    {
+        simplifier.setVertices(mesh.getVertexView(), nbThreads);
+        double time = timeBest([&]() { simplifier.generateLODs(mesh.getIndexView(), ratios, 0.02f, lods); }, 1);
+        bool identical = true;
+        if (nbThreads == 1)
+        {
+            singleThreadTime = time;
+            reference = lods;
+        }
+        else
+        {
+            identical = (lods.size() == reference.size());
+            for (size_t i = 0; identical && i < lods.size(); i++)
+                identical = (lods[i].indices == reference[i].indices);
+        }
+        std::cout << "  " << nbThreads << "t : " << time << " ms (speedup x" << singleThreadTime / time << ")"
+                  << (identical ? "" : " results differ from 1 thread!") << std::endl;
+    }
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        std::cout << "  LOD " << i + 1 << ": " << reference[i].indices.size() / 3 << " triangles, error " << reference[i].error
+                  << " (" << reference[i].error / simplifier.getExtent() * 100.0f << "% of AABB diagonal)" << std::endl;
+    }
+    return 0;
+}
+
+
+/*
+ * Level of detail selection checks (no mesh, no timing): level picked from known projected errors, hysteresis around
+ * a switch distance, and pixels per unit of perspective and orthographic projections vs projected points
+ */
+static int benchLODSelect()
+{
+    int nbFailed = 0;
+    auto check = [&](const std::string& _label, bool _passed)
+    {
+        std::cout << "  " << (_passed ? "ok     " : "FAILED ") << _label << std::endl;
+        if (!_passed)
+            nbFailed++;
+    };
+    std::cout << "[BENCH] LOD selection" << std::endl;
+
+    // Known projected errors (no hysteresis): coarsest level whose error x pixels per unit is below the threshold
+    const float errors[] = { 0.0f, 1.0f, 2.0f, 4.0f, 8.0f };
+    check("threshold 0.5 px -> level 0", selectLOD(errors, 1.0f, 0, 0.5f, 0.0f) == 0);
+    check("threshold 1 px -> level 1 (error equal to the threshold)", selectLOD(errors, 1.0f, 0, 1.0f, 0.0f) == 1);
+    check("threshold 3 px -> level 2", selectLOD(errors, 1.0f, 0, 3.0f, 0.0f) == 2);
+    check("threshold 100 px -> level 4 (coarsest)", selectLOD(errors, 1.0f, 0, 100.0f, 0.0f) == 4);
+    check("2 px per unit, threshold 3 px -> level 1", selectLOD(errors, 2.0f, 0, 3.0f, 0.0f) == 1);
+    check("camera inside the bounding sphere (infinite pixels per unit) -> level 0",
+          selectLOD(errors, std::numeric_limits<float>::infinity(), 3, 3.0f, LOD_HYSTERESIS) == 0);
+    check("current level out of range is clamped", selectLOD(errors, 1.0f, 42, 3.0f, 0.0f) == 2);
+
+    // Hysteresis: coarser only below (1 - LOD_HYSTERESIS) x threshold, finer as soon as the threshold is exceeded
+    const float threshold = 3.0f, margin = threshold * (1.0f - LOD_HYSTERESIS);
+    check("level 3 projected inside the margin: level 2 is held", selectLOD(errors, 0.5f * (margin + threshold) / errors[3], 2, threshold, LOD_HYSTERESIS) == 2);
+    check("level 3 projected below the margin: switch to level 3", selectLOD(errors, 0.99f * margin / errors[3], 2, threshold, LOD_HYSTERESIS) == 3);
+    check("level 2 projected inside the margin: level 2 is held (no refinement)", selectLOD(errors, 0.5f * (margin + threshold) / errors[2], 2, threshold, LOD_HYSTERESIS) == 2);
+    check("level 2 projected above the threshold: refine to level 1 at once", selectLOD(errors, 1.01f * threshold / errors[2], 2, threshold, LOD_HYSTERESIS) == 1);
+
+    // Camera oscillating by +-5% around the distance where level 3 reaches the threshold: switches with and without hysteresis
+    int nbSwitches[2] = { 0, 0 };
+    for (int h = 0; h < 2; h++)
+    {
+        float hysteresis = (h == 0) ? 0.0f : LOD_HYSTERESIS;
+        int lod = selectLOD(errors, threshold / errors[3], 0, threshold, hysteresis);
+        for (int frame = 0; frame < 100; frame++)
+        {
+            float pixelsPerUnit = threshold / errors[3] * ((frame % 2 == 0) ? 1.05f : 0.95f);
+            int newLOD = selectLOD(errors, pixelsPerUnit, lod, threshold, hysteresis);
+            nbSwitches[h] += (newLOD != lod);
+            lod = newLOD;
+        }
+    }
+    check("oscillating camera: " + std::to_string(nbSwitches[0]) + " switches without hysteresis, " + std::to_string(nbSwitches[1]) + " with",
+          nbSwitches[0] > 0 && nbSwitches[1] <= 1);
+
+    // Pixels per unit vs the pixel distance between two projected points one unit apart, at the nearest depth of the sphere
+    const float viewportHeight = 720.0f, radius = 0.5f;
+    auto projectedPixels = [&](const glm::mat4& _projMat, float _depth)
+    {
+        glm::vec4 p0 = _projMat * glm::vec4(0.0f, 0.0f, -_depth, 1.0f);
+        glm::vec4 p1 = _projMat * glm::vec4(0.0f, 1.0f, -_depth, 1.0f);
+        return (p1.y / p1.w - p0.y / p0.w) * 0.5f * viewportHeight;
+    };
+    auto nearlyEqual = [](float _a, float _b) { return std::abs(_a - _b) <= 1e-4f * std::max(std::abs(_a), std::abs(_b)); };
+    glm::mat4 perspectiveMat = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 orthoMat = glm::ortho(-2.0f, 2.0f, -1.5f, 1.5f, 0.1f, 100.0f);
+    float perspective[2], ortho[2];
+    for (int i = 0; i < 2; i++)
+    {
+        float distance = (i == 0) ? 5.0f : 10.0f;
+        glm::mat4 viewMat = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -distance));
+        perspective[i] = computePixelsPerUnit(glm::vec3(0.0f), radius, viewMat, perspectiveMat, viewportHeight);
+        ortho[i] = computePixelsPerUnit(glm::vec3(0.0f), radius, viewMat, orthoMat, viewportHeight);
+        check("perspective at distance " + std::to_string((int)distance) + ": " + std::to_string(perspective[i]) + " px per unit",
+              nearlyEqual(perspective[i], projectedPixels(perspectiveMat, distance - radius)));
+        check("orthographic at distance " + std::to_string((int)distance) + ": " + std::to_string(ortho[i]) + " px per unit",
+              nearlyEqual(ortho[i], projectedPixels(orthoMat, distance - radius)));
+    }
+    check("perspective: farther sphere, fewer pixels per unit", perspective[1] < perspective[0]);
+    check("orthographic: pixels per unit independent of the distance", nearlyEqual(ortho[0], ortho[1]));
+    glm::mat4 scaledMat = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)), glm::vec3(2.0f));
+    check("orthographic: model scaled x2, pixels per unit x2", nearlyEqual(computePixelsPerUnit(glm::vec3(0.0f), radius, scaledMat, orthoMat, viewportHeight), 2.0f * ortho[0]));
+    glm::mat4 insideMat = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.2f));
+    check("perspective: camera inside the sphere -> infinite pixels per unit",
+          std::isinf(computePixelsPerUnit(glm::vec3(0.0f), radius, insideMat, perspectiveMat, viewportHeight)));
+
+    std::cout << "  " << nbFailed << " check(s) failed" << std::endl;
+    return (nbFailed == 0) ? 0 : 1;
+}
+
+
+/*
+ * Coherent rays (pinhole camera looking at the mesh from outside, 512 x 512) and incoherent rays (segments between
+ * random points of the bounding box)
+ */
+static void makeBenchRays(std::span<const glm::vec3> _positions, std::vector<Ray>& _primaryRays, std::vector<Ray>& _randomRays)
+{
+    glm::vec3 bBoxMin(FLT_MAX), bBoxMax(-FLT_MAX);
+    for (const glm::vec3& p : _positions)
+    {
+        bBoxMin = glm::min(bBoxMin, p);
+        bBoxMax = glm::max(bBoxMax, p);
+    }
+    glm::vec3 center = (bBoxMin + bBoxMax) * 0.5f;
+    float radius = glm::length(bBoxMax - bBoxMin) * 0.5f;
+
+    const int resolution = 512;
+    glm::vec3 eye = center + glm::vec3(0.3f, 0.5f, 1.0f) * (2.0f * radius);
+    glm::vec3 forward = glm::normalize(center - eye);
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::cross(right, forward);
+    for (int y = 0; y < resolution; y++)
+        for (int x = 0; x < resolution; x++)
+        {
+            Ray ray;
+            ray.origin = eye;
+            ray.direction = forward + (right * ((float)x / resolution - 0.5f) + up * ((float)y / resolution - 0.5f)) * 0.8f;
+            _primaryRays.push_back(ray);
+        }
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    auto randomPoint = [&]() { return center + glm::vec3(dist(rng), dist(rng), dist(rng)) * radius; };
+    for (int i = 0; i < resolution * resolution; i++)
+    {
+        Ray ray;
+        ray.origin = randomPoint();
+        ray.direction = randomPoint() - ray.origin;
+        ray.tMax = 1.0f;
+        _randomRays.push_back(ray);
+    }
+}
+
+
+/*
+ * BVH build time with 1 to N threads, and ray queries (closest hit and any hit, single thread)
+ * _filename can be "torus" to use a procedural mesh (1M vertices, 2M triangles)
+ */
+static int benchBVH(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1000, _maxThreads, mesh))
+        return 1;
+
+    std::span<const glm::vec3> positions = mesh.getVertexView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+    std::cout << "[BENCH] BVH " << _filename << " (" << positions.size() << " vertices, " << indices.size() / 3 << " triangles)" << std::endl;
+
+    MeshBVH bvh;
+    std::vector<BVHNode> reference;
+    double singleThreadTime = 0.0;
+    // 1, 2, 4, ... threads, and _maxThreads
+    for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+    {
+        double time = timeBest([&]() { bvh.build(positions, indices, nbThreads); });
+        std::span<const BVHNode> nodes = bvh.getNodes();
+        bool identical = true;
+        if (nbThreads == 1)
+        {
+            singleThreadTime = time;
+            reference.assign(nodes.begin(), nodes.end());
+        }
+        else
+        {
+            identical = (nodes.size() == reference.size()) && std::memcmp(nodes.data(), reference.data(), nodes.size_bytes()) == 0;
+        }
+        std::cout << "  build " << nbThreads << "t : " << time << " ms (speedup x" << singleThreadTime / time << ")"
+                  << (identical ? "" : " results differ from 1 thread!") << std::endl;
+    }
+    std::cout << "  " << bvh.getNodes().size() << " nodes (" << bvh.getNodes().size_bytes() / (1024 * 1024) << " MB), SAH cost " << bvh.computeSAHCost() << std::endl;
+
+    std::vector<Ray> primaryRays, randomRays;
+    makeBenchRays(positions, primaryRays, randomRays);
+
+    for (int set = 0; set < 2; set++)
+    {
+        const std::vector<Ray>& rays = (set == 0) ? primaryRays : randomRays;
+        size_t nbHits = 0, nbOccluded = 0;
+        double closestTime = timeBest([&]()
+        {
+            nbHits = 0;
+            RayHit hit;
+            for (const Ray& ray : rays)
+                nbHits += bvh.intersect(ray, hit) ? 1 : 0;
+        });
+        double anyTime = timeBest([&]()
+        {
+            nbOccluded = 0;
+            for (const Ray& ray : rays)
+                nbOccluded += bvh.occluded(ray) ? 1 : 0;
+        });
+        std::cout << "  " << ((set == 0) ? "primary" : "random ") << " rays: closest hit " << rays.size() / (closestTime * 1000.0) << " Mrays/s, any hit "
+                  << rays.size() / (anyTime * 1000.0) << " Mrays/s (" << nbHits * 100 / rays.size() << "% hit)"
+                  << ((nbHits == nbOccluded) ? "" : " closest and any hit disagree!") << std::endl;
+    }
+
+    // check a few rays against brute force
+    size_t nbErrors = 0;
+    for (size_t r = 0; r < primaryRays.size(); r += primaryRays.size() / 16 + 1)
+    {
+        const Ray& ray = primaryRays[r];
+        float closest = FLT_MAX;
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            glm::vec3 v0 = positions[indices[t]];
+            glm::vec3 e1 = positions[indices[t + 1]] - v0, e2 = positions[indices[t + 2]] - v0;
+            glm::vec3 p = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, p);
+            if (std::abs(det) < 1e-20f)
+                continue;
+            glm::vec3 s = ray.origin - v0;
+            float u = glm::dot(s, p) / det;
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(ray.direction, q) / det;
+            float tHit = glm::dot(e2, q) / det;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && tHit >= 0.0f)
+                closest = std::min(closest, tHit);
+        }
+        RayHit hit;
+        bvh.intersect(ray, hit);
+        if (std::abs(hit.t - closest) > 1e-4f * std::max(1.0f, closest))
+            nbErrors++;
+    }
+    std::cout << "  brute force check: " << ((nbErrors == 0) ? "OK" : std::to_string(nbErrors) + " errors") << std::endl;
+    return 0;
+}
+
+
+/*
+ * Batched ray queries: packets of each supported SIMD width compared to single rays (1 thread), then scaling
+ * from 1 to N threads. _filename can be "torus" to use a procedural mesh (1M vertices, 2M triangles)
+ */
+static int benchRays(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1000, _maxThreads, mesh))
+        return 1;
+
+    std::cout << "[BENCH] Batched rays " << _filename << " (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+
+    MeshBVH bvh;
+    bvh.build(mesh, _maxThreads);
+    std::vector<Ray> primaryRays, randomRays;
+    makeBenchRays(mesh.getVertexView(), primaryRays, randomRays);
+
+    SimdISA defaultISA = getSimdISA();
+    for (int set = 0; set < 2; set++)
+    {
+        const std::vector<Ray>& rays = (set == 0) ? primaryRays : randomRays;
+        double nbRays = (double)rays.size();
+        std::cout << "  " << ((set == 0) ? "primary" : "random") << " rays (" << rays.size() << ")" << std::endl;
+
+        // reference: single-ray traversal
+        std::vector<RayHit> reference(rays.size()), hits(rays.size());
+        std::vector<uint8_t> referenceOccluded(rays.size()), occluded(rays.size());
+        for (size_t r = 0; r < rays.size(); r++)
+        {
+            bvh.intersect(rays[r], reference[r]);
+            referenceOccluded[r] = bvh.occluded(rays[r]) ? 1 : 0;
+        }
+
+        double singleRayRate = 0.0;
+        for (int i = 0; i <= (int)getSupportedSimdISA(); i++)
+        {
+            SimdISA isa = setSimdISA((SimdISA)i);
+            double closestTime = timeBest([&]() { bvh.intersect(rays, hits, 1); });
+            double anyTime = timeBest([&]() { bvh.occluded(rays, occluded, 1); });
+            if (isa == SimdISA::SCALAR)
+                singleRayRate = nbRays / closestTime;
+
+            size_t nbMismatches = 0;
+            for (size_t r = 0; r < rays.size(); r++)
+            {
+                bool mismatch = (hits[r].isHit() != reference[r].isHit()) || (occluded[r] != referenceOccluded[r]);
+                if (!mismatch && hits[r].isHit())
+                    mismatch = std::abs(hits[r].t - reference[r].t) > 1e-5f * std::max(1.0f, reference[r].t);
+                nbMismatches += mismatch ? 1 : 0;
+            }
+
+            std::string name = (isa == SimdISA::SCALAR) ? "single ray" : std::string(getSimdISAName(isa)) + " x" + std::to_string(MeshBVH::getPacketSize());
+            std::cout << "    " << name << std::string(12 - name.size(), ' ') << ": closest hit " << nbRays / (closestTime * 1e3) << " Mrays/s (x"
+                      << (nbRays / closestTime) / singleRayRate << " vs single ray), any hit " << nbRays / (anyTime * 1e3) << " Mrays/s, "
+                      << ((nbMismatches == 0) ? "same hits as single ray" : std::to_string(nbMismatches) + " rays differ from single ray") << std::endl;
+        }
+
+        // scaling of the best packets and of single rays
+        for (int i : { (int)SimdISA::SCALAR, (int)getSupportedSimdISA() })
+        {
+            SimdISA isa = setSimdISA((SimdISA)i);
+            double singleThreadTime = 0.0;
+            // 1, 2, 4, ... threads, and _maxThreads
+            for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+            {
+                double time = timeBest([&]() { bvh.intersect(rays, hits, nbThreads); });
+                if (nbThreads == 1)
+                    singleThreadTime = time;
+                std::cout << "    " << ((isa == SimdISA::SCALAR) ? "single ray" : getSimdISAName(isa)) << " " << nbThreads << "t : "
+                          << nbRays / (time * 1e3) << " Mrays/s, " << nbRays / (time * 1e3) / nbThreads << " Mrays/s per core (speedup x"
+                          << singleThreadTime / time << ")" << std::endl;
+            }
+            if (isa == SimdISA::SCALAR && getSupportedSimdISA() == SimdISA::SCALAR)
+                break;
+        }
+    }
+    setSimdISA(defaultISA);
+    return 0;
+}
+
+
+/*
+ * Meshlet partition (64 vertices / 124 triangles) of the triangles in their input order and after vertex cache
+ * optimization: build time, cluster quality, and ACMR of the reordered triangles.
+ * _filename can be "torus" to use a procedural mesh (1M vertices, 2M triangles)
+ */
+static int benchMeshlets(const std::string& _filename, unsigned _nbThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 1000, _nbThreads, mesh))
+        return 1;
+
+    std::cout << "[BENCH] Meshlets " << _filename << " (" << mesh.getVertexView().size() << " vertices, " << mesh.getIndexView().size() / 3 << " triangles)" << std::endl;
+
+    mesh.computeAABB();
+    float diagonal = glm::length(mesh.getBBoxMax() - mesh.getBBoxMin());
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+            mesh.optimizeVertexCache(16);
+        VertexCacheStats before = simulateVertexCache(mesh.getIndexView(), mesh.getVertexView().size(), 16, VertexCacheModel::FIFO);
+
+        std::vector<uint32_t> indices;
+        std::vector<Meshlet> meshlets;
+        double time = timeBest([&]() { buildMeshlets(mesh.getVertexView(), mesh.getIndexView(), 64, 124, _nbThreads, indices, meshlets); });
+        MeshletStats stats = computeMeshletStats(mesh.getVertexView(), indices, meshlets);
+        VertexCacheStats after = simulateVertexCache(indices, mesh.getVertexView().size(), 16, VertexCacheModel::FIFO);
+        double optimizeTime = timeBest([&]() { optimizeMeshletVertexCache(indices, meshlets, mesh.getVertexView().size(), 16, _nbThreads); });
+        VertexCacheStats optimized = simulateVertexCache(indices, mesh.getVertexView().size(), 16, VertexCacheModel::FIFO);
+        MeshletStats optimizedStats = computeMeshletStats(mesh.getVertexView(), indices, meshlets);
+        bool sameBounds = (optimizedStats.verticesPerTriangle == stats.verticesPerTriangle && optimizedStats.avgRadius == stats.avgRadius);
+
+        std::cout << "  " << ((pass == 0) ? "input order    " : "vcache-ordered ") << ": " << time << " ms ("
+                  << mesh.getIndexView().size() / (3000.0 * time) << " Mtriangles/s), " << stats.nbMeshlets << " meshlets" << std::endl
+                  << "    " << stats.avgVertices << " vertices / " << stats.avgTriangles << " triangles per meshlet, "
+                  << stats.verticesPerTriangle << " vertices per triangle" << std::endl
+                  << "    radius " << stats.avgRadius / diagonal << " x diagonal, compactness " << stats.compactness
+                  << ", usable normal cones " << 100.0f * stats.cullableRatio << "%" << std::endl
+                  << "    FIFO 16 ACMR " << before.acmr << " -> " << after.acmr << " -> " << optimized.acmr
+                  << " after reordering within meshlets (" << optimizeTime << " ms" << (sameBounds ? "" : ", meshlets changed!") << ")" << std::endl;
+    }
+    return 0;
+}
+
+
+/*
+ * Cluster culling (frustum, normal cone, small clusters) of the meshlets of a mesh seen from cameras orbiting around
+ * it: clusters per second for each instruction set and from 1 to N threads, culled ratios, and a check that culled
+ * clusters only hold triangles outside the frustum or facing away.
+ * _filename can be "torus" to use a procedural mesh (4M vertices, 8M triangles)
+ */
+static int benchCulling(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 2000, _maxThreads, mesh))
+        return 1;
+
+    mesh.computeAABB();
+    mesh.buildMeshlets(64, 124, _maxThreads);
+    std::cout << "[BENCH] Cluster culling " << _filename << " (" << mesh.getIndexView().size() / 3 << " triangles, "
+              << mesh.getMeshlets().size() << " meshlets)" << std::endl;
+
+    ClusterCuller culler;
+    culler.setClusters(mesh.getMeshlets());
+    ClusterCullingParams params;
+    params.minPixelRadius = 0.5f;
+
+    // cameras around the mesh, from inside its bounding sphere to 3 radii away
+    const unsigned nbViews = 64;
+    const float viewportHeight = 1080.0f;
+    glm::vec3 center = 0.5f * (mesh.getBBoxMin() + mesh.getBBoxMax());
+    float radius = 0.5f * glm::length(mesh.getBBoxMax() - mesh.getBBoxMin());
+    glm::mat4 modelMat(1.0f);
+    glm::mat4 projMat = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.001f * radius, 10.0f * radius);
+    std::vector<glm::mat4> viewMats(nbViews);
+    for (unsigned v = 0; v < nbViews; v++)
+    {
+        float azimuth = 6.2831853f * (float)v / (float)nbViews, elevation = 0.6f * std::sin(3.0f * azimuth);
+        float distance = radius * (0.5f + 2.5f * (float)(v % 8) / 7.0f);
+        glm::vec3 eye = center + distance * glm::vec3(std::cos(azimuth) * std::cos(elevation), std::sin(elevation), std::sin(azimuth) * std::cos(elevation));
+        viewMats[v] = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    std::vector<std::vector<IndexRange>> reference(nbViews), ranges(nbViews);
+    std::vector<CullingStats> referenceStats(nbViews), stats(nbViews);
+    auto cullAll = [&](unsigned _nbThreads)
+    {
+        for (unsigned v = 0; v < nbViews; v++)
+            culler.cull(modelMat, viewMats[v], projMat, viewportHeight, params, _nbThreads, ranges[v], stats[v]);
+    };
+
+    SimdISA defaultISA = getSimdISA();
+    double nbTests = (double)culler.getNbClusters() * nbViews;
+    double scalarTime = 0.0;
+    for (int i = 0; i <= (int)getSupportedSimdISA(); i++)
+    {
+        SimdISA isa = setSimdISA((SimdISA)i);
+        double time = timeBest([&]() { cullAll(1); });
+        size_t nbMismatches = 0;
+        if (isa == SimdISA::SCALAR)
+        {
+            scalarTime = time;
+            reference = ranges;
+            referenceStats = stats;
+        }
+        for (unsigned v = 0; v < nbViews; v++)
+        {
+            bool same = (ranges[v].size() == reference[v].size()) && (stats[v].nbTrianglesSubmitted == referenceStats[v].nbTrianglesSubmitted);
+            for (size_t r = 0; same && r < ranges[v].size(); r++)
+                same = (ranges[v][r].firstIndex == reference[v][r].firstIndex) && (ranges[v][r].count == reference[v][r].count);
+            nbMismatches += same ? 0 : 1;
+        }
+        std::cout << "  " << getSimdISAName(isa) << std::string(8 - std::string(getSimdISAName(isa)).size(), ' ') << " 1t : "
+                  << nbTests / (time * 1e3) << " Mclusters/s (x" << scalarTime / time << " vs scalar), "
+                  << ((nbMismatches == 0) ? "same ranges as scalar" : std::to_string(nbMismatches) + " views differ from scalar") << std::endl;
+    }
+
+    setSimdISA(getSupportedSimdISA());
+    double singleThreadTime = 0.0;
+    // 1, 2, 4, ... threads, and _maxThreads
+    for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+    {
+        double time = timeBest([&]() { cullAll(nbThreads); });
+        if (nbThreads == 1)
+            singleThreadTime = time;
+        size_t nbMismatches = 0;
+        for (unsigned v = 0; v < nbViews; v++)
+            nbMismatches += (ranges[v].size() == reference[v].size() && stats[v].nbTrianglesSubmitted == referenceStats[v].nbTrianglesSubmitted) ? 0 : 1;
+        std::cout << "  " << getSimdISAName(getSimdISA()) << " " << nbThreads << "t : " << nbTests / (time * 1e3) << " Mclusters/s, "
+                  << time / nbViews << " ms per view (speedup x" << singleThreadTime / time << ")"
+                  << ((nbMismatches == 0) ? "" : ", " + std::to_string(nbMismatches) + " views differ") << std::endl;
+    }
+    setSimdISA(defaultISA);
+
+    CullingStats total;
+    for (const CullingStats& s : referenceStats)
+    {
+        total.nbFrustumCulled += s.nbFrustumCulled;
+        total.nbBackfaceCulled += s.nbBackfaceCulled;
+        total.nbSmallCulled += s.nbSmallCulled;
+        total.nbTrianglesSubmitted += s.nbTrianglesSubmitted;
+        total.nbDraws += s.nbDraws;
+    }
+    std::cout << "  culled (average over " << nbViews << " views): frustum " << 100.0 * total.nbFrustumCulled / nbTests << "%, backface "
+              << 100.0 * total.nbBackfaceCulled / nbTests << "%, small " << 100.0 * total.nbSmallCulled / nbTests << "%, triangles submitted "
+              << 100.0 * total.nbTrianglesSubmitted / ((double)mesh.getIndexView().size() / 3 * nbViews) << "%, "
+              << (double)total.nbDraws / nbViews << " draws per view" << std::endl;
+
+    // conservative tests: triangles of the clusters culled by the frustum or the cone are outside or facing away
+    std::span<const glm::vec3> positions = mesh.getVertexView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+    std::span<const Meshlet> meshlets = mesh.getMeshlets();
+    size_t nbErrors = 0;
+    ClusterCullingParams exactParams;
+    for (unsigned v = 0; v < nbViews; v += 8)
+    {
+        std::vector<IndexRange> visible;
+        CullingStats viewStats;
+        culler.cull(modelMat, viewMats[v], projMat, viewportHeight, exactParams, 1, visible, viewStats);
+        glm::mat4 mvp = projMat * viewMats[v] * modelMat;
+        glm::vec3 eye = glm::vec3(glm::inverse(viewMats[v] * modelMat) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        size_t r = 0;
+        for (const Meshlet& meshlet : meshlets)
+        {
+            while (r < visible.size() && visible[r].firstIndex + visible[r].count <= meshlet.firstIndex)
+                r++;
+            if (r < visible.size() && visible[r].firstIndex <= meshlet.firstIndex)
+                continue;
+            for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + 3 * meshlet.nbTriangles; i += 3)
+            {
+                const glm::vec3& p0 = positions[indices[i]];
+                glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+                bool facingAway = glm::dot(normal, p0 - eye) >= -1e-6f * glm::length(normal) * glm::length(p0 - eye);
+                bool outside = false;
+                glm::vec4 clip[3] = { mvp * glm::vec4(p0, 1.0f), mvp * glm::vec4(positions[indices[i + 1]], 1.0f), mvp * glm::vec4(positions[indices[i + 2]], 1.0f) };
+                for (int a = 0; a < 3 && !outside; a++)
+                {
+                    outside = (clip[0][a] < -clip[0].w && clip[1][a] < -clip[1].w && clip[2][a] < -clip[2].w)
+                           || (clip[0][a] > clip[0].w && clip[1][a] > clip[1].w && clip[2][a] > clip[2].w);
+                }
+                nbErrors += (facingAway || outside) ? 0 : 1;
+            }
+        }
+    }
+    std::cout << "  conservative check: " << ((nbErrors == 0) ? "OK" : std::to_string(nbErrors) + " visible triangles culled") << std::endl;
+    return 0;
+}
+
+
+/*
+ * Exact depth (interpolated at pixel centers, front faces only) of the triangles of a mesh, for the occlusion checks
+ * _func(pixel, depth) is called for each covered pixel
+ */
+template<typename Func>
+static void rasterizeReference(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, const glm::mat4& _mvp,
+                               unsigned _width, unsigned _height, Func&& _func)
+{
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+    {
+        glm::vec3 screen[3];
+        bool nearClipped = false;
+        for (int k = 0; k < 3; k++)
+        {
+            glm::vec4 clip = _mvp * glm::vec4(_positions[_indices[i + k]], 1.0f);
+            nearClipped |= (clip.w <= 0.0f || clip.z < -clip.w);
+            screen[k] = glm::vec3((clip.x / clip.w + 1.0f) * 0.5f * (float)_width, (clip.y / clip.w + 1.0f) * 0.5f * (float)_height, clip.z / clip.w);
+        }
+        float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+        if (nearClipped || !(area > 0.0f))
+            continue;
+        int minX = std::max(0, (int)std::ceil(std::min({ screen[0].x, screen[1].x, screen[2].x }) - 0.5f));
+        int maxX = std::min((int)_width - 1, (int)std::floor(std::max({ screen[0].x, screen[1].x, screen[2].x }) - 0.5f));
+        int minY = std::max(0, (int)std::ceil(std::min({ screen[0].y, screen[1].y, screen[2].y }) - 0.5f));
+        int maxY = std::min((int)_height - 1, (int)std::floor(std::max({ screen[0].y, screen[1].y, screen[2].y }) - 0.5f));
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                glm::vec2 p((float)x + 0.5f, (float)y + 0.5f);
+                float w0 = (screen[2].x - screen[1].x) * (p.y - screen[1].y) - (screen[2].y - screen[1].y) * (p.x - screen[1].x);
+                float w1 = (screen[0].x - screen[2].x) * (p.y - screen[2].y) - (screen[0].y - screen[2].y) * (p.x - screen[2].x);
+                float w2 = (screen[1].x - screen[0].x) * (p.y - screen[0].y) - (screen[1].y - screen[0].y) * (p.x - screen[0].x);
+                if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+                    _func((size_t)y * _width + x, (w0 * screen[0].z + w1 * screen[1].z + w2 * screen[2].z) / area);
+            }
+        }
+    }
+}
+
+
+/*
+ * Software occlusion culling of a grid of instances of a mesh seen from cameras at ground level: the coarsest level
+ * of detail under 4096 triangles of each instance is rasterized in the occlusion buffer, then the meshlets of all the
+ * instances are culled. Rasterization time for each instruction set and from 1 to N threads (with a check that the
+ * depth buffer is always the same), occluded ratio, test time, effect of a short time budget, and a check against the
+ * exact depth of the full-detail scene that occluded clusters cover no visible pixel.
+ * _filename can be "torus" to use a procedural mesh (22500 vertices, 45000 triangles)
+ */
+static int benchOcclusion(const std::string& _filename, unsigned _maxThreads)
+{
+    ProceduralMesh mesh;
+    if (!loadBenchMesh(_filename, 150, _maxThreads, mesh))
+        return 1;
+
+    mesh.computeAABB();
+    mesh.generateLODs({ 0.5f, 0.25f, 0.125f, 0.0625f }, 0.02f, _maxThreads);
+    mesh.buildMeshlets(64, 124, _maxThreads);
+    size_t occluderLevel = 0;
+    while (occluderLevel + 1 < mesh.getNbLODs() && mesh.getLODIndexView(occluderLevel).size() > 3 * 4096)
+        occluderLevel++;
+
+    // instances on a grid, each turned around the vertical axis
+    const unsigned gridSize = 8, nbViews = 8;
+    const unsigned width = 1920, height = 1080;
+    glm::vec3 center = 0.5f * (mesh.getBBoxMin() + mesh.getBBoxMax());
+    float radius = 0.5f * glm::length(mesh.getBBoxMax() - mesh.getBBoxMin());
+    float spacing = 2.5f * radius;
+    std::vector<glm::mat4> modelMats;
+    for (unsigned i = 0; i < gridSize * gridSize; i++)
+    {
+        glm::vec3 position(((float)(i % gridSize) - 0.5f * (float)(gridSize - 1)) * spacing, 0.0f, ((float)(i / gridSize) - 0.5f * (float)(gridSize - 1)) * spacing);
+        glm::mat4 modelMat = glm::translate(glm::mat4(1.0f), position) * glm::rotate(glm::mat4(1.0f), 0.7f * (float)i, glm::vec3(0.0f, 1.0f, 0.0f));
+        modelMats.push_back(glm::translate(modelMat, -center));
+    }
+    std::cout << "[BENCH] Occlusion culling " << _filename << " (" << modelMats.size() << " instances of " << mesh.getIndexView().size() / 3
+              << " triangles / " << mesh.getMeshlets().size() << " meshlets, occluders of " << mesh.getLODIndexView(occluderLevel).size() / 3
+              << " triangles, LOD " << occluderLevel << ")" << std::endl;
+
+    std::vector<glm::vec3> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
+    extractOccluder(mesh.getVertexView(), mesh.getLODIndexView(occluderLevel), occluderPositions, occluderIndices);
+    std::vector<Occluder> occluders;
+    for (const glm::mat4& modelMat : modelMats)
+        occluders.push_back({ occluderPositions, occluderIndices, modelMat, mesh.getLODErrorBound(occluderLevel) });
+
+    // cameras around the grid, slightly above the instances and looking across it
+    float gridRadius = 0.5f * (float)gridSize * spacing;
+    glm::mat4 projMat = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.05f * radius, 4.0f * gridRadius);
+    std::vector<glm::mat4> viewMats(nbViews);
+    for (unsigned v = 0; v < nbViews; v++)
+    {
+        float azimuth = 6.2831853f * ((float)v + 0.3f) / (float)nbViews;
+        glm::vec3 eye = glm::vec3(std::cos(azimuth), 0.0f, std::sin(azimuth)) * (1.1f * gridRadius) + glm::vec3(0.0f, (0.3f + 0.2f * (float)(v % 3)) * radius, 0.0f);
+        viewMats[v] = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    OcclusionBuffer buffer;
+    buffer.resize(OcclusionBuffer::DEFAULT_WIDTH, OcclusionBuffer::DEFAULT_WIDTH * height / width);
+    OcclusionStats stats;
+    std::vector<std::vector<float>> reference(nbViews);
+    auto renderAll = [&](unsigned _nbThreads, float _timeBudget, size_t& _nbMismatches)
+    {
+        _nbMismatches = 0;
+        for (unsigned v = 0; v < nbViews; v++)
+        {
+            buffer.render(occluders, viewMats[v], projMat, _timeBudget, _nbThreads, stats);
+            std::span<const float> depth = buffer.getLevel(0);
+            if (reference[v].empty())
+                reference[v].assign(depth.begin(), depth.end());
+            else
+                _nbMismatches += std::equal(depth.begin(), depth.end(), reference[v].begin()) ? 0 : 1;
+        }
+    };
+
+    SimdISA defaultISA = getSimdISA();
+    double scalarTime = 0.0;
+    size_t nbMismatches = 0;
+    for (int i = 0; i <= (int)getSupportedSimdISA(); i++)
+    {
+        SimdISA isa = setSimdISA((SimdISA)i);
+        double time = timeBest([&]() { renderAll(1, 0.0f, nbMismatches); });
+        if (isa == SimdISA::SCALAR)
+            scalarTime = time;
+        std::cout << "  " << getSimdISAName(isa) << std::string(8 - std::string(getSimdISAName(isa)).size(), ' ') << " 1t : "
+                  << time / nbViews << " ms per view (x" << scalarTime / time << " vs scalar), "
+                  << ((nbMismatches == 0) ? "same depth as scalar" : std::to_string(nbMismatches) + " views differ from scalar") << std::endl;
+    }
+
+    setSimdISA(getSupportedSimdISA());
+    double singleThreadTime = 0.0;
+    // 1, 2, 4, ... threads, and _maxThreads
+    for (unsigned nbThreads = 1; nbThreads <= _maxThreads; nbThreads = (nbThreads == _maxThreads) ? nbThreads + 1 : std::min(nbThreads * 2, _maxThreads))
+    {
+        double time = timeBest([&]() { renderAll(nbThreads, 0.0f, nbMismatches); });
+        if (nbThreads == 1)
+            singleThreadTime = time;
+        std::cout << "  " << getSimdISAName(getSimdISA()) << " " << nbThreads << "t : " << time / nbViews << " ms per view (speedup x"
+                  << singleThreadTime / time << "), " << stats.nbRasterizedTriangles << " / " << stats.nbOccluderTriangles
+                  << " triangles rasterized, " << ((nbMismatches == 0) ? "same depth" : std::to_string(nbMismatches) + " views differ") << std::endl;
+    }
+
+    // culling of all the instances, without and with the occlusion test
+    ClusterCuller culler;
+    culler.setClusters(mesh.getMeshlets());
+    ClusterCullingParams params;
+    std::vector<std::vector<std::vector<IndexRange>>> visible(nbViews, std::vector<std::vector<IndexRange>>(modelMats.size()));
+    CullingStats total, instanceStats;
+    double cullTime = 0.0, occlusionCullTime = 0.0, renderTime = 0.0;
+    std::vector<IndexRange> ranges;
+    for (unsigned v = 0; v < nbViews; v++)
+    {
+        cullTime += timeBest([&]()
+        {
+            for (const glm::mat4& modelMat : modelMats)
+                culler.cull(modelMat, viewMats[v], projMat, (float)height, params, _maxThreads, ranges, instanceStats);
+        });
+        renderTime += timeBest([&]() { buffer.render(occluders, viewMats[v], projMat, 0.0f, _maxThreads, stats); });
+        occlusionCullTime += timeBest([&]()
+        {
+            for (size_t m = 0; m < modelMats.size(); m++)
+                culler.cull(modelMats[m], viewMats[v], projMat, (float)height, params, _maxThreads, visible[v][m], instanceStats, &buffer);
+        });
+        for (size_t m = 0; m < modelMats.size(); m++)
+        {
+            culler.cull(modelMats[m], viewMats[v], projMat, (float)height, params, _maxThreads, visible[v][m], instanceStats, &buffer);
+            total.nbTested += instanceStats.nbTested;
+            total.nbFrustumCulled += instanceStats.nbFrustumCulled;
+            total.nbBackfaceCulled += instanceStats.nbBackfaceCulled;
+            total.nbOccludedCulled += instanceStats.nbOccludedCulled;
+            total.nbTrianglesSubmitted += instanceStats.nbTrianglesSubmitted;
+        }
+    }
+    size_t nbRemaining = total.nbTested - total.nbFrustumCulled - total.nbBackfaceCulled;
+    std::cout << "  clusters (average over " << nbViews << " views): frustum " << 100.0 * total.nbFrustumCulled / total.nbTested << "%, backface "
+              << 100.0 * total.nbBackfaceCulled / total.nbTested << "%, occluded " << 100.0 * total.nbOccludedCulled / total.nbTested << "% ("
+              << 100.0 * total.nbOccludedCulled / std::max<size_t>(nbRemaining, 1) << "% of the clusters passing the other tests), triangles submitted "
+              << 100.0 * total.nbTrianglesSubmitted / ((double)mesh.getIndexView().size() / 3 * modelMats.size() * nbViews) << "%" << std::endl;
+    std::cout << "  time per view: occluders " << renderTime / nbViews << " ms (pyramid " << stats.pyramidTime << " ms), cluster tests "
+              << cullTime / nbViews << " ms without occlusion, " << occlusionCullTime / nbViews << " ms with occlusion" << std::endl;
+
+    // time budget: triangles not binned and tiles not rasterized in time occlude nothing, so that a buffer rendered
+    // within a budget never occludes more than the complete one
+    std::vector<std::vector<size_t>> submitted(nbViews, std::vector<size_t>(modelMats.size()));
+    for (unsigned v = 0; v < nbViews; v++)
+    {
+        for (size_t m = 0; m < modelMats.size(); m++)
+        {
+            for (const IndexRange& range : visible[v][m])
+                submitted[v][m] += range.count / 3;
+        }
+    }
+    for (float budget : { 2.0f, 1.0f, 0.1f })
+    {
+        size_t nbSkippedTriangles = 0, nbSkippedTiles = 0, nbOccluded = 0, nbErrors = 0;
+        double time = 0.0;
+        for (unsigned v = 0; v < nbViews; v++)
+        {
+            buffer.render(occluders, viewMats[v], projMat, budget, _maxThreads, stats);
+            time += stats.rasterTime + stats.pyramidTime;
+            nbSkippedTriangles += stats.nbSkippedTriangles;
+            nbSkippedTiles += stats.nbSkippedTiles;
+            for (size_t m = 0; m < modelMats.size(); m++)
+            {
+                culler.cull(modelMats[m], viewMats[v], projMat, (float)height, params, _maxThreads, ranges, instanceStats, &buffer);
+                nbOccluded += instanceStats.nbOccludedCulled;
+                nbErrors += (instanceStats.nbTrianglesSubmitted < submitted[v][m]) ? 1 : 0;
+            }
+        }
+        std::cout << "  budget " << budget << " ms: " << time / nbViews << " ms per view, " << 100.0 * nbSkippedTriangles / ((double)stats.nbOccluderTriangles * nbViews)
+                  << "% triangles and " << 100.0 * nbSkippedTiles / ((double)stats.nbTiles * nbViews) << "% tiles skipped, occluded "
+                  << 100.0 * nbOccluded / total.nbTested << "%" << ((nbErrors == 0) ? "" : ", " + std::to_string(nbErrors) + " instances with more culled triangles than without budget") << std::endl;
+    }
+    setSimdISA(defaultISA);
+
+    // conservative check: pixels of the exact full-detail scene (at 4x the occlusion resolution) drawn by occluded clusters
+    const unsigned checkWidth = 4 * buffer.getWidth(), checkHeight = 4 * buffer.getHeight();
+    std::span<const glm::vec3> positions = mesh.getVertexView();
+    std::span<const uint32_t> indices = mesh.getIndexView();
+    std::span<const Meshlet> meshlets = mesh.getMeshlets();
+    size_t nbVisiblePixels = 0, nbLostPixels = 0;
+    for (unsigned v = 0; v < nbViews; v++)
+    {
+        std::vector<float> depth((size_t)checkWidth * checkHeight, FLT_MAX);
+        for (const glm::mat4& modelMat : modelMats)
+            rasterizeReference(positions, indices, projMat * viewMats[v] * modelMat, checkWidth, checkHeight, [&](size_t _pixel, float _z) { depth[_pixel] = std::min(depth[_pixel], _z); });
+        std::vector<uint8_t> lost(depth.size(), 0);
+        for (size_t m = 0; m < modelMats.size(); m++)
+        {
+            glm::mat4 mvp = projMat * viewMats[v] * modelMats[m];
+            const std::vector<IndexRange>& visibleRanges = visible[v][m];
+            size_t r = 0;
+            for (const Meshlet& meshlet : meshlets)
+            {
+                while (r < visibleRanges.size() && visibleRanges[r].firstIndex + visibleRanges[r].count <= meshlet.firstIndex)
+                    r++;
+                if (r < visibleRanges.size() && visibleRanges[r].firstIndex <= meshlet.firstIndex)
+                    continue;
+                rasterizeReference(positions, indices.subspan(meshlet.firstIndex, 3 * meshlet.nbTriangles), mvp, checkWidth, checkHeight,
+                                   [&](size_t _pixel, float _z) { lost[_pixel] |= (_z <= depth[_pixel]) ? 1 : 0; });
+            }
+        }
+        for (size_t p = 0; p < depth.size(); p++)
+        {
+            nbVisiblePixels += (depth[p] < FLT_MAX) ? 1 : 0;
+            nbLostPixels += lost[p];
+        }
+    }
+    std::cout << "  conservative check: " << ((nbLostPixels == 0) ? "OK" : std::to_string(nbLostPixels) + " visible pixels culled")
+              << " (" << nbVisiblePixels << " visible pixels at " << checkWidth << "x" << checkHeight << ")" << std::endl;
+    return (nbLostPixels == 0) ? 0 : 1;
+}
+
+
+/*
+ * Allocator of the geometry arena: churn of mesh-sized ranges (allocation and release at a steady occupancy), then
+ * compaction
+ */
+static int benchArena(size_t _nbOperations)
+{
+    const uint32_t capacity = 1u << 24, minSize = 16, maxSize = 1u << 16;
+    const double occupancy = 0.75;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> logSize(std::log((double)minSize), std::log((double)maxSize));
+    auto randomSize = [&]() { return (uint32_t)std::exp(logSize(rng)); };
+
+    RangeAllocator allocator;
+    allocator.reset(capacity);
+    std::vector<uint32_t> live;
+    while (allocator.getUsed() < occupancy * capacity)
+        live.push_back(allocator.allocate(randomSize()));
+
+    // random releases and allocations around the target occupancy
+    size_t nbAllocations = 0, nbFrees = 0, nbFailures = 0, nbFragmentationFailures = 0;
+    double allocateTime = 0.0, freeTime = 0.0, fragmentation = 0.0;
+    for (size_t i = 0; i < _nbOperations; i++)
+    {
+        if (allocator.getUsed() > occupancy * capacity && !live.empty())
+        {
+            size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+            auto startTime = std::chrono::steady_clock::now();
+            allocator.free(live[index]);
+            freeTime += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+            live[index] = live.back();
+            live.pop_back();
+            nbFrees++;
+        }
+        else
+        {
+            uint32_t size = randomSize();
+            auto startTime = std::chrono::steady_clock::now();
+            uint32_t offset = allocator.allocate(size);
+            allocateTime += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+            nbAllocations++;
+            if (offset != RangeAllocator::INVALID_OFFSET)
+                live.push_back(offset);
+            else
+            {
+                nbFailures++;
+                nbFragmentationFailures += (allocator.getFree() >= size) ? 1 : 0;
+            }
+        }
+        fragmentation += allocator.getFragmentation();
+    }
+
+    std::cout << "[BENCH] Geometry arena allocator (" << capacity << " elements, ranges of " << minSize << " to " << maxSize << ", "
+              << 100.0 * occupancy << "% occupancy, " << _nbOperations << " operations)" << std::endl;
+    std::cout << "  allocate: " << allocateTime / std::max(nbAllocations, (size_t)1) << " ns, free: " << freeTime / std::max(nbFrees, (size_t)1)
+              << " ns per operation" << std::endl
+              << "  " << live.size() << " allocations, " << allocator.getNbFreeBlocks() << " free blocks (largest " << allocator.getLargestFreeBlock()
+              << " / " << allocator.getFree() << " free), fragmentation " << 100.0 * allocator.getFragmentation() << "% (mean "
+              << 100.0 * fragmentation / std::max(_nbOperations, (size_t)1) << "%)" << std::endl
+              << "  failed allocations: " << nbFailures << ", " << nbFragmentationFailures << " with enough free space" << std::endl;
+
+    // compaction: relocations in increasing order, towards lower offsets, sizes kept
+    std::vector<std::pair<uint32_t, uint32_t>> before;
+    for (uint32_t offset : live)
+        before.push_back({ offset, allocator.getSize(offset) });
+    std::sort(before.begin(), before.end());
+
+    std::vector<Relocation> relocations;
+    auto startTime = std::chrono::steady_clock::now();
+    allocator.compact(relocations);
+    double compactTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    size_t nbMoved = 0, nbErrors = 0;
+    uint32_t expected = 0;
+    size_t r = 0;
+    for (const auto& [offset, size] : before)
+    {
+        uint32_t newOffset = offset;
+        if (r < relocations.size() && relocations[r].oldOffset == offset)
+        {
+            nbErrors += (relocations[r].newOffset >= offset || relocations[r].size != size) ? 1 : 0;
+            newOffset = relocations[r++].newOffset;
+            nbMoved += size;
+        }
+        nbErrors += (newOffset != expected || allocator.getSize(newOffset) != size) ? 1 : 0;
+        expected += size;
+    }
+    nbErrors += (r != relocations.size() || allocator.getNbFreeBlocks() > 1 || allocator.getFragmentation() != 0.0f) ? 1 : 0;
+    std::cout << "  compaction: " << compactTime << " ms, " << relocations.size() << " ranges moved (" << nbMoved << " elements, "
+              << 100.0 * nbMoved / std::max(allocator.getUsed(), 1u) << "% of used space), " << ((nbErrors == 0) ? "OK" : std::to_string(nbErrors) + " errors")
+              << std::endl;
+    return (nbErrors == 0) ? 0 : 1;
+}
+
+
+int runBenchmark(int _argc, char** _argv)
+{
+    std::string name = (_argc > 0) ? _argv[0] : "";
+    unsigned maxThreads = getNbThreads(0);
+
+    if (name == "obj" && _argc > 1)
+    {
+        if (_argc > 2)
+            maxThreads = (unsigned)std::stoi(_argv[2]);
+        return benchOBJ(_argv[1], maxThreads);
+    }
+    if (name == "import" && _argc > 1)
+        return benchImport(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : 1);
+    if (name == "cache" && _argc > 1)
+        return benchCache(_argv[1]);
+    if (name == "memory")
+        return benchMemory((_argc > 1) ? (size_t)std::stoull(_argv[1]) : 10000000);
+    if (name == "layout")
+        return benchLayouts((_argc > 1) ? (size_t)std::stoull(_argv[1]) : 4000000);
+    if (name == "simd")
+        return benchSimd((_argc > 1) ? (size_t)std::stoull(_argv[1]) : 4000000);
+    if (name == "normals")
+        return benchNormals((_argc > 1) ? (size_t)std::stoull(_argv[1]) : 4000000, (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "vcache" && _argc > 1)
+        return benchVertexCache(_argv[1]);
+    if (name == "spatial" && _argc > 1)
+        return benchSpatialSort(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "halfedge" && _argc > 1)
+        return benchHalfEdges(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "lod" && _argc > 1)
+        return benchLODs(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "lodselect")
+        return benchLODSelect();
+    if (name == "bvh" && _argc > 1)
+        return benchBVH(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "rays" && _argc > 1)
+        return benchRays(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "meshlets" && _argc > 1)
+        return benchMeshlets(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "cull" && _argc > 1)
+        return benchCulling(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "occlusion" && _argc > 1)
+        return benchOcclusion(_argv[1], (_argc > 2) ? (unsigned)std::stoi(_argv[2]) : maxThreads);
+    if (name == "arena")
+        return benchArena((_argc > 1) ? (size_t)std::stoull(_argv[1]) : 1000000);
+    if (name == "codec" && _argc > 1)
+        return benchCodec(_argv[1], (_argc > 2) ? std::stof(_argv[2]) : 0.0f);
+
+    std::cerr << "Usage: OpenGL_demo --bench <name> [args]" << std::endl
+              << "  obj <file.obj> [maxThreads] : OBJ import (legacy / single-pass / parallel)" << std::endl
+              << "  import <file> [nbThreads] : import throughput of any supported format" << std::endl
+              << "  cache <file> : cold parse vs binary cache reload" << std::endl
+              << "  memory [nbVertices] : peak memory of mesh upload (copies vs views)" << std::endl
+              << "  layout [nbVertices] : vertex storage layouts (arrays / AoS / SoA) on AABB, normals and upload" << std::endl
+              << "  simd [nbVertices] : SIMD AABB / normals kernels for each instruction set" << std::endl
+              << "  normals [nbVertices] [maxThreads] : parallel normals (area / angle weighting) with 1 to N threads" << std::endl
+              << "  vcache <file|torus> : vertex cache optimization (simulated ACMR / ATVR)" << std::endl
+              << "  spatial <file|torus> [nbThreads] : Morton-order sort (cache misses, normals and one-ring queries)" << std::endl
+              << "  halfedge <file|torus|fan> [maxThreads] : half-edge construction with 1 to N threads" << std::endl
+              << "  lod <file|torus> [maxThreads] : quadric simplification of a LOD chain with 1 to N threads" << std::endl
+              << "  lodselect : level of detail selection checks (projected errors, hysteresis, perspective / ortho)" << std::endl
+              << "  bvh <file|torus> [maxThreads] : SAH BVH build with 1 to N threads, closest / any hit rays per second" << std::endl
+              << "  rays <file|torus> [maxThreads] : batched ray queries, SIMD packets vs single rays, 1 to N threads" << std::endl
+              << "  meshlets <file|torus> [nbThreads] : meshlet partition (build time, cluster size and bounds, ACMR)" << std::endl
+              << "  cull <file|torus> [maxThreads] : meshlet culling (frustum / cone / small) per instruction set, 1 to N threads" << std::endl
+              << "  occlusion <file|torus> [maxThreads] : software occlusion culling (occluder rasterization, occluded ratio, budget)" << std::endl
+              << "  arena [nbOperations] : geometry arena allocator (allocate / free time, fragmentation, compaction)" << std::endl
+              << "  codec <file|torus> [maxError] : compressed mesh format (ratio, speed, error)" << std::endl;
+    return 1;
+}
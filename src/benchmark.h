@@ -0,0 +1,26 @@
+/*********************************************************************************************************************
+ *
+ * benchmark.h
+ *
+ * Headless CPU benchmarks (run with: OpenGL_demo --bench <name> [args])
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+/*!
+* \fn runBenchmark
+* \brief run a benchmark selected from the command line, without creating any window
+* \param _argc : number of arguments (after "--bench")
+* \param _argv : arguments (after "--bench"), the first one is the benchmark name
+* \return exit code
+*/
+int runBenchmark(int _argc, char** _argv);
+
+
+#endif // BENCHMARK_H
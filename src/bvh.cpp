@@ -0,0 +1,679 @@
+/*********************************************************************************************************************
+ *
+ * bvh.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "bvh.h"
+#include "trimesh.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+static const unsigned MAX_SAH_DEPTH = 64;      // nodes deeper than this are split in halves (tree depth <= 64 + 32)
+static_assert(MeshBVH::MAX_STACK_SIZE >= MAX_SAH_DEPTH + 32, "traversal stack is smaller than the max tree depth");
+
+
+/*
+ * Axis-aligned bounding box
+ */
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& _p) { min = glm::min(min, _p); max = glm::max(max, _p); }
+    void grow(const AABB& _b) { min = glm::min(min, _b.min); max = glm::max(max, _b.max); }
+    float halfArea() const
+    {
+        if (min.x > max.x)
+            return 0.0f;
+        glm::vec3 d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+
+/*
+ * SAH bins of the 3 axes (triangles are binned by centroid), fewer bins for small nodes
+ */
+struct Bins
+{
+    unsigned nbBins;
+    AABB bounds[3][MeshBVH::NB_BINS];
+    uint32_t counts[3][MeshBVH::NB_BINS] = {};
+
+    explicit Bins(uint32_t _nbTriangles) : nbBins(std::clamp(_nbTriangles, 4u, MeshBVH::NB_BINS)) {}
+
+    void merge(const Bins& _other)
+    {
+        for (int a = 0; a < 3; a++)
+            for (unsigned b = 0; b < nbBins; b++)
+            {
+                bounds[a][b].grow(_other.bounds[a][b]);
+                counts[a][b] += _other.counts[a][b];
+            }
+    }
+};
+
+
+/*
+ * Node waiting to be split: range of triangles in the working order, and bounds
+ */
+struct BuildNode
+{
+    uint32_t node = 0;      // index of the node (in the node array being filled)
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t depth = 0;
+    AABB bounds;
+    AABB centroids;
+};
+
+
+/*
+ * Split plane chosen by SAH (bin boundary after splitBin on axis)
+ */
+struct Split
+{
+    int axis = -1;
+    unsigned nbBins = 0;
+    unsigned splitBin = 0;
+    float cost = FLT_MAX;
+    AABB bounds[2];
+    AABB centroids[2];
+    uint32_t counts[2] = { 0, 0 };
+};
+
+
+/*
+ * Per-triangle data shared by all build steps
+ */
+struct BuildContext
+{
+    std::vector<AABB> triBounds;
+    std::vector<glm::vec3> triCentroids;
+    std::vector<uint32_t> ids;              // triangles in working order (leaf order once built)
+};
+
+
+// bin of a centroid along an axis (same expression for binning and partitioning)
+static inline unsigned binOf(const glm::vec3& _c, int _axis, const AABB& _centroids, float _scale, unsigned _nbBins)
+{
+    int b = (int)((_c[_axis] - _centroids.min[_axis]) * _scale);
+    return (unsigned)std::clamp(b, 0, (int)_nbBins - 1);
+}
+
+
+static inline glm::vec3 binScales(const AABB& _centroids, unsigned _nbBins)
+{
+    glm::vec3 extent = _centroids.max - _centroids.min;
+    glm::vec3 scale;
+    for (int a = 0; a < 3; a++)
+        scale[a] = (extent[a] > 0.0f) ? (float)_nbBins / extent[a] : 0.0f;
+    return scale;
+}
+
+
+static void binTriangles(const BuildContext& _ctx, size_t _begin, size_t _end, const AABB& _centroids, Bins& _bins)
+{
+    glm::vec3 scale = binScales(_centroids, _bins.nbBins);
+    for (size_t i = _begin; i < _end; i++)
+    {
+        uint32_t t = _ctx.ids[i];
+        const glm::vec3& c = _ctx.triCentroids[t];
+        for (int a = 0; a < 3; a++)
+        {
+            unsigned b = binOf(c, a, _centroids, scale[a], _bins.nbBins);
+            _bins.bounds[a][b].grow(_ctx.triBounds[t]);
+            _bins.counts[a][b]++;
+        }
+    }
+}
+
+
+// best bin boundary, with cost = sum of (half area x number of triangles) of both sides
+static Split findBestSplit(const Bins& _bins, const AABB& _centroids)
+{
+    Split best;
+    best.nbBins = _bins.nbBins;
+    glm::vec3 extent = _centroids.max - _centroids.min;
+    for (int a = 0; a < 3; a++)
+    {
+        if (!(extent[a] > 0.0f))
+            continue;
+
+        // sweep from the right to get the cost of the right sides
+        float rightCosts[MeshBVH::NB_BINS];
+        AABB right;
+        uint32_t rightCount = 0;
+        for (unsigned b = _bins.nbBins - 1; b > 0; b--)
+        {
+            right.grow(_bins.bounds[a][b]);
+            rightCount += _bins.counts[a][b];
+            rightCosts[b - 1] = (rightCount > 0) ? right.halfArea() * (float)rightCount : -1.0f;
+        }
+
+        AABB left;
+        uint32_t leftCount = 0;
+        for (unsigned b = 0; b + 1 < _bins.nbBins; b++)
+        {
+            left.grow(_bins.bounds[a][b]);
+            leftCount += _bins.counts[a][b];
+            if (leftCount == 0 || rightCosts[b] < 0.0f)
+                continue;
+
+            float cost = left.halfArea() * (float)leftCount + rightCosts[b];
+            if (cost < best.cost)
+            {
+                best.cost = cost;
+                best.axis = a;
+                best.splitBin = b;
+            }
+        }
+    }
+
+    // bounds of both sides (centroid bounds are computed while partitioning)
+    if (best.axis >= 0)
+    {
+        for (unsigned b = 0; b < _bins.nbBins; b++)
+        {
+            int side = (b <= best.splitBin) ? 0 : 1;
+            best.bounds[side].grow(_bins.bounds[best.axis][b]);
+            best.counts[side] += _bins.counts[best.axis][b];
+        }
+    }
+    return best;
+}
+
+
+// bounds of both halves of a range (fallback split when all centroids are equal)
+static void splitMedian(const BuildContext& _ctx, const BuildNode& _node, Split& _split)
+{
+    _split.counts[0] = _node.count / 2;
+    _split.counts[1] = _node.count - _split.counts[0];
+    for (int side = 0; side < 2; side++)
+    {
+        uint32_t begin = _node.first + side * _split.counts[0];
+        for (uint32_t i = begin; i < begin + _split.counts[side]; i++)
+        {
+            _split.bounds[side].grow(_ctx.triBounds[_ctx.ids[i]]);
+            _split.centroids[side].grow(_ctx.triCentroids[_ctx.ids[i]]);
+        }
+    }
+}
+
+
+static BVHNode makeLeaf(const BuildNode& _node)
+{
+    return BVHNode{ _node.bounds.min, _node.first, _node.bounds.max, _node.count };
+}
+
+
+/*
+ * Build the subtree of a node with a single thread, into a local node array (root at index 0)
+ */
+static void buildSubtree(BuildContext& _ctx, const BuildNode& _root, std::vector<BVHNode>& _nodes)
+{
+    _nodes.clear();
+    _nodes.push_back(BVHNode{});
+
+    std::vector<BuildNode> stack;
+    stack.push_back(_root);
+    stack.back().node = 0;
+
+    while (!stack.empty())
+    {
+        BuildNode node = stack.back();
+        stack.pop_back();
+
+        Split split;
+        if (node.count > 1 && node.depth < MAX_SAH_DEPTH)
+        {
+            Bins bins(node.count);
+            binTriangles(_ctx, node.first, node.first + node.count, node.centroids, bins);
+            split = findBestSplit(bins, node.centroids);
+        }
+
+        // leaf if splitting does not pay off (traversal cost = 1 triangle test)
+        float leafCost = node.bounds.halfArea() * (float)node.count;
+        float splitCost = node.bounds.halfArea() + split.cost;
+        if (node.count == 1 || (node.count <= MeshBVH::MAX_LEAF_SIZE && leafCost <= splitCost))
+        {
+            _nodes[node.node] = makeLeaf(node);
+            continue;
+        }
+
+        if (split.axis >= 0)
+        {
+            float scale = binScales(node.centroids, split.nbBins)[split.axis];
+            uint32_t* left = _ctx.ids.data() + node.first;
+            uint32_t* right = left + node.count;
+            while (left < right)
+            {
+                const glm::vec3& c = _ctx.triCentroids[*left];
+                if (binOf(c, split.axis, node.centroids, scale, split.nbBins) <= split.splitBin)
+                {
+                    split.centroids[0].grow(c);
+                    left++;
+                }
+                else
+                {
+                    split.centroids[1].grow(c);
+                    std::swap(*left, *--right);
+                }
+            }
+        }
+        else
+        {
+            splitMedian(_ctx, node, split);
+        }
+
+        uint32_t left = (uint32_t)_nodes.size();
+        _nodes[node.node] = BVHNode{ node.bounds.min, left, node.bounds.max, 0 };
+        _nodes.resize(_nodes.size() + 2);
+
+        // push right first, so that the left child is split first (depth-first order)
+        for (int side = 1; side >= 0; side--)
+        {
+            BuildNode child;
+            child.node = left + side;
+            child.first = node.first + ((side == 0) ? 0 : split.counts[0]);
+            child.count = split.counts[side];
+            child.depth = node.depth + 1;
+            child.bounds = split.bounds[side];
+            child.centroids = split.centroids[side];
+            stack.push_back(child);
+        }
+    }
+}
+
+
+/*
+ * Split a large node using all threads: binning and stable partition are both done per block, then merged in block
+ * order, so the result is the same as with a single thread
+ */
+static void splitLargeNode(BuildContext& _ctx, const BuildNode& _node, Split& _split, std::vector<uint32_t>& _scratch, unsigned _nbThreads)
+{
+    unsigned nbBlocks = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), _node.count);
+
+    std::vector<Bins> blockBins(nbBlocks, Bins(_node.count));
+    parallelFor(_node.first, _node.first + _node.count, nbBlocks, [&](size_t _begin, size_t _end, unsigned _block)
+    {
+        binTriangles(_ctx, _begin, _end, _node.centroids, blockBins[_block]);
+    });
+    for (unsigned b = 1; b < nbBlocks; b++)
+        blockBins[0].merge(blockBins[b]);
+    _split = findBestSplit(blockBins[0], _node.centroids);
+
+    if (_split.axis < 0)
+    {
+        splitMedian(_ctx, _node, _split);
+        return;
+    }
+
+    // stable partition: count the left side of each block, then scatter
+    float scale = binScales(_node.centroids, _split.nbBins)[_split.axis];
+    auto isLeft = [&](uint32_t _t) { return binOf(_ctx.triCentroids[_t], _split.axis, _node.centroids, scale, _split.nbBins) <= _split.splitBin; };
+
+    std::vector<uint32_t> blockLeft(nbBlocks + 1, 0), blockBegin(nbBlocks + 1, 0);
+    std::vector<AABB> blockCentroids(2 * nbBlocks);
+    parallelFor(_node.first, _node.first + _node.count, nbBlocks, [&](size_t _begin, size_t _end, unsigned _block)
+    {
+        uint32_t n = 0;
+        for (size_t i = _begin; i < _end; i++)
+        {
+            bool left = isLeft(_ctx.ids[i]);
+            blockCentroids[2 * _block + (left ? 0 : 1)].grow(_ctx.triCentroids[_ctx.ids[i]]);
+            n += left ? 1 : 0;
+        }
+        blockLeft[_block + 1] = n;
+        blockBegin[_block + 1] = (uint32_t)(_end - _begin);
+    });
+    for (unsigned b = 0; b < nbBlocks; b++)
+    {
+        blockLeft[b + 1] += blockLeft[b];
+        blockBegin[b + 1] += blockBegin[b];
+        _split.centroids[0].grow(blockCentroids[2 * b]);
+        _split.centroids[1].grow(blockCentroids[2 * b + 1]);
+    }
+
+    _scratch.resize(_node.count);
+    parallelFor(_node.first, _node.first + _node.count, nbBlocks, [&](size_t _begin, size_t _end, unsigned _block)
+    {
+        uint32_t l = blockLeft[_block];
+        uint32_t r = blockLeft[nbBlocks] + (blockBegin[_block] - blockLeft[_block]);
+        for (size_t i = _begin; i < _end; i++)
+        {
+            uint32_t t = _ctx.ids[i];
+            _scratch[isLeft(t) ? l++ : r++] = t;
+        }
+    });
+    std::copy(_scratch.begin(), _scratch.end(), _ctx.ids.begin() + _node.first);
+}
+
+
+
+/*------------------------------------------------------------------------------------------------------------+
+|                                              GETTERS/SETTERS                                                |
++-------------------------------------------------------------------------------------------------------------*/
+
+float MeshBVH::computeSAHCost() const
+{
+    if (m_nodes.empty())
+        return 0.0f;
+
+    auto halfArea = [](const BVHNode& _n)
+    {
+        glm::vec3 d = _n.bBoxMax - _n.bBoxMin;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    };
+
+    double cost = 0.0;
+    for (const BVHNode& node : m_nodes)
+        cost += (double)halfArea(node) * (node.isLeaf() ? (double)node.count : 1.0);
+
+    double rootArea = halfArea(m_nodes[0]);
+    return (rootArea > 0.0) ? (float)(cost / rootArea) : 0.0f;
+}
+
+
+
+/*------------------------------------------------------------------------------------------------------------+
+|                                               OTHER METHODS                                                 |
++-------------------------------------------------------------------------------------------------------------*/
+
+void MeshBVH::build(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, unsigned _nbThreads)
+{
+    clear();
+    m_positions = _positions;
+    m_sourceIndices = _indices;
+
+    size_t nbTriangles = _indices.size() / 3;
+    if (nbTriangles == 0)
+        return;
+
+    BuildContext ctx;
+    ctx.triBounds.resize(nbTriangles);
+    ctx.triCentroids.resize(nbTriangles);
+    ctx.ids.resize(nbTriangles);
+
+    // bounds and centroid of each triangle, and of the root
+    unsigned nbBlocks = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), nbTriangles);
+    std::vector<BuildNode> blockRoots(nbBlocks);
+    parallelFor(0, nbTriangles, nbBlocks, [&](size_t _begin, size_t _end, unsigned _block)
+    {
+        BuildNode& root = blockRoots[_block];
+        for (size_t t = _begin; t < _end; t++)
+        {
+            AABB b;
+            b.grow(_positions[_indices[3 * t]]);
+            b.grow(_positions[_indices[3 * t + 1]]);
+            b.grow(_positions[_indices[3 * t + 2]]);
+            ctx.triBounds[t] = b;
+            ctx.triCentroids[t] = (b.min + b.max) * 0.5f;
+            ctx.ids[t] = (uint32_t)t;
+            root.bounds.grow(b);
+            root.centroids.grow(ctx.triCentroids[t]);
+        }
+    });
+    BuildNode root;
+    root.count = (uint32_t)nbTriangles;
+    for (const BuildNode& b : blockRoots)
+    {
+        root.bounds.grow(b.bounds);
+        root.centroids.grow(b.centroids);
+    }
+
+    // split the top of the tree with all threads, until nodes are small enough to be built by a single thread
+    m_nodes.reserve(2 * nbTriangles);
+    m_nodes.push_back(BVHNode{});
+    std::vector<BuildNode> subtrees;
+    std::vector<BuildNode> largeNodes = { root };
+    std::vector<uint32_t> scratch;
+    while (!largeNodes.empty())
+    {
+        BuildNode node = largeNodes.back();
+        largeNodes.pop_back();
+        if (node.count <= SUBTREE_SIZE)
+        {
+            subtrees.push_back(node);
+            continue;
+        }
+
+        Split split;
+        if (node.depth < MAX_SAH_DEPTH)
+            splitLargeNode(ctx, node, split, scratch, _nbThreads);
+        else
+            splitMedian(ctx, node, split);
+
+        uint32_t left = (uint32_t)m_nodes.size();
+        m_nodes[node.node] = BVHNode{ node.bounds.min, left, node.bounds.max, 0 };
+        m_nodes.resize(m_nodes.size() + 2);
+        for (int side = 1; side >= 0; side--)
+        {
+            BuildNode child;
+            child.node = left + side;
+            child.first = node.first + ((side == 0) ? 0 : split.counts[0]);
+            child.count = split.counts[side];
+            child.depth = node.depth + 1;
+            child.bounds = split.bounds[side];
+            child.centroids = split.centroids[side];
+            largeNodes.push_back(child);
+        }
+    }
+
+    // build subtrees concurrently, then append them in order
+    std::vector<std::vector<BVHNode>> subtreeNodes(subtrees.size());
+    parallelFor(0, subtrees.size(), _nbThreads, [&](size_t _begin, size_t _end, unsigned)
+    {
+        for (size_t s = _begin; s < _end; s++)
+            buildSubtree(ctx, subtrees[s], subtreeNodes[s]);
+    });
+    for (size_t s = 0; s < subtrees.size(); s++)
+    {
+        const std::vector<BVHNode>& nodes = subtreeNodes[s];
+        uint32_t offset = (uint32_t)m_nodes.size() - 1;     // local node i (i > 0) goes to offset + i
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            BVHNode node = nodes[i];
+            if (!node.isLeaf())
+                node.leftFirst += offset;
+            if (i == 0)
+                m_nodes[subtrees[s].node] = node;
+            else
+                m_nodes.push_back(node);
+        }
+    }
+    m_nodes.shrink_to_fit();
+
+    // triangles in leaf order
+    m_triangleIds = std::move(ctx.ids);
+    m_indices.resize(3 * nbTriangles);
+    parallelFor(0, nbTriangles, _nbThreads, [&](size_t _begin, size_t _end, unsigned)
+    {
+        for (size_t i = _begin; i < _end; i++)
+            for (int k = 0; k < 3; k++)
+                m_indices[3 * i + k] = _indices[3 * m_triangleIds[i] + k];
+    });
+}
+
+
+void MeshBVH::build(const TriMesh& _triMesh, unsigned _nbThreads)
+{
+    build(_triMesh.getVertexView(), _triMesh.getIndexView(), _nbThreads);
+}
+
+
+void MeshBVH::clear()
+{
+    m_positions = {};
+    m_sourceIndices = {};
+    m_nodes.clear();
+    m_indices.clear();
+    m_triangleIds.clear();
+}
+
+
+template<bool AnyHit>
+bool MeshBVH::traverse(const Ray& _ray, RayHit& _hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    // avoid 0 * inf = NaN in the slab test when the origin lies on a box plane
+    glm::vec3 invDir;
+    for (int a = 0; a < 3; a++)
+    {
+        float d = _ray.direction[a];
+        if (std::abs(d) < 1e-30f)
+            d = std::copysign(1e-30f, d);
+        invDir[a] = 1.0f / d;
+    }
+
+    float tMax = std::min(_ray.tMax, _hit.t);
+    bool hit = false;
+
+    // entry distance of a ray in a box (FLT_MAX if missed)
+    auto intersectBox = [&](const BVHNode& _node)
+    {
+        glm::vec3 t0 = (_node.bBoxMin - _ray.origin) * invDir;
+        glm::vec3 t1 = (_node.bBoxMax - _ray.origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float tEnter = std::max({ tNear.x, tNear.y, tNear.z, _ray.tMin });
+        float tExit = std::min({ tFar.x, tFar.y, tFar.z, tMax });
+        return (tEnter <= tExit) ? tEnter : FLT_MAX;
+    };
+
+    uint32_t stack[MeshBVH::MAX_STACK_SIZE];
+    unsigned stackSize = 0;
+    const BVHNode* node = &m_nodes[0];
+    if (intersectBox(*node) == FLT_MAX)
+        return false;
+
+    while (true)
+    {
+        if (node->isLeaf())
+        {
+            for (uint32_t i = node->leftFirst; i < node->leftFirst + node->count; i++)
+            {
+                // Moller-Trumbore, both sides
+                const glm::vec3& v0 = m_positions[m_indices[3 * i]];
+                glm::vec3 e1 = m_positions[m_indices[3 * i + 1]] - v0;
+                glm::vec3 e2 = m_positions[m_indices[3 * i + 2]] - v0;
+                glm::vec3 p = glm::cross(_ray.direction, e2);
+                float det = glm::dot(e1, p);
+                if (std::abs(det) < 1e-20f)
+                    continue;
+                float invDet = 1.0f / det;
+                glm::vec3 s = _ray.origin - v0;
+                float u = glm::dot(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f)
+                    continue;
+                glm::vec3 q = glm::cross(s, e1);
+                float v = glm::dot(_ray.direction, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f)
+                    continue;
+                float t = glm::dot(e2, q) * invDet;
+                if (t < _ray.tMin || t >= tMax)
+                    continue;
+
+                _hit.t = t;
+                _hit.triangle = m_triangleIds[i];
+                _hit.u = u;
+                _hit.v = v;
+                if (AnyHit)
+                    return true;
+                tMax = t;
+                hit = true;
+            }
+        }
+        else
+        {
+            // visit the nearest child first, and the other one later if it is still in range
+            uint32_t nearChild = node->leftFirst, farChild = node->leftFirst + 1;
+            float tNear = intersectBox(m_nodes[nearChild]);
+            float tFar = intersectBox(m_nodes[farChild]);
+            if (tFar < tNear)
+            {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+            if (tNear != FLT_MAX)
+            {
+                if (tFar != FLT_MAX)
+                    stack[stackSize++] = farChild;
+                node = &m_nodes[nearChild];
+                continue;
+            }
+        }
+
+        // next node in the stack, skipping the ones now beyond the closest hit
+        node = nullptr;
+        while (stackSize > 0)
+        {
+            const BVHNode* candidate = &m_nodes[stack[--stackSize]];
+            if (AnyHit || intersectBox(*candidate) != FLT_MAX)
+            {
+                node = candidate;
+                break;
+            }
+        }
+        if (node == nullptr)
+            break;
+    }
+    return hit;
+}
+
+
+bool MeshBVH::intersect(const Ray& _ray, RayHit& _hit) const
+{
+    RayHit hit;
+    if (!traverse<false>(_ray, hit))
+        return false;
+    _hit = hit;
+    return true;
+}
+
+
+bool MeshBVH::occluded(const Ray& _ray) const
+{
+    RayHit hit;
+    return traverse<true>(_ray, hit);
+}
+
+
+uint32_t MeshBVH::getClosestVertex(const RayHit& _hit) const
+{
+    if (!_hit.isHit() || 3 * (size_t)_hit.triangle + 2 >= m_sourceIndices.size())
+        return RayHit::NO_HIT;
+
+    float w[3] = { 1.0f - _hit.u - _hit.v, _hit.u, _hit.v };
+    int k = (int)(std::max_element(w, w + 3) - w);
+    return m_sourceIndices[3 * _hit.triangle + k];
+}
+
+
+Ray computePickingRay(const glm::vec2& _cursor, const glm::vec2& _windowSize, const glm::mat4& _modelMat, const glm::mat4& _viewMat, const glm::mat4& _projMat)
+{
+    // pixel center to normalized device coords (y points up in NDC, down in window coords)
+    glm::vec2 ndc(2.0f * (_cursor.x + 0.5f) / _windowSize.x - 1.0f,
+                  1.0f - 2.0f * (_cursor.y + 0.5f) / _windowSize.y);
+
+    glm::mat4 invMVP = glm::inverse(_projMat * _viewMat * _modelMat);
+    glm::vec4 nearPoint = invMVP * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = invMVP * glm::vec4(ndc, 1.0f, 1.0f);
+
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.direction = glm::vec3(farPoint) / farPoint.w - ray.origin;
+    ray.tMin = 0.0f;
+    ray.tMax = 1.0f;
+    return ray;
+}
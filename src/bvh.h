@@ -0,0 +1,231 @@
+/*********************************************************************************************************************
+ *
+ * bvh.h
+ *
+ * Bounding volume hierarchy over the triangles of a mesh, for picking and ray queries
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cfloat>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+class TriMesh;
+
+
+/*!
+* \struct BVHNode
+* \brief Node of the hierarchy (32 bytes, two nodes per 64-byte cache line)
+* Inner nodes have two children stored next to each other, at leftFirst and leftFirst + 1.
+* Leaves reference count triangles from leftFirst in the triangle order of the BVH.
+*/
+struct BVHNode
+{
+    glm::vec3 bBoxMin;      /*!< min corner of the bounding box */
+    uint32_t leftFirst;     /*!< first child (inner node) or first triangle (leaf) */
+    glm::vec3 bBoxMax;      /*!< max corner of the bounding box */
+    uint32_t count;         /*!< number of triangles (0 for inner nodes) */
+
+    bool isLeaf() const { return count > 0; }
+};
+static_assert(sizeof(BVHNode) == 32, "BVHNode must be 32 bytes");
+
+
+/*!
+* \struct Ray
+* \brief Ray (or segment) origin + t * direction, for t in [tMin, tMax]
+*/
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    float tMin = 0.0f;
+    float tMax = FLT_MAX;
+};
+
+
+/*!
+* \struct RayHit
+* \brief Closest intersection found along a ray
+*/
+struct RayHit
+{
+    static constexpr uint32_t NO_HIT = UINT32_MAX;
+
+    float t = FLT_MAX;                  /*!< ray parameter of the hit point */
+    uint32_t triangle = NO_HIT;         /*!< triangle index (in the index buffer of the mesh) */
+    float u = 0.0f;                     /*!< barycentric coord of the 2nd vertex of the triangle */
+    float v = 0.0f;                     /*!< barycentric coord of the 3rd vertex of the triangle */
+
+    bool isHit() const { return triangle != NO_HIT; }
+};
+
+
+/*!
+* \fn computePickingRay
+* \brief ray through a pixel of the window, in model space (i.e., the space of the mesh vertices)
+* \param _cursor : cursor position in pixels (origin at the top-left corner, as given by GLFW)
+* \param _windowSize : window size in pixels
+* \param _modelMat : model matrix
+* \param _viewMat : camera view matrix (GLtools::Camera::getViewMatrix())
+* \param _projMat : camera projection matrix (GLtools::Camera::getProjectionMatrix())
+* \return ray from the near plane to the far plane (tMax = 1)
+*/
+Ray computePickingRay(const glm::vec2& _cursor, const glm::vec2& _windowSize, const glm::mat4& _modelMat, const glm::mat4& _viewMat, const glm::mat4& _projMat);
+
+
+/*!
+* \class MeshBVH
+* \brief Binned SAH bounding volume hierarchy over the triangles of a mesh
+* Large nodes are split with parallel binning and partitioning, then subtrees are built concurrently.
+* Result does not depend on the number of threads.
+* Vertex coords are not copied (they must stay alive and unchanged while the BVH is used, so the BVH has to be
+* rebuilt after TriMesh::optimizeVertexCache() or TriMesh::sortSpatially()); triangles are copied in leaf order.
+*/
+class MeshBVH
+{
+    public:
+
+        static constexpr unsigned NB_BINS = 16;             /*!< number of SAH bins per axis */
+        static constexpr unsigned MAX_LEAF_SIZE = 8;        /*!< leaves are split beyond this size, even against SAH */
+        static constexpr size_t SUBTREE_SIZE = 16384;       /*!< nodes smaller than this are built by a single thread */
+        static constexpr unsigned MAX_STACK_SIZE = 96;      /*!< traversal stack (the build bounds the tree depth) */
+        static constexpr size_t RAY_BATCH_SIZE = 4096;      /*!< rays per job of the batched queries */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getNodes */
+        std::span<const BVHNode> getNodes() const { return m_nodes; }
+        /*! \fn getNbTriangles */
+        size_t getNbTriangles() const { return m_triangleIds.size(); }
+        /*! \fn isEmpty */
+        bool isEmpty() const { return m_nodes.empty(); }
+
+        /*!
+        * \fn computeSAHCost
+        * \brief expected cost of a random ray query (1 per node visited, 1 per triangle tested), to compare builds
+        */
+        float computeSAHCost() const;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn build
+        * \brief build the hierarchy over the triangles of a mesh
+        * \param _positions : vertex coords (not copied)
+        * \param _indices : triangles (not copied either, only used by getClosestVertex())
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        */
+        void build(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn build
+        * \brief build the hierarchy over the triangles of a TriMesh (full-detail level)
+        */
+        void build(const TriMesh& _triMesh, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn clear
+        * \brief release arrays
+        */
+        void clear();
+
+        /*!
+        * \fn intersect
+        * \brief find the closest triangle hit by a ray (both sides of triangles are hit)
+        * \param _ray : ray
+        * \param _hit : closest hit (left unchanged if nothing is hit)
+        * \return true if a triangle is hit
+        */
+        bool intersect(const Ray& _ray, RayHit& _hit) const;
+
+        /*!
+        * \fn occluded
+        * \brief check if a ray hits any triangle (stops at the first hit found, e.g. for visibility tests)
+        */
+        bool occluded(const Ray& _ray) const;
+
+        /*!
+        * \fn intersect
+        * \brief closest hits of a batch of rays, traversed by packets of getPacketSize() rays with SIMD box and
+        * triangle tests. Rays are split in jobs of RAY_BATCH_SIZE rays shared by the threads, and reordered within
+        * each job by direction octant and origin (Morton order) so that packets hold similar rays.
+        * Packets pay off for coherent rays (e.g., rays from a camera); incoherent rays are about as fast as single rays.
+        * Hits are the same as the single-ray query, up to ties between triangles at the same distance.
+        * \param _rays : rays
+        * \param _hits : closest hit of each ray (same size as _rays, triangle = NO_HIT if nothing is hit)
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        */
+        void intersect(std::span<const Ray> _rays, std::span<RayHit> _hits, unsigned _nbThreads = 1) const;
+
+        /*!
+        * \fn occluded
+        * \brief any-hit queries of a batch of rays (see the batched intersect())
+        * \param _occluded : 1 if the ray hits a triangle, 0 otherwise (same size as _rays)
+        */
+        void occluded(std::span<const Ray> _rays, std::span<uint8_t> _occluded, unsigned _nbThreads = 1) const;
+
+        /*!
+        * \fn getPacketSize
+        * \brief number of rays per packet of the batched queries: 4 (SSE4.2), 8 (AVX2), 16 (AVX-512) depending on
+        * getSimdISA(), 1 without SIMD (single-ray traversal)
+        */
+        static unsigned getPacketSize();
+
+        /*!
+        * \fn getClosestVertex
+        * \brief vertex of the hit triangle closest to the hit point
+        */
+        uint32_t getClosestVertex(const RayHit& _hit) const;
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        std::span<const glm::vec3> m_positions;     /*!< vertex coords (not owned) */
+        std::vector<BVHNode> m_nodes;               /*!< nodes, root first */
+        std::vector<uint32_t> m_indices;            /*!< triangles in leaf order */
+        std::vector<uint32_t> m_triangleIds;        /*!< original index of each triangle in leaf order */
+        std::span<const uint32_t> m_sourceIndices;  /*!< triangles in their original order (not owned) */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn traverse
+        * \brief closest-hit or any-hit traversal, front-to-back
+        */
+        template<bool AnyHit>
+        bool traverse(const Ray& _ray, RayHit& _hit) const;
+
+        /*!
+        * \fn traverseBatch
+        * \brief closest-hit or any-hit queries of a range of rays by packets (see the batched intersect())
+        */
+        template<bool AnyHit>
+        void traverseBatch(std::span<const Ray> _rays, size_t _begin, size_t _end, RayHit* _hits, uint8_t* _occluded) const;
+
+};
+
+
+#endif // BVH_H
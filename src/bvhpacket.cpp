@@ -0,0 +1,538 @@
+/*********************************************************************************************************************
+ *
+ * bvhpacket.cpp
+ *
+ * Batched ray queries of MeshBVH: packets of 4 / 8 / 16 rays traversed together, with SIMD box and triangle tests
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "bvh.h"
+#include "simdkernels.h"
+#include "spatialsort.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+#endif
+
+// per-function instruction sets, as in simdkernels.cpp
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define SIMD_TARGET(_isa) __attribute__((target(_isa)))
+#else
+    #define SIMD_TARGET(_isa)
+#endif
+
+
+static const unsigned MAX_PACKET_SIZE = 16;
+
+
+/*
+ * Rays of a packet in SoA layout (one register per coord). Unused lanes have tMax = -FLT_MAX, so they miss everything.
+ */
+struct alignas(64) RayPacket
+{
+    float ox[MAX_PACKET_SIZE], oy[MAX_PACKET_SIZE], oz[MAX_PACKET_SIZE];
+    float dx[MAX_PACKET_SIZE], dy[MAX_PACKET_SIZE], dz[MAX_PACKET_SIZE];
+    float invDx[MAX_PACKET_SIZE], invDy[MAX_PACKET_SIZE], invDz[MAX_PACKET_SIZE];
+    float tMin[MAX_PACKET_SIZE], tMax[MAX_PACKET_SIZE];
+    float u[MAX_PACKET_SIZE], v[MAX_PACKET_SIZE];
+    uint32_t triangle[MAX_PACKET_SIZE];     // hit triangle, in leaf order
+};
+
+
+// test a box against all the rays of a packet: returns the mask of rays entering the box, and their entry distances
+typedef uint32_t (*BoxKernel)(const BVHNode& _node, const RayPacket& _packet, float* _tEnter);
+// test a triangle against all the rays of a packet, update the closest hits: returns the mask of rays hitting it
+typedef uint32_t (*TriangleKernel)(const glm::vec3& _v0, const glm::vec3& _e1, const glm::vec3& _e2, uint32_t _triangle, RayPacket& _packet);
+
+struct PacketKernels
+{
+    unsigned size;
+    BoxKernel box;
+    TriangleKernel triangle;
+};
+
+
+#ifdef SIMD_X86
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 SSE4.2                                                      |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// Same operations in the same order as MeshBVH::traverse(), lane by lane
+
+
+SIMD_TARGET("sse4.2")
+static uint32_t intersectBoxSSE(const BVHNode& _node, const RayPacket& _p, float* _tEnter)
+{
+    __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMin.x), _mm_load_ps(_p.ox)), _mm_load_ps(_p.invDx));
+    __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMin.y), _mm_load_ps(_p.oy)), _mm_load_ps(_p.invDy));
+    __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMin.z), _mm_load_ps(_p.oz)), _mm_load_ps(_p.invDz));
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMax.x), _mm_load_ps(_p.ox)), _mm_load_ps(_p.invDx));
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMax.y), _mm_load_ps(_p.oy)), _mm_load_ps(_p.invDy));
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bBoxMax.z), _mm_load_ps(_p.oz)), _mm_load_ps(_p.invDz));
+
+    __m128 tEnter = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_load_ps(_p.tMin)));
+    __m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_load_ps(_p.tMax)));
+    _mm_store_ps(_tEnter, tEnter);
+    return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(tEnter, tExit));
+}
+
+
+SIMD_TARGET("sse4.2")
+static uint32_t intersectTriangleSSE(const glm::vec3& _v0, const glm::vec3& _e1, const glm::vec3& _e2, uint32_t _triangle, RayPacket& _p)
+{
+    __m128 e1x = _mm_set1_ps(_e1.x), e1y = _mm_set1_ps(_e1.y), e1z = _mm_set1_ps(_e1.z);
+    __m128 e2x = _mm_set1_ps(_e2.x), e2y = _mm_set1_ps(_e2.y), e2z = _mm_set1_ps(_e2.z);
+    __m128 dx = _mm_load_ps(_p.dx), dy = _mm_load_ps(_p.dy), dz = _mm_load_ps(_p.dz);
+
+    // p = cross(d, e2), det = dot(e1, p)
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    // s = o - v0, u = dot(s, p) / det
+    __m128 sx = _mm_sub_ps(_mm_load_ps(_p.ox), _mm_set1_ps(_v0.x));
+    __m128 sy = _mm_sub_ps(_mm_load_ps(_p.oy), _mm_set1_ps(_v0.y));
+    __m128 sz = _mm_sub_ps(_mm_load_ps(_p.oz), _mm_set1_ps(_v0.z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+    // q = cross(s, e1), v = dot(d, q) / det, t = dot(e2, q) / det
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(e1y, sz));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(e1z, sx));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(e1x, sy));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 tMax = _mm_load_ps(_p.tMax);
+    __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 hit = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-20f));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, _mm_load_ps(_p.tMin)), _mm_cmplt_ps(t, tMax)));
+
+    uint32_t mask = (uint32_t)_mm_movemask_ps(hit);
+    if (mask != 0)
+    {
+        _mm_store_ps(_p.tMax, _mm_blendv_ps(tMax, t, hit));
+        _mm_store_ps(_p.u, _mm_blendv_ps(_mm_load_ps(_p.u), u, hit));
+        _mm_store_ps(_p.v, _mm_blendv_ps(_mm_load_ps(_p.v), v, hit));
+        __m128 triangle = _mm_castsi128_ps(_mm_set1_epi32((int)_triangle));
+        _mm_store_ps((float*)_p.triangle, _mm_blendv_ps(_mm_load_ps((const float*)_p.triangle), triangle, hit));
+    }
+    return mask;
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                  AVX2                                                       |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+SIMD_TARGET("avx2")
+static uint32_t intersectBoxAVX2(const BVHNode& _node, const RayPacket& _p, float* _tEnter)
+{
+    __m256 tx0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMin.x), _mm256_load_ps(_p.ox)), _mm256_load_ps(_p.invDx));
+    __m256 ty0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMin.y), _mm256_load_ps(_p.oy)), _mm256_load_ps(_p.invDy));
+    __m256 tz0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMin.z), _mm256_load_ps(_p.oz)), _mm256_load_ps(_p.invDz));
+    __m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMax.x), _mm256_load_ps(_p.ox)), _mm256_load_ps(_p.invDx));
+    __m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMax.y), _mm256_load_ps(_p.oy)), _mm256_load_ps(_p.invDy));
+    __m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(_node.bBoxMax.z), _mm256_load_ps(_p.oz)), _mm256_load_ps(_p.invDz));
+
+    __m256 tEnter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx0, tx1), _mm256_min_ps(ty0, ty1)), _mm256_max_ps(_mm256_min_ps(tz0, tz1), _mm256_load_ps(_p.tMin)));
+    __m256 tExit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx0, tx1), _mm256_max_ps(ty0, ty1)), _mm256_min_ps(_mm256_max_ps(tz0, tz1), _mm256_load_ps(_p.tMax)));
+    _mm256_store_ps(_tEnter, tEnter);
+    return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+}
+
+
+SIMD_TARGET("avx2")
+static uint32_t intersectTriangleAVX2(const glm::vec3& _v0, const glm::vec3& _e1, const glm::vec3& _e2, uint32_t _triangle, RayPacket& _p)
+{
+    __m256 e1x = _mm256_set1_ps(_e1.x), e1y = _mm256_set1_ps(_e1.y), e1z = _mm256_set1_ps(_e1.z);
+    __m256 e2x = _mm256_set1_ps(_e2.x), e2y = _mm256_set1_ps(_e2.y), e2z = _mm256_set1_ps(_e2.z);
+    __m256 dx = _mm256_load_ps(_p.dx), dy = _mm256_load_ps(_p.dy), dz = _mm256_load_ps(_p.dz);
+
+    __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(e2y, dz));
+    __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(e2z, dx));
+    __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(e2x, dy));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+    __m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+    __m256 sx = _mm256_sub_ps(_mm256_load_ps(_p.ox), _mm256_set1_ps(_v0.x));
+    __m256 sy = _mm256_sub_ps(_mm256_load_ps(_p.oy), _mm256_set1_ps(_v0.y));
+    __m256 sz = _mm256_sub_ps(_mm256_load_ps(_p.oz), _mm256_set1_ps(_v0.z));
+    __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), invDet);
+
+    __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(e1y, sz));
+    __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(e1z, sx));
+    __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(e1x, sy));
+    __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDet);
+    __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDet);
+
+    __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 tMax = _mm256_load_ps(_p.tMax);
+    __m256 absDet = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), det);
+    __m256 hit = _mm256_cmp_ps(absDet, _mm256_set1_ps(1e-20f), _CMP_GE_OQ);
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(t, _mm256_load_ps(_p.tMin), _CMP_GE_OQ), _mm256_cmp_ps(t, tMax, _CMP_LT_OQ)));
+
+    uint32_t mask = (uint32_t)_mm256_movemask_ps(hit);
+    if (mask != 0)
+    {
+        _mm256_store_ps(_p.tMax, _mm256_blendv_ps(tMax, t, hit));
+        _mm256_store_ps(_p.u, _mm256_blendv_ps(_mm256_load_ps(_p.u), u, hit));
+        _mm256_store_ps(_p.v, _mm256_blendv_ps(_mm256_load_ps(_p.v), v, hit));
+        __m256 triangle = _mm256_castsi256_ps(_mm256_set1_epi32((int)_triangle));
+        _mm256_store_ps((float*)_p.triangle, _mm256_blendv_ps(_mm256_load_ps((const float*)_p.triangle), triangle, hit));
+    }
+    return mask;
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 AVX-512                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// AVX-512 implies FMA: arithmetic uses the explicit rounding intrinsics, which the compiler never contracts into FMA,
+// so that the hits are the same as with the scalar and narrower kernels
+
+#define EXACT_ROUNDING (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+SIMD_TARGET("avx512f")
+static inline __m512 addExact(__m512 _a, __m512 _b) { return _mm512_add_round_ps(_a, _b, EXACT_ROUNDING); }
+SIMD_TARGET("avx512f")
+static inline __m512 subExact(__m512 _a, __m512 _b) { return _mm512_sub_round_ps(_a, _b, EXACT_ROUNDING); }
+SIMD_TARGET("avx512f")
+static inline __m512 mulExact(__m512 _a, __m512 _b) { return _mm512_mul_round_ps(_a, _b, EXACT_ROUNDING); }
+
+
+SIMD_TARGET("avx512f")
+static uint32_t intersectBoxAVX512(const BVHNode& _node, const RayPacket& _p, float* _tEnter)
+{
+    __m512 tx0 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMin.x), _mm512_load_ps(_p.ox)), _mm512_load_ps(_p.invDx));
+    __m512 ty0 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMin.y), _mm512_load_ps(_p.oy)), _mm512_load_ps(_p.invDy));
+    __m512 tz0 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMin.z), _mm512_load_ps(_p.oz)), _mm512_load_ps(_p.invDz));
+    __m512 tx1 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMax.x), _mm512_load_ps(_p.ox)), _mm512_load_ps(_p.invDx));
+    __m512 ty1 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMax.y), _mm512_load_ps(_p.oy)), _mm512_load_ps(_p.invDy));
+    __m512 tz1 = mulExact(subExact(_mm512_set1_ps(_node.bBoxMax.z), _mm512_load_ps(_p.oz)), _mm512_load_ps(_p.invDz));
+
+    __m512 tEnter = _mm512_max_ps(_mm512_max_ps(_mm512_min_ps(tx0, tx1), _mm512_min_ps(ty0, ty1)), _mm512_max_ps(_mm512_min_ps(tz0, tz1), _mm512_load_ps(_p.tMin)));
+    __m512 tExit = _mm512_min_ps(_mm512_min_ps(_mm512_max_ps(tx0, tx1), _mm512_max_ps(ty0, ty1)), _mm512_min_ps(_mm512_max_ps(tz0, tz1), _mm512_load_ps(_p.tMax)));
+    _mm512_store_ps(_tEnter, tEnter);
+    return (uint32_t)_mm512_cmp_ps_mask(tEnter, tExit, _CMP_LE_OQ);
+}
+
+
+SIMD_TARGET("avx512f")
+static uint32_t intersectTriangleAVX512(const glm::vec3& _v0, const glm::vec3& _e1, const glm::vec3& _e2, uint32_t _triangle, RayPacket& _p)
+{
+    __m512 e1x = _mm512_set1_ps(_e1.x), e1y = _mm512_set1_ps(_e1.y), e1z = _mm512_set1_ps(_e1.z);
+    __m512 e2x = _mm512_set1_ps(_e2.x), e2y = _mm512_set1_ps(_e2.y), e2z = _mm512_set1_ps(_e2.z);
+    __m512 dx = _mm512_load_ps(_p.dx), dy = _mm512_load_ps(_p.dy), dz = _mm512_load_ps(_p.dz);
+
+    __m512 px = subExact(mulExact(dy, e2z), mulExact(e2y, dz));
+    __m512 py = subExact(mulExact(dz, e2x), mulExact(e2z, dx));
+    __m512 pz = subExact(mulExact(dx, e2y), mulExact(e2x, dy));
+    __m512 det = addExact(addExact(mulExact(e1x, px), mulExact(e1y, py)), mulExact(e1z, pz));
+    __m512 invDet = _mm512_div_ps(_mm512_set1_ps(1.0f), det);
+
+    __m512 sx = subExact(_mm512_load_ps(_p.ox), _mm512_set1_ps(_v0.x));
+    __m512 sy = subExact(_mm512_load_ps(_p.oy), _mm512_set1_ps(_v0.y));
+    __m512 sz = subExact(_mm512_load_ps(_p.oz), _mm512_set1_ps(_v0.z));
+    __m512 u = mulExact(addExact(addExact(mulExact(sx, px), mulExact(sy, py)), mulExact(sz, pz)), invDet);
+
+    __m512 qx = subExact(mulExact(sy, e1z), mulExact(e1y, sz));
+    __m512 qy = subExact(mulExact(sz, e1x), mulExact(e1z, sx));
+    __m512 qz = subExact(mulExact(sx, e1y), mulExact(e1x, sy));
+    __m512 v = mulExact(addExact(addExact(mulExact(dx, qx), mulExact(dy, qy)), mulExact(dz, qz)), invDet);
+    __m512 t = mulExact(addExact(addExact(mulExact(e2x, qx), mulExact(e2y, qy)), mulExact(e2z, qz)), invDet);
+
+    __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f);
+    __m512 tMax = _mm512_load_ps(_p.tMax);
+    __mmask16 hit = _mm512_cmp_ps_mask(_mm512_abs_ps(det), _mm512_set1_ps(1e-20f), _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, u, zero, _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, u, one, _CMP_LE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, v, zero, _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, addExact(u, v), one, _CMP_LE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, t, _mm512_load_ps(_p.tMin), _CMP_GE_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, t, tMax, _CMP_LT_OQ);
+
+    if (hit != 0)
+    {
+        _mm512_store_ps(_p.tMax, _mm512_mask_blend_ps(hit, tMax, t));
+        _mm512_store_ps(_p.u, _mm512_mask_blend_ps(hit, _mm512_load_ps(_p.u), u));
+        _mm512_store_ps(_p.v, _mm512_mask_blend_ps(hit, _mm512_load_ps(_p.v), v));
+        __m512i triangles = _mm512_load_si512(_p.triangle);
+        _mm512_store_si512(_p.triangle, _mm512_mask_blend_epi32(hit, triangles, _mm512_set1_epi32((int)_triangle)));
+    }
+    return (uint32_t)hit;
+}
+
+#undef EXACT_ROUNDING
+
+#endif // SIMD_X86
+
+
+static bool getPacketKernels(PacketKernels& _kernels)
+{
+    switch (getSimdISA())
+    {
+#ifdef SIMD_X86
+        case SimdISA::AVX512: _kernels = { 16, intersectBoxAVX512, intersectTriangleAVX512 }; return true;
+        case SimdISA::AVX2:   _kernels = { 8, intersectBoxAVX2, intersectTriangleAVX2 }; return true;
+        case SimdISA::SSE42:  _kernels = { 4, intersectBoxSSE, intersectTriangleSSE }; return true;
+#endif
+        default:              return false;
+    }
+}
+
+
+/*
+ * Packet traversal: a node is visited while at least one ray of the packet enters its box.
+ * Children are visited in the order of the smallest entry distance of the rays entering them.
+ * Returns the mask of rays hitting a triangle (any-hit only: these rays are then deactivated).
+ */
+template<bool AnyHit>
+static uint32_t traversePacket(std::span<const BVHNode> _nodes, std::span<const uint32_t> _indices, std::span<const glm::vec3> _positions,
+                               const PacketKernels& _kernels, uint32_t _activeMask, RayPacket& _p)
+{
+    alignas(64) float tEnter[2][MAX_PACKET_SIZE];
+    auto minEnter = [](const float* _t, uint32_t _mask)
+    {
+        float tMin = FLT_MAX;
+        for (; _mask != 0; _mask &= _mask - 1)
+            tMin = std::min(tMin, _t[std::countr_zero(_mask)]);
+        return tMin;
+    };
+
+    uint32_t hitMask = 0;
+    uint32_t stack[MeshBVH::MAX_STACK_SIZE];
+    unsigned stackSize = 0;
+    uint32_t nodeId = 0;
+    if (_kernels.box(_nodes[0], _p, tEnter[0]) == 0)
+        return 0;
+
+    while (true)
+    {
+        const BVHNode& node = _nodes[nodeId];
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++)
+            {
+                const glm::vec3& v0 = _positions[_indices[3 * i]];
+                glm::vec3 e1 = _positions[_indices[3 * i + 1]] - v0;
+                glm::vec3 e2 = _positions[_indices[3 * i + 2]] - v0;
+                uint32_t mask = _kernels.triangle(v0, e1, e2, i, _p);
+                if (AnyHit && mask != 0)
+                {
+                    hitMask |= mask;
+                    if (hitMask == _activeMask)
+                        return hitMask;
+                    for (; mask != 0; mask &= mask - 1)
+                        _p.tMax[std::countr_zero(mask)] = -FLT_MAX;
+                }
+            }
+        }
+        else
+        {
+            uint32_t left = node.leftFirst;
+            uint32_t mask0 = _kernels.box(_nodes[left], _p, tEnter[0]);
+            uint32_t mask1 = _kernels.box(_nodes[left + 1], _p, tEnter[1]);
+            if (mask0 != 0 && mask1 != 0)
+            {
+                bool leftFirst = minEnter(tEnter[0], mask0) <= minEnter(tEnter[1], mask1);
+                stack[stackSize++] = leftFirst ? left + 1 : left;
+                nodeId = leftFirst ? left : left + 1;
+                continue;
+            }
+            if (mask0 != 0 || mask1 != 0)
+            {
+                nodeId = (mask0 != 0) ? left : left + 1;
+                continue;
+            }
+        }
+
+        // next node in the stack, skipping the ones no ray enters anymore
+        bool found = false;
+        while (stackSize > 0 && !found)
+        {
+            nodeId = stack[--stackSize];
+            found = (_kernels.box(_nodes[nodeId], _p, tEnter[0]) != 0);
+        }
+        if (!found)
+            break;
+    }
+    return hitMask;
+}
+
+
+unsigned MeshBVH::getPacketSize()
+{
+    PacketKernels kernels;
+    return getPacketKernels(kernels) ? kernels.size : 1;
+}
+
+
+template<bool AnyHit>
+void MeshBVH::traverseBatch(std::span<const Ray> _rays, size_t _begin, size_t _end, RayHit* _hits, uint8_t* _occluded) const
+{
+    PacketKernels kernels;
+    if (!getPacketKernels(kernels))
+    {
+        // no SIMD: single-ray traversal
+        for (size_t r = _begin; r < _end; r++)
+        {
+            if (AnyHit)
+            {
+                _occluded[r] = occluded(_rays[r]) ? 1 : 0;
+            }
+            else
+            {
+                _hits[r] = RayHit();
+                intersect(_rays[r], _hits[r]);
+            }
+        }
+        return;
+    }
+
+    // group rays by direction octant, then by origin and direction along Morton curves (stable sort: rays with the
+    // same key keep their order)
+    size_t count = _end - _begin;
+    glm::vec3 bBoxMin = m_nodes[0].bBoxMin;
+    glm::vec3 extent = glm::max(m_nodes[0].bBoxMax - bBoxMin, glm::vec3(FLT_MIN));
+    std::vector<uint64_t> keys(count);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Ray& ray = _rays[_begin + i];
+        uint64_t octant = (ray.direction.x < 0.0f ? 1u : 0u) | (ray.direction.y < 0.0f ? 2u : 0u) | (ray.direction.z < 0.0f ? 4u : 0u);
+        float length = std::max({ std::abs(ray.direction.x), std::abs(ray.direction.y), std::abs(ray.direction.z), FLT_MIN });
+        uint64_t origin = mortonCode30((ray.origin - bBoxMin) / extent);
+        uint64_t direction = mortonCode30(ray.direction / (2.0f * length) + 0.5f);
+        keys[i] = (octant << 60) | (origin << 30) | direction;
+    }
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) { return keys[_a] < keys[_b]; });
+
+    RayPacket packet;
+    for (size_t first = 0; first < count; first += kernels.size)
+    {
+        unsigned nbRays = (unsigned)std::min<size_t>(kernels.size, count - first);
+        for (unsigned l = 0; l < kernels.size; l++)
+        {
+            Ray ray;
+            if (l < nbRays)
+                ray = _rays[_begin + order[first + l]];
+            else
+                ray.tMax = -FLT_MAX;    // unused lane
+            packet.ox[l] = ray.origin.x;
+            packet.oy[l] = ray.origin.y;
+            packet.oz[l] = ray.origin.z;
+            packet.dx[l] = ray.direction.x;
+            packet.dy[l] = ray.direction.y;
+            packet.dz[l] = ray.direction.z;
+            // same clamping as the single-ray traversal
+            glm::vec3 invDir;
+            for (int a = 0; a < 3; a++)
+            {
+                float d = ray.direction[a];
+                if (std::abs(d) < 1e-30f)
+                    d = std::copysign(1e-30f, d);
+                invDir[a] = 1.0f / d;
+            }
+            packet.invDx[l] = invDir.x;
+            packet.invDy[l] = invDir.y;
+            packet.invDz[l] = invDir.z;
+            packet.tMin[l] = ray.tMin;
+            packet.tMax[l] = ray.tMax;
+            packet.u[l] = packet.v[l] = 0.0f;
+            packet.triangle[l] = RayHit::NO_HIT;
+        }
+
+        uint32_t activeMask = (1u << nbRays) - 1;
+        uint32_t hitMask = traversePacket<AnyHit>(m_nodes, m_indices, m_positions, kernels, activeMask, packet);
+        for (unsigned l = 0; l < nbRays; l++)
+        {
+            size_t r = _begin + order[first + l];
+            if (AnyHit)
+            {
+                _occluded[r] = (hitMask >> l) & 1;
+            }
+            else
+            {
+                RayHit hit;
+                if (packet.triangle[l] != RayHit::NO_HIT)
+                {
+                    hit.t = packet.tMax[l];
+                    hit.triangle = m_triangleIds[packet.triangle[l]];
+                    hit.u = packet.u[l];
+                    hit.v = packet.v[l];
+                }
+                _hits[r] = hit;
+            }
+        }
+    }
+}
+
+
+/*
+ * Jobs of RAY_BATCH_SIZE rays handed out to the threads on demand (ray costs vary a lot across a scene)
+ */
+template<typename Func>
+static void dispatchRayBatches(size_t _nbRays, unsigned _nbThreads, Func&& _func)
+{
+    size_t nbBatches = (_nbRays + MeshBVH::RAY_BATCH_SIZE - 1) / MeshBVH::RAY_BATCH_SIZE;
+    unsigned nbThreads = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), nbBatches);
+    std::atomic<size_t> nextBatch(0);
+    parallelFor(0, nbThreads, nbThreads, [&](size_t, size_t, unsigned)
+    {
+        size_t b;
+        while ((b = nextBatch.fetch_add(1, std::memory_order_relaxed)) < nbBatches)
+            _func(b * MeshBVH::RAY_BATCH_SIZE, std::min(_nbRays, (b + 1) * MeshBVH::RAY_BATCH_SIZE));
+    });
+}
+
+
+void MeshBVH::intersect(std::span<const Ray> _rays, std::span<RayHit> _hits, unsigned _nbThreads) const
+{
+    if (m_nodes.empty())
+    {
+        std::fill(_hits.begin(), _hits.end(), RayHit());
+        return;
+    }
+    dispatchRayBatches(_rays.size(), _nbThreads, [&](size_t _begin, size_t _end)
+    {
+        traverseBatch<false>(_rays, _begin, _end, _hits.data(), nullptr);
+    });
+}
+
+
+void MeshBVH::occluded(std::span<const Ray> _rays, std::span<uint8_t> _occluded, unsigned _nbThreads) const
+{
+    if (m_nodes.empty())
+    {
+        std::fill(_occluded.begin(), _occluded.end(), 0);
+        return;
+    }
+    dispatchRayBatches(_rays.size(), _nbThreads, [&](size_t _begin, size_t _end)
+    {
+        traverseBatch<true>(_rays, _begin, _end, nullptr, _occluded.data());
+    });
+}
@@ -0,0 +1,483 @@
+/*********************************************************************************************************************
+ *
+ * clusterculling.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "clusterculling.h"
+#include "occlusionbuffer.h"
+#include "simdkernels.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+#endif
+
+// per-function instruction sets, as in simdkernels.cpp
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define SIMD_TARGET(_isa) __attribute__((target(_isa)))
+#else
+    #define SIMD_TARGET(_isa)
+#endif
+
+
+static const size_t SIMD_WIDTH = 16;        // bounds arrays are padded to the widest kernel
+static const size_t CODE_BATCH_SIZE = 256;  // clusters tested between two compactions
+
+// first test culling a cluster
+enum CullCode : uint8_t
+{
+    VISIBLE = 0,
+    FRUSTUM_CULLED,
+    BACKFACE_CULLED,
+    SMALL_CULLED
+};
+
+
+/*
+ * Per-frame constants of the tests, in model space
+ */
+struct CullingConstants
+{
+    glm::vec4 planes[6];        // frustum planes (normalized, inside when dot(plane, (p, 1)) >= 0)
+    unsigned nbPlanes;          // 0 if the frustum test is disabled
+    bool backface;
+    glm::vec3 eye;              // camera position (perspective), minus the view direction (orthographic)
+    float perspective;          // 1 in perspective, 0 in orthographic: the camera sees a cluster along perspective * center - eye
+    bool small;
+    glm::vec4 wRow;             // row of the model-view-projection matrix giving the clip w of a point
+    float pixelScale;           // projected radius in pixels = radius * pixelScale / w
+    float minPixelRadius;
+};
+
+
+/*
+ * Bounds of the clusters in SoA layout
+ */
+struct ClusterBounds
+{
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+    const float* axisX;
+    const float* axisY;
+    const float* axisZ;
+    const float* cutoff;
+};
+
+
+// cull codes of the clusters [_begin, _end), _begin being a multiple of SIMD_WIDTH
+typedef void (*CullKernel)(const ClusterBounds& _bounds, size_t _begin, size_t _end, const CullingConstants& _c, uint8_t* _codes);
+
+
+/*
+ * Reference tests, one cluster at a time. The normal cone test is the one described in Meshlet, written with
+ * v = perspective * center - eye so that it also holds for orthographic projections.
+ */
+static void cullScalar(const ClusterBounds& _bounds, size_t _begin, size_t _end, const CullingConstants& _c, uint8_t* _codes)
+{
+    for (size_t i = _begin; i < _end; i++)
+    {
+        float x = _bounds.centerX[i], y = _bounds.centerY[i], z = _bounds.centerZ[i], r = _bounds.radius[i];
+        uint8_t code = VISIBLE;
+        for (unsigned p = 0; p < _c.nbPlanes; p++)
+        {
+            const glm::vec4& plane = _c.planes[p];
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r)
+                code = FRUSTUM_CULLED;
+        }
+        if (code == VISIBLE && _c.backface && _bounds.cutoff[i] < 1.0f)
+        {
+            float vx = _c.perspective * x - _c.eye.x, vy = _c.perspective * y - _c.eye.y, vz = _c.perspective * z - _c.eye.z;
+            float d = vx * _bounds.axisX[i] + vy * _bounds.axisY[i] + vz * _bounds.axisZ[i];
+            if (d >= _bounds.cutoff[i] * std::sqrt(vx * vx + vy * vy + vz * vz) + _c.perspective * r)
+                code = BACKFACE_CULLED;
+        }
+        if (code == VISIBLE && _c.small)
+        {
+            float w = _c.wRow.x * x + _c.wRow.y * y + _c.wRow.z * z + _c.wRow.w;
+            if (r * _c.pixelScale < _c.minPixelRadius * w)
+                code = SMALL_CULLED;
+        }
+        _codes[i - _begin] = code;
+    }
+}
+
+
+/*
+ * Cull codes of a group of clusters from the masks of each test (a cluster is counted by the first test culling it)
+ */
+static void storeCodes(uint32_t _frustumMask, uint32_t _backfaceMask, uint32_t _smallMask, size_t _count, uint8_t* _codes)
+{
+    for (size_t l = 0; l < _count; l++)
+    {
+        uint32_t bit = 1u << l;
+        _codes[l] = (_frustumMask & bit) ? FRUSTUM_CULLED : (_backfaceMask & bit) ? BACKFACE_CULLED : (_smallMask & bit) ? SMALL_CULLED : VISIBLE;
+    }
+}
+
+
+#ifdef SIMD_X86
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 SSE4.2                                                      |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// Same operations in the same order as cullScalar(), lane by lane
+
+
+SIMD_TARGET("sse4.2")
+static void cullSSE(const ClusterBounds& _bounds, size_t _begin, size_t _end, const CullingConstants& _c, uint8_t* _codes)
+{
+    __m128 perspective = _mm_set1_ps(_c.perspective);
+    for (size_t i = _begin; i < _end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(_bounds.centerX + i), y = _mm_loadu_ps(_bounds.centerY + i), z = _mm_loadu_ps(_bounds.centerZ + i);
+        __m128 r = _mm_loadu_ps(_bounds.radius + i);
+        __m128 minusR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+        __m128 outside = _mm_setzero_ps();
+        for (unsigned p = 0; p < _c.nbPlanes; p++)
+        {
+            const glm::vec4& plane = _c.planes[p];
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                                             _mm_mul_ps(_mm_set1_ps(plane.z), z)), _mm_set1_ps(plane.w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, minusR));
+        }
+        uint32_t frustumMask = (uint32_t)_mm_movemask_ps(outside);
+
+        uint32_t backfaceMask = 0;
+        if (_c.backface)
+        {
+            __m128 cutoff = _mm_loadu_ps(_bounds.cutoff + i);
+            __m128 vx = _mm_sub_ps(_mm_mul_ps(perspective, x), _mm_set1_ps(_c.eye.x));
+            __m128 vy = _mm_sub_ps(_mm_mul_ps(perspective, y), _mm_set1_ps(_c.eye.y));
+            __m128 vz = _mm_sub_ps(_mm_mul_ps(perspective, z), _mm_set1_ps(_c.eye.z));
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(_bounds.axisX + i)), _mm_mul_ps(vy, _mm_loadu_ps(_bounds.axisY + i))),
+                                  _mm_mul_ps(vz, _mm_loadu_ps(_bounds.axisZ + i)));
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+            __m128 limit = _mm_add_ps(_mm_mul_ps(cutoff, length), _mm_mul_ps(perspective, r));
+            __m128 away = _mm_and_ps(_mm_cmpge_ps(d, limit), _mm_cmplt_ps(cutoff, _mm_set1_ps(1.0f)));
+            backfaceMask = (uint32_t)_mm_movemask_ps(away);
+        }
+
+        uint32_t smallMask = 0;
+        if (_c.small)
+        {
+            __m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(_c.wRow.x), x), _mm_mul_ps(_mm_set1_ps(_c.wRow.y), y)),
+                                             _mm_mul_ps(_mm_set1_ps(_c.wRow.z), z)), _mm_set1_ps(_c.wRow.w));
+            __m128 tooSmall = _mm_cmplt_ps(_mm_mul_ps(r, _mm_set1_ps(_c.pixelScale)), _mm_mul_ps(_mm_set1_ps(_c.minPixelRadius), w));
+            smallMask = (uint32_t)_mm_movemask_ps(tooSmall);
+        }
+
+        storeCodes(frustumMask, backfaceMask, smallMask, std::min<size_t>(4, _end - i), _codes + (i - _begin));
+    }
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                  AVX2                                                       |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+SIMD_TARGET("avx2")
+static void cullAVX2(const ClusterBounds& _bounds, size_t _begin, size_t _end, const CullingConstants& _c, uint8_t* _codes)
+{
+    __m256 perspective = _mm256_set1_ps(_c.perspective);
+    for (size_t i = _begin; i < _end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(_bounds.centerX + i), y = _mm256_loadu_ps(_bounds.centerY + i), z = _mm256_loadu_ps(_bounds.centerZ + i);
+        __m256 r = _mm256_loadu_ps(_bounds.radius + i);
+        __m256 minusR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (unsigned p = 0; p < _c.nbPlanes; p++)
+        {
+            const glm::vec4& plane = _c.planes[p];
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x), _mm256_mul_ps(_mm256_set1_ps(plane.y), y)),
+                                                   _mm256_mul_ps(_mm256_set1_ps(plane.z), z)), _mm256_set1_ps(plane.w));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, minusR, _CMP_LT_OQ));
+        }
+        uint32_t frustumMask = (uint32_t)_mm256_movemask_ps(outside);
+
+        uint32_t backfaceMask = 0;
+        if (_c.backface)
+        {
+            __m256 cutoff = _mm256_loadu_ps(_bounds.cutoff + i);
+            __m256 vx = _mm256_sub_ps(_mm256_mul_ps(perspective, x), _mm256_set1_ps(_c.eye.x));
+            __m256 vy = _mm256_sub_ps(_mm256_mul_ps(perspective, y), _mm256_set1_ps(_c.eye.y));
+            __m256 vz = _mm256_sub_ps(_mm256_mul_ps(perspective, z), _mm256_set1_ps(_c.eye.z));
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, _mm256_loadu_ps(_bounds.axisX + i)), _mm256_mul_ps(vy, _mm256_loadu_ps(_bounds.axisY + i))),
+                                     _mm256_mul_ps(vz, _mm256_loadu_ps(_bounds.axisZ + i)));
+            __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz)));
+            __m256 limit = _mm256_add_ps(_mm256_mul_ps(cutoff, length), _mm256_mul_ps(perspective, r));
+            __m256 away = _mm256_and_ps(_mm256_cmp_ps(d, limit, _CMP_GE_OQ), _mm256_cmp_ps(cutoff, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+            backfaceMask = (uint32_t)_mm256_movemask_ps(away);
+        }
+
+        uint32_t smallMask = 0;
+        if (_c.small)
+        {
+            __m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(_c.wRow.x), x), _mm256_mul_ps(_mm256_set1_ps(_c.wRow.y), y)),
+                                                   _mm256_mul_ps(_mm256_set1_ps(_c.wRow.z), z)), _mm256_set1_ps(_c.wRow.w));
+            __m256 tooSmall = _mm256_cmp_ps(_mm256_mul_ps(r, _mm256_set1_ps(_c.pixelScale)), _mm256_mul_ps(_mm256_set1_ps(_c.minPixelRadius), w), _CMP_LT_OQ);
+            smallMask = (uint32_t)_mm256_movemask_ps(tooSmall);
+        }
+
+        storeCodes(frustumMask, backfaceMask, smallMask, std::min<size_t>(8, _end - i), _codes + (i - _begin));
+    }
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 AVX-512                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+SIMD_TARGET("avx512f")
+static void cullAVX512(const ClusterBounds& _bounds, size_t _begin, size_t _end, const CullingConstants& _c, uint8_t* _codes)
+{
+    __m512 perspective = _mm512_set1_ps(_c.perspective);
+    for (size_t i = _begin; i < _end; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(_bounds.centerX + i), y = _mm512_loadu_ps(_bounds.centerY + i), z = _mm512_loadu_ps(_bounds.centerZ + i);
+        __m512 r = _mm512_loadu_ps(_bounds.radius + i);
+        __m512 minusR = _mm512_sub_ps(_mm512_setzero_ps(), r);
+
+        __mmask16 outside = 0;
+        for (unsigned p = 0; p < _c.nbPlanes; p++)
+        {
+            const glm::vec4& plane = _c.planes[p];
+            __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(plane.x), x), _mm512_mul_ps(_mm512_set1_ps(plane.y), y)),
+                                                   _mm512_mul_ps(_mm512_set1_ps(plane.z), z)), _mm512_set1_ps(plane.w));
+            outside |= _mm512_cmp_ps_mask(d, minusR, _CMP_LT_OQ);
+        }
+
+        __mmask16 away = 0;
+        if (_c.backface)
+        {
+            __m512 cutoff = _mm512_loadu_ps(_bounds.cutoff + i);
+            __m512 vx = _mm512_sub_ps(_mm512_mul_ps(perspective, x), _mm512_set1_ps(_c.eye.x));
+            __m512 vy = _mm512_sub_ps(_mm512_mul_ps(perspective, y), _mm512_set1_ps(_c.eye.y));
+            __m512 vz = _mm512_sub_ps(_mm512_mul_ps(perspective, z), _mm512_set1_ps(_c.eye.z));
+            __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(vx, _mm512_loadu_ps(_bounds.axisX + i)), _mm512_mul_ps(vy, _mm512_loadu_ps(_bounds.axisY + i))),
+                                     _mm512_mul_ps(vz, _mm512_loadu_ps(_bounds.axisZ + i)));
+            __m512 length = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(vx, vx), _mm512_mul_ps(vy, vy)), _mm512_mul_ps(vz, vz)));
+            __m512 limit = _mm512_add_ps(_mm512_mul_ps(cutoff, length), _mm512_mul_ps(perspective, r));
+            away = _mm512_cmp_ps_mask(d, limit, _CMP_GE_OQ) & _mm512_cmp_ps_mask(cutoff, _mm512_set1_ps(1.0f), _CMP_LT_OQ);
+        }
+
+        __mmask16 tooSmall = 0;
+        if (_c.small)
+        {
+            __m512 w = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(_c.wRow.x), x), _mm512_mul_ps(_mm512_set1_ps(_c.wRow.y), y)),
+                                                   _mm512_mul_ps(_mm512_set1_ps(_c.wRow.z), z)), _mm512_set1_ps(_c.wRow.w));
+            tooSmall = _mm512_cmp_ps_mask(_mm512_mul_ps(r, _mm512_set1_ps(_c.pixelScale)), _mm512_mul_ps(_mm512_set1_ps(_c.minPixelRadius), w), _CMP_LT_OQ);
+        }
+
+        storeCodes(outside, away, tooSmall, std::min<size_t>(16, _end - i), _codes + (i - _begin));
+    }
+}
+
+
+#endif // SIMD_X86
+
+
+static CullKernel getCullKernel()
+{
+    switch (getSimdISA())
+    {
+#ifdef SIMD_X86
+        case SimdISA::AVX512: return cullAVX512;
+        case SimdISA::AVX2:   return cullAVX2;
+        case SimdISA::SSE42:  return cullSSE;
+#endif
+        default:              return cullScalar;
+    }
+}
+
+
+/*
+ * Tests in model space: frustum planes of the model-view-projection matrix (Gribb / Hartmann), and camera
+ * position (or view direction) brought back to model space
+ */
+static CullingConstants computeCullingConstants(const glm::mat4& _modelMat, const glm::mat4& _viewMat, const glm::mat4& _projMat,
+                                                float _viewportHeight, const ClusterCullingParams& _params)
+{
+    CullingConstants constants;
+    glm::mat4 modelViewMat = _viewMat * _modelMat;
+    glm::mat4 mvp = _projMat * modelViewMat;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+
+    // left, right, bottom, top, near, far
+    constants.nbPlanes = _params.frustum ? 6 : 0;
+    for (int i = 0; i < 6; i++)
+    {
+        glm::vec4 plane = (i % 2 == 0) ? rows[3] + rows[i / 2] : rows[3] - rows[i / 2];
+        float length = glm::length(glm::vec3(plane));
+        constants.planes[i] = (length > 0.0f) ? plane / length : plane;
+    }
+
+    // perspective if the clip w depends on the view depth
+    glm::mat4 invModelView = glm::inverse(modelViewMat);
+    constants.backface = _params.backface;
+    if (_projMat[2][3] != 0.0f)
+    {
+        constants.eye = glm::vec3(invModelView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        constants.perspective = 1.0f;
+    }
+    else
+    {
+        glm::vec3 direction = glm::vec3(invModelView * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+        float length = glm::length(direction);
+        constants.eye = (length > 0.0f) ? -direction / length : glm::vec3(0.0f);
+        constants.perspective = 0.0f;
+    }
+
+    // lengths are scaled by the largest axis of the model-view matrix (as in computePixelsPerUnit())
+    float scale = std::max({ glm::length(glm::vec3(modelViewMat[0])), glm::length(glm::vec3(modelViewMat[1])), glm::length(glm::vec3(modelViewMat[2])) });
+    constants.small = (_params.minPixelRadius > 0.0f);
+    constants.wRow = rows[3];
+    constants.pixelScale = scale * _projMat[1][1] * 0.5f * _viewportHeight;
+    constants.minPixelRadius = _params.minPixelRadius;
+    return constants;
+}
+
+
+void ClusterCuller::setClusters(std::span<const Meshlet> _meshlets)
+{
+    clear();
+    size_t size = (_meshlets.size() + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    // padding clusters are never emitted
+    for (std::vector<float>* array : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_axisX, &m_axisY, &m_axisZ })
+        array->assign(size, 0.0f);
+    m_cutoff.assign(size, 1.0f);
+    m_firstIndex.resize(_meshlets.size());
+    m_nbTriangles.resize(_meshlets.size());
+
+    for (size_t i = 0; i < _meshlets.size(); i++)
+    {
+        const Meshlet& meshlet = _meshlets[i];
+        m_centerX[i] = meshlet.center.x;
+        m_centerY[i] = meshlet.center.y;
+        m_centerZ[i] = meshlet.center.z;
+        m_radius[i] = meshlet.radius;
+        m_axisX[i] = meshlet.coneAxis.x;
+        m_axisY[i] = meshlet.coneAxis.y;
+        m_axisZ[i] = meshlet.coneAxis.z;
+        m_cutoff[i] = meshlet.coneCutoff;
+        m_firstIndex[i] = meshlet.firstIndex;
+        m_nbTriangles[i] = meshlet.nbTriangles;
+    }
+}
+
+
+void ClusterCuller::clear()
+{
+    for (std::vector<float>* array : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_axisX, &m_axisY, &m_axisZ, &m_cutoff })
+        array->clear();
+    m_firstIndex.clear();
+    m_nbTriangles.clear();
+}
+
+
+void ClusterCuller::cull(const glm::mat4& _modelMat, const glm::mat4& _viewMat, const glm::mat4& _projMat, float _viewportHeight,
+                         const ClusterCullingParams& _params, unsigned _nbThreads, std::vector<IndexRange>& _ranges, CullingStats& _stats,
+                         const OcclusionBuffer* _occlusionBuffer) const
+{
+    _ranges.clear();
+    _stats = CullingStats();
+    size_t nbClusters = getNbClusters();
+    if (nbClusters == 0)
+        return;
+
+    CullingConstants constants = computeCullingConstants(_modelMat, _viewMat, _projMat, _viewportHeight, _params);
+    CullKernel kernel = getCullKernel();
+    glm::mat4 mvp = _projMat * _viewMat * _modelMat;
+    ClusterBounds bounds = { m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_radius.data(),
+                             m_axisX.data(), m_axisY.data(), m_axisZ.data(), m_cutoff.data() };
+
+    // contiguous jobs of whole SIMD groups, one per thread (results are merged in job order)
+    size_t nbJobs = std::min<size_t>(getNbThreads(_nbThreads), (nbClusters + JOB_SIZE - 1) / JOB_SIZE);
+    size_t jobSize = ((nbClusters + nbJobs - 1) / nbJobs + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    nbJobs = (nbClusters + jobSize - 1) / jobSize;
+    std::vector<std::vector<IndexRange>> jobRanges(nbJobs);
+    std::vector<CullingStats> jobStats(nbJobs);
+
+    parallelFor(0, nbJobs, (unsigned)nbJobs, [&](size_t _firstJob, size_t _lastJob, unsigned)
+    {
+        uint8_t codes[CODE_BATCH_SIZE];
+        for (size_t job = _firstJob; job < _lastJob; job++)
+        {
+            std::vector<IndexRange>& ranges = (nbJobs == 1) ? _ranges : jobRanges[job];
+            CullingStats& stats = jobStats[job];
+            size_t jobEnd = std::min(nbClusters, (job + 1) * jobSize);
+            for (size_t first = job * jobSize; first < jobEnd; first += CODE_BATCH_SIZE)
+            {
+                size_t last = std::min(jobEnd, first + CODE_BATCH_SIZE);
+                kernel(bounds, first, last, constants, codes);
+
+                // visible clusters next to each other in the index buffer are drawn as one range
+                for (size_t i = first; i < last; i++)
+                {
+                    switch (codes[i - first])
+                    {
+                        case FRUSTUM_CULLED:  stats.nbFrustumCulled++; continue;
+                        case BACKFACE_CULLED: stats.nbBackfaceCulled++; continue;
+                        case SMALL_CULLED:    stats.nbSmallCulled++; continue;
+                        default:              break;
+                    }
+                    if (_occlusionBuffer)
+                    {
+                        glm::vec3 center(m_centerX[i], m_centerY[i], m_centerZ[i]);
+                        if (_occlusionBuffer->isBoxOccluded(center - m_radius[i], center + m_radius[i], mvp))
+                        {
+                            stats.nbOccludedCulled++;
+                            continue;
+                        }
+                    }
+                    uint32_t count = 3 * m_nbTriangles[i];
+                    stats.nbTrianglesSubmitted += m_nbTriangles[i];
+                    if (!ranges.empty() && ranges.back().firstIndex + ranges.back().count == m_firstIndex[i])
+                        ranges.back().count += count;
+                    else
+                        ranges.push_back({ m_firstIndex[i], count });
+                }
+            }
+        }
+    });
+
+    for (size_t job = 0; job < nbJobs; job++)
+    {
+        if (nbJobs > 1)
+        {
+            for (const IndexRange& range : jobRanges[job])
+            {
+                if (!_ranges.empty() && _ranges.back().firstIndex + _ranges.back().count == range.firstIndex)
+                    _ranges.back().count += range.count;
+                else
+                    _ranges.push_back(range);
+            }
+        }
+        _stats.nbFrustumCulled += jobStats[job].nbFrustumCulled;
+        _stats.nbBackfaceCulled += jobStats[job].nbBackfaceCulled;
+        _stats.nbSmallCulled += jobStats[job].nbSmallCulled;
+        _stats.nbOccludedCulled += jobStats[job].nbOccludedCulled;
+        _stats.nbTrianglesSubmitted += jobStats[job].nbTrianglesSubmitted;
+    }
+    _stats.nbTested = nbClusters;
+    _stats.nbDraws = _ranges.size();
+}
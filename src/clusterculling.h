@@ -0,0 +1,141 @@
+/*********************************************************************************************************************
+ *
+ * clusterculling.h
+ *
+ * Per-cluster culling of meshlets (frustum, backface normal cone, small clusters) on the CPU, no OpenGL call
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef CLUSTERCULLING_H
+#define CLUSTERCULLING_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "meshlets.h"
+
+class OcclusionBuffer;
+
+
+/*!
+* \struct IndexRange
+* \brief Range of triangles to draw: first index and number of indices in the index buffer
+*/
+struct IndexRange
+{
+    uint32_t firstIndex;
+    uint32_t count;
+};
+
+
+/*!
+* \struct ClusterCullingParams
+* \brief Tests applied by ClusterCuller::cull()
+*/
+struct ClusterCullingParams
+{
+    bool frustum = true;            /*!< cull clusters whose bounding sphere is outside the view frustum */
+    bool backface = true;           /*!< cull clusters whose normal cone faces away from the camera */
+    float minPixelRadius = 0.0f;    /*!< cull clusters whose bounding sphere projects under this radius, in pixels (0 = off) */
+};
+
+
+/*!
+* \struct CullingStats
+* \brief Result of the last ClusterCuller::cull() (each cluster is counted by the first test that culls it)
+*/
+struct CullingStats
+{
+    size_t nbTested = 0;                /*!< number of clusters tested */
+    size_t nbFrustumCulled = 0;         /*!< clusters outside the frustum */
+    size_t nbBackfaceCulled = 0;        /*!< clusters facing away */
+    size_t nbSmallCulled = 0;           /*!< clusters under the pixel threshold */
+    size_t nbOccludedCulled = 0;        /*!< clusters hidden behind the occluders */
+    size_t nbTrianglesSubmitted = 0;    /*!< triangles of the visible clusters */
+    size_t nbDraws = 0;                 /*!< index ranges (visible clusters next to each other are drawn together) */
+
+    size_t getNbCulled() const { return nbFrustumCulled + nbBackfaceCulled + nbSmallCulled + nbOccludedCulled; }
+};
+
+
+/*!
+* \class ClusterCuller
+* \brief Culling of the meshlets of a mesh from the camera matrices. Bounds are stored in SoA layout and tested by
+* 4 / 8 / 16 clusters with SSE4.2 / AVX2 / AVX-512 (see getSimdISA()), in jobs of JOB_SIZE clusters shared by the
+* threads of WorkerPool (kept from frame to frame, see parallelFor()). Visible clusters are emitted as a compact list of
+* index ranges (e.g., for glMultiDrawElements), in cluster order and independently of the number of threads.
+* Tests are done in model space: the normal cone test assumes the model matrix has no shear nor non-uniform scale.
+*/
+class ClusterCuller
+{
+    public:
+
+        static constexpr size_t JOB_SIZE = 4096;    /*!< clusters per job (smaller meshes are culled by a single thread) */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getNbClusters */
+        size_t getNbClusters() const { return m_firstIndex.size(); }
+        /*! \fn isEmpty */
+        bool isEmpty() const { return m_firstIndex.empty(); }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn setClusters
+        * \brief copy the bounds and index ranges of meshlets (see ::buildMeshlets)
+        */
+        void setClusters(std::span<const Meshlet> _meshlets);
+
+        /*!
+        * \fn clear
+        * \brief release arrays
+        */
+        void clear();
+
+        /*!
+        * \fn cull
+        * \brief test all the clusters and emit the index ranges of the visible ones
+        * \param _modelMat : model matrix
+        * \param _viewMat : camera view matrix
+        * \param _projMat : camera projection matrix (perspective or orthographic)
+        * \param _viewportHeight : height of the viewport in pixels (for the small cluster test)
+        * \param _params : tests to apply
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        * \param _ranges : index ranges to draw (cleared first)
+        * \param _stats : number of clusters culled by each test
+        * \param _occlusionBuffer : if not null, the bounding boxes of the spheres of the clusters passing the other
+        * tests are tested against it (see OcclusionBuffer::isBoxOccluded(), rendered with the same view and projection)
+        */
+        void cull(const glm::mat4& _modelMat, const glm::mat4& _viewMat, const glm::mat4& _projMat, float _viewportHeight,
+                  const ClusterCullingParams& _params, unsigned _nbThreads, std::vector<IndexRange>& _ranges, CullingStats& _stats,
+                  const OcclusionBuffer* _occlusionBuffer = nullptr) const;
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;   /*!< bounding spheres (padded to 16 clusters) */
+        std::vector<float> m_axisX, m_axisY, m_axisZ, m_cutoff;         /*!< normal cones (padded to 16 clusters) */
+        std::vector<uint32_t> m_firstIndex;                             /*!< first index of each cluster */
+        std::vector<uint32_t> m_nbTriangles;                            /*!< number of triangles of each cluster */
+
+};
+
+
+#endif // CLUSTERCULLING_H
@@ -8,6 +8,15 @@
  *********************************************************************************************************************/
 
 #include "drawablemesh.h"
+#include "GLtools.h"
+#include "lodselection.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
 
 
 DrawableMesh::DrawableMesh()
@@ -15,11 +24,35 @@ DrawableMesh::DrawableMesh()
 
     m_defaultVAO = 0;
 
-    m_ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-    m_diffuseColor = glm::vec3(0.8f, 0.6f, 0.5f);
-    m_specularColor = glm::vec3(0.95f, 0.95f, 0.95f);
-
-    m_specPow = 128.0f;
+    m_meshVAO = 0;
+    m_vertexVBO = 0;
+    m_normalVBO = 0;
+    m_indexVBO = 0;
+    m_numVertices = 0;
+    m_numIndices = 0;
+    m_lod = 0;
+    m_autoLOD = true;
+    m_lodPixelError = 1.0f;
+    m_pixelsPerUnit = 0.0f;
+    m_boundingCenter = glm::vec3(0.0f);
+    m_boundingRadius = 0.0f;
+    m_clusterCulling = true;
+    m_cullingTime = 0.0f;
+    m_occluderError = 0.0f;
+    m_occlusionCulling = false;
+    m_occlusionBudget = 1.0f;
+
+    m_uploadPending = false;
+    m_uploadedBytes = 0;
+
+    m_nbMaterials = 1;
+    m_materialsFrame = UINT64_MAX;
+    m_materialsOffset = -1;
+    m_nbGLCalls = 0;
+    m_instanceVBO = 0;
+    m_instanceCenter = glm::vec3(0.0f);
+    m_instanceRadius = 0.0f;
+    m_instanceScale = 1.0f;
 
 }
 
@@ -30,42 +63,42 @@ DrawableMesh::~DrawableMesh()
     glDeleteBuffers(1, &(m_normalVBO));
 
     glDeleteBuffers(1, &(m_indexVBO));
+    glDeleteBuffers(1, &(m_instanceVBO));
     glDeleteVertexArrays(1, &(m_meshVAO));
 }
 
 
-void DrawableMesh::createMeshVAO(TriMesh& _triMesh)
+void DrawableMesh::createMeshVAO(const TriMesh& _triMesh)
 {
-    // read vertices from mesh object and fill in VAO
-    
-    // mandatory data
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<uint32_t> indices;      // !! uint32_t !!
+    // upload directly from the mesh arrays
+    std::span<const glm::vec3> vertices = _triMesh.getVertexView();
+    std::span<const glm::vec3> normals = _triMesh.getNormalView();
+    std::span<const uint32_t> indices = _triMesh.getIndexView();      // !! uint32_t !!
 
-
-    _triMesh.getVertices(vertices);
-    _triMesh.getNormals(normals);
-    _triMesh.getIndices(indices);
+    createMeshVAO(vertices.data(), vertices.size(), normals.data(), normals.size(), indices.data(), indices.size());
+}
 
 
+void DrawableMesh::createMeshVAO(const glm::vec3* _vertices, size_t _nbVertices, const glm::vec3* _normals, size_t _nbNormals, 
+                                 const uint32_t* _indices, size_t _nbIndices)
+{
     // Generates and populates a VBO for vertex coords
     glGenBuffers(1, &(m_vertexVBO));
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
-    size_t verticesNBytes = vertices.size() * sizeof(vertices[0]);
-    glBufferData(GL_ARRAY_BUFFER, verticesNBytes, vertices.data(), GL_STATIC_DRAW);
+    size_t verticesNBytes = _nbVertices * sizeof(glm::vec3);
+    glBufferData(GL_ARRAY_BUFFER, verticesNBytes, _vertices, GL_STATIC_DRAW);
 
     // Generates and populates a VBO for vertex normals
     glGenBuffers(1, &(m_normalVBO));
     glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
-    size_t normalsNBytes = normals.size() * sizeof(normals[0]);
-    glBufferData(GL_ARRAY_BUFFER, normalsNBytes, normals.data(), GL_STATIC_DRAW);
+    size_t normalsNBytes = _nbNormals * sizeof(glm::vec3);
+    glBufferData(GL_ARRAY_BUFFER, normalsNBytes, _normals, GL_STATIC_DRAW);
 
     // Generates and populates a VBO for the element indices
     glGenBuffers(1, &(m_indexVBO));
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
-    auto indicesNBytes = indices.size() * sizeof(indices[0]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, indices.data(), GL_STATIC_DRAW);
+    size_t indicesNBytes = _nbIndices * sizeof(uint32_t);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, _indices, GL_STATIC_DRAW);
 
 
 
@@ -83,18 +116,356 @@ void DrawableMesh::createMeshVAO(TriMesh& _triMesh)
     glEnableVertexAttribArray(NORMAL);
     glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+    // add instance data to VAO
+    createInstanceVBO();
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
     glBindVertexArray(m_defaultVAO); // unbinds the VAO
 
     // Additional information required by draw calls
-    m_numVertices = (int)vertices.size();
-    m_numIndices = (int)indices.size();
+    m_numVertices = (int)_nbVertices;
+    m_numIndices = (int)_nbIndices;
+    m_lodRanges.clear();
+    m_lodErrors.clear();
+    m_clusterCuller.clear();
+    m_cullingStats = CullingStats();
+    m_occluderPositions.clear();
+    m_occluderIndices.clear();
+    m_occlusionStats = OcclusionStats();
+    m_lod = 0;
+}
 
-    // Clear temporary vectors
-    vertices.clear();
-    normals.clear();
-    indices.clear();
+
+void DrawableMesh::createMeshVAO(const VertexUploadViews& _vertices, std::span<const uint32_t> _indices)
+{
+    // Generates and populates a VBO for vertex coords
+    glGenBuffers(1, &(m_vertexVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+    glBufferData(GL_ARRAY_BUFFER, _vertices.position.bufferSize, _vertices.position.data, GL_STATIC_DRAW);
+
+    // Normals have their own VBO unless they are interleaved with vertex coords
+    GLuint normalBuffer = m_vertexVBO;
+    if (_vertices.normal.data != _vertices.position.data)
+    {
+        glGenBuffers(1, &(m_normalVBO));
+        glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+        glBufferData(GL_ARRAY_BUFFER, _vertices.normal.bufferSize, _vertices.normal.data, GL_STATIC_DRAW);
+        normalBuffer = m_normalVBO;
+    }
+
+    // Generates and populates a VBO for the element indices
+    glGenBuffers(1, &(m_indexVBO));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size_bytes(), _indices.data(), GL_STATIC_DRAW);
+
+
+    // Creates a vertex array object (VAO) for drawing the mesh
+    glGenVertexArrays(1, &(m_meshVAO));
+    glBindVertexArray(m_meshVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+    glEnableVertexAttribArray(POSITION);
+    glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, (GLsizei)_vertices.position.stride, (const void*)_vertices.position.offset);
+
+    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+    glEnableVertexAttribArray(NORMAL);
+    glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, (GLsizei)_vertices.normal.stride, (const void*)_vertices.normal.offset);
+
+    createInstanceVBO();
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    glBindVertexArray(m_defaultVAO); // unbinds the VAO
+
+    // Additional information required by draw calls
+    m_numVertices = (int)_vertices.nbVertices;
+    m_numIndices = (int)_indices.size();
+    m_lodRanges.clear();
+    m_lodErrors.clear();
+    m_clusterCuller.clear();
+    m_cullingStats = CullingStats();
+    m_occluderPositions.clear();
+    m_occluderIndices.clear();
+    m_occlusionStats = OcclusionStats();
+    m_lod = 0;
+}
+
+
+void DrawableMesh::beginMeshUpload(TriMesh& _triMesh, bool _releaseCPUData)
+{
+    // release previous buffers (if any)
+    glDeleteBuffers(1, &(m_vertexVBO));
+    glDeleteBuffers(1, &(m_normalVBO));
+    glDeleteBuffers(1, &(m_indexVBO));
+    glDeleteVertexArrays(1, &(m_meshVAO));
+
+    if (_releaseCPUData)
+    {
+        m_stagingVertices = _triMesh.takeVertices();
+        m_stagingNormals = _triMesh.takeNormals();
+        m_stagingIndices = _triMesh.takeIndices();
+        m_uploadVertices = m_stagingVertices;
+        m_uploadNormals = m_stagingNormals;
+        m_uploadIndices = m_stagingIndices;
+    }
+    else
+    {
+        m_uploadVertices = _triMesh.getVertexView();
+        m_uploadNormals = _triMesh.getNormalView();
+        m_uploadIndices = _triMesh.getIndexView();
+    }
+
+    // allocate buffers and VAO, data is uploaded later by uploadMeshSlice()
+    createMeshVAO(nullptr, m_uploadVertices.size(), nullptr, m_uploadNormals.size(), nullptr, m_uploadIndices.size());
+
+    m_numIndices = 0;
+    m_uploadedBytes = 0;
+    m_uploadPending = true;
+}
+
+
+bool DrawableMesh::uploadMeshSlice(size_t _maxBytes)
+{
+    if (!m_uploadPending)
+        return true;
+    if (_maxBytes == 0)
+        _maxBytes = SIZE_MAX;
+
+    // vertex coords, normals, then indices
+    struct UploadStream 
+    { 
+        GLenum target; 
+        GLuint buffer; 
+        const char* data; 
+        size_t size; 
+    };
+    UploadStream streams[3] = { { GL_ARRAY_BUFFER, m_vertexVBO, (const char*)m_uploadVertices.data(), m_uploadVertices.size_bytes() },
+                                { GL_ARRAY_BUFFER, m_normalVBO, (const char*)m_uploadNormals.data(), m_uploadNormals.size_bytes() },
+                                { GL_ELEMENT_ARRAY_BUFFER, m_indexVBO, (const char*)m_uploadIndices.data(), m_uploadIndices.size_bytes() } };
+
+    glBindVertexArray(m_defaultVAO); // do not modify the mesh VAO
+    size_t streamStart = 0;
+    for (const UploadStream& stream : streams)
+    {
+        size_t streamEnd = streamStart + stream.size;
+        if (m_uploadedBytes < streamEnd && _maxBytes > 0)
+        {
+            size_t offset = m_uploadedBytes - streamStart;
+            size_t nbBytes = std::min(_maxBytes, stream.size - offset);
+            glBindBuffer(stream.target, stream.buffer);
+            glBufferSubData(stream.target, offset, nbBytes, stream.data + offset);
+            m_uploadedBytes += nbBytes;
+            _maxBytes -= nbBytes;
+        }
+        streamStart = streamEnd;
+    }
+
+    // triangles can be drawn progressively as soon as vertex data is complete
+    size_t vertexBytes = streams[0].size + streams[1].size;
+    if (m_uploadedBytes > vertexBytes)
+        m_numIndices = (int)((m_uploadedBytes - vertexBytes) / sizeof(uint32_t) / 3 * 3);
+
+    if (m_uploadedBytes == streamStart)
+    {
+        // release CPU data (if it has been moved out of the mesh)
+        m_uploadVertices = {};
+        m_uploadNormals = {};
+        m_uploadIndices = {};
+        std::vector<glm::vec3>().swap(m_stagingVertices);
+        std::vector<glm::vec3>().swap(m_stagingNormals);
+        std::vector<uint32_t>().swap(m_stagingIndices);
+        m_uploadPending = false;
+    }
+    return !m_uploadPending;
+}
+
+
+float DrawableMesh::getUploadProgress() const
+{
+    if (!m_uploadPending)
+        return 1.0f;
+    size_t totalBytes = m_uploadVertices.size_bytes() + m_uploadNormals.size_bytes() + m_uploadIndices.size_bytes();
+    return (totalBytes != 0) ? (float)m_uploadedBytes / (float)totalBytes : 1.0f;
+}
+
+
+void DrawableMesh::uploadLODs(const TriMesh& _triMesh)
+{
+    if (m_uploadPending)
+    {
+        warningLog() << "DrawableMesh::uploadLODs(): mesh upload is not complete";
+        return;
+    }
+
+    // level 0: triangles already in the index VBO, then the simplified levels
+    m_lodRanges.assign(1, { 0, m_numIndices });
+    m_lodErrors.assign(1, 0.0f);
+    size_t nbIndices = (size_t)m_numIndices;
+    for (size_t level = 1; level < _triMesh.getNbLODs(); level++)
+    {
+        size_t count = _triMesh.getLODIndexView(level).size();
+        m_lodRanges.push_back({ nbIndices, (int)count });
+        m_lodErrors.push_back(_triMesh.getLODErrorBound(level));
+        nbIndices += count;
+    }
+
+    // bounding sphere of the AABB, for the projected error
+    m_boundingCenter = 0.5f * (_triMesh.getBBoxMin() + _triMesh.getBBoxMax());
+    m_boundingRadius = 0.5f * glm::length(_triMesh.getBBoxMax() - _triMesh.getBBoxMin());
+    updateInstanceBounds();
+
+    GLuint indexVBO = 0;
+    glGenBuffers(1, &indexVBO);
+    glBindVertexArray(m_defaultVAO); // do not modify the mesh VAO yet
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexVBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, nbIndices * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_indexVBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (size_t)m_numIndices * sizeof(uint32_t));
+    for (size_t level = 1; level < m_lodRanges.size(); level++)
+    {
+        std::span<const uint32_t> indices = _triMesh.getLODIndexView(level);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, m_lodRanges[level].offset * sizeof(uint32_t), indices.size_bytes(), indices.data());
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // the index VBO is part of the VAO state
+    glDeleteBuffers(1, &(m_indexVBO));
+    m_indexVBO = indexVBO;
+    glBindVertexArray(m_meshVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    glBindVertexArray(m_defaultVAO);
+
+    m_lod = std::min(m_lod, getNbLODs() - 1);
+}
+
+
+void DrawableMesh::uploadMeshlets(const TriMesh& _triMesh)
+{
+    if (m_uploadPending)
+    {
+        warningLog() << "DrawableMesh::uploadMeshlets(): mesh upload is not complete";
+        return;
+    }
+
+    std::span<const Meshlet> meshlets = _triMesh.getMeshlets();
+    if (!meshlets.empty() && meshlets.back().firstIndex + 3 * meshlets.back().nbTriangles > (uint32_t)m_numIndices)
+    {
+        warningLog() << "DrawableMesh::uploadMeshlets(): meshlets do not match the uploaded triangles";
+        return;
+    }
+    m_clusterCuller.setClusters(meshlets);
+}
+
+
+void DrawableMesh::uploadOccluder(const TriMesh& _triMesh, unsigned _maxTriangles)
+{
+    m_occluderPositions.clear();
+    m_occluderIndices.clear();
+    m_occluderError = 0.0f;
+
+    size_t level = 0;
+    while (level < _triMesh.getNbLODs() && _triMesh.getLODIndexView(level).size() > 3 * (size_t)_maxTriangles)
+        level++;
+    if (level == _triMesh.getNbLODs())
+    {
+        infoLog() << "DrawableMesh::uploadOccluder(): no level of detail has at most " << _maxTriangles
+                  << " triangles, no occlusion culling for this mesh";
+        return;
+    }
+
+    extractOccluder(_triMesh.getVertexView(), _triMesh.getLODIndexView(level), m_occluderPositions, m_occluderIndices);
+    m_occluderError = _triMesh.getLODErrorBound(level);
+}
+
+
+void DrawableMesh::setMaterials(std::span<const MaterialUniforms> _materials)
+{
+    if (_materials.size() > MAX_MATERIALS)
+        warningLog() << "DrawableMesh::setMaterials(): " << _materials.size() << " materials, only the first " << MAX_MATERIALS << " are kept";
+
+    m_nbMaterials = (unsigned)std::clamp(_materials.size(), (size_t)1, (size_t)MAX_MATERIALS);
+    std::copy_n(_materials.begin(), std::min(_materials.size(), (size_t)MAX_MATERIALS), m_materials);
+    m_materialsFrame = UINT64_MAX;
+}
+
+
+void DrawableMesh::setInstances(std::span<const glm::mat4> _modelMats, std::span<const uint32_t> _materialIndices)
+{
+    if (!_materialIndices.empty() && _materialIndices.size() != _modelMats.size())
+        warningLog() << "DrawableMesh::setInstances(): " << _materialIndices.size() << " material indices for " << _modelMats.size()
+                     << " instances, material 0 is used";
+
+    m_instanceMats.assign(_modelMats.begin(), _modelMats.end());
+    m_instances.resize(std::max(_modelMats.size(), (size_t)1));
+    for (size_t i = 0; i < m_instances.size(); i++)
+    {
+        m_instances[i].modelMat = _modelMats.empty() ? glm::mat4(1.0f) : _modelMats[i];
+        m_instances[i].materialIndex = (_materialIndices.size() == _modelMats.size() && !_materialIndices.empty())
+                                       ? std::min(_materialIndices[i], m_nbMaterials - 1) : 0;
+    }
+    updateInstanceBounds();
+
+    // the VBO is part of the VAO state: only its content changes
+    if (m_instanceVBO != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(InstanceData), m_instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+
+void DrawableMesh::updateInstanceBounds()
+{
+    m_instanceCenter = m_boundingCenter;
+    m_instanceRadius = m_boundingRadius;
+    m_instanceScale = 1.0f;
+    if (m_instanceMats.empty())
+        return;
+
+    // center of the box of the instance centers, then radius reaching the farthest instance sphere
+    glm::vec3 minCenter(FLT_MAX), maxCenter(-FLT_MAX);
+    for (const glm::mat4& instanceMat : m_instanceMats)
+    {
+        glm::vec3 center = glm::vec3(instanceMat * glm::vec4(m_boundingCenter, 1.0f));
+        minCenter = glm::min(minCenter, center);
+        maxCenter = glm::max(maxCenter, center);
+    }
+    m_instanceCenter = 0.5f * (minCenter + maxCenter);
+    m_instanceRadius = 0.0f;
+    m_instanceScale = 0.0f;
+    for (const glm::mat4& instanceMat : m_instanceMats)
+    {
+        float scale = std::max({ glm::length(glm::vec3(instanceMat[0])), glm::length(glm::vec3(instanceMat[1])), glm::length(glm::vec3(instanceMat[2])) });
+        glm::vec3 center = glm::vec3(instanceMat * glm::vec4(m_boundingCenter, 1.0f));
+        m_instanceRadius = std::max(m_instanceRadius, glm::length(center - m_instanceCenter) + scale * m_boundingRadius);
+        m_instanceScale = std::max(m_instanceScale, scale);
+    }
+}
+
+
+void DrawableMesh::createInstanceVBO()
+{
+    // a single default instance (identity, material 0) until instances are set
+    if (m_instances.empty())
+        m_instances.push_back({ glm::mat4(1.0f), 0 });
+
+    glDeleteBuffers(1, &(m_instanceVBO));
+    glGenBuffers(1, &(m_instanceVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(InstanceData), m_instances.data(), GL_STATIC_DRAW);
+
+    // model matrix as 4 column attributes, then the material index (integer attribute)
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(INSTANCE_MATRIX + column);
+        glVertexAttribPointer(INSTANCE_MATRIX + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const void*)(offsetof(InstanceData, modelMat) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(INSTANCE_MATRIX + column, 1);
+    }
+    glEnableVertexAttribArray(MATERIAL_INDEX);
+    glVertexAttribIPointer(MATERIAL_INDEX, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (const void*)offsetof(InstanceData, materialIndex));
+    glVertexAttribDivisor(MATERIAL_INDEX, 1);
 }
 
 
@@ -147,6 +518,8 @@ void DrawableMesh::createUnitCubeVAO()
     glEnableVertexAttribArray(NORMAL);
     glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+    createInstanceVBO();
+
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
     glBindVertexArray(m_defaultVAO); // unbinds the VAO
 
@@ -162,37 +535,138 @@ void DrawableMesh::createUnitCubeVAO()
 
 
 
-void DrawableMesh::draw(GLuint _program, glm::mat4& _modelMat, glm::mat4& _viewMat, glm::mat4& _projMat, glm::vec3& _lightPos,  glm::vec3& _camPos,  glm::vec3& _lightCol)
+void DrawableMesh::draw(const ProgramReflection& _program, UniformRing& _uniforms, const FrameUniforms& _frame, const glm::mat4& _modelMat)
 {
-    // Activate program
-    glUseProgram(_program);
-
+    const glm::mat4& viewMat = _frame.viewMat;
+    const glm::mat4& projMat = _frame.projMat;
+    float viewportWidth = _frame.viewport[2], viewportHeight = _frame.viewport[3];
+
+    if (!bindObjectUniforms(_program, _uniforms, _modelMat))
+        return;
+
+    // level of detail: coarsest one whose error projects under the pixel threshold (for the nearest instance, bounded
+    // with the sphere of all the instances, see updateInstanceBounds())
+    if (m_lodRanges.size() > 1)
+    {
+        glm::mat4 modelViewMat = viewMat * _modelMat;
+        if (m_instanceMats.empty())
+            m_pixelsPerUnit = computePixelsPerUnit(m_boundingCenter, m_boundingRadius, modelViewMat, projMat, viewportHeight);
+        else
+            m_pixelsPerUnit = computePixelsPerUnit(m_instanceCenter, m_instanceRadius, modelViewMat, projMat, viewportHeight) * m_instanceScale;
+        if (m_autoLOD)
+            m_lod = selectLOD(m_lodErrors, m_pixelsPerUnit, m_lod, m_lodPixelError, LOD_HYSTERESIS);
+    }
 
-    // Pass uniforms
-    glUniformMatrix4fv(glGetUniformLocation(_program, "u_matM"), 1, GL_FALSE, &_modelMat[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(_program, "u_matV"), 1, GL_FALSE, &_viewMat[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(_program, "u_matP"), 1, GL_FALSE, &_projMat[0][0]);
-    glUniform3fv(glGetUniformLocation(_program, "u_lightPos"), 1, &_lightPos[0]);
-    glUniform3fv(glGetUniformLocation(_program, "u_camPos"), 1, &_camPos[0]);
+    // Draw!
+    glBindVertexArray(m_meshVAO);   // bind the VAO (the index buffer is part of its state)
+    m_nbGLCalls++;
+
+    m_cullingStats = CullingStats();
+    if (m_lod == 0 && m_clusterCulling && !m_clusterCuller.isEmpty() && m_instanceMats.empty())
+    {
+        // full detail: only the visible meshlets, in a single call
+        auto startTime = std::chrono::steady_clock::now();
+
+        // occluder rasterized at low resolution (same aspect ratio as the viewport), then tested by the culler
+        const OcclusionBuffer* occlusionBuffer = nullptr;
+        m_occlusionStats = OcclusionStats();
+        if (m_occlusionCulling && !m_occluderIndices.empty() && viewportWidth > 0.0f)
+        {
+            unsigned width = OcclusionBuffer::DEFAULT_WIDTH;
+            m_occlusionBuffer.resize(width, (unsigned)std::lround((float)width * viewportHeight / viewportWidth));
+            Occluder occluder = { m_occluderPositions, m_occluderIndices, _modelMat, m_occluderError };
+            m_occlusionBuffer.render(std::span<const Occluder>(&occluder, 1), viewMat, projMat, m_occlusionBudget, 0, m_occlusionStats);
+            occlusionBuffer = &m_occlusionBuffer;
+        }
+        m_clusterCuller.cull(_modelMat, viewMat, projMat, viewportHeight, m_cullingParams, 0, m_visibleRanges, m_cullingStats, occlusionBuffer);
+        m_drawCounts.resize(m_visibleRanges.size());
+        m_drawOffsets.resize(m_visibleRanges.size());
+        for (size_t i = 0; i < m_visibleRanges.size(); i++)
+        {
+            m_drawCounts[i] = (GLsizei)m_visibleRanges[i].count;
+            m_drawOffsets[i] = (const void*)((size_t)m_visibleRanges[i].firstIndex * sizeof(uint32_t));
+        }
+        m_cullingTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (!m_visibleRanges.empty())
+        {
+            glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT, m_drawOffsets.data(), (GLsizei)m_visibleRanges.size());
+            m_nbGLCalls++;
+        }
+    }
+    else
+    {
+        drawLevel(m_lod);
+    }
+
+    // unbind the VAO, so that buffer bindings elsewhere do not modify it (the program can stay in use)
+    glBindVertexArray(m_defaultVAO);
+    m_nbGLCalls++;
+}
 
-    glUniform3fv(glGetUniformLocation(_program, "u_lightColor"), 1, &_lightCol[0]);
 
-    glUniform3fv(glGetUniformLocation(_program, "u_ambientColor"), 1, &m_ambientColor[0]);
-    glUniform3fv(glGetUniformLocation(_program, "u_diffuseColor"), 1, &m_diffuseColor[0]);
-    glUniform3fv(glGetUniformLocation(_program, "u_specularColor"), 1, &m_specularColor[0]);
-    glUniform1f(glGetUniformLocation(_program, "u_specularPower"), m_specPow);
+void DrawableMesh::drawCopy(const ProgramReflection& _program, UniformRing& _uniforms, const FrameUniforms& _frame, const glm::mat4& _modelMat, int& _lod)
+{
+    if (!bindObjectUniforms(_program, _uniforms, _modelMat))
+        return;
+
+    // level of detail of the copy, with the hysteresis of its own previous level
+    _lod = std::clamp(_lod, 0, getNbLODs() - 1);
+    if (m_lodRanges.size() > 1)
+    {
+        if (m_autoLOD)
+        {
+            float pixelsPerUnit = computePixelsPerUnit(m_boundingCenter, m_boundingRadius, _frame.viewMat * _modelMat, _frame.projMat, _frame.viewport[3]);
+            _lod = selectLOD(m_lodErrors, pixelsPerUnit, _lod, m_lodPixelError, LOD_HYSTERESIS);
+        }
+        else
+        {
+            _lod = m_lod;
+        }
+    }
 
-    // ...
+    glBindVertexArray(m_meshVAO);
+    m_nbGLCalls++;
+    drawLevel(_lod);
+    glBindVertexArray(m_defaultVAO);
+    m_nbGLCalls++;
+}
 
-    // Draw!
-    glBindVertexArray(m_meshVAO);                       // bind the VAO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);  // do not forget to bind the index buffer AFTER !
 
-    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
+bool DrawableMesh::bindObjectUniforms(const ProgramReflection& _program, UniformRing& _uniforms, const glm::mat4& _modelMat)
+{
+    // Activate program
+    glUseProgram(_program.getProgram());
+    m_nbGLCalls = 1;
+
+    // per-object block at each draw, materials once per frame (then shared by all the draws of the mesh)
+    ObjectUniforms object = { _modelMat };
+    GLintptr objectOffset = _uniforms.push(&object, sizeof(ObjectUniforms));
+    if (m_materialsFrame != _uniforms.getFrame())
+    {
+        m_materialsOffset = _uniforms.push(m_materials, sizeof(m_materials));
+        m_materialsFrame = _uniforms.getFrame();
+    }
+    if (objectOffset < 0 || m_materialsOffset < 0)
+        return false;
+    if (_program.hasBlock(OBJECT_BLOCK))
+        _uniforms.bind(OBJECT_BLOCK, objectOffset, sizeof(ObjectUniforms));
+    if (_program.hasBlock(MATERIAL_BLOCK))
+        _uniforms.bind(MATERIAL_BLOCK, m_materialsOffset, sizeof(m_materials));
+    return true;
+}
 
-    glBindVertexArray(m_defaultVAO);
 
-    glUseProgram(0);
+void DrawableMesh::drawLevel(int _lod)
+{
+    // same vertices for all levels of detail, only the index range changes
+    size_t firstIndex = m_lodRanges.empty() ? 0 : m_lodRanges[_lod].offset;
+    GLsizei count = m_lodRanges.empty() ? m_numIndices : m_lodRanges[_lod].count;
+    if (m_instanceMats.empty())
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (const void*)(firstIndex * sizeof(uint32_t)));
+    else
+        glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, (const void*)(firstIndex * sizeof(uint32_t)), (GLsizei)m_instanceMats.size());
+    m_nbGLCalls++;
 }
 
 
@@ -15,14 +15,44 @@
 #define QT_NO_OPENGL_ES_2
 #include <GL/glew.h>
 
+#include <algorithm>
 
 #include "trimesh.h"
+#include "meshlayout.h"
+#include "clusterculling.h"
+#include "occlusionbuffer.h"
+#include "uniformbuffers.h"
 
 // The attribute locations we will use in the vertex shader
 enum AttributeLocation 
 {
     POSITION = 0,
     NORMAL = 1,
+    INSTANCE_MATRIX = 2,    // mat4: locations 2 to 5
+    MATERIAL_INDEX = 6,
+};
+
+
+
+/*!
+* \struct LODRange
+* \brief Range of the indices of a level of detail in the index VBO
+*/
+struct LODRange
+{
+    size_t offset;  /*!< first index */
+    int count;      /*!< number of indices */
+};
+
+
+/*!
+* \struct InstanceData
+* \brief Per-instance vertex attributes (attribute divisor 1)
+*/
+struct InstanceData
+{
+    glm::mat4 modelMat;         /*!< model matrix of the instance, in the space of the mesh model matrix */
+    uint32_t materialIndex;     /*!< material of the instance (see DrawableMesh::setMaterials) */
 };
 
 
@@ -59,15 +89,144 @@ class DrawableMesh
         +-------------------------------------------------------------------------------------------------------------*/
 
 
+        /*! \fn getNumIndices */
+        inline int getNumIndices() const { return m_numIndices; }
+
+        /*! \fn getNbLODs */
+        inline int getNbLODs() const { return std::max((int)m_lodRanges.size(), 1); }
+        /*! \fn getLOD */
+        inline int getLOD() const { return m_lod; }
+        /*!
+        * \fn setLOD
+        * \brief select the level of detail to draw (clamped to the uploaded levels): only the drawn index range changes
+        * (ignored while automatic selection is enabled)
+        */
+        inline void setLOD(int _level) { m_lod = std::clamp(_level, 0, getNbLODs() - 1); }
+        /*! \fn isAutoLOD */
+        inline bool isAutoLOD() const { return m_autoLOD; }
+        /*!
+        * \fn setAutoLOD
+        * \brief select the level of detail at each draw from its projected error (see ::selectLOD)
+        */
+        inline void setAutoLOD(bool _autoLOD) { m_autoLOD = _autoLOD; }
+        /*! \fn getLODPixelError */
+        inline float getLODPixelError() const { return m_lodPixelError; }
+        /*!
+        * \fn setLODPixelError
+        * \brief max projected error of the automatically selected level of detail, in pixels
+        */
+        inline void setLODPixelError(float _pixels) { m_lodPixelError = _pixels; }
+        /*!
+        * \fn getProjectedError
+        * \brief projected error of the level of detail drawn last, in pixels
+        */
+        inline float getProjectedError() const { return (m_lod == 0) ? 0.0f : m_lodErrors[m_lod] * m_pixelsPerUnit; }
+        /*!
+        * \fn getNumDrawnIndices
+        * \brief number of indices drawn at the current level of detail
+        */
+        inline int getNumDrawnIndices() const
+        {
+            if (m_cullingStats.nbTested > 0)
+                return 3 * (int)m_cullingStats.nbTrianglesSubmitted;
+            return m_lodRanges.empty() ? m_numIndices : m_lodRanges[m_lod].count;
+        }
+        /*! \fn getNbMeshlets */
+        inline int getNbMeshlets() const { return (int)m_clusterCuller.getNbClusters(); }
+        /*! \fn isClusterCulling */
+        inline bool isClusterCulling() const { return m_clusterCulling; }
+        /*!
+        * \fn setClusterCulling
+        * \brief cull the meshlets of the full-detail level at each draw (see ClusterCuller) and draw the visible ones
+        * with a single glMultiDrawElements()
+        */
+        inline void setClusterCulling(bool _clusterCulling) { m_clusterCulling = _clusterCulling; }
+        /*! \fn getCullingParams */
+        inline const ClusterCullingParams& getCullingParams() const { return m_cullingParams; }
+        /*! \fn setCullingParams */
+        inline void setCullingParams(const ClusterCullingParams& _params) { m_cullingParams = _params; }
+        /*!
+        * \fn getCullingStats
+        * \brief result of the cluster culling of the last draw (empty if the last draw was not culled)
+        */
+        inline const CullingStats& getCullingStats() const { return m_cullingStats; }
+        /*!
+        * \fn getCullingTime
+        * \brief CPU time of the cluster culling of the last draw, occluder rasterization included, in ms
+        */
+        inline float getCullingTime() const { return m_cullingTime; }
+        /*! \fn getNbOccluderTriangles */
+        inline int getNbOccluderTriangles() const { return (int)m_occluderIndices.size() / 3; }
+        /*! \fn isOcclusionCulling */
+        inline bool isOcclusionCulling() const { return m_occlusionCulling; }
+        /*!
+        * \fn setOcclusionCulling
+        * \brief rasterize the occluder in an OcclusionBuffer at each draw and cull the meshlets hidden behind it
+        * (needs cluster culling and an occluder, see uploadOccluder()). Off by default: a mesh only occludes its own
+        * meshlets, which are mostly culled by the backface test already, so the rasterization rarely pays for itself.
+        */
+        inline void setOcclusionCulling(bool _occlusionCulling) { m_occlusionCulling = _occlusionCulling; }
+        /*! \fn getOcclusionBudget */
+        inline float getOcclusionBudget() const { return m_occlusionBudget; }
+        /*!
+        * \fn setOcclusionBudget
+        * \brief max time of the occluder rasterization per draw, in ms (0 = no limit)
+        */
+        inline void setOcclusionBudget(float _ms) { m_occlusionBudget = std::max(_ms, 0.0f); }
+        /*!
+        * \fn getOcclusionStats
+        * \brief occluder rasterization of the last draw (empty if the last draw was not occlusion culled)
+        */
+        inline const OcclusionStats& getOcclusionStats() const { return m_occlusionStats; }
+        /*! \fn isUploadComplete */
+        inline bool isUploadComplete() const { return !m_uploadPending; }
+
+        /*!
+        * \fn getUploadProgress
+        * \brief get progress of the current progressive upload
+        * \return progress in [0,1]
+        */
+        float getUploadProgress() const;
+
+        /*!
+        * \fn getNbGLCalls
+        * \brief number of GL calls of the last draw, uniform buffer updates and bindings excluded (see UniformRing)
+        */
+        inline unsigned getNbGLCalls() const { return m_nbGLCalls; }
+
+        /*!
+        * \fn getNbInstances
+        * \brief number of instances drawn by draw() (1 if no instance is set)
+        */
+        inline int getNbInstances() const { return std::max((int)m_instanceMats.size(), 1); }
+        /*! \fn getNbMaterials */
+        inline int getNbMaterials() const { return (int)m_nbMaterials; }
+
         /*! \fn setSpeculatPower */
-        inline void setSpeculatPower(float _specPow) { m_specPow = _specPow; }
+        inline void setSpeculatPower(float _specPow) { m_materials[0].specularPower = _specPow; m_materialsFrame = UINT64_MAX; }
 
         /*! \fn setAmbientColor */
-        inline void setAmbientColor(int _r, int _g, int _b) { m_ambientColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setAmbientColor(int _r, int _g, int _b) { m_materials[0].ambientColor = glm::vec4( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f, 1.0f ); m_materialsFrame = UINT64_MAX; }
         /*! \fn setAmbientColor */
-        inline void setDiffuseColor(int _r, int _g, int _b) { m_diffuseColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setDiffuseColor(int _r, int _g, int _b) { m_materials[0].diffuseColor = glm::vec4( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f, 1.0f ); m_materialsFrame = UINT64_MAX; }
         /*! \fn setAmbientColor */
-        inline void setSpecularColor(int _r, int _g, int _b) { m_specularColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setSpecularColor(int _r, int _g, int _b) { m_materials[0].specularColor = glm::vec4( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f, 1.0f ); m_materialsFrame = UINT64_MAX; }
+
+        /*!
+        * \fn setMaterials
+        * \brief set the materials indexed by the instances (at most MAX_MATERIALS, the color setters modify material 0,
+        * used when no instance is set)
+        */
+        void setMaterials(std::span<const MaterialUniforms> _materials);
+
+        /*!
+        * \fn setInstances
+        * \brief draw copies of the mesh with a single glDrawElementsInstanced(): model matrices (applied before the model
+        * matrix of draw()) and material indices are uploaded once in the instance VBO
+        * \param _modelMats : model matrix of each instance (empty = a single copy drawn with the model matrix of draw())
+        * \param _materialIndices : material of each instance (empty = material 0), clamped to the number of materials
+        */
+        void setInstances(std::span<const glm::mat4> _modelMats, std::span<const uint32_t> _materialIndices = {});
 
 
 
@@ -77,10 +236,62 @@ class DrawableMesh
 
         /*!
         * \fn createMeshVAO
-        * \brief Create mesh VAO and VBOs.
+        * \brief Create mesh VAO and VBOs, uploaded directly from the mesh arrays (no copy).
         * \param _triMesh : Mesh to update mesh VAO and VBOs from
         */
-        void createMeshVAO(TriMesh& _triMesh);
+        void createMeshVAO(const TriMesh& _triMesh);
+
+        /*!
+        * \fn createMeshVAO
+        * \brief Create mesh VAO and VBOs from vertex data in any storage layout (see LayoutMesh::getUploadViews()).
+        * Attributes sharing the same buffer (interleaved layouts) are uploaded in a single VBO.
+        * \param _vertices : vertex attributes
+        * \param _indices : triangles
+        */
+        void createMeshVAO(const VertexUploadViews& _vertices, std::span<const uint32_t> _indices);
+
+        /*!
+        * \fn beginMeshUpload
+        * \brief Create mesh VAO and allocate VBOs, data is then uploaded in slices by uploadMeshSlice().
+        * \param _triMesh : Mesh to upload (read through views: it must not be modified nor destroyed until upload is complete)
+        * \param _releaseCPUData : move the arrays out of the mesh and release them once uploaded
+        */
+        void beginMeshUpload(TriMesh& _triMesh, bool _releaseCPUData = false);
+
+        /*!
+        * \fn uploadMeshSlice
+        * \brief Upload the next slice of the mesh started with beginMeshUpload() (vertices, normals, then indices).
+        * Triangles whose indices are uploaded can be drawn as soon as vertex data is complete.
+        * \param _maxBytes : max number of bytes to upload in this call (0 = no limit)
+        * \return true if the whole mesh is uploaded
+        */
+        bool uploadMeshSlice(size_t _maxBytes);
+
+        /*!
+        * \fn uploadLODs
+        * \brief Upload the levels of detail of a mesh (see TriMesh::generateLODs) in a new index VBO, after the triangles
+        * already uploaded (copied on the GPU). Vertex VBOs are not modified: all levels index the same vertices.
+        * \param _triMesh : mesh whose vertex data is already uploaded (upload must be complete)
+        */
+        void uploadLODs(const TriMesh& _triMesh);
+
+        /*!
+        * \fn uploadMeshlets
+        * \brief Keep the meshlets of a mesh (see TriMesh::buildMeshlets) for cluster culling. The index VBO is not
+        * modified: the full-detail triangles are uploaded in meshlet order, so each meshlet is a range of level 0.
+        * \param _triMesh : mesh whose indices are already uploaded (upload must be complete)
+        */
+        void uploadMeshlets(const TriMesh& _triMesh);
+
+        /*!
+        * \fn uploadOccluder
+        * \brief Keep a copy of the finest level of detail of a mesh with at most _maxTriangles triangles, with only the
+        * vertices it uses, as occluder of the occlusion culling. If no level is that small, the mesh gets no occluder
+        * (its occlusion culling is skipped) rather than a larger one that would cost more than it saves.
+        * \param _triMesh : mesh with its levels of detail (see TriMesh::generateLODs)
+        * \param _maxTriangles : max number of triangles of the occluder
+        */
+        void uploadOccluder(const TriMesh& _triMesh, unsigned _maxTriangles = 4096);
 
         /*!
         * \fn createUnitCubeVAO
@@ -92,16 +303,30 @@ class DrawableMesh
 
         /*!
         * \fn draw
-        * \brief Draw the content of the mesh VAO
-        * \param _program : shader program
+        * \brief Draw the content of the mesh VAO (at the level of detail selected from the matrices, if enabled).
+        * The per-object block is written in the ring and bound by range at each draw, the per-material block once per
+        * frame: no uniform is set by name.
+        * Instances (see setInstances()) are drawn with the finest level of detail needed by the nearest one (estimated from
+        * a bounding sphere of all the instances), without cluster culling.
+        * \param _program : shader program, with the per-object and per-material blocks (see ProgramReflection)
+        * \param _uniforms : ring buffer of the uniform blocks, the per-frame block being already bound
+        * \param _frame : content of the per-frame block (camera matrices and viewport)
         * \param _modelMat : model matrix
-        * \param _viewMat :camera view matrix
-        * \param _projMat :camera projection matrix
-        * \param _lightPos : 3D coords of light position
-        * \param _lightCol : RGB color of the light
         */
-        void draw(GLuint _program, glm::mat4& _modelMat, glm::mat4& _viewMat, glm::mat4& _projMat, glm::vec3& _lightPos, glm::vec3& _camPos, glm::vec3& _lightCol);
+        void draw(const ProgramReflection& _program, UniformRing& _uniforms, const FrameUniforms& _frame, const glm::mat4& _modelMat);
 
+        /*!
+        * \fn drawCopy
+        * \brief Draw one of many copies of the mesh, each with its own level of detail (e.g., stress test without
+        * instancing). Cluster and occlusion culling are skipped (their cost would be paid at each copy), and the level of
+        * detail of the mesh (getLOD(), with its hysteresis) is left untouched.
+        * \param _program : shader program, with the per-object and per-material blocks (see ProgramReflection)
+        * \param _uniforms : ring buffer of the uniform blocks, the per-frame block being already bound
+        * \param _frame : content of the per-frame block (camera matrices and viewport)
+        * \param _modelMat : model matrix of the copy
+        * \param _lod : level of detail of the copy at its previous draw, updated (fixed to getLOD() without auto LOD)
+        */
+        void drawCopy(const ProgramReflection& _program, UniformRing& _uniforms, const FrameUniforms& _frame, const glm::mat4& _modelMat, int& _lod);
         
 
 
@@ -121,16 +346,93 @@ class DrawableMesh
 
         int m_numVertices;          /*!< number of vertices in the VBOs */
         int m_numIndices;           /*!< number of indices in the index VBO */
-
-        float m_specPow;            /*!< specular power */
-
-        glm::vec3 m_ambientColor;   /*!< ambient color */
-        glm::vec3 m_diffuseColor;   /*!< diffuse color */
-        glm::vec3 m_specularColor;  /*!< specular color */
+        std::vector<LODRange> m_lodRanges;  /*!< index range of each level of detail (empty if there is a single level) */
+        std::vector<float> m_lodErrors;     /*!< geometric error of each level of detail, with LOD_ERROR_MARGIN (model space) */
+        ClusterCuller m_clusterCuller;      /*!< meshlets of level 0 (ranges of the index VBO, empty if not built) */
+        bool m_clusterCulling;              /*!< flag to cull meshlets before drawing level 0 */
+        ClusterCullingParams m_cullingParams;   /*!< tests of the cluster culling */
+        CullingStats m_cullingStats;        /*!< result of the cluster culling of the last draw */
+        float m_cullingTime;                /*!< CPU time of the cluster culling of the last draw (ms) */
+        std::vector<glm::vec3> m_occluderPositions; /*!< vertex coords of the occluder (CPU copy) */
+        std::vector<uint32_t> m_occluderIndices;    /*!< triangles of the occluder (CPU copy, empty if none) */
+        float m_occluderError;                      /*!< geometric error of the occluder, with LOD_ERROR_MARGIN (model space) */
+        OcclusionBuffer m_occlusionBuffer;          /*!< occluder rasterized at the last draw */
+        bool m_occlusionCulling;                    /*!< flag to cull meshlets hidden behind the occluder */
+        float m_occlusionBudget;                    /*!< max time of the occluder rasterization (ms, 0 = no limit) */
+        OcclusionStats m_occlusionStats;            /*!< occluder rasterization of the last draw */
+        std::vector<IndexRange> m_visibleRanges;    /*!< index ranges of the visible meshlets */
+        std::vector<GLsizei> m_drawCounts;          /*!< glMultiDrawElements() counts */
+        std::vector<const void*> m_drawOffsets;     /*!< glMultiDrawElements() offsets */
+        int m_lod;                  /*!< level of detail to draw */
+        bool m_autoLOD;             /*!< flag to select the level of detail from its projected error */
+        float m_lodPixelError;      /*!< max projected error of the selected level of detail, in pixels */
+        float m_pixelsPerUnit;      /*!< projection scale of the last draw (pixels per model space unit) */
+        glm::vec3 m_boundingCenter; /*!< bounding sphere of the mesh (model space) */
+        float m_boundingRadius;     /*!< bounding sphere of the mesh (model space) */
+
+        MaterialUniforms m_materials[MAX_MATERIALS];    /*!< colors and specular power (per-material block) */
+        unsigned m_nbMaterials;                         /*!< number of materials set */
+        uint64_t m_materialsFrame;                      /*!< frame of the ring in which the materials were written */
+        GLintptr m_materialsOffset;                     /*!< offset of the materials in the ring */
+        unsigned m_nbGLCalls;                           /*!< GL calls of the last draw (uniform buffer excluded) */
+
+        GLuint m_instanceVBO;                           /*!< name of instance data VBO (a single default instance if none is set) */
+        std::vector<glm::mat4> m_instanceMats;          /*!< model matrix of each instance (CPU copy) */
+        glm::vec3 m_instanceCenter;                     /*!< sphere enclosing the bounding spheres of the instances */
+        float m_instanceRadius;                         /*!< sphere enclosing the bounding spheres of the instances */
+        float m_instanceScale;                          /*!< largest scale of the instance matrices */
+        std::vector<InstanceData> m_instances;          /*!< content of the instance VBO */
 
         bool m_vertexProvided;      /*!< flag to indicate if vertex coords are available or not */
         bool m_normalProvided;      /*!< flag to indicate if normals are available or not */
         bool m_indexProvided;       /*!< flag to indicate if indices are available or not */
 
+        std::span<const glm::vec3> m_uploadVertices;    /*!< vertex coords waiting for progressive upload */
+        std::span<const glm::vec3> m_uploadNormals;     /*!< normals waiting for progressive upload */
+        std::span<const uint32_t> m_uploadIndices;      /*!< indices waiting for progressive upload */
+        std::vector<glm::vec3> m_stagingVertices;       /*!< vertex coords moved out of the mesh (if CPU data is released) */
+        std::vector<glm::vec3> m_stagingNormals;        /*!< normals moved out of the mesh (if CPU data is released) */
+        std::vector<uint32_t> m_stagingIndices;         /*!< indices moved out of the mesh (if CPU data is released) */
+        size_t m_uploadedBytes;                     /*!< number of bytes already uploaded */
+        bool m_uploadPending;                       /*!< flag to indicate if a progressive upload is in progress */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn createMeshVAO
+        * \brief Create mesh VAO and VBOs from raw arrays.
+        */
+        void createMeshVAO(const glm::vec3* _vertices, size_t _nbVertices, const glm::vec3* _normals, size_t _nbNormals, 
+                           const uint32_t* _indices, size_t _nbIndices);
+
+        /*!
+        * \fn createInstanceVBO
+        * \brief Create the instance VBO and add its attributes to the bound VAO (divisor 1)
+        */
+        void createInstanceVBO();
+
+        /*!
+        * \fn updateInstanceBounds
+        * \brief sphere enclosing the bounding spheres of the instances, and their largest scale: the pixels per unit of
+        * the nearest instance are at most the ones of this sphere times this scale
+        */
+        void updateInstanceBounds();
+
+        /*!
+        * \fn bindObjectUniforms
+        * \brief use the program, write the per-object block in the ring (and the materials once per frame) and bind them
+        * \return false if the ring is full (nothing can be drawn)
+        */
+        bool bindObjectUniforms(const ProgramReflection& _program, UniformRing& _uniforms, const glm::mat4& _modelMat);
+
+        /*!
+        * \fn drawLevel
+        * \brief draw the index range of a level of detail, with the instances if any (mesh VAO bound)
+        */
+        void drawLevel(int _lod);
+
 };
 #endif // DRAWABLEMESH_H
@@ -0,0 +1,212 @@
+/*********************************************************************************************************************
+ *
+ * flathashmap.h
+ *
+ * Open-addressing hash map used to weld vertices (key -> vertex index)
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct UVec3Hash
+* \brief Hash functor for (v, vt, vn) index tuples
+*/
+struct UVec3Hash
+{
+    size_t operator() (const glm::uvec3& _key) const
+    {
+        uint64_t h = (uint64_t)_key.x * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)_key.y + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        h ^= ((uint64_t)_key.z + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+
+/*!
+* \class FlatHashMap
+* \brief Flat hash map with linear probing, storing a uint32_t value (e.g., a vertex index) per key
+* All entries live in a single contiguous array, there is no per-entry allocation and no erase.
+* \tparam Key : key type (must be equality comparable)
+* \tparam Hash : hash functor for Key
+*/
+template<typename Key, typename Hash>
+class FlatHashMap
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn FlatHashMap
+        * \brief Constructor of FlatHashMap
+        * \param _expectedSize : number of entries to pre-allocate room for
+        */
+        FlatHashMap(size_t _expectedSize = 0) : m_size(0), m_mask(0)
+        {
+            reserve(_expectedSize);
+        }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn size */
+        size_t size() const { return m_size; }
+
+        /*! \fn capacity */
+        size_t capacity() const { return m_slots.size(); }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn reserve
+        * \brief make room for a given number of entries without rehashing (max load factor is 1/2)
+        * \param _expectedSize : number of entries
+        */
+        void reserve(size_t _expectedSize)
+        {
+            size_t capacity = 16;
+            while (capacity < _expectedSize * 2)
+                capacity *= 2;
+            if (capacity > m_slots.size())
+                rehash(capacity);
+        }
+
+        /*!
+        * \fn findOrInsert
+        * \brief find a key, insert it with a given value if it is not in the map
+        * \param _key : key to look for
+        * \param _value : value to insert if key is not found (must not be EMPTY)
+        * \return pair (value associated to the key, true if the key has been inserted)
+        */
+        std::pair<uint32_t, bool> findOrInsert(const Key& _key, uint32_t _value)
+        {
+            if ((m_size + 1) * 2 > m_slots.size())
+                rehash(m_slots.size() * 2);
+
+            size_t i = m_hash(_key) & m_mask;
+            while (true)
+            {
+                Slot& slot = m_slots[i];
+                if (slot.value == EMPTY)
+                {
+                    slot.key = _key;
+                    slot.value = _value;
+                    m_size++;
+                    return std::make_pair(_value, true);
+                }
+                if (slot.key == _key)
+                    return std::make_pair(slot.value, false);
+                i = (i + 1) & m_mask;
+            }
+        }
+
+        /*!
+        * \fn find
+        * \brief find a key
+        * \param _key : key to look for
+        * \return value associated to the key, EMPTY if not found
+        */
+        uint32_t find(const Key& _key) const
+        {
+            if (m_slots.empty())
+                return EMPTY;
+
+            size_t i = m_hash(_key) & m_mask;
+            while (m_slots[i].value != EMPTY)
+            {
+                if (m_slots[i].key == _key)
+                    return m_slots[i].value;
+                i = (i + 1) & m_mask;
+            }
+            return EMPTY;
+        }
+
+        /*!
+        * \fn clear
+        * \brief remove all entries and release memory
+        */
+        void clear()
+        {
+            std::vector<Slot>().swap(m_slots);
+            m_size = 0;
+            m_mask = 0;
+        }
+
+
+        static constexpr uint32_t EMPTY = 0xFFFFFFFFu;  /*!< value marking an empty slot */
+
+
+    protected:
+
+        /*!
+        * \struct Slot
+        * \brief key/value pair stored in the table
+        */
+        struct Slot
+        {
+            Key key;
+            uint32_t value = EMPTY;
+        };
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        std::vector<Slot> m_slots;  /*!< table of slots (size is a power of 2) */
+        size_t m_size;              /*!< number of entries */
+        size_t m_mask;              /*!< table size - 1 */
+        Hash m_hash;                /*!< hash functor */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn rehash
+        * \brief re-insert all entries in a new table
+        * \param _capacity : new table size (power of 2)
+        */
+        void rehash(size_t _capacity)
+        {
+            if (_capacity < 16)
+                _capacity = 16;
+
+            std::vector<Slot> oldSlots(_capacity);
+            oldSlots.swap(m_slots);
+            m_mask = _capacity - 1;
+
+            for (const Slot& slot : oldSlots)
+            {
+                if (slot.value == EMPTY)
+                    continue;
+                size_t i = m_hash(slot.key) & m_mask;
+                while (m_slots[i].value != EMPTY)
+                    i = (i + 1) & m_mask;
+                m_slots[i] = slot;
+            }
+        }
+};
+
+#endif // FLATHASHMAP_H
@@ -0,0 +1,443 @@
+/*********************************************************************************************************************
+ *
+ * geometryarena.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "geometryarena.h"
+#include "GLtools.h"
+
+#include <algorithm>
+#include <cstddef>
+
+
+/*!
+* \fn reallocateBuffer
+* \brief replace a buffer by a new one of _newSize bytes, holding the first bytes of the old one (copied on the GPU)
+*/
+static GLuint reallocateBuffer(GLuint _buffer, size_t _oldSize, size_t _newSize)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)_newSize, nullptr, GL_STATIC_DRAW);
+    if (_buffer != 0 && _oldSize > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, _buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)std::min(_oldSize, _newSize));
+    }
+    glDeleteBuffers(1, &_buffer);
+    return buffer;
+}
+
+
+/*!
+* \fn relocateBuffer
+* \brief apply the relocations of RangeAllocator::compact() to a buffer: ranges are copied in place, except those
+* overlapping their old range, copied through _scratch (a buffer of _scratchSize bytes, enlarged if needed)
+*/
+static void relocateBuffer(GLuint _buffer, const std::vector<Relocation>& _relocations, size_t _elementSize, GLuint& _scratch, size_t& _scratchSize)
+{
+    for (const Relocation& relocation : _relocations)
+    {
+        GLintptr src = (GLintptr)(relocation.oldOffset * _elementSize), dst = (GLintptr)(relocation.newOffset * _elementSize);
+        GLsizeiptr size = (GLsizeiptr)(relocation.size * _elementSize);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, _buffer);
+        if (relocation.newOffset + relocation.size <= relocation.oldOffset)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src, dst, size);
+            continue;
+        }
+
+        // overlapping ranges of the same buffer cannot be copied directly
+        if ((size_t)size > _scratchSize)
+        {
+            glDeleteBuffers(1, &_scratch);
+            glGenBuffers(1, &_scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_COPY);
+            _scratchSize = (size_t)size;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _scratch);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src, 0, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, _scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, dst, size);
+    }
+}
+
+
+/*!
+* \fn relocatedOffset
+* \brief new offset of the range starting at _offset (unchanged if it was not moved)
+*/
+static uint32_t relocatedOffset(const std::vector<Relocation>& _relocations, uint32_t _offset)
+{
+    auto it = std::lower_bound(_relocations.begin(), _relocations.end(), _offset,
+                               [](const Relocation& _relocation, uint32_t _key) { return _relocation.oldOffset < _key; });
+    return (it != _relocations.end() && it->oldOffset == _offset) ? it->newOffset : _offset;
+}
+
+
+GeometryArena::~GeometryArena()
+{
+    glDeleteBuffers(1, &m_vertexVBO);
+    glDeleteBuffers(1, &m_normalVBO);
+    glDeleteBuffers(1, &m_indexVBO);
+    glDeleteBuffers(1, &m_instanceVBO);
+    glDeleteBuffers(1, &m_indirectBuffer);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+
+void GeometryArena::setMaterials(std::span<const MaterialUniforms> _materials)
+{
+    if (_materials.size() > MAX_MATERIALS)
+        warningLog() << "GeometryArena::setMaterials(): " << _materials.size() << " materials, only the first " << MAX_MATERIALS << " are kept";
+
+    m_nbMaterials = (unsigned)std::clamp(_materials.size(), (size_t)1, (size_t)MAX_MATERIALS);
+    std::copy_n(_materials.begin(), std::min(_materials.size(), (size_t)MAX_MATERIALS), m_materials);
+    m_materialsFrame = UINT64_MAX;
+}
+
+
+void GeometryArena::create(uint32_t _vertexCapacity, uint32_t _indexCapacity)
+{
+    glDeleteBuffers(1, &m_vertexVBO);
+    glDeleteBuffers(1, &m_normalVBO);
+    glDeleteBuffers(1, &m_indexVBO);
+    glDeleteBuffers(1, &m_instanceVBO);
+    glDeleteBuffers(1, &m_indirectBuffer);
+    glDeleteVertexArrays(1, &m_vao);
+    m_vertexVBO = m_normalVBO = m_indexVBO = 0;
+
+    m_vertexAllocator.reset(0);
+    m_indexAllocator.reset(0);
+    m_vertexBlocks.clear();
+    m_meshes.clear();
+    m_freeMeshes.clear();
+    m_commands.clear();
+    m_instances.clear();
+    m_nbDefragmentations = 0;
+
+    // multi-draw-indirect is core in 4.3, reading the instance rows through baseInstance in 4.2
+    m_multiDrawIndirect = (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+    infoLog() << "GeometryArena::create(): " << (m_multiDrawIndirect ? "multi-draw-indirect" : "one draw call per mesh (no multi-draw-indirect)");
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_instanceVBO);
+    glGenBuffers(1, &m_indirectBuffer);
+
+    // mesh VBOs are attached to the VAO by resizeBuffers()
+    resizeBuffers(std::max(_vertexCapacity, 1u), std::max(_indexCapacity, 1u));
+    m_vertexAllocator.reset(std::max(_vertexCapacity, 1u));
+    m_indexAllocator.reset(std::max(_indexCapacity, 1u));
+
+    // instance attributes: one row of InstanceData per draw, selected by baseInstance
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(INSTANCE_MATRIX + column);
+        glVertexAttribDivisor(INSTANCE_MATRIX + column, 1);
+    }
+    glEnableVertexAttribArray(MATERIAL_INDEX);
+    glVertexAttribDivisor(MATERIAL_INDEX, 1);
+    setInstanceAttributes(0);
+    glBindVertexArray(0);
+}
+
+
+void GeometryArena::resizeBuffers(uint32_t _vertexCapacity, uint32_t _indexCapacity)
+{
+    if (m_vertexVBO == 0 || _vertexCapacity != m_vertexAllocator.getCapacity())
+    {
+        m_vertexVBO = reallocateBuffer(m_vertexVBO, m_vertexAllocator.getCapacity() * sizeof(glm::vec3), _vertexCapacity * sizeof(glm::vec3));
+        m_normalVBO = reallocateBuffer(m_normalVBO, m_vertexAllocator.getCapacity() * sizeof(glm::vec3), _vertexCapacity * sizeof(glm::vec3));
+    }
+    if (m_indexVBO == 0 || _indexCapacity != m_indexAllocator.getCapacity())
+        m_indexVBO = reallocateBuffer(m_indexVBO, m_indexAllocator.getCapacity() * sizeof(uint32_t), _indexCapacity * sizeof(uint32_t));
+
+    // attach the new buffers to the VAO
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+    glEnableVertexAttribArray(POSITION);
+    glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+    glEnableVertexAttribArray(NORMAL);
+    glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBindVertexArray(0);
+}
+
+
+uint32_t GeometryArena::allocateRange(bool _vertices, uint32_t _size)
+{
+    RangeAllocator& allocator = _vertices ? m_vertexAllocator : m_indexAllocator;
+
+    uint32_t offset = allocator.allocate(_size);
+    if (offset != RangeAllocator::INVALID_OFFSET)
+        return offset;
+
+    // enough free space, but fragmented
+    if (allocator.getFree() >= _size)
+    {
+        defragment();
+        offset = allocator.allocate(_size);
+        if (offset != RangeAllocator::INVALID_OFFSET)
+            return offset;
+    }
+
+    // not enough space: double the capacity (at least)
+    uint64_t capacity = std::max((uint64_t)allocator.getCapacity() * 2, (uint64_t)allocator.getUsed() + _size);
+    if (capacity >= RangeAllocator::INVALID_OFFSET)
+    {
+        warningLog() << "GeometryArena::allocateRange(): cannot grow the " << (_vertices ? "vertex" : "index") << " buffer above "
+                     << allocator.getCapacity() << " elements";
+        return RangeAllocator::INVALID_OFFSET;
+    }
+    if (_vertices)
+        resizeBuffers((uint32_t)capacity, m_indexAllocator.getCapacity());
+    else
+        resizeBuffers(m_vertexAllocator.getCapacity(), (uint32_t)capacity);
+    allocator.grow((uint32_t)capacity);
+    return allocator.allocate(_size);
+}
+
+
+uint32_t GeometryArena::addMesh(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals, std::span<const uint32_t> _indices)
+{
+    if (_positions.empty() || _indices.empty() || _normals.size() != _positions.size())
+    {
+        warningLog() << "GeometryArena::addMesh(): " << _positions.size() << " vertices, " << _normals.size() << " normals and "
+                     << _indices.size() << " indices, mesh is not added";
+        return INVALID_MESH;
+    }
+    if (*std::max_element(_indices.begin(), _indices.end()) >= _positions.size())
+    {
+        warningLog() << "GeometryArena::addMesh(): indices out of the " << _positions.size() << " vertices, mesh is not added";
+        return INVALID_MESH;
+    }
+
+    uint32_t vertexOffset = allocateRange(true, (uint32_t)_positions.size());
+    if (vertexOffset == RangeAllocator::INVALID_OFFSET)
+        return INVALID_MESH;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertexOffset * sizeof(glm::vec3)), (GLsizeiptr)_positions.size_bytes(), _positions.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_normalVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertexOffset * sizeof(glm::vec3)), (GLsizeiptr)_normals.size_bytes(), _normals.data());
+
+    // vertex block registered before allocating the indices (a defragmentation may move it), counted once the mesh is
+    // added
+    auto block = std::find_if(m_vertexBlocks.begin(), m_vertexBlocks.end(), [](const VertexBlock& _block) { return _block.nbMeshes == 0; });
+    if (block == m_vertexBlocks.end())
+        block = m_vertexBlocks.insert(block, { vertexOffset, 0 });
+    else
+        block->offset = vertexOffset;
+    block->nbMeshes = 1;
+    uint32_t blockIndex = (uint32_t)(block - m_vertexBlocks.begin());
+
+    uint32_t mesh = addIndices(blockIndex, _indices);
+    m_vertexBlocks[blockIndex].nbMeshes--;
+    if (mesh == INVALID_MESH)
+        m_vertexAllocator.free(m_vertexBlocks[blockIndex].offset);
+    return mesh;
+}
+
+
+uint32_t GeometryArena::addSubMesh(uint32_t _mesh, std::span<const uint32_t> _indices)
+{
+    if (_mesh >= m_meshes.size() || m_meshes[_mesh].mesh.count == 0 || _indices.empty())
+    {
+        warningLog() << "GeometryArena::addSubMesh(): invalid mesh " << _mesh << " or no index, sub-mesh is not added";
+        return INVALID_MESH;
+    }
+
+    uint32_t blockIndex = m_meshes[_mesh].vertexBlock;
+    uint32_t nbVertices = m_vertexAllocator.getSize(m_vertexBlocks[blockIndex].offset);
+    if (*std::max_element(_indices.begin(), _indices.end()) >= nbVertices)
+    {
+        warningLog() << "GeometryArena::addSubMesh(): indices out of the " << nbVertices << " vertices, sub-mesh is not added";
+        return INVALID_MESH;
+    }
+    return addIndices(blockIndex, _indices);
+}
+
+
+uint32_t GeometryArena::addIndices(uint32_t _vertexBlock, std::span<const uint32_t> _indices)
+{
+    uint32_t indexOffset = allocateRange(false, (uint32_t)_indices.size());
+    if (indexOffset == RangeAllocator::INVALID_OFFSET)
+        return INVALID_MESH;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(indexOffset * sizeof(uint32_t)), (GLsizeiptr)_indices.size_bytes(), _indices.data());
+
+    VertexBlock& block = m_vertexBlocks[_vertexBlock];
+    block.nbMeshes++;
+    MeshRecord record = { { (int32_t)block.offset, indexOffset, (uint32_t)_indices.size() }, _vertexBlock };
+
+    if (!m_freeMeshes.empty())
+    {
+        uint32_t mesh = m_freeMeshes.back();
+        m_freeMeshes.pop_back();
+        m_meshes[mesh] = record;
+        return mesh;
+    }
+    m_meshes.push_back(record);
+    return (uint32_t)(m_meshes.size() - 1);
+}
+
+
+void GeometryArena::removeMesh(uint32_t _mesh)
+{
+    if (_mesh >= m_meshes.size() || m_meshes[_mesh].mesh.count == 0)
+        return;
+
+    MeshRecord& record = m_meshes[_mesh];
+    m_indexAllocator.free(record.mesh.firstIndex);
+    VertexBlock& block = m_vertexBlocks[record.vertexBlock];
+    if (--block.nbMeshes == 0)
+        m_vertexAllocator.free(block.offset);
+
+    record.mesh = ArenaMesh();
+    m_freeMeshes.push_back(_mesh);
+}
+
+
+void GeometryArena::defragment()
+{
+    std::vector<Relocation> vertexRelocations, indexRelocations;
+    m_vertexAllocator.compact(vertexRelocations);
+    m_indexAllocator.compact(indexRelocations);
+    m_nbDefragmentations++;
+
+    GLuint scratch = 0;
+    size_t scratchSize = 0;
+    relocateBuffer(m_vertexVBO, vertexRelocations, sizeof(glm::vec3), scratch, scratchSize);
+    relocateBuffer(m_normalVBO, vertexRelocations, sizeof(glm::vec3), scratch, scratchSize);
+    relocateBuffer(m_indexVBO, indexRelocations, sizeof(uint32_t), scratch, scratchSize);
+    glDeleteBuffers(1, &scratch);
+
+    // draw arguments follow their ranges
+    for (VertexBlock& block : m_vertexBlocks)
+        if (block.nbMeshes > 0)
+            block.offset = relocatedOffset(vertexRelocations, block.offset);
+    for (MeshRecord& record : m_meshes)
+    {
+        if (record.mesh.count == 0)
+            continue;
+        record.mesh.baseVertex = (int32_t)m_vertexBlocks[record.vertexBlock].offset;
+        record.mesh.firstIndex = relocatedOffset(indexRelocations, record.mesh.firstIndex);
+    }
+
+    infoLog() << "GeometryArena::defragment(): " << vertexRelocations.size() << " vertex and " << indexRelocations.size()
+              << " index ranges moved";
+}
+
+
+void GeometryArena::clearDraws()
+{
+    m_commands.clear();
+    m_instances.clear();
+}
+
+
+void GeometryArena::addDraw(uint32_t _mesh, const glm::mat4& _modelMat, uint32_t _materialIndex)
+{
+    if (_mesh >= m_meshes.size() || m_meshes[_mesh].mesh.count == 0)
+        return;
+
+    const ArenaMesh& mesh = m_meshes[_mesh].mesh;
+    m_instances.push_back({ _modelMat, std::min(_materialIndex, m_nbMaterials - 1) });
+
+    // consecutive draws of a mesh are merged in one instanced command
+    if (!m_commands.empty())
+    {
+        DrawElementsIndirectCommand& last = m_commands.back();
+        if (last.firstIndex == mesh.firstIndex && last.count == mesh.count && last.baseVertex == mesh.baseVertex)
+        {
+            last.instanceCount++;
+            return;
+        }
+    }
+    m_commands.push_back({ mesh.count, 1, mesh.firstIndex, mesh.baseVertex, (uint32_t)(m_instances.size() - 1) });
+}
+
+
+void GeometryArena::draw(const ProgramReflection& _program, UniformRing& _uniforms, const glm::mat4& _modelMat)
+{
+    m_nbGLCalls = 0;
+    if (m_commands.empty() || m_vao == 0)
+        return;
+
+    // Activate program
+    glUseProgram(_program.getProgram());
+    m_nbGLCalls = 1;
+
+    // per-object block shared by all the draws, materials once per frame
+    ObjectUniforms object = { _modelMat };
+    GLintptr objectOffset = _uniforms.push(&object, sizeof(ObjectUniforms));
+    if (m_materialsFrame != _uniforms.getFrame())
+    {
+        m_materialsOffset = _uniforms.push(m_materials, sizeof(m_materials));
+        m_materialsFrame = _uniforms.getFrame();
+    }
+    if (objectOffset < 0 || m_materialsOffset < 0)
+        return;
+    if (_program.hasBlock(OBJECT_BLOCK))
+        _uniforms.bind(OBJECT_BLOCK, objectOffset, sizeof(ObjectUniforms));
+    if (_program.hasBlock(MATERIAL_BLOCK))
+        _uniforms.bind(MATERIAL_BLOCK, m_materialsOffset, sizeof(m_materials));
+
+    // instance rows of the frame (orphaned, so the previous frame can still be read)
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(m_instances.size() * sizeof(InstanceData)), m_instances.data(), GL_STREAM_DRAW);
+    glBindVertexArray(m_vao);
+    m_nbGLCalls += 3;
+
+    if (m_multiDrawIndirect)
+    {
+        // Draw all!
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(m_commands.size() * sizeof(DrawElementsIndirectCommand)), m_commands.data(), GL_STREAM_DRAW);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)m_commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        m_nbGLCalls += 4;
+    }
+    else
+    {
+        // without base instance, the instance attributes are moved to the row of each command
+        for (const DrawElementsIndirectCommand& command : m_commands)
+        {
+            setInstanceAttributes(command.baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+                                              (const void*)((size_t)command.firstIndex * sizeof(uint32_t)), (GLsizei)command.instanceCount, command.baseVertex);
+            m_nbGLCalls += 6;
+        }
+        setInstanceAttributes(0);
+        m_nbGLCalls += 5;
+    }
+
+    // unbind the VAO, so that buffer bindings elsewhere do not modify it
+    glBindVertexArray(0);
+    m_nbGLCalls++;
+}
+
+
+void GeometryArena::setInstanceAttributes(uint32_t _row)
+{
+    // model matrix as 4 column attributes, then the material index (integer attribute)
+    size_t rowOffset = (size_t)_row * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; column++)
+        glVertexAttribPointer(INSTANCE_MATRIX + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const void*)(rowOffset + offsetof(InstanceData, modelMat) + column * sizeof(glm::vec4)));
+    glVertexAttribIPointer(MATERIAL_INDEX, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (const void*)(rowOffset + offsetof(InstanceData, materialIndex)));
+}
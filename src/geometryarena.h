@@ -0,0 +1,291 @@
+/*********************************************************************************************************************
+ *
+ * geometryarena.h
+ *
+ * Shared vertex and index buffers for many meshes, drawn with a single VAO and multi-draw-indirect
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#define QT_NO_OPENGL_ES_2
+#include <GL/glew.h>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "drawablemesh.h"
+#include "rangeallocator.h"
+#include "uniformbuffers.h"
+
+
+/*!
+* \struct DrawElementsIndirectCommand
+* \brief Draw command read by glMultiDrawElementsIndirect() (layout defined by OpenGL)
+*/
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;             /*!< number of indices */
+    uint32_t instanceCount;     /*!< number of instances */
+    uint32_t firstIndex;        /*!< first index in the index buffer */
+    int32_t baseVertex;         /*!< added to each index */
+    uint32_t baseInstance;      /*!< first row of the instance buffer */
+};
+
+
+/*!
+* \struct ArenaMesh
+* \brief Mesh stored in a GeometryArena: the arguments of its draw call
+*/
+struct ArenaMesh
+{
+    int32_t baseVertex = 0;     /*!< first vertex of the mesh in the vertex buffers (indices are relative to it) */
+    uint32_t firstIndex = 0;    /*!< first index of the mesh in the index buffer */
+    uint32_t count = 0;         /*!< number of indices (0 if the mesh was removed) */
+};
+
+
+/*!
+* \class GeometryArena
+* \brief Vertex coords, normals and indices of many meshes in a few large buffers, sub-allocated by RangeAllocator,
+* so that all the meshes share one VAO. The draws of a frame are collected (see addDraw()) as indirect commands, with
+* one row of instance data each (model matrix and material, see InstanceData), and issued with a single
+* glMultiDrawElementsIndirect(): each command reads its row through baseInstance.
+* Buffers grow (x2) when an allocation does not fit, after a defragmentation if free space would be enough. Without
+* multi-draw-indirect and base instance (OpenGL < 4.3), commands are drawn one by one.
+*/
+class GeometryArena
+{
+    public:
+
+        static constexpr uint32_t INVALID_MESH = UINT32_MAX;    /*!< returned when a mesh cannot be added */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn GeometryArena
+        * \brief Default constructor of GeometryArena (no buffer is allocated before create())
+        */
+        GeometryArena() = default;
+
+        /*!
+        * \fn ~GeometryArena
+        * \brief Destructor of GeometryArena
+        */
+        ~GeometryArena();
+
+        GeometryArena(const GeometryArena&) = delete;
+        GeometryArena& operator=(const GeometryArena&) = delete;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getNbMeshes */
+        size_t getNbMeshes() const { return m_meshes.size() - m_freeMeshes.size(); }
+        /*! \fn getMesh */
+        const ArenaMesh& getMesh(uint32_t _mesh) const { return m_meshes[_mesh].mesh; }
+        /*! \fn getVertexAllocator */
+        const RangeAllocator& getVertexAllocator() const { return m_vertexAllocator; }
+        /*! \fn getIndexAllocator */
+        const RangeAllocator& getIndexAllocator() const { return m_indexAllocator; }
+        /*!
+        * \fn getUsedBytes
+        * \brief bytes of the vertex and index buffers used by the meshes
+        */
+        size_t getUsedBytes() const { return (size_t)m_vertexAllocator.getUsed() * 2 * sizeof(glm::vec3) + (size_t)m_indexAllocator.getUsed() * sizeof(uint32_t); }
+        /*!
+        * \fn getCapacityBytes
+        * \brief bytes allocated for the vertex and index buffers
+        */
+        size_t getCapacityBytes() const { return (size_t)m_vertexAllocator.getCapacity() * 2 * sizeof(glm::vec3) + (size_t)m_indexAllocator.getCapacity() * sizeof(uint32_t); }
+        /*! \fn getNbDefragmentations */
+        unsigned getNbDefragmentations() const { return m_nbDefragmentations; }
+        /*!
+        * \fn isMultiDrawIndirect
+        * \brief true if all the draws of a frame are issued with a single glMultiDrawElementsIndirect()
+        */
+        bool isMultiDrawIndirect() const { return m_multiDrawIndirect; }
+        /*! \fn getNbDraws */
+        size_t getNbDraws() const { return m_instances.size(); }
+        /*!
+        * \fn getNbCommands
+        * \brief number of indirect commands of the frame (consecutive draws of a mesh share one)
+        */
+        size_t getNbCommands() const { return m_commands.size(); }
+        /*!
+        * \fn getNbGLCalls
+        * \brief number of GL calls of the last draw, uniform buffer excluded (see UniformRing)
+        */
+        unsigned getNbGLCalls() const { return m_nbGLCalls; }
+
+        /*!
+        * \fn setMaterials
+        * \brief set the materials indexed by the draws (at most MAX_MATERIALS)
+        */
+        void setMaterials(std::span<const MaterialUniforms> _materials);
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn create
+        * \brief allocate the buffers and the VAO (meshes are removed)
+        * \param _vertexCapacity : initial number of vertices
+        * \param _indexCapacity : initial number of indices
+        */
+        void create(uint32_t _vertexCapacity, uint32_t _indexCapacity);
+
+        /*!
+        * \fn addMesh
+        * \brief copy a mesh in the arena
+        * \param _positions : vertex coords
+        * \param _normals : vertex normals (same size as _positions)
+        * \param _indices : triangles, indexing _positions
+        * \return mesh id, INVALID_MESH if the mesh is empty or normals are missing
+        */
+        uint32_t addMesh(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals, std::span<const uint32_t> _indices);
+
+        /*!
+        * \fn addSubMesh
+        * \brief copy triangles sharing the vertices of a mesh of the arena (e.g., a level of detail): the vertices are
+        * released with the last mesh using them
+        * \param _mesh : mesh whose vertices are indexed
+        * \param _indices : triangles, indexing the vertices of _mesh
+        * \return mesh id, INVALID_MESH if _mesh is not valid or _indices is empty
+        */
+        uint32_t addSubMesh(uint32_t _mesh, std::span<const uint32_t> _indices);
+
+        /*!
+        * \fn removeMesh
+        * \brief release the indices of a mesh (and its vertices if no other mesh uses them), its id may be reused
+        */
+        void removeMesh(uint32_t _mesh);
+
+        /*!
+        * \fn defragment
+        * \brief move the meshes to the start of the buffers (see RangeAllocator::compact), so that free space is a single
+        * block; copies are done on the GPU and mesh ids are kept
+        */
+        void defragment();
+
+        /*!
+        * \fn clearDraws
+        * \brief start collecting the draws of a frame
+        */
+        void clearDraws();
+
+        /*!
+        * \fn addDraw
+        * \brief add a draw of a mesh to the current frame
+        * \param _mesh : mesh id
+        * \param _modelMat : model matrix of the draw (applied before the model matrix of draw())
+        * \param _materialIndex : material of the draw (clamped to the number of materials)
+        */
+        void addDraw(uint32_t _mesh, const glm::mat4& _modelMat, uint32_t _materialIndex);
+
+        /*!
+        * \fn draw
+        * \brief upload the commands and instance rows of the collected draws and issue them
+        * \param _program : shader program, with the per-object and per-material blocks (see ProgramReflection)
+        * \param _uniforms : ring buffer of the uniform blocks, the per-frame block being already bound
+        * \param _modelMat : model matrix applied to all the draws
+        */
+        void draw(const ProgramReflection& _program, UniformRing& _uniforms, const glm::mat4& _modelMat);
+
+
+    protected:
+
+        /*!
+        * \struct VertexBlock
+        * \brief Vertices of the arena shared by one or more meshes
+        */
+        struct VertexBlock
+        {
+            uint32_t offset;        /*!< first vertex */
+            uint32_t nbMeshes;      /*!< meshes indexing the block (0 if released) */
+        };
+
+        /*!
+        * \struct MeshRecord
+        * \brief Draw arguments and vertex block of a mesh
+        */
+        struct MeshRecord
+        {
+            ArenaMesh mesh;
+            uint32_t vertexBlock;   /*!< index in m_vertexBlocks */
+        };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        GLuint m_vao = 0;                       /*!< VAO shared by all the meshes */
+        GLuint m_vertexVBO = 0;                 /*!< vertex coords of all the meshes */
+        GLuint m_normalVBO = 0;                 /*!< normals of all the meshes */
+        GLuint m_indexVBO = 0;                  /*!< indices of all the meshes */
+        GLuint m_instanceVBO = 0;               /*!< one row of instance data per draw of the frame */
+        GLuint m_indirectBuffer = 0;            /*!< draw commands of the frame */
+        bool m_multiDrawIndirect = false;       /*!< flag to indicate if glMultiDrawElementsIndirect() and base instance are available */
+
+        RangeAllocator m_vertexAllocator;       /*!< ranges of the vertex VBOs */
+        RangeAllocator m_indexAllocator;        /*!< ranges of the index VBO */
+        std::vector<VertexBlock> m_vertexBlocks;    /*!< vertex ranges (released ones are reused) */
+        std::vector<MeshRecord> m_meshes;           /*!< meshes, by id */
+        std::vector<uint32_t> m_freeMeshes;         /*!< ids of removed meshes */
+        unsigned m_nbDefragmentations = 0;          /*!< number of defragment() calls */
+
+        std::vector<DrawElementsIndirectCommand> m_commands;    /*!< draws of the frame */
+        std::vector<InstanceData> m_instances;                  /*!< instance row of each draw */
+        MaterialUniforms m_materials[MAX_MATERIALS];            /*!< materials indexed by the draws */
+        unsigned m_nbMaterials = 1;                             /*!< number of materials set */
+        uint64_t m_materialsFrame = UINT64_MAX;                 /*!< frame of the ring in which the materials were written */
+        GLintptr m_materialsOffset = -1;                        /*!< offset of the materials in the ring */
+        unsigned m_nbGLCalls = 0;                               /*!< GL calls of the last draw */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn resizeBuffers
+        * \brief reallocate the vertex and index VBOs with a new capacity, copying the content that fits on the GPU
+        */
+        void resizeBuffers(uint32_t _vertexCapacity, uint32_t _indexCapacity);
+
+        /*!
+        * \fn allocateRange
+        * \brief allocate a range, after a defragmentation or a growth of the buffers if needed
+        * \param _vertices : true for the vertex VBOs, false for the index VBO
+        */
+        uint32_t allocateRange(bool _vertices, uint32_t _size);
+
+        /*!
+        * \fn addIndices
+        * \brief copy the indices of a mesh using a vertex block, and add its record
+        * \return mesh id, INVALID_MESH if the indices cannot be allocated
+        */
+        uint32_t addIndices(uint32_t _vertexBlock, std::span<const uint32_t> _indices);
+
+        /*!
+        * \fn setInstanceAttributes
+        * \brief point the instance attributes of the bound VAO at a row of the instance VBO
+        */
+        void setInstanceAttributes(uint32_t _row);
+
+};
+
+
+#endif // GEOMETRYARENA_H
@@ -0,0 +1,142 @@
+/*********************************************************************************************************************
+ *
+ * halfedge.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "halfedge.h"
+#include "meshnormals.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+
+void HalfEdgeMesh::build(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _nbThreads)
+{
+    clear();
+    m_indices = _indices.first(_indices.size() - _indices.size() % 3);
+    size_t nbHalfEdges = m_indices.size();
+    unsigned nbThreads = getNbThreads(_nbThreads);
+
+    // Corners around each vertex = half-edges leaving it
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_nbVertices, m_indices, nbThreads, adjacency);
+    const uint32_t* offsets = adjacency.offsets.data();
+    const uint32_t* corners = adjacency.corners.data();
+
+    // Twins, per vertex u: the half-edges around u (the ones leaving it, and the previous one of each in its
+    // triangle, which comes into u) are grouped by their other vertex w in a hash table sized to the valence of u,
+    // so that each edge is found in O(valence) whatever the valence. The twin of u->w is the single w->u, if u->w is
+    // single too; edges with more half-edges (or a single vertex) are non-manifold, counted once at min(u, w).
+    // Each half-edge is written by its origin vertex only.
+    struct EdgeCounts { size_t nbBoundary = 0; size_t nbNonManifold = 0; };
+    struct NeighborSlot { uint32_t vertex; uint32_t nbOutgoing; uint32_t nbIncoming; uint32_t incoming; };
+    std::vector<EdgeCounts> blockCounts(nbThreads);
+    m_twins.resize(nbHalfEdges);
+    parallelFor(0, _nbVertices, nbThreads, [&](size_t _first, size_t _last, unsigned _block)
+    {
+        EdgeCounts counts;
+        std::vector<NeighborSlot> table;
+        for (size_t u = _first; u < _last; u++)
+        {
+            uint32_t begin = offsets[u], end = offsets[u + 1];
+            if (begin == end)
+                continue;
+
+            // open addressing, at most half full: up to 2 neighbors per corner
+            unsigned nbBits = 2;
+            while ((size_t(1) << nbBits) < 4 * size_t(end - begin))
+                nbBits++;
+            uint32_t mask = (1u << nbBits) - 1;
+            table.assign(size_t(1) << nbBits, { INVALID, 0, 0, INVALID });
+            auto slotOf = [&](uint32_t _w) -> NeighborSlot&
+            {
+                uint32_t s = (_w * 0x9E3779B1u) >> (32 - nbBits);
+                while (table[s].vertex != INVALID && table[s].vertex != _w)
+                    s = (s + 1) & mask;
+                table[s].vertex = _w;
+                return table[s];
+            };
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                uint32_t h = corners[i], g = prev(h);
+                slotOf(to(h)).nbOutgoing++;
+                NeighborSlot& slot = slotOf(from(g));
+                slot.nbIncoming++;
+                slot.incoming = g;
+            }
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                uint32_t h = corners[i], w = to(h);
+                const NeighborSlot& slot = slotOf(w);
+                if (w != u && slot.nbOutgoing == 1 && slot.nbIncoming <= 1)
+                {
+                    m_twins[h] = slot.incoming;
+                    if (slot.nbIncoming == 0)
+                        counts.nbBoundary++;
+                }
+                else
+                    m_twins[h] = INVALID;
+            }
+
+            for (const NeighborSlot& slot : table)
+            {
+                if (slot.vertex != INVALID && slot.vertex >= u &&
+                    (slot.vertex == u || slot.nbOutgoing > 1 || slot.nbIncoming > 1))
+                    counts.nbNonManifold++;
+            }
+        }
+        blockCounts[_block] = counts;
+    });
+    for (const EdgeCounts& counts : blockCounts)
+    {
+        m_nbBoundaryEdges += counts.nbBoundary;
+        m_nbNonManifoldEdges += counts.nbNonManifold;
+    }
+
+    // Outgoing half-edge: the first boundary one if any, so that walking the fan from it visits all of it
+    std::vector<size_t> blockNonManifoldVertices(nbThreads, 0);
+    m_outgoing.resize(_nbVertices);
+    parallelFor(0, _nbVertices, nbThreads, [&](size_t _first, size_t _last, unsigned _block)
+    {
+        size_t nbNonManifold = 0;
+        for (size_t v = _first; v < _last; v++)
+        {
+            uint32_t outgoing = (offsets[v] < offsets[v + 1]) ? corners[offsets[v]] : INVALID;
+            for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                if (m_twins[corners[i]] == INVALID)
+                {
+                    outgoing = corners[i];
+                    break;
+                }
+            }
+            m_outgoing[v] = outgoing;
+
+            // a single fan visits all the triangles of the vertex
+            uint32_t nbVisited = 0;
+            forEachOutgoing((uint32_t)v, [&nbVisited](uint32_t) { nbVisited++; });
+            if (nbVisited != offsets[v + 1] - offsets[v])
+                nbNonManifold++;
+        }
+        blockNonManifoldVertices[_block] = nbNonManifold;
+    });
+    for (size_t nbNonManifold : blockNonManifoldVertices)
+        m_nbNonManifoldVertices += nbNonManifold;
+}
+
+
+void HalfEdgeMesh::clear()
+{
+    m_indices = {};
+    m_twins.clear();
+    m_outgoing.clear();
+    m_nbBoundaryEdges = 0;
+    m_nbNonManifoldEdges = 0;
+    m_nbNonManifoldVertices = 0;
+}
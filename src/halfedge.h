@@ -0,0 +1,137 @@
+/*********************************************************************************************************************
+ *
+ * halfedge.h
+ *
+ * Compact half-edge adjacency of an indexed triangle mesh
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef HALFEDGE_H
+#define HALFEDGE_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+
+/*!
+* \class HalfEdgeMesh
+* \brief Half-edge adjacency stored as flat arrays, on top of an index buffer
+* Half-edge h = 3 * t + k is the edge of triangle t leaving its k-th vertex, so next / prev / face / vertices are
+* implicit (computed from h and the index buffer); only twins and one outgoing half-edge per vertex are stored
+* (16 bytes per triangle in total for a closed mesh).
+* Edges shared by more than two triangles, or by two triangles with the same orientation (both going from a to b,
+* i.e., inconsistently oriented neighbours), are non-manifold: their half-edges have no twin (as boundary ones).
+* The index buffer is not copied: it must stay alive and unchanged while the half-edges are used.
+*/
+class HalfEdgeMesh
+{
+    public:
+
+        static constexpr uint32_t INVALID = UINT32_MAX;    /*!< no half-edge (boundary, or isolated vertex) */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getNbHalfEdges */
+        size_t getNbHalfEdges() const { return m_twins.size(); }
+        /*! \fn getNbVertices */
+        size_t getNbVertices() const { return m_outgoing.size(); }
+
+        /*! \fn getNbBoundaryEdges */
+        size_t getNbBoundaryEdges() const { return m_nbBoundaryEdges; }
+        /*! \fn getNbNonManifoldEdges */
+        size_t getNbNonManifoldEdges() const { return m_nbNonManifoldEdges; }
+        /*!
+        * \fn getNbNonManifoldVertices
+        * \brief number of vertices whose triangles do not form a single fan (e.g., two cones joined by their apex)
+        */
+        size_t getNbNonManifoldVertices() const { return m_nbNonManifoldVertices; }
+
+        /*! \fn twin \brief opposite half-edge (INVALID on boundary or non-manifold edges) */
+        uint32_t twin(uint32_t _h) const { return m_twins[_h]; }
+        /*! \fn next \brief next half-edge in the same triangle */
+        static uint32_t next(uint32_t _h) { return (_h % 3 == 2) ? _h - 2 : _h + 1; }
+        /*! \fn prev \brief previous half-edge in the same triangle */
+        static uint32_t prev(uint32_t _h) { return (_h % 3 == 0) ? _h + 2 : _h - 1; }
+        /*! \fn face \brief triangle of a half-edge */
+        static uint32_t face(uint32_t _h) { return _h / 3; }
+        /*! \fn from \brief origin vertex of a half-edge */
+        uint32_t from(uint32_t _h) const { return m_indices[_h]; }
+        /*! \fn to \brief target vertex of a half-edge */
+        uint32_t to(uint32_t _h) const { return m_indices[next(_h)]; }
+        /*! \fn isBoundary \brief check if a half-edge has no twin */
+        bool isBoundary(uint32_t _h) const { return m_twins[_h] == INVALID; }
+
+        /*!
+        * \fn outgoing
+        * \brief one half-edge leaving a vertex (a boundary one if there is any, so that fans can be walked from it)
+        * \return INVALID for isolated vertices
+        */
+        uint32_t outgoing(uint32_t _v) const { return m_outgoing[_v]; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn build
+        * \brief build the half-edges of a triangle mesh in expected linear time, whatever the valence of the vertices:
+        * the vertex-to-corner adjacency (see buildVertexAdjacency) gives the half-edges around each vertex, and twins
+        * are matched among them with a hash table sized to the valence.
+        * Result does not depend on the number of threads.
+        * \param _indices : triangles (valid indices, less than 2^32 / 3 triangles)
+        * \param _nbVertices : number of vertices
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        */
+        void build(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn clear
+        * \brief release arrays
+        */
+        void clear();
+
+        /*!
+        * \fn forEachOutgoing
+        * \brief call _func(h) for the half-edges leaving a vertex, walking around the fan from outgoing(_v)
+        * (only the first fan is visited around non-manifold vertices)
+        */
+        template<typename Func>
+        void forEachOutgoing(uint32_t _v, Func&& _func) const
+        {
+            uint32_t start = m_outgoing[_v];
+            if (start == INVALID)
+                return;
+            uint32_t h = start;
+            do
+            {
+                _func(h);
+                h = m_twins[prev(h)];
+            }
+            while (h != INVALID && h != start);
+        }
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        std::span<const uint32_t> m_indices;    /*!< index buffer (not owned) */
+        std::vector<uint32_t> m_twins;          /*!< opposite half-edge of each half-edge */
+        std::vector<uint32_t> m_outgoing;       /*!< one outgoing half-edge per vertex */
+
+        size_t m_nbBoundaryEdges = 0;           /*!< number of half-edges without twin on manifold edges */
+        size_t m_nbNonManifoldEdges = 0;        /*!< number of non-manifold (undirected) edges */
+        size_t m_nbNonManifoldVertices = 0;     /*!< number of vertices with several fans */
+
+};
+
+#endif // HALFEDGE_H
@@ -0,0 +1,54 @@
+/*********************************************************************************************************************
+ *
+ * lodselection.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "lodselection.h"
+
+#include <algorithm>
+#include <limits>
+
+
+float computePixelsPerUnit(const glm::vec3& _center, float _radius, const glm::mat4& _modelViewMat, const glm::mat4& _projMat, float _viewportHeight)
+{
+    // lengths are scaled by the largest axis of the model-view matrix
+    float scale = std::max({ glm::length(glm::vec3(_modelViewMat[0])), glm::length(glm::vec3(_modelViewMat[1])), glm::length(glm::vec3(_modelViewMat[2])) });
+    glm::vec4 center = _modelViewMat * glm::vec4(_center, 1.0f);
+    float radius = _radius * scale;
+
+    // clip w of the nearest point of the sphere (view depth in perspective, 1 in orthographic)
+    float w = _projMat[2][3] * (center.z + radius) + _projMat[3][3];
+    if (w <= 0.0f)
+        return std::numeric_limits<float>::infinity();
+
+    return scale * _projMat[1][1] * 0.5f * _viewportHeight / w;
+}
+
+
+int selectLOD(std::span<const float> _errors, float _pixelsPerUnit, int _currentLOD, float _threshold, float _hysteresis)
+{
+    if (_errors.empty())
+        return 0;
+    int nbLODs = (int)_errors.size();
+    int current = std::clamp(_currentLOD, 0, nbLODs - 1);
+
+    // coarsest level under a given projected error (errors increase with the level)
+    auto coarsestUnder = [&](float _maxPixels)
+    {
+        int level = 0;
+        while (level + 1 < nbLODs && _errors[level + 1] * _pixelsPerUnit <= _maxPixels)
+            level++;
+        return level;
+    };
+
+    int level = coarsestUnder(_threshold);
+    if (level < current)
+        return level;       // current level is too coarse: refine now
+
+    level = coarsestUnder(_threshold * (1.0f - _hysteresis));
+    return std::max(level, current);
+}
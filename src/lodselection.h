@@ -0,0 +1,52 @@
+/*********************************************************************************************************************
+ *
+ * lodselection.h
+ *
+ * Screen-space error level of detail selection (CPU only, no OpenGL call)
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef LODSELECTION_H
+#define LODSELECTION_H
+
+#include <span>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \fn computePixelsPerUnit
+* \brief number of pixels covered by one unit of length (in model space) at the point of a bounding sphere nearest
+* to the camera, i.e., the worst case for the projected error of anything inside the sphere.
+* The zoom factor of the camera is part of the projection matrix (see GLtools::Camera::initProjectionMatrix()).
+* \param _center : center of the bounding sphere (model space)
+* \param _radius : radius of the bounding sphere (model space)
+* \param _modelViewMat : model-view matrix
+* \param _projMat : projection matrix (perspective or orthographic)
+* \param _viewportHeight : height of the viewport in pixels
+* \return pixels per unit, infinity if the camera is inside the sphere
+*/
+float computePixelsPerUnit(const glm::vec3& _center, float _radius, const glm::mat4& _modelViewMat, const glm::mat4& _projMat, float _viewportHeight);
+
+static const float LOD_HYSTERESIS = 0.25f;     /*!< margin on the pixel error before switching to a coarser level */
+
+/*!
+* \fn selectLOD
+* \brief pick the coarsest level of detail whose projected error is below a threshold.
+* Hysteresis: the level gets finer as soon as the current one exceeds the threshold, but coarser only when the new
+* level is below (1 - _hysteresis) * threshold, so that small camera moves around a switch distance do not flicker.
+* \param _errors : geometric error of each level (model space, increasing, level 0 = full detail)
+* \param _pixelsPerUnit : see computePixelsPerUnit()
+* \param _currentLOD : level selected at the previous frame
+* \param _threshold : max projected error in pixels
+* \param _hysteresis : relative margin in [0,1)
+* \return selected level
+*/
+int selectLOD(std::span<const float> _errors, float _pixelsPerUnit, int _currentLOD, float _threshold, float _hysteresis);
+
+
+#endif // LODSELECTION_H
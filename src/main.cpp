@@ -16,6 +16,7 @@
 #include <math.h>
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
 
 // OpenGL includes
 #include <GL/glew.h>
@@ -28,6 +29,11 @@
 
 #include "utils.h"
 #include "drawablemesh.h"
+#include "geometryarena.h"
+#include "lodselection.h"
+#include "meshloader.h"
+#include "benchmark.h"
+#include "bvh.h"
 
 
 // Window
@@ -53,16 +59,45 @@ std::unique_ptr<TriMesh> m_triMesh;             /*!<  triangle mesh */
 std::unique_ptr<DrawableMesh> m_drawMeshTeapot; /*!<  drawable object: mesh object */
 std::unique_ptr<DrawableMesh> m_drawMeshCube;   /*!<  drawable object: mesh object */
 
+// Background loading
+AsyncMeshLoader m_meshLoader;                   /*!<  imports the mesh on a worker thread */
+size_t m_uploadBudget = 16 << 20;               /*!<  max number of bytes uploaded to the GPU per frame */
+
 glm::mat4 m_modelMatrix;        /*!<  model matrix of the mesh */
+
+// Picking
+MeshBVH m_bvh;                  /*!<  ray queries on the triangles of m_triMesh (built at first pick) */
+RayHit m_pickHit;               /*!<  last picked triangle */
+uint32_t m_pickVertex = RayHit::NO_HIT;   /*!<  vertex of the last picked triangle nearest to the cursor */
     
 GLuint m_defaultVAO;            /*!<  default VAO */
 
 // shader programs
-GLuint m_program;               /*!< handle of the program object (i.e. shaders) for shaded surface rendering */
+ProgramReflection m_program;    /*!< program object (i.e. shaders) for shaded surface rendering, with its uniforms */
+UniformRing m_uniformRing;      /*!< per-frame, per-material and per-object uniform blocks */
+unsigned m_nbGLCalls = 0;       /*!< GL calls of the last frame (scene only, not the GUI) */
 
 // UI flags
 bool m_showTeapot = true;
 
+// Stress test
+enum StressMode { STRESS_INSTANCED, STRESS_DRAW_PER_TEAPOT, STRESS_MULTI_DRAW_INDIRECT };
+int m_nbStressTeapots = 0;                  /*!< number of teapots of the stress test (0 = off) */
+int m_stressMode = STRESS_INSTANCED;        /*!< single instanced draw, one draw per teapot, or one multi-draw-indirect (per-teapot LOD) */
+std::vector<glm::mat4> m_stressMatrices;    /*!< model matrix of each teapot of the stress test (in the space of the mesh) */
+std::vector<uint32_t> m_stressMaterials;    /*!< material of each teapot of the stress test */
+std::vector<int> m_stressLODs;              /*!< level of detail of each teapot at the last frame (one draw per teapot or multi-draw-indirect) */
+float m_submitTime = 0.0f;                  /*!< CPU time of the draws of the last frame (ms) */
+MaterialUniforms m_materials[4];            /*!< materials of the teapots (material 0 is the one of the GUI) */
+
+// Geometry arena
+GeometryArena m_arena;                      /*!< levels of detail of the teapot in shared buffers, for multi-draw-indirect */
+std::vector<uint32_t> m_arenaLODs;          /*!< arena mesh of each level of detail */
+std::vector<float> m_arenaLODErrors;        /*!< geometric error of each level of detail, with LOD_ERROR_MARGIN */
+glm::vec3 m_arenaCenter(0.0f);              /*!< bounding sphere of the teapot, for the projected error */
+float m_arenaRadius = 0.0f;
+size_t m_arenaTriangles = 0;                /*!< triangles of the last multi-draw-indirect frame */
+
 float m_specPow = 128.0f;
 
 std::string shaderDir = "../../src/shaders/";   /*!< relative path to shaders folder  */
@@ -73,6 +108,9 @@ std::string modelDir = "../../models/";   /*!< relative path to meshes and textu
 
 void initialize();
 void initScene();
+void updateStressTest();
+void uploadArena();
+void updateLoading();
 void setupImgui(GLFWwindow *window);
 void update();
 void display();
@@ -82,6 +120,7 @@ void charCallback(GLFWwindow* window, unsigned int codepoint);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void cursorPosCallback(GLFWwindow* window, double x, double y);
+void pickMesh(double x, double y);
 void runGUI();
 int main(int argc, char** argv);
 
@@ -109,31 +148,48 @@ void initialize()
     // init model matrix
     m_modelMatrix = glm::mat4(1.0f);
 
-    // init triangle mesh (read OBJ file)
-    m_triMesh = std::make_unique<TriMesh>();
-    m_triMesh->readFile(modelDir + "teapot.obj");
-    // setup mesh rendering
+    // init triangle mesh (read OBJ file in background, with all hardware threads, optimized for the vertex cache, with LODs)
+    m_meshLoader.start(modelDir + "teapot.obj", 0, true, true, true, true);
+    // setup mesh rendering (uploaded progressively when loaded)
     m_drawMeshTeapot = std::make_unique<DrawableMesh>();
-    m_drawMeshTeapot->createMeshVAO(*m_triMesh);
 
-    // init cube mesh
+    // init cube mesh (also used as placeholder while loading)
     m_drawMeshCube = std::make_unique<DrawableMesh>();
     m_drawMeshCube->createUnitCubeVAO();
 
-    // init scene depending on object geom
+    // init scene around the placeholder, until the object is loaded
     initScene();
 
-    // init shaders
-    m_program = loadShaderProgram(shaderDir + "phong.vert", shaderDir + "phong.frag");
+    // materials of the instances of the stress test (material 0 is the one of the GUI)
+    m_materials[1].diffuseColor = glm::vec4(0.3f, 0.5f, 0.8f, 1.0f);
+    m_materials[2].diffuseColor = glm::vec4(0.4f, 0.75f, 0.35f, 1.0f);
+    m_materials[3].diffuseColor = glm::vec4(0.85f, 0.8f, 0.3f, 1.0f);
+    m_drawMeshTeapot->setMaterials(m_materials);
+
+    // shared geometry buffers (grown when needed), filled once the teapot is uploaded
+    m_arena.create(1 << 18, 1 << 20);
+    m_arena.setMaterials(m_materials);
+
+    // init shaders, and the ring buffer of their uniform blocks (room for one per-object block per teapot of the stress
+    // test drawn without instancing, 256-byte aligned on most drivers)
+    loadShaderProgram(m_program, shaderDir + "phong.vert", shaderDir + "phong.frag");
+    m_uniformRing.create(4 << 20);
 
 }
 
 
 void initScene()
 {
-    m_triMesh->computeAABB();
-    glm::vec3 bBoxMin = m_triMesh->getBBoxMin();
-    glm::vec3 bBoxMax = m_triMesh->getBBoxMax();
+    // unit cube bounds if no mesh is loaded yet
+    glm::vec3 bBoxMin(-0.5f, -0.5f, -0.5f);
+    glm::vec3 bBoxMax(0.5f, 0.5f, 0.5f);
+    if(m_triMesh)
+    {
+        m_triMesh->computeAABB();
+        bBoxMin = m_triMesh->getBBoxMin();
+        bBoxMax = m_triMesh->getBBoxMax();
+    }
+    m_centerCoords = glm::vec3(0.0f, 0.0f, 0.0f);
     if(bBoxMin != bBoxMax)
     {
         // set the center of the scene to the center of the bBox
@@ -149,6 +205,92 @@ void initScene()
 
     // init trackball
     m_trackball.init(m_winWidth, m_winHeight);
+
+    // stress test teapots follow the bounds of the mesh
+    if (m_nbStressTeapots > 0)
+        updateStressTest();
+}
+
+
+void updateStressTest()
+{
+    // square grid of teapots in the plane of the screen, scaled to fit in the bounds of the mesh
+    m_stressMatrices.clear();
+    m_stressMaterials.clear();
+    int side = (int)std::ceil(std::sqrt((float)m_nbStressTeapots));
+    float cellSize = 2.0f * m_radScene / (float)std::max(side, 1);
+    for (int i = 0; i < m_nbStressTeapots; i++)
+    {
+        glm::vec3 offset(((float)(i % side) + 0.5f) * cellSize - m_radScene, ((float)(i / side) + 0.5f) * cellSize - m_radScene, 0.0f);
+        glm::mat4 instanceMat = glm::translate(glm::mat4(1.0f), m_centerCoords + offset);
+        instanceMat = glm::scale(instanceMat, glm::vec3(0.9f / (float)side));
+        m_stressMatrices.push_back(glm::translate(instanceMat, -m_centerCoords));
+        m_stressMaterials.push_back((uint32_t)i % (uint32_t)m_drawMeshTeapot->getNbMaterials());
+    }
+
+    // instanced: uploaded once in the instance VBO, otherwise drawn by display()
+    if (m_stressMode == STRESS_INSTANCED)
+        m_drawMeshTeapot->setInstances(m_stressMatrices, m_stressMaterials);
+    else
+        m_drawMeshTeapot->setInstances({});
+}
+
+
+void uploadArena()
+{
+    // previous mesh released first, then the levels of detail sharing the vertices of level 0
+    for (uint32_t mesh : m_arenaLODs)
+        m_arena.removeMesh(mesh);
+    m_arenaLODs.clear();
+    m_arenaLODErrors.clear();
+    m_stressLODs.clear();
+
+    uint32_t mesh = m_arena.addMesh(m_triMesh->getVertexView(), m_triMesh->getNormalView(), m_triMesh->getLODIndexView(0));
+    if (mesh == GeometryArena::INVALID_MESH)
+        return;
+    m_arenaLODs.push_back(mesh);
+    m_arenaLODErrors.push_back(0.0f);
+    for (size_t level = 1; level < m_triMesh->getNbLODs(); level++)
+    {
+        uint32_t subMesh = m_arena.addSubMesh(mesh, m_triMesh->getLODIndexView(level));
+        if (subMesh == GeometryArena::INVALID_MESH)
+            break;
+        m_arenaLODs.push_back(subMesh);
+        m_arenaLODErrors.push_back(m_triMesh->getLODErrorBound(level));
+    }
+
+    m_arenaCenter = 0.5f * (m_triMesh->getBBoxMin() + m_triMesh->getBBoxMax());
+    m_arenaRadius = 0.5f * glm::length(m_triMesh->getBBoxMax() - m_triMesh->getBBoxMin());
+}
+
+
+void updateLoading()
+{
+    // mesh imported by the worker thread: start progressive upload
+    if(m_meshLoader.getState() == AsyncMeshLoader::READY)
+    {
+        m_triMesh = m_meshLoader.takeMesh();
+        m_bvh.clear();
+        m_pickHit = RayHit();
+        m_pickVertex = RayHit::NO_HIT;
+        m_drawMeshTeapot->beginMeshUpload(*m_triMesh);
+        m_drawMeshTeapot->setSpeculatPower(m_specPow);
+        initScene();
+    }
+
+    // upload a bounded slice per frame, so that frame time does not depend on mesh size
+    if(!m_drawMeshTeapot->isUploadComplete())
+    {
+        // levels of detail share the vertex VBOs: only their indices are added once the mesh is uploaded
+        if(m_drawMeshTeapot->uploadMeshSlice(m_uploadBudget))
+        {
+            if(m_triMesh->getNbLODs() > 1)
+                m_drawMeshTeapot->uploadLODs(*m_triMesh);
+            m_drawMeshTeapot->uploadMeshlets(*m_triMesh);
+            m_drawMeshTeapot->uploadOccluder(*m_triMesh);
+            uploadArena();
+        }
+    }
 }
 
 
@@ -191,16 +333,66 @@ void display()
     // Clear window with background color
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Get MVP matrices
-    glm::mat4 modelMat = m_modelMatrix;
-    glm::mat4 viewMat = m_camera.getViewMatrix();
-    glm::mat4 projMat = m_camera.getProjectionMatrix();
-
-    // draw objects
-    if(m_showTeapot)
-        m_drawMeshTeapot->draw(m_program, modelMat, viewMat, projMat, m_lightPos, m_camPos, m_lightCol);
+    // per-frame block: camera matrices, light and viewport, bound once for all draws
+    FrameUniforms frame;
+    frame.viewMat = m_camera.getViewMatrix();
+    frame.projMat = m_camera.getProjectionMatrix();
+    frame.lightPos = glm::vec4(m_lightPos, 1.0f);
+    frame.lightColor = glm::vec4(m_lightCol, 1.0f);
+    frame.camPos = glm::vec4(m_camPos, 1.0f);
+    frame.viewport = glm::vec4(0.0f, 0.0f, (float)m_winWidth, (float)m_winHeight);
+    m_uniformRing.beginFrame();
+    GLintptr frameOffset = m_uniformRing.push(&frame, sizeof(FrameUniforms));
+    if (frameOffset >= 0)
+        m_uniformRing.bind(FRAME_BLOCK, frameOffset, sizeof(FrameUniforms));
+
+    // draw objects (cube is used as placeholder until the first triangles of the mesh are uploaded)
+    auto submitStart = std::chrono::steady_clock::now();
+    unsigned nbDrawCalls = 0;
+    DrawableMesh* drawMesh = (m_showTeapot && m_drawMeshTeapot->getNumIndices() > 0) ? m_drawMeshTeapot.get() : m_drawMeshCube.get();
+    if (drawMesh == m_drawMeshTeapot.get() && m_stressMode == STRESS_MULTI_DRAW_INDIRECT && !m_stressMatrices.empty() && !m_arenaLODs.empty())
+    {
+        // stress test in the arena: level of detail of each teapot, then all of them in a single call
+        m_arena.clearDraws();
+        m_stressLODs.resize(m_stressMatrices.size(), 0);
+        m_arenaTriangles = 0;
+        glm::mat4 modelViewMat = frame.viewMat * m_modelMatrix;
+        int nbLODs = (int)m_arenaLODs.size();
+        for (size_t i = 0; i < m_stressMatrices.size(); i++)
+        {
+            int& lod = m_stressLODs[i];
+            if (m_drawMeshTeapot->isAutoLOD())
+                lod = selectLOD(std::span<const float>(m_arenaLODErrors),
+                                computePixelsPerUnit(m_arenaCenter, m_arenaRadius, modelViewMat * m_stressMatrices[i], frame.projMat, frame.viewport[3]),
+                                std::min(lod, nbLODs - 1), m_drawMeshTeapot->getLODPixelError(), LOD_HYSTERESIS);
+            else
+                lod = std::min(m_drawMeshTeapot->getLOD(), nbLODs - 1);
+            m_arena.addDraw(m_arenaLODs[lod], m_stressMatrices[i], m_stressMaterials[i]);
+            m_arenaTriangles += m_arena.getMesh(m_arenaLODs[lod]).count / 3;
+        }
+        m_arena.draw(m_program, m_uniformRing, m_modelMatrix);
+        nbDrawCalls += m_arena.getNbGLCalls();
+    }
+    else if (drawMesh == m_drawMeshTeapot.get() && m_stressMode != STRESS_INSTANCED && !m_stressMatrices.empty())
+    {
+        // stress test without instancing: one draw per teapot, each with its own level of detail (no cluster nor
+        // occlusion culling, which would be paid at each draw)
+        m_stressLODs.resize(m_stressMatrices.size(), 0);
+        for (size_t i = 0; i < m_stressMatrices.size(); i++)
+        {
+            drawMesh->drawCopy(m_program, m_uniformRing, frame, m_modelMatrix * m_stressMatrices[i], m_stressLODs[i]);
+            nbDrawCalls += drawMesh->getNbGLCalls();
+        }
+    }
     else
-        m_drawMeshCube->draw(m_program, modelMat, viewMat, projMat, m_lightPos, m_camPos, m_lightCol);
+    {
+        drawMesh->draw(m_program, m_uniformRing, frame, m_modelMatrix);
+        nbDrawCalls += drawMesh->getNbGLCalls();
+    }
+    m_submitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+
+    // framebuffer binding and clear, uniform blocks, then draws
+    m_nbGLCalls = 2 + m_uniformRing.getNbGLCalls() + nbDrawCalls;
 
 }
 
@@ -248,7 +440,7 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     }
     if (key == GLFW_KEY_S && action == GLFW_PRESS)
     {
-        m_program = loadShaderProgram(shaderDir + "phong.vert", shaderDir + "phong.frag");
+        loadShaderProgram(m_program, shaderDir + "phong.vert", shaderDir + "phong.frag");
     }
 }
 
@@ -270,6 +462,8 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     {
         if (button == GLFW_MOUSE_BUTTON_LEFT)
             m_trackball.startTracking( glm::vec2(x, y) );
+        else if (button == GLFW_MOUSE_BUTTON_RIGHT)
+            pickMesh(x, y);
     }
     else 
     {
@@ -303,6 +497,27 @@ void cursorPosCallback(GLFWwindow* window, double x, double y)
 }
 
 
+void pickMesh(double x, double y)
+{
+    if (!m_showTeapot || !m_triMesh || !m_drawMeshTeapot->isUploadComplete())
+        return;
+
+    // hierarchy is only needed once the user picks something
+    if (m_bvh.isEmpty())
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_bvh.build(*m_triMesh, 0);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        infoLog() << "pickMesh(): BVH built in " << seconds * 1000.0 << " ms (" << m_bvh.getNodes().size() << " nodes)";
+    }
+
+    Ray ray = computePickingRay(glm::vec2(x, y), glm::vec2(m_winWidth, m_winHeight), m_modelMatrix, m_camera.getViewMatrix(), m_camera.getProjectionMatrix());
+    m_pickHit = RayHit();
+    m_bvh.intersect(ray, m_pickHit);
+    m_pickVertex = m_bvh.getClosestVertex(m_pickHit);
+}
+
+
 
 
     /*------------------------------------------------------------------------------------------------------------+
@@ -318,6 +533,31 @@ void runGUI()
         // ImGui frame rate measurement
         float frameRate = ImGui::GetIO().Framerate;
         ImGui::Text("FrameRate: %.3f ms/frame (%.1f FPS)", 1000.0f / frameRate, frameRate);
+        ImGui::Text("GL calls: %u per frame (%u for uniform blocks, %zu bytes)", m_nbGLCalls, m_uniformRing.getNbGLCalls(),
+                    m_uniformRing.getUsedBytes());
+
+        ImGui::Separator();
+
+        // background loading progress
+        AsyncMeshLoader::State loadState = m_meshLoader.getState();
+        if (loadState == AsyncMeshLoader::LOADING)
+        {
+            ImGui::Text("Loading %s", m_meshLoader.getFilename().c_str());
+            ImGui::ProgressBar(m_meshLoader.getProgress());
+            if (ImGui::Button("Cancel loading"))
+                m_meshLoader.cancel();
+        }
+        else if (!m_drawMeshTeapot->isUploadComplete())
+        {
+            ImGui::Text("Uploading to GPU");
+            ImGui::ProgressBar(m_drawMeshTeapot->getUploadProgress());
+        }
+        else if (loadState == AsyncMeshLoader::FAILED || loadState == AsyncMeshLoader::CANCELLED)
+        {
+            ImGui::Text(loadState == AsyncMeshLoader::FAILED ? "Loading failed" : "Loading cancelled");
+            if (ImGui::Button("Retry loading"))
+                m_meshLoader.start(modelDir + "teapot.obj", 0, true, true, true, true);
+        }
 
         ImGui::Separator();
 
@@ -332,6 +572,114 @@ void runGUI()
         if (ImGui::SliderFloat("specular pow", &m_specPow, 0.5f, 200.0f, "%.2f"))
         {
             m_drawMeshTeapot->setSpeculatPower(m_specPow);
+            m_materials[0].specularPower = m_specPow;
+            m_arena.setMaterials(m_materials);
+        }
+
+        ImGui::Separator();
+
+        // many copies of the mesh, drawn with instancing, one by one, or with multi-draw-indirect from the arena
+        bool stressChanged = ImGui::SliderInt("stress test teapots", &m_nbStressTeapots, 0, 16384);
+        stressChanged |= ImGui::Combo("draw mode", &m_stressMode, "instanced\0one draw per teapot\0multi-draw-indirect\0");
+        if (stressChanged)
+            updateStressTest();
+        ImGui::Text("CPU submit %.3f ms per frame for %d teapots", m_submitTime, 
+                    (m_stressMode == STRESS_INSTANCED) ? m_drawMeshTeapot->getNbInstances() : std::max((int)m_stressMatrices.size(), 1));
+        if (m_stressMode == STRESS_MULTI_DRAW_INDIRECT && !m_stressMatrices.empty())
+            ImGui::Text("%s: %zu commands, %zu triangles", m_arena.isMultiDrawIndirect() ? "multi-draw-indirect" : "one call per command (no multi-draw-indirect)",
+                        m_arena.getNbCommands(), m_arenaTriangles);
+
+        // shared geometry buffers: space used and fragmentation of their allocators
+        const RangeAllocator& arenaVertices = m_arena.getVertexAllocator();
+        const RangeAllocator& arenaIndices = m_arena.getIndexAllocator();
+        ImGui::Text("Geometry arena: %zu meshes, %.2f / %.2f MB", m_arena.getNbMeshes(), (float)m_arena.getUsedBytes() / (1 << 20),
+                    (float)m_arena.getCapacityBytes() / (1 << 20));
+        ImGui::Text("vertices %u / %u, %zu free blocks (largest %u), %.1f%% fragmented", arenaVertices.getUsed(), arenaVertices.getCapacity(),
+                    arenaVertices.getNbFreeBlocks(), arenaVertices.getLargestFreeBlock(), 100.0f * arenaVertices.getFragmentation());
+        ImGui::Text("indices %u / %u, %zu free blocks (largest %u), %.1f%% fragmented", arenaIndices.getUsed(), arenaIndices.getCapacity(),
+                    arenaIndices.getNbFreeBlocks(), arenaIndices.getLargestFreeBlock(), 100.0f * arenaIndices.getFragmentation());
+        if (ImGui::Button("Defragment"))
+            m_arena.defragment();
+        ImGui::SameLine();
+        ImGui::Text("%u defragmentations", m_arena.getNbDefragmentations());
+
+        if (m_pickHit.isHit())
+        {
+            ImGui::Separator();
+            glm::vec3 pickPos = m_triMesh->getVertexView()[m_pickVertex];
+            ImGui::Text("Picked triangle %u, vertex %u (%.3f, %.3f, %.3f)", m_pickHit.triangle, m_pickVertex, pickPos.x, pickPos.y, pickPos.z);
+        }
+
+        if (m_drawMeshTeapot->getNbMeshlets() > 0)
+        {
+            ImGui::Separator();
+            ImGui::Text("%d meshlets (%.1f triangles on average)", m_drawMeshTeapot->getNbMeshlets(),
+                        (float)m_drawMeshTeapot->getNumIndices() / (3.0f * (float)m_drawMeshTeapot->getNbMeshlets()));
+
+            bool clusterCulling = m_drawMeshTeapot->isClusterCulling();
+            if (ImGui::Checkbox("cluster culling", &clusterCulling))
+                m_drawMeshTeapot->setClusterCulling(clusterCulling);
+            if (clusterCulling)
+            {
+                ClusterCullingParams params = m_drawMeshTeapot->getCullingParams();
+                bool changed = ImGui::Checkbox("frustum", &params.frustum);
+                ImGui::SameLine();
+                changed |= ImGui::Checkbox("backface", &params.backface);
+                changed |= ImGui::SliderFloat("min cluster radius (px)", &params.minPixelRadius, 0.0f, 4.0f, "%.2f");
+                if (changed)
+                    m_drawMeshTeapot->setCullingParams(params);
+
+                const CullingStats& stats = m_drawMeshTeapot->getCullingStats();
+                if (stats.nbTested > 0)
+                {
+                    ImGui::Text("Clusters: %zu tested, %zu culled (%zu frustum, %zu backface, %zu small, %zu occluded)", stats.nbTested,
+                                stats.getNbCulled(), stats.nbFrustumCulled, stats.nbBackfaceCulled, stats.nbSmallCulled, stats.nbOccludedCulled);
+                    ImGui::Text("%zu triangles submitted in %zu draws (culling %.3f ms)", stats.nbTrianglesSubmitted, stats.nbDraws,
+                                m_drawMeshTeapot->getCullingTime());
+                }
+
+                bool occlusionCulling = m_drawMeshTeapot->isOcclusionCulling();
+                if (ImGui::Checkbox("occlusion culling", &occlusionCulling))
+                    m_drawMeshTeapot->setOcclusionCulling(occlusionCulling);
+                if (occlusionCulling)
+                {
+                    float budget = m_drawMeshTeapot->getOcclusionBudget();
+                    if (ImGui::SliderFloat("occlusion budget (ms)", &budget, 0.0f, 4.0f, "%.2f"))
+                        m_drawMeshTeapot->setOcclusionBudget(budget);
+
+                    const OcclusionStats& occlusionStats = m_drawMeshTeapot->getOcclusionStats();
+                    if (stats.nbTested > 0 && occlusionStats.nbTiles > 0)
+                    {
+                        ImGui::Text("%zu clusters occluded (%.1f%%) by %d occluder triangles", stats.nbOccludedCulled,
+                                    100.0f * (float)stats.nbOccludedCulled / (float)stats.nbTested, m_drawMeshTeapot->getNbOccluderTriangles());
+                        ImGui::Text("Occluder raster %.3f ms + depth pyramid %.3f ms, %zu / %zu tiles skipped", occlusionStats.rasterTime,
+                                    occlusionStats.pyramidTime, occlusionStats.nbSkippedTiles, occlusionStats.nbTiles);
+                    }
+                }
+            }
+        }
+
+        if (m_drawMeshTeapot->getNbLODs() > 1)
+        {
+            ImGui::Separator();
+
+            bool autoLOD = m_drawMeshTeapot->isAutoLOD();
+            if (ImGui::Checkbox("auto LOD", &autoLOD))
+                m_drawMeshTeapot->setAutoLOD(autoLOD);
+            if (autoLOD)
+            {
+                float pixelError = m_drawMeshTeapot->getLODPixelError();
+                if (ImGui::SliderFloat("LOD pixel error", &pixelError, 0.25f, 16.0f, "%.2f"))
+                    m_drawMeshTeapot->setLODPixelError(pixelError);
+            }
+            else
+            {
+                int lod = m_drawMeshTeapot->getLOD();
+                if (ImGui::SliderInt("LOD", &lod, 0, m_drawMeshTeapot->getNbLODs() - 1))
+                    m_drawMeshTeapot->setLOD(lod);
+            }
+            ImGui::Text("LOD %d / %d: %d triangles per frame (%.2f px error)", m_drawMeshTeapot->getLOD(), m_drawMeshTeapot->getNbLODs() - 1,
+                        m_drawMeshTeapot->getNumDrawnIndices() / 3 * m_drawMeshTeapot->getNbInstances(), m_drawMeshTeapot->getProjectedError());
         }
     } // end "Settings"
 
@@ -344,6 +692,9 @@ void runGUI()
 
 int main(int argc, char** argv)
 {
+    // headless CPU benchmarks (no window)
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+        return runBenchmark(argc - 2, argv + 2);
 
     /* Initialize GLFW and create a window */
     glfwInit();
@@ -375,6 +726,7 @@ int main(int argc, char** argv)
     std::cout << std::endl
               << "UI commands:" << std::endl
               << " - Mouse left button : trackball" << std::endl
+              << " - Mouse right button : pick a triangle" << std::endl
               << " - Mouse scroll: camera zoom" << std::endl
               << " - R: re-init trackball and cameras" << std::endl << std::endl
               << "OpenGL version: " << glGetString(GL_VERSION) << std::endl
@@ -398,6 +750,9 @@ int main(int argc, char** argv)
         // build GUI
         runGUI();
 
+        // background loading
+        updateLoading();
+
         // idle updates
         update();
 
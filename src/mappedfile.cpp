@@ -0,0 +1,126 @@
+/*********************************************************************************************************************
+ *
+ * mappedfile.cpp
+ * 
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+    : m_data(nullptr),
+      m_size(0),
+      m_isOpen(false)
+#ifdef _WIN32
+    , m_fileHandle(nullptr),
+      m_mappingHandle(nullptr)
+#else
+    , m_fileDescriptor(-1)
+#endif
+{ }
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+bool MappedFile::open(const std::string& _filename)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_fileHandle = file;
+    m_size = (size_t)fileSize.QuadPart;
+
+    if (m_size != 0)
+    {
+        m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle != nullptr)
+            m_data = (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (m_data == nullptr)
+        {
+            close();
+            return false;
+        }
+    }
+#else
+    m_fileDescriptor = ::open(_filename.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0)
+    {
+        close();
+        return false;
+    }
+    m_size = (size_t)fileStat.st_size;
+
+    if (m_size != 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+        if (data == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = (const char*)data;
+    }
+#endif
+
+    m_isOpen = true;
+    return true;
+}
+
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle != nullptr)
+        CloseHandle((HANDLE)m_mappingHandle);
+    if (m_fileHandle != nullptr)
+        CloseHandle((HANDLE)m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap((void*)m_data, m_size);
+    if (m_fileDescriptor >= 0)
+        ::close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
@@ -0,0 +1,97 @@
+/*********************************************************************************************************************
+ *
+ * mappedfile.h
+ *
+ * Read-only memory-mapped file
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+
+/*!
+* \class MappedFile
+* \brief Read-only memory mapping of a whole file
+* Pages are loaded on demand by the OS, so files larger than the available memory can be read.
+*/
+class MappedFile
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn MappedFile
+        * \brief Default constructor of MappedFile
+        */
+        MappedFile();
+
+        /*!
+        * \fn ~MappedFile
+        * \brief Destructor of MappedFile (unmaps the file)
+        */
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn data */
+        const char* data() const { return m_data; }
+        /*! \fn size */
+        size_t size() const { return m_size; }
+        /*! \fn isOpen */
+        bool isOpen() const { return m_isOpen; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn open
+        * \brief map a file in memory (read-only)
+        * \param _filename : name of the file
+        * \return false if the file could not be opened or mapped
+        */
+        bool open(const std::string& _filename);
+
+        /*!
+        * \fn close
+        * \brief unmap the file
+        */
+        void close();
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        const char* m_data;     /*!< pointer to the mapped content (nullptr if file is empty) */
+        size_t m_size;          /*!< size of the file in bytes */
+        bool m_isOpen;          /*!< flag to indicate if a file is mapped */
+
+#ifdef _WIN32
+        void* m_fileHandle;     /*!< file handle */
+        void* m_mappingHandle;  /*!< file mapping handle */
+#else
+        int m_fileDescriptor;   /*!< file descriptor */
+#endif
+
+};
+#endif // MAPPEDFILE_H
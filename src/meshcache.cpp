@@ -0,0 +1,185 @@
+/*********************************************************************************************************************
+ *
+ * meshcache.cpp
+ * 
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshcache.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+
+
+static const char CACHE_MAGIC[4] = { 'T', 'M', 'C', '\0' };
+
+
+MeshCache::MeshCache()
+    : m_header(nullptr),
+      m_vertices(nullptr),
+      m_normals(nullptr),
+      m_texcoords(nullptr),
+      m_colors(nullptr),
+      m_indices(nullptr)
+{ }
+
+
+bool MeshCache::open(const std::string& _filename)
+{
+    close();
+
+    if (!m_file.open(_filename) || m_file.size() < sizeof(MeshCacheHeader))
+    {
+        close();
+        return false;
+    }
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)m_file.data();
+    if (std::memcmp(header->magic, CACHE_MAGIC, 4) != 0 || header->version != VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // check that the arrays fill the file (counts are compared to the remaining size, so that corrupt counts cannot
+    // overflow)
+    uint64_t remainingSize = m_file.size() - sizeof(MeshCacheHeader);
+    auto consume = [&](uint64_t _count, size_t _elementSize)
+    {
+        if (_count > remainingSize / _elementSize)
+            return false;
+        remainingSize -= _count * _elementSize;
+        return true;
+    };
+    if (!consume(header->nbVertices, sizeof(glm::vec3)) || !consume(header->nbNormals, sizeof(glm::vec3))
+        || !consume(header->nbTexcoords, sizeof(glm::vec2)) || !consume(header->nbColors, sizeof(glm::vec3))
+        || !consume(header->nbIndices, sizeof(uint32_t)) || remainingSize != 0)
+    {
+        close();
+        return false;
+    }
+
+    const char* ptr = m_file.data() + sizeof(MeshCacheHeader);
+    m_vertices = (const glm::vec3*)ptr;
+    ptr += header->nbVertices * sizeof(glm::vec3);
+    m_normals = (const glm::vec3*)ptr;
+    ptr += header->nbNormals * sizeof(glm::vec3);
+    m_texcoords = (const glm::vec2*)ptr;
+    ptr += header->nbTexcoords * sizeof(glm::vec2);
+    m_colors = (const glm::vec3*)ptr;
+    ptr += header->nbColors * sizeof(glm::vec3);
+    m_indices = (const uint32_t*)ptr;
+
+    m_header = header;
+    m_filename = _filename;
+    return true;
+}
+
+
+bool MeshCache::isValidFor(const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime)
+{
+    if (m_header == nullptr || m_header->sourceSize != _sourceSize)
+        return false;
+    if (m_header->sourceTime == _sourceTime)
+        return true;
+
+    // same size, but written since: compare the content
+    uint64_t hash = 0, size = 0;
+    if (!hashFile(_sourceFilename, hash, size) || hash != m_header->sourceHash || size != _sourceSize)
+        return false;
+
+    // same content: store the new write time, so that the next loads do not hash the source again
+    // (the file is unmapped while it is written, a mapped file cannot be written on all platforms)
+    std::string filename = m_filename;
+    close();
+    std::fstream f(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    if (f.is_open())
+    {
+        f.seekp(offsetof(MeshCacheHeader, sourceTime));
+        f.write((const char*)&_sourceTime, sizeof(uint64_t));
+    }
+    f.close();
+    return open(filename);
+}
+
+
+void MeshCache::close()
+{
+    m_file.close();
+    m_filename.clear();
+    m_header = nullptr;
+    m_vertices = nullptr;
+    m_normals = nullptr;
+    m_texcoords = nullptr;
+    m_colors = nullptr;
+    m_indices = nullptr;
+}
+
+
+bool MeshCache::hashFile(const std::string& _filename, uint64_t& _hash, uint64_t& _size)
+{
+    MappedFile file;
+    if (!file.open(_filename))
+        return false;
+
+    // 64-bit multiply-xorshift hash over 8-byte words
+    const uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 0xCBF29CE484222325ull ^ (file.size() * PRIME);
+    const char* ptr = file.data();
+    size_t nbWords = file.size() / 8;
+    for (size_t i = 0; i < nbWords; i++)
+    {
+        uint64_t word;
+        std::memcpy(&word, ptr + i * 8, 8);
+        h = (h ^ word) * PRIME;
+        h ^= h >> 32;
+    }
+    for (size_t i = nbWords * 8; i < file.size(); i++)
+        h = (h ^ (uint8_t)ptr[i]) * PRIME;
+
+    _hash = h ^ (h >> 29);
+    _size = file.size();
+    return true;
+}
+
+
+bool MeshCache::statFile(const std::string& _filename, uint64_t& _size, uint64_t& _time)
+{
+    std::error_code error;
+    std::filesystem::path path(_filename);
+    uint64_t size = (uint64_t)std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error)
+        return false;
+
+    _size = size;
+    _time = (uint64_t)time.time_since_epoch().count();
+    return true;
+}
+
+
+bool MeshCache::write(const std::string& _filename, MeshCacheHeader _header, const glm::vec3* _vertices, const glm::vec3* _normals,
+                      const glm::vec2* _texcoords, const glm::vec3* _colors, const uint32_t* _indices)
+{
+    std::memcpy(_header.magic, CACHE_MAGIC, 4);
+    _header.version = VERSION;
+
+    std::ofstream f(_filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!f.is_open())
+        return false;
+
+    f.write((const char*)&_header, sizeof(MeshCacheHeader));
+    f.write((const char*)_vertices, _header.nbVertices * sizeof(glm::vec3));
+    f.write((const char*)_normals, _header.nbNormals * sizeof(glm::vec3));
+    f.write((const char*)_texcoords, _header.nbTexcoords * sizeof(glm::vec2));
+    f.write((const char*)_colors, _header.nbColors * sizeof(glm::vec3));
+    f.write((const char*)_indices, _header.nbIndices * sizeof(uint32_t));
+
+    return (bool)f;
+}
@@ -0,0 +1,185 @@
+/*********************************************************************************************************************
+ *
+ * meshcache.h
+ *
+ * Binary mesh cache, memory-mapped for near-instant reloads
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <vector>
+#include <string>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "mappedfile.h"
+
+
+/*!
+* \struct MeshCacheHeader
+* \brief Header of a binary mesh cache file
+* The header is followed by the vertices, normals, texcoords, colors and indices arrays (in this order),
+* stored as tightly packed little-endian float32 / uint32.
+*/
+struct MeshCacheHeader
+{
+    char magic[4];          /*!< "TMC\0" */
+    uint32_t version;       /*!< format version */
+    uint64_t sourceHash;    /*!< hash of the content of the source file */
+    uint64_t sourceSize;    /*!< size of the source file in bytes */
+    uint64_t sourceTime;    /*!< last write time of the source file (clock ticks of std::filesystem) */
+    uint64_t nbVertices;    /*!< number of vertices */
+    uint64_t nbNormals;     /*!< number of normals */
+    uint64_t nbTexcoords;   /*!< number of texcoords */
+    uint64_t nbColors;      /*!< number of colors */
+    uint64_t nbIndices;     /*!< number of indices */
+    float bBoxMin[3];       /*!< min corner of the bounding box */
+    float bBoxMax[3];       /*!< max corner of the bounding box */
+    uint32_t flags;         /*!< processing applied to the mesh (VERTEX_CACHE_OPTIMIZED) */
+    uint32_t reserved;      /*!< padding (0) */
+};
+
+
+/*!
+* \class MeshCache
+* \brief Read-only access to a memory-mapped binary mesh cache
+* Arrays point directly into the mapped file (zero-copy), they remain valid as long as the cache is open.
+*/
+class MeshCache
+{
+    public:
+
+        static constexpr uint32_t VERSION = 3;  /*!< current format version */
+
+        static constexpr uint32_t VERTEX_CACHE_OPTIMIZED = 1;   /*!< header flag: triangles and vertices were reordered */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn MeshCache
+        * \brief Default constructor of MeshCache
+        */
+        MeshCache();
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getHeader */
+        const MeshCacheHeader& getHeader() const { return *m_header; }
+
+        /*! \fn getVertices */
+        const glm::vec3* getVertices() const { return m_vertices; }
+        /*! \fn getNormals */
+        const glm::vec3* getNormals() const { return m_normals; }
+        /*! \fn getTexCoords */
+        const glm::vec2* getTexCoords() const { return m_texcoords; }
+        /*! \fn getColors */
+        const glm::vec3* getColors() const { return m_colors; }
+        /*! \fn getIndices */
+        const uint32_t* getIndices() const { return m_indices; }
+
+        /*!
+        * \fn getVertexView
+        * \brief view of the vertices array (empty if the cache is not open)
+        */
+        std::span<const glm::vec3> getVertexView() const { return { m_vertices, isOpen() ? (size_t)m_header->nbVertices : 0 }; }
+        /*! \fn getNormalView */
+        std::span<const glm::vec3> getNormalView() const { return { m_normals, isOpen() ? (size_t)m_header->nbNormals : 0 }; }
+        /*! \fn getTexCoordView */
+        std::span<const glm::vec2> getTexCoordView() const { return { m_texcoords, isOpen() ? (size_t)m_header->nbTexcoords : 0 }; }
+        /*! \fn getColorView */
+        std::span<const glm::vec3> getColorView() const { return { m_colors, isOpen() ? (size_t)m_header->nbColors : 0 }; }
+        /*! \fn getIndexView */
+        std::span<const uint32_t> getIndexView() const { return { m_indices, isOpen() ? (size_t)m_header->nbIndices : 0 }; }
+
+        /*! \fn isOpen */
+        bool isOpen() const { return m_header != nullptr; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn open
+        * \brief map a cache file and check its header
+        * \param _filename : name of the cache file
+        * \return false if the file cannot be mapped or is not a valid cache file
+        */
+        bool open(const std::string& _filename);
+
+        /*!
+        * \fn isValidFor
+        * \brief check if the open cache has been built from a given source file: sizes must match, then the content
+        * is hashed only if the write time differs (e.g., file touched or copied). If the content matches, the new write
+        * time is stored in the cache file (which is reopened), so that it is hashed only once.
+        * \param _sourceFilename : name of the source file
+        * \param _sourceSize : size of the source file (see statFile())
+        * \param _sourceTime : last write time of the source file (see statFile())
+        */
+        bool isValidFor(const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime);
+
+        /*!
+        * \fn close
+        * \brief unmap the cache file
+        */
+        void close();
+
+        /*!
+        * \fn hashFile
+        * \brief compute a 64-bit hash of the content of a file
+        * \param _filename : name of the file
+        * \param _hash : resulting hash
+        * \param _size : size of the file
+        * \return false if the file cannot be read
+        */
+        static bool hashFile(const std::string& _filename, uint64_t& _hash, uint64_t& _size);
+
+        /*!
+        * \fn statFile
+        * \brief get the size and last write time of a file, without reading it
+        * \return false if the file does not exist
+        */
+        static bool statFile(const std::string& _filename, uint64_t& _size, uint64_t& _time);
+
+        /*!
+        * \fn write
+        * \brief write mesh arrays in a cache file
+        * \param _filename : name of the cache file
+        * \param _header : header (magic and version are filled in, counts must match the arrays)
+        * \return false if the file cannot be written
+        */
+        static bool write(const std::string& _filename, MeshCacheHeader _header, const glm::vec3* _vertices, const glm::vec3* _normals,
+                          const glm::vec2* _texcoords, const glm::vec3* _colors, const uint32_t* _indices);
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        MappedFile m_file;                  /*!< mapped cache file */
+        std::string m_filename;             /*!< name of the mapped cache file */
+        const MeshCacheHeader* m_header;    /*!< header (in mapped file) */
+
+        const glm::vec3* m_vertices;        /*!< vertices positions array (in mapped file) */
+        const glm::vec3* m_normals;         /*!< vertices normals array (in mapped file) */
+        const glm::vec2* m_texcoords;       /*!< vertices uvs array (in mapped file) */
+        const glm::vec3* m_colors;          /*!< vertices colors array (in mapped file) */
+        const uint32_t* m_indices;          /*!< indices array (in mapped file) */
+
+};
+#endif // MESHCACHE_H
@@ -0,0 +1,626 @@
+/*********************************************************************************************************************
+ *
+ * meshcodec.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshcodec.h"
+#include "vertexcache.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+
+static const char CODEC_MAGIC[4] = { 'T', 'M', 'Q', '\0' };
+
+static const uint32_t RANS_PROB_BITS = 12;                      // frequencies are normalized to 2^12
+static const uint32_t RANS_PROB_SCALE = 1u << RANS_PROB_BITS;
+static const uint32_t RANS_L = 1u << 23;                        // lower bound of the rANS state
+
+static const uint8_t STREAM_RAW = 0;    // stream stored as is
+static const uint8_t STREAM_RANS = 1;   // stream entropy-coded with rANS
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              BYTE STREAMS                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+/*
+ * Bounds-checked reader over an encoded buffer
+ */
+struct ByteReader
+{
+    const uint8_t* ptr;
+    const uint8_t* end;
+
+    bool read(void* _dst, size_t _size)
+    {
+        if ((size_t)(end - ptr) < _size)
+            return false;
+        if (_size == 0)
+            return true;
+        std::memcpy(_dst, ptr, _size);
+        ptr += _size;
+        return true;
+    }
+};
+
+
+static void writeBytes(std::vector<uint8_t>& _out, const void* _src, size_t _size)
+{
+    _out.insert(_out.end(), (const uint8_t*)_src, (const uint8_t*)_src + _size);
+}
+
+
+static inline uint32_t zigzagEncode(int32_t _value) { return ((uint32_t)_value << 1) ^ (uint32_t)(_value >> 31); }
+static inline int32_t zigzagDecode(uint32_t _value) { return (int32_t)(_value >> 1) ^ -(int32_t)(_value & 1); }
+
+
+static void writeVarint(std::vector<uint8_t>& _out, uint32_t _value)
+{
+    while (_value >= 0x80)
+    {
+        _out.push_back((uint8_t)(_value | 0x80));
+        _value >>= 7;
+    }
+    _out.push_back((uint8_t)_value);
+}
+
+
+static inline bool readVarint(const uint8_t*& _ptr, const uint8_t* _end, uint32_t& _value)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && _ptr < _end; shift += 7)
+    {
+        uint8_t byte = *(_ptr++);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            _value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                             ENTROPY CODING                                                  |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+/*
+ * Scale symbol counts so that they sum to RANS_PROB_SCALE (used symbols keep a frequency >= 1)
+ */
+static void normalizeFrequencies(const uint32_t _counts[256], size_t _total, uint32_t _freqs[256])
+{
+    int sum = 0;
+    for (int s = 0; s < 256; s++)
+    {
+        _freqs[s] = (_counts[s] == 0) ? 0 : std::max<uint32_t>(1, (uint32_t)((uint64_t)_counts[s] * RANS_PROB_SCALE / _total));
+        sum += (int)_freqs[s];
+    }
+
+    // fix rounding errors on the most frequent symbols
+    int diff = (int)RANS_PROB_SCALE - sum;
+    while (diff != 0)
+    {
+        int maxSymbol = (int)(std::max_element(_freqs, _freqs + 256) - _freqs);
+        if (diff > 0)
+        {
+            _freqs[maxSymbol] += diff;
+            diff = 0;
+        }
+        else
+        {
+            int decrement = std::min(-diff, (int)_freqs[maxSymbol] / 2);
+            _freqs[maxSymbol] -= decrement;
+            diff += decrement;
+        }
+    }
+}
+
+
+/*
+ * Append a byte stream to the output, entropy-coded with a static order-0 rANS coder if it is worth it
+ * Layout: raw size (u32), method (u8), [RANS: 256 frequencies (u16), payload size (u32)], payload
+ */
+static void encodeStream(const std::vector<uint8_t>& _input, std::vector<uint8_t>& _output)
+{
+    uint32_t rawSize = (uint32_t)_input.size();
+    writeBytes(_output, &rawSize, sizeof(uint32_t));
+
+    std::vector<uint8_t> encoded;
+    uint32_t freqs[256] = {};
+    if (rawSize != 0)
+    {
+        uint32_t counts[256] = {};
+        for (uint8_t symbol : _input)
+            counts[symbol]++;
+        normalizeFrequencies(counts, rawSize, freqs);
+
+        uint32_t starts[256];
+        uint32_t start = 0;
+        for (int s = 0; s < 256; s++)
+        {
+            starts[s] = start;
+            start += freqs[s];
+        }
+
+        // rANS encodes backwards, bytes are emitted in reverse order
+        encoded.reserve(rawSize / 2 + 16);
+        uint32_t x = RANS_L;
+        for (size_t i = rawSize; i-- > 0;)
+        {
+            uint8_t symbol = _input[i];
+            uint32_t freq = freqs[symbol];
+            uint32_t xMax = ((RANS_L >> RANS_PROB_BITS) << 8) * freq;
+            while (x >= xMax)
+            {
+                encoded.push_back((uint8_t)(x & 0xFF));
+                x >>= 8;
+            }
+            x = ((x / freq) << RANS_PROB_BITS) + (x % freq) + starts[symbol];
+        }
+        for (int shift = 24; shift >= 0; shift -= 8)
+            encoded.push_back((uint8_t)(x >> shift));
+        std::reverse(encoded.begin(), encoded.end());
+    }
+
+    if (rawSize == 0 || encoded.size() + 256 * sizeof(uint16_t) + sizeof(uint32_t) >= rawSize)
+    {
+        _output.push_back(STREAM_RAW);
+        writeBytes(_output, _input.data(), rawSize);
+        return;
+    }
+
+    _output.push_back(STREAM_RANS);
+    for (int s = 0; s < 256; s++)
+    {
+        uint16_t freq = (uint16_t)freqs[s];
+        writeBytes(_output, &freq, sizeof(uint16_t));
+    }
+    uint32_t payloadSize = (uint32_t)encoded.size();
+    writeBytes(_output, &payloadSize, sizeof(uint32_t));
+    writeBytes(_output, encoded.data(), encoded.size());
+}
+
+
+/*
+ * Decode a byte stream written by encodeStream()
+ */
+static bool decodeStream(ByteReader& _reader, std::vector<uint8_t>& _output)
+{
+    uint32_t rawSize;
+    uint8_t method;
+    if (!_reader.read(&rawSize, sizeof(uint32_t)) || !_reader.read(&method, 1))
+        return false;
+
+    if (method == STREAM_RAW)
+    {
+        _output.resize(rawSize);
+        return _reader.read(_output.data(), rawSize);
+    }
+    if (method != STREAM_RANS)
+        return false;
+
+    // frequency table, must sum to RANS_PROB_SCALE
+    uint32_t freqs[256], starts[256];
+    uint32_t start = 0;
+    for (int s = 0; s < 256; s++)
+    {
+        uint16_t freq;
+        if (!_reader.read(&freq, sizeof(uint16_t)))
+            return false;
+        freqs[s] = freq;
+        starts[s] = start;
+        start += freq;
+    }
+    if (start != RANS_PROB_SCALE)
+        return false;
+
+    uint8_t slotToSymbol[RANS_PROB_SCALE];
+    for (int s = 0; s < 256; s++)
+        std::memset(slotToSymbol + starts[s], s, freqs[s]);
+
+    uint32_t payloadSize;
+    if (!_reader.read(&payloadSize, sizeof(uint32_t)) || (size_t)(_reader.end - _reader.ptr) < payloadSize || payloadSize < 4)
+        return false;
+    const uint8_t* ptr = _reader.ptr;
+    const uint8_t* end = ptr + payloadSize;
+    _reader.ptr = end;
+
+    uint32_t x;
+    std::memcpy(&x, ptr, sizeof(uint32_t));
+    ptr += 4;
+
+    _output.resize(rawSize);
+    uint8_t* out = _output.data();
+    for (uint32_t i = 0; i < rawSize; i++)
+    {
+        uint32_t slot = x & (RANS_PROB_SCALE - 1);
+        uint8_t symbol = slotToSymbol[slot];
+        x = freqs[symbol] * (x >> RANS_PROB_BITS) + slot - starts[symbol];
+        while (x < RANS_L)
+        {
+            if (ptr >= end)
+                return false;
+            x = (x << 8) | *(ptr++);
+        }
+        out[i] = symbol;
+    }
+    return true;
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              QUANTIZATION                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+glm::vec2 MeshCodec::encodeOctahedral(glm::vec3 _n)
+{
+    float l1 = std::abs(_n.x) + std::abs(_n.y) + std::abs(_n.z);
+    if (l1 == 0.0f || !(l1 == l1))
+        return glm::vec2(0.0f, 0.0f);
+    _n = _n / l1;
+    if (_n.z < 0.0f)
+    {
+        float x = _n.x;
+        _n.x = (1.0f - std::abs(_n.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        _n.y = (1.0f - std::abs(x)) * (_n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::vec2(_n.x, _n.y);
+}
+
+
+glm::vec3 MeshCodec::decodeOctahedral(glm::vec2 _e)
+{
+    glm::vec3 n(_e.x, _e.y, 1.0f - std::abs(_e.x) - std::abs(_e.y));
+    if (n.z < 0.0f)
+    {
+        float x = n.x;
+        n.x = (1.0f - std::abs(n.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        n.y = (1.0f - std::abs(x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(n);
+}
+
+
+/*
+ * Quantize a value in [_min, _min + _extent] on _bits bits
+ */
+static inline int32_t quantize(float _value, float _min, float _extent, uint32_t _bits)
+{
+    if (_bits == 0 || _extent <= 0.0f)
+        return 0;
+    float maxValue = (float)((1u << _bits) - 1);
+    return (int32_t)std::min(maxValue, std::max(0.0f, std::round((_value - _min) / _extent * maxValue)));
+}
+
+
+/*
+ * Number of bits needed so that the quantization error of a range stays below _maxError (may exceed
+ * MeshCodec::MAX_POSITION_BITS, checked by the caller)
+ */
+static uint32_t getQuantizationBits(float _extent, float _maxError)
+{
+    if (_extent <= 0.0f)
+        return 0;
+    if (_maxError <= 0.0f)
+        return 16;
+    double nbSteps = (double)_extent / (2.0 * (double)_maxError) + 1.0;
+    return (uint32_t)std::min(64.0, std::max(1.0, std::ceil(std::log2(nbSteps))));
+}
+
+
+/*
+ * Append quantized values as delta-coded zigzag varints
+ */
+static void writeDeltas(const std::vector<int32_t>& _values, std::vector<uint8_t>& _out)
+{
+    _out.clear();
+    _out.reserve(_values.size() * 2);
+    int32_t prev = 0;
+    for (int32_t value : _values)
+    {
+        writeVarint(_out, zigzagEncode(value - prev));
+        prev = value;
+    }
+}
+
+
+/*
+ * Read _count delta-coded zigzag varints, call _func(i, value) for each reconstructed value
+ */
+template<typename Func>
+static bool readDeltas(const std::vector<uint8_t>& _stream, size_t _count, Func&& _func)
+{
+    const uint8_t* ptr = _stream.data();
+    const uint8_t* end = ptr + _stream.size();
+    int32_t value = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+        uint32_t code;
+        if (!readVarint(ptr, end, code))
+            return false;
+        value += zigzagDecode(code);
+        _func(i, value);
+    }
+    return true;
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              ENCODE / DECODE                                                |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+bool MeshCodec::encode(std::span<const glm::vec3> _vertices, std::span<const glm::vec3> _normals, std::span<const glm::vec2> _texcoords,
+                       std::span<const glm::vec3> _colors, std::span<const uint32_t> _indices, const MeshCodecParams& _params,
+                       std::vector<uint8_t>& _output)
+{
+    const uint32_t UNUSED = 0xFFFFFFFFu;
+    size_t nbVertices = _vertices.size();
+    if (std::any_of(_indices.begin(), _indices.end(), [&](uint32_t _index) { return _index >= nbVertices; }))
+        return false;
+
+    // Reorder triangles for the vertex cache: consecutive triangles share vertices, so the first-use order below
+    // follows a local traversal of the surface
+    std::vector<uint32_t> reorderedIndices;
+    if (_params.optimizeVertexCache && _indices.size() % 3 == 0)
+    {
+        reorderedIndices.resize(_indices.size());
+        ::optimizeVertexCache(_indices, nbVertices, VERTEX_CACHE_SIZE, reorderedIndices);
+        _indices = reorderedIndices;
+    }
+
+    // Reorder vertices in first-use order: new vertices get consecutive indices, so index deltas stay small
+    std::vector<uint32_t> oldToNew(nbVertices, UNUSED);
+    std::vector<uint32_t> newToOld;
+    newToOld.reserve(nbVertices);
+    for (uint32_t index : _indices)
+    {
+        if (oldToNew[index] == UNUSED)
+        {
+            oldToNew[index] = (uint32_t)newToOld.size();
+            newToOld.push_back(index);
+        }
+    }
+    for (uint32_t v = 0; v < nbVertices; v++)
+    {
+        // keep unreferenced vertices
+        if (oldToNew[v] == UNUSED)
+        {
+            oldToNew[v] = (uint32_t)newToOld.size();
+            newToOld.push_back(v);
+        }
+    }
+
+    MeshCodecHeader header = {};
+    std::memcpy(header.magic, CODEC_MAGIC, 4);
+    header.version = VERSION;
+    header.nbVertices = (uint32_t)nbVertices;
+    header.nbIndices = (uint32_t)_indices.size();
+    header.flags = (_normals.size() == nbVertices && nbVertices ? HAS_NORMALS : 0)
+                 | (_texcoords.size() == nbVertices && nbVertices ? HAS_TEXCOORDS : 0)
+                 | (_colors.size() == nbVertices && nbVertices ? HAS_COLORS : 0);
+    header.normalBits = (uint32_t)std::min(16, std::max(2, _params.normalBits));
+
+    glm::vec3 bBoxMin(0.0f), bBoxMax(0.0f);
+    if (nbVertices != 0)
+    {
+        bBoxMin = bBoxMax = _vertices[0];
+        for (const glm::vec3& vertex : _vertices)
+        {
+            bBoxMin = glm::min(bBoxMin, vertex);
+            bBoxMax = glm::max(bBoxMax, vertex);
+        }
+    }
+    glm::vec2 uvMin(0.0f), uvMax(0.0f);
+    if (header.flags & HAS_TEXCOORDS)
+    {
+        uvMin = uvMax = _texcoords[0];
+        for (const glm::vec2& uv : _texcoords)
+        {
+            uvMin = glm::vec2(std::min(uvMin.x, uv.x), std::min(uvMin.y, uv.y));
+            uvMax = glm::vec2(std::max(uvMax.x, uv.x), std::max(uvMax.y, uv.y));
+        }
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        header.bBoxMin[i] = bBoxMin[i];
+        header.bBoxMax[i] = bBoxMax[i];
+        header.positionBits[i] = getQuantizationBits(bBoxMax[i] - bBoxMin[i], _params.maxPositionError);
+        if (header.positionBits[i] > MAX_POSITION_BITS)
+            return false;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        header.uvMin[i] = uvMin[i];
+        header.uvMax[i] = uvMax[i];
+    }
+
+    _output.clear();
+    writeBytes(_output, &header, sizeof(MeshCodecHeader));
+
+    std::vector<uint8_t> stream;
+    std::vector<int32_t> values(nbVertices);
+
+    // Indices: distance to the next new vertex (0 = new vertex)
+    stream.reserve(_indices.size());
+    uint32_t nextVertex = 0;
+    for (uint32_t index : _indices)
+    {
+        uint32_t newIndex = oldToNew[index];
+        writeVarint(stream, nextVertex - newIndex);
+        if (newIndex == nextVertex)
+            nextVertex++;
+    }
+    encodeStream(stream, _output);
+
+    // Positions: one stream per axis
+    for (int i = 0; i < 3; i++)
+    {
+        for (size_t v = 0; v < nbVertices; v++)
+            values[v] = quantize(_vertices[newToOld[v]][i], bBoxMin[i], bBoxMax[i] - bBoxMin[i], header.positionBits[i]);
+        writeDeltas(values, stream);
+        encodeStream(stream, _output);
+    }
+
+    // Normals: octahedral coords
+    if (header.flags & HAS_NORMALS)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            for (size_t v = 0; v < nbVertices; v++)
+                values[v] = quantize(encodeOctahedral(_normals[newToOld[v]])[i], -1.0f, 2.0f, header.normalBits);
+            writeDeltas(values, stream);
+            encodeStream(stream, _output);
+        }
+    }
+
+    // Texcoords: 16 bits in the uv range
+    if (header.flags & HAS_TEXCOORDS)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            for (size_t v = 0; v < nbVertices; v++)
+                values[v] = quantize(_texcoords[newToOld[v]][i], uvMin[i], uvMax[i] - uvMin[i], 16);
+            writeDeltas(values, stream);
+            encodeStream(stream, _output);
+        }
+    }
+
+    // Colors: 8 bits per channel, byte deltas
+    if (header.flags & HAS_COLORS)
+    {
+        stream.resize(nbVertices * 3);
+        for (int i = 0; i < 3; i++)
+        {
+            uint8_t prev = 0;
+            for (size_t v = 0; v < nbVertices; v++)
+            {
+                uint8_t value = (uint8_t)quantize(_colors[newToOld[v]][i], 0.0f, 1.0f, 8);
+                stream[i * nbVertices + v] = (uint8_t)(value - prev);
+                prev = value;
+            }
+        }
+        encodeStream(stream, _output);
+    }
+
+    return true;
+}
+
+
+bool MeshCodec::decode(const uint8_t* _data, size_t _size, MeshCodecHeader& _header, std::vector<glm::vec3>& _vertices, std::vector<glm::vec3>& _normals,
+                       std::vector<glm::vec2>& _texcoords, std::vector<glm::vec3>& _colors, std::vector<uint32_t>& _indices)
+{
+    ByteReader reader = { _data, _data + _size };
+    if (!reader.read(&_header, sizeof(MeshCodecHeader)) || std::memcmp(_header.magic, CODEC_MAGIC, 4) != 0 || _header.version != VERSION)
+        return false;
+    for (int i = 0; i < 3; i++)
+        if (_header.positionBits[i] > 24)
+            return false;
+    if (_header.normalBits > 16)
+        return false;
+
+    size_t nbVertices = _header.nbVertices;
+    std::vector<uint8_t> stream;
+
+    // Indices
+    // (every index / vertex coord takes at least one byte: reject corrupted counts before allocating)
+    if (!decodeStream(reader, stream) || stream.size() < _header.nbIndices)
+        return false;
+    _indices.resize(_header.nbIndices);
+    {
+        const uint8_t* ptr = stream.data();
+        const uint8_t* end = ptr + stream.size();
+        uint32_t nextVertex = 0;
+        for (size_t k = 0; k < _indices.size(); k++)
+        {
+            uint32_t code;
+            if (!readVarint(ptr, end, code) || code > nextVertex)
+                return false;
+            _indices[k] = nextVertex - code;
+            if (code == 0 && ++nextVertex > nbVertices)
+                return false;
+        }
+    }
+
+    // Positions
+    _vertices.clear();
+    for (int i = 0; i < 3; i++)
+    {
+        if (!decodeStream(reader, stream) || stream.size() < nbVertices)
+            return false;
+        float origin = _header.bBoxMin[i];
+        _vertices.resize(nbVertices);
+        float step = (_header.positionBits[i] == 0) ? 0.0f : (_header.bBoxMax[i] - _header.bBoxMin[i]) / (float)((1u << _header.positionBits[i]) - 1);
+        if (!readDeltas(stream, nbVertices, [&](size_t _v, int32_t _q) { _vertices[_v][i] = origin + (float)_q * step; }))
+            return false;
+    }
+
+    // Normals
+    _normals.clear();
+    if (_header.flags & HAS_NORMALS)
+    {
+        std::vector<glm::vec2> octCoords(nbVertices);
+        float step = 2.0f / (float)((1u << _header.normalBits) - 1);
+        for (int i = 0; i < 2; i++)
+        {
+            if (!decodeStream(reader, stream))
+                return false;
+            if (!readDeltas(stream, nbVertices, [&](size_t _v, int32_t _q) { octCoords[_v][i] = -1.0f + (float)_q * step; }))
+                return false;
+        }
+        _normals.resize(nbVertices);
+        for (size_t v = 0; v < nbVertices; v++)
+            _normals[v] = decodeOctahedral(octCoords[v]);
+    }
+
+    // Texcoords
+    _texcoords.clear();
+    if (_header.flags & HAS_TEXCOORDS)
+    {
+        _texcoords.resize(nbVertices);
+        for (int i = 0; i < 2; i++)
+        {
+            if (!decodeStream(reader, stream))
+                return false;
+            float origin = _header.uvMin[i];
+            float step = (_header.uvMax[i] - _header.uvMin[i]) / 65535.0f;
+            if (!readDeltas(stream, nbVertices, [&](size_t _v, int32_t _q) { _texcoords[_v][i] = origin + (float)_q * step; }))
+                return false;
+        }
+    }
+
+    // Colors
+    _colors.clear();
+    if (_header.flags & HAS_COLORS)
+    {
+        if (!decodeStream(reader, stream) || stream.size() != nbVertices * 3)
+            return false;
+        _colors.resize(nbVertices);
+        for (int i = 0; i < 3; i++)
+        {
+            uint8_t value = 0;
+            for (size_t v = 0; v < nbVertices; v++)
+            {
+                value = (uint8_t)(value + stream[i * nbVertices + v]);
+                _colors[v][i] = (float)value / 255.0f;
+            }
+        }
+    }
+
+    return true;
+}
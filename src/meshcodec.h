@@ -0,0 +1,121 @@
+/*********************************************************************************************************************
+ *
+ * meshcodec.h
+ *
+ * Quantized and entropy-coded mesh format
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHCODEC_H
+#define MESHCODEC_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct MeshCodecParams
+* \brief Encoding parameters (error bounds)
+*/
+struct MeshCodecParams
+{
+    float maxPositionError = 0.0f;  /*!< max error on vertex coords (in model units), 0 = 16 bits per axis */
+    int normalBits = 12;            /*!< bits per octahedral normal component, in [2,16] */
+    bool optimizeVertexCache = true;    /*!< reorder triangles for the vertex cache before the first-use order of vertices
+                                             (makes the size independent of the triangle order of the source, but may be
+                                             larger than an already coherent order, see --bench codec) */
+};
+
+
+/*!
+* \struct MeshCodecHeader
+* \brief Header of a compressed mesh, followed by the encoded streams
+*/
+struct MeshCodecHeader
+{
+    char magic[4];              /*!< "TMQ\0" */
+    uint32_t version;           /*!< format version */
+    uint32_t nbVertices;        /*!< number of vertices */
+    uint32_t nbIndices;         /*!< number of indices */
+    uint32_t flags;             /*!< optional attributes (HAS_NORMALS | HAS_TEXCOORDS | HAS_COLORS) */
+    uint32_t positionBits[3];   /*!< quantization bits of vertex coords, per axis */
+    uint32_t normalBits;        /*!< quantization bits of octahedral normals */
+    float bBoxMin[3];           /*!< min corner of the bounding box (quantization origin) */
+    float bBoxMax[3];           /*!< max corner of the bounding box */
+    float uvMin[2];             /*!< min texcoords */
+    float uvMax[2];             /*!< max texcoords */
+};
+
+
+/*!
+* \class MeshCodec
+* \brief Encode / decode meshes in a compact format
+* - triangles are reordered for the post-transform vertex cache (see ::optimizeVertexCache), then vertices are
+*   reordered in first-use order of the index buffer, so that index and attribute deltas stay small
+* - positions are quantized relative to the AABB (at most MAX_POSITION_BITS per axis), normals are octahedral-encoded,
+*   texcoords use 16 bits, colors 8 bits
+* - indices and attributes are delta-coded (zigzag varints), then each stream is entropy-coded (order-0 rANS)
+*/
+class MeshCodec
+{
+    public:
+
+        static constexpr uint32_t VERSION = 1;          /*!< current format version */
+
+        static constexpr uint32_t MAX_POSITION_BITS = 24;       /*!< max quantization bits per axis (float precision) */
+        static constexpr unsigned VERTEX_CACHE_SIZE = 16;       /*!< cache size targeted by the triangle reordering */
+
+        static constexpr uint32_t HAS_NORMALS = 1;      /*!< header flag: normals are stored */
+        static constexpr uint32_t HAS_TEXCOORDS = 2;    /*!< header flag: texcoords are stored */
+        static constexpr uint32_t HAS_COLORS = 4;       /*!< header flag: colors are stored */
+
+        /*!
+        * \fn encode
+        * \brief encode a mesh (optional attributes are stored if they have one value per vertex)
+        * \param _vertices : vertices positions
+        * \param _normals : vertices normals (optional)
+        * \param _texcoords : vertices uvs (optional)
+        * \param _colors : vertices RGB colors in [0,1] (optional)
+        * \param _indices : triangles
+        * \param _params : error bounds
+        * \param _output : encoded mesh
+        * \return false if the mesh cannot be encoded (invalid indices, or a position error below what MAX_POSITION_BITS
+        * can hold over the AABB)
+        */
+        static bool encode(std::span<const glm::vec3> _vertices, std::span<const glm::vec3> _normals, std::span<const glm::vec2> _texcoords,
+                           std::span<const glm::vec3> _colors, std::span<const uint32_t> _indices, const MeshCodecParams& _params,
+                           std::vector<uint8_t>& _output);
+
+        /*!
+        * \fn decode
+        * \brief decode a mesh
+        * \param _data : encoded mesh
+        * \param _size : size of encoded mesh in bytes
+        * \param _header : decoded header (AABB, counts, ...)
+        * \return false if data is corrupted
+        */
+        static bool decode(const uint8_t* _data, size_t _size, MeshCodecHeader& _header, std::vector<glm::vec3>& _vertices, std::vector<glm::vec3>& _normals,
+                           std::vector<glm::vec2>& _texcoords, std::vector<glm::vec3>& _colors, std::vector<uint32_t>& _indices);
+
+        /*!
+        * \fn encodeOctahedral
+        * \brief map a unit vector to octahedral coords in [-1,1]^2
+        */
+        static glm::vec2 encodeOctahedral(glm::vec3 _n);
+
+        /*!
+        * \fn decodeOctahedral
+        * \brief map octahedral coords in [-1,1]^2 to a unit vector
+        */
+        static glm::vec3 decodeOctahedral(glm::vec2 _e);
+
+};
+
+#endif // MESHCODEC_H
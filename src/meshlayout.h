@@ -0,0 +1,444 @@
+/*********************************************************************************************************************
+ *
+ * meshlayout.h
+ *
+ * Vertex storage layouts (compile-time policies) and mesh algorithms written for each of them
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHLAYOUT_H
+#define MESHLAYOUT_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct VertexAttributeView
+* \brief Location of a vertex attribute (3 floats per vertex) in a buffer ready for GPU upload
+*/
+struct VertexAttributeView
+{
+    const void* data = nullptr;     /*!< first byte of the buffer holding the attribute */
+    size_t bufferSize = 0;          /*!< size of the buffer in bytes */
+    size_t stride = 0;              /*!< bytes between two consecutive values (0 = tightly packed) */
+    size_t offset = 0;              /*!< offset of the first value in the buffer */
+};
+
+
+/*!
+* \struct VertexUploadViews
+* \brief Vertex attributes ready for GPU upload (attributes sharing the same data pointer share the same buffer)
+*/
+struct VertexUploadViews
+{
+    VertexAttributeView position;   /*!< vertices positions */
+    VertexAttributeView normal;     /*!< vertices normals */
+    size_t nbVertices = 0;          /*!< number of vertices */
+};
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 LAYOUTS                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+/*!
+* \struct ArrayLayout
+* \brief One array of vec3 per attribute (layout used by TriMesh)
+* Each array can be uploaded as is in its own VBO.
+*/
+struct ArrayLayout
+{
+    static constexpr const char* NAME = "arrays";
+
+    std::vector<glm::vec3> positions;   /*!< vertices positions */
+    std::vector<glm::vec3> normals;     /*!< vertices normals */
+
+    /*! \fn size */
+    size_t size() const { return positions.size(); }
+
+    /*!
+    * \fn assign
+    * \brief copy positions and normals (normals are zeroed if not provided)
+    */
+    void assign(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals)
+    {
+        positions.assign(_positions.begin(), _positions.end());
+        if (_normals.size() == _positions.size())
+            normals.assign(_normals.begin(), _normals.end());
+        else
+            normals.assign(_positions.size(), glm::vec3(0.0f));
+    }
+
+    /*!
+    * \fn computeAABB
+    * \brief compute bounding box of a vec3 array (at least one element)
+    */
+    static void computeAABB(std::span<const glm::vec3> _positions, glm::vec3& _min, glm::vec3& _max)
+    {
+        _min = _max = _positions[0];
+        for (const glm::vec3& p : _positions)
+        {
+            _min = glm::min(_min, p);
+            _max = glm::max(_max, p);
+        }
+    }
+
+    /*!
+    * \fn computeNormals
+    * \brief average the unnormalized face normals around each vertex
+    */
+    static void computeNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::span<glm::vec3> _normals)
+    {
+        std::fill(_normals.begin(), _normals.end(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+        {
+            uint32_t i0 = _indices[i], i1 = _indices[i + 1], i2 = _indices[i + 2];
+            glm::vec3 normal = glm::cross(_positions[i1] - _positions[i0], _positions[i2] - _positions[i0]);
+            _normals[i0] += normal;
+            _normals[i1] += normal;
+            _normals[i2] += normal;
+        }
+        for (glm::vec3& normal : _normals)
+            normal = glm::normalize(normal);
+    }
+
+    void computeAABB(glm::vec3& _min, glm::vec3& _max) const { computeAABB(positions, _min, _max); }
+    void computeNormals(std::span<const uint32_t> _indices) { computeNormals(positions, _indices, normals); }
+
+    /*!
+    * \fn getUploadViews
+    * \brief arrays are uploaded as is in two VBOs
+    */
+    VertexUploadViews getUploadViews(std::vector<float>& /*_scratch*/) const
+    {
+        VertexUploadViews views;
+        views.nbVertices = positions.size();
+        views.position = { positions.data(), positions.size() * sizeof(glm::vec3), 0, 0 };
+        views.normal = { normals.data(), normals.size() * sizeof(glm::vec3), 0, 0 };
+        return views;
+    }
+};
+
+
+/*!
+* \struct InterleavedLayout
+* \brief Array of structures: position and normal of a vertex are stored next to each other
+* The whole array is uploaded in a single VBO; per-vertex loops touch a single stream.
+*/
+struct InterleavedLayout
+{
+    static constexpr const char* NAME = "AoS";
+
+    /*!
+    * \struct Vertex
+    * \brief interleaved vertex attributes
+    */
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+
+    std::vector<Vertex> vertices;   /*!< interleaved vertices */
+
+    /*! \fn size */
+    size_t size() const { return vertices.size(); }
+
+    /*!
+    * \fn assign
+    * \brief interleave positions and normals (normals are zeroed if not provided)
+    */
+    void assign(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals)
+    {
+        bool hasNormals = (_normals.size() == _positions.size());
+        vertices.resize(_positions.size());
+        for (size_t i = 0; i < _positions.size(); i++)
+            vertices[i] = { _positions[i], hasNormals ? _normals[i] : glm::vec3(0.0f) };
+    }
+
+    /*!
+    * \fn computeAABB
+    * \brief compute bounding box (at least one vertex)
+    */
+    void computeAABB(glm::vec3& _min, glm::vec3& _max) const
+    {
+        _min = _max = vertices[0].position;
+        for (const Vertex& v : vertices)
+        {
+            _min = glm::min(_min, v.position);
+            _max = glm::max(_max, v.position);
+        }
+    }
+
+    /*!
+    * \fn computeNormals
+    * \brief average the unnormalized face normals around each vertex (position and normal share a cache line)
+    */
+    void computeNormals(std::span<const uint32_t> _indices)
+    {
+        for (Vertex& v : vertices)
+            v.normal = glm::vec3(0.0f);
+        for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+        {
+            Vertex& v0 = vertices[_indices[i]];
+            Vertex& v1 = vertices[_indices[i + 1]];
+            Vertex& v2 = vertices[_indices[i + 2]];
+            glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+            v0.normal += normal;
+            v1.normal += normal;
+            v2.normal += normal;
+        }
+        for (Vertex& v : vertices)
+            v.normal = glm::normalize(v.normal);
+    }
+
+    /*!
+    * \fn getUploadViews
+    * \brief the interleaved array is uploaded as is in one VBO
+    */
+    VertexUploadViews getUploadViews(std::vector<float>& /*_scratch*/) const
+    {
+        VertexUploadViews views;
+        views.nbVertices = vertices.size();
+        size_t bufferSize = vertices.size() * sizeof(Vertex);
+        views.position = { vertices.data(), bufferSize, sizeof(Vertex), offsetof(Vertex, position) };
+        views.normal = { vertices.data(), bufferSize, sizeof(Vertex), offsetof(Vertex, normal) };
+        return views;
+    }
+};
+
+
+/*!
+* \struct SoALayout
+* \brief Pure structure of arrays: one float stream per coordinate (x, y, z of positions and normals)
+* Per-vertex loops are plain float loops that the compiler can vectorize; upload needs an interleaving pass.
+*/
+struct SoALayout
+{
+    static constexpr const char* NAME = "SoA";
+
+    std::vector<float> px, py, pz;  /*!< vertices positions */
+    std::vector<float> nx, ny, nz;  /*!< vertices normals */
+
+    /*! \fn size */
+    size_t size() const { return px.size(); }
+
+    /*!
+    * \fn assign
+    * \brief split positions and normals in coordinate streams (normals are zeroed if not provided)
+    */
+    void assign(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals)
+    {
+        size_t n = _positions.size();
+        bool hasNormals = (_normals.size() == n);
+        for (std::vector<float>* stream : { &px, &py, &pz, &nx, &ny, &nz })
+            stream->assign(n, 0.0f);
+        for (size_t i = 0; i < n; i++)
+        {
+            px[i] = _positions[i].x;
+            py[i] = _positions[i].y;
+            pz[i] = _positions[i].z;
+            if (hasNormals)
+            {
+                nx[i] = _normals[i].x;
+                ny[i] = _normals[i].y;
+                nz[i] = _normals[i].z;
+            }
+        }
+    }
+
+    /*!
+    * \fn computeRange
+    * \brief min and max of a float stream, with 4 independent accumulators (vectorizable, no loop-carried dependency on a single value)
+    */
+    static void computeRange(const std::vector<float>& _values, float& _min, float& _max)
+    {
+        float mins[4] = { _values[0], _values[0], _values[0], _values[0] };
+        float maxs[4] = { _values[0], _values[0], _values[0], _values[0] };
+        size_t n = _values.size(), i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                mins[k] = std::min(mins[k], _values[i + k]);
+                maxs[k] = std::max(maxs[k], _values[i + k]);
+            }
+        }
+        for (; i < n; i++)
+        {
+            mins[0] = std::min(mins[0], _values[i]);
+            maxs[0] = std::max(maxs[0], _values[i]);
+        }
+        _min = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+        _max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+    }
+
+    /*!
+    * \fn computeAABB
+    * \brief compute bounding box, one coordinate stream at a time (at least one vertex)
+    */
+    void computeAABB(glm::vec3& _min, glm::vec3& _max) const
+    {
+        computeRange(px, _min.x, _max.x);
+        computeRange(py, _min.y, _max.y);
+        computeRange(pz, _min.z, _max.z);
+    }
+
+    /*!
+    * \fn computeNormals
+    * \brief average the unnormalized face normals around each vertex, then normalize the streams
+    */
+    void computeNormals(std::span<const uint32_t> _indices)
+    {
+        std::fill(nx.begin(), nx.end(), 0.0f);
+        std::fill(ny.begin(), ny.end(), 0.0f);
+        std::fill(nz.begin(), nz.end(), 0.0f);
+        for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+        {
+            uint32_t i0 = _indices[i], i1 = _indices[i + 1], i2 = _indices[i + 2];
+            float e1x = px[i1] - px[i0], e1y = py[i1] - py[i0], e1z = pz[i1] - pz[i0];
+            float e2x = px[i2] - px[i0], e2y = py[i2] - py[i0], e2z = pz[i2] - pz[i0];
+            float cx = e1y * e2z - e1z * e2y;
+            float cy = e1z * e2x - e1x * e2z;
+            float cz = e1x * e2y - e1y * e2x;
+            nx[i0] += cx; ny[i0] += cy; nz[i0] += cz;
+            nx[i1] += cx; ny[i1] += cy; nz[i1] += cz;
+            nx[i2] += cx; ny[i2] += cy; nz[i2] += cz;
+        }
+
+        // branch-free loop over contiguous floats
+        float* x = nx.data();
+        float* y = ny.data();
+        float* z = nz.data();
+        for (size_t i = 0; i < nx.size(); i++)
+        {
+            float invLength = 1.0f / std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+            x[i] *= invLength;
+            y[i] *= invLength;
+            z[i] *= invLength;
+        }
+    }
+
+    /*!
+    * \fn getUploadViews
+    * \brief interleave the streams in _scratch (x y z nx ny nz per vertex), uploaded in one VBO
+    */
+    VertexUploadViews getUploadViews(std::vector<float>& _scratch) const
+    {
+        size_t n = px.size();
+        _scratch.resize(n * 6);
+        for (size_t i = 0; i < n; i++)
+        {
+            float* v = &_scratch[i * 6];
+            v[0] = px[i]; v[1] = py[i]; v[2] = pz[i];
+            v[3] = nx[i]; v[4] = ny[i]; v[5] = nz[i];
+        }
+        VertexUploadViews views;
+        views.nbVertices = n;
+        views.position = { _scratch.data(), _scratch.size() * sizeof(float), 6 * sizeof(float), 0 };
+        views.normal = { _scratch.data(), _scratch.size() * sizeof(float), 6 * sizeof(float), 3 * sizeof(float) };
+        return views;
+    }
+};
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                  MESH                                                       |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+/*!
+* \class LayoutMesh
+* \brief Indexed triangle mesh whose vertex storage layout is a compile-time policy
+* \tparam Layout : ArrayLayout, InterleavedLayout or SoALayout
+*/
+template<typename Layout>
+class LayoutMesh
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getLayout */
+        const Layout& getLayout() const { return m_layout; }
+        /*! \fn getIndexView */
+        std::span<const uint32_t> getIndexView() const { return m_indices; }
+        /*! \fn getNbVertices */
+        size_t getNbVertices() const { return m_layout.size(); }
+        /*! \fn getBBoxMin */
+        glm::vec3 getBBoxMin() const { return m_bBoxMin; }
+        /*! \fn getBBoxMax */
+        glm::vec3 getBBoxMax() const { return m_bBoxMax; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn assign
+        * \brief copy mesh data in this layout
+        * \param _positions : vertices positions
+        * \param _normals : vertices normals (optional)
+        * \param _indices : triangles
+        */
+        void assign(std::span<const glm::vec3> _positions, std::span<const glm::vec3> _normals, std::span<const uint32_t> _indices)
+        {
+            m_layout.assign(_positions, _normals);
+            m_indices.assign(_indices.begin(), _indices.end());
+        }
+
+        /*!
+        * \fn computeAABB
+        * \brief compute Axis Oriented Bounding Box
+        */
+        void computeAABB()
+        {
+            m_bBoxMin = m_bBoxMax = glm::vec3(0.0f);
+            if (m_layout.size() != 0)
+                m_layout.computeAABB(m_bBoxMin, m_bBoxMax);
+        }
+
+        /*!
+        * \fn computeNormals
+        * \brief recompute vertex normals from the triangles
+        */
+        void computeNormals() { m_layout.computeNormals(m_indices); }
+
+        /*!
+        * \fn getUploadViews
+        * \brief get vertex data ready for GPU upload (layouts that cannot be uploaded as is are converted in _scratch)
+        */
+        VertexUploadViews getUploadViews(std::vector<float>& _scratch) const { return m_layout.getUploadViews(_scratch); }
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        Layout m_layout;                    /*!< vertex storage */
+        std::vector<uint32_t> m_indices;    /*!< vertices indices array */
+        glm::vec3 m_bBoxMin = glm::vec3(0.0f);  /*!< min point of the bounding box */
+        glm::vec3 m_bBoxMax = glm::vec3(0.0f);  /*!< max point of the bounding box */
+};
+
+
+#endif // MESHLAYOUT_H
@@ -0,0 +1,375 @@
+/*********************************************************************************************************************
+ *
+ * meshlets.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshlets.h"
+#include "meshnormals.h"
+#include "vertexcache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+
+static const uint32_t INVALID_INDEX = UINT32_MAX;
+static const float MIN_CONE_DOT = 0.1f;     // normal cones wider than acos(0.1) (~84 deg) are not worth testing
+static const double PI = 3.14159265358979323846;
+
+
+/*
+ * Bounding sphere of points (Ritter): sphere through the most distant pair of axis extremes, grown to include
+ * the points outside
+ */
+static void computeBoundingSphere(std::span<const glm::vec3> _positions, std::span<const uint32_t> _vertices, glm::vec3& _center, float& _radius)
+{
+    uint32_t minIds[3] = { _vertices[0], _vertices[0], _vertices[0] };
+    uint32_t maxIds[3] = { _vertices[0], _vertices[0], _vertices[0] };
+    for (uint32_t v : _vertices)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            if (_positions[v][a] < _positions[minIds[a]][a])
+                minIds[a] = v;
+            if (_positions[v][a] > _positions[maxIds[a]][a])
+                maxIds[a] = v;
+        }
+    }
+
+    int axis = 0;
+    float maxDist2 = -1.0f;
+    for (int a = 0; a < 3; a++)
+    {
+        glm::vec3 d = _positions[maxIds[a]] - _positions[minIds[a]];
+        float dist2 = glm::dot(d, d);
+        if (dist2 > maxDist2)
+        {
+            maxDist2 = dist2;
+            axis = a;
+        }
+    }
+
+    _center = 0.5f * (_positions[minIds[axis]] + _positions[maxIds[axis]]);
+    _radius = 0.5f * std::sqrt(maxDist2);
+    for (uint32_t v : _vertices)
+    {
+        glm::vec3 d = _positions[v] - _center;
+        float dist = std::sqrt(glm::dot(d, d));
+        if (dist > _radius)
+        {
+            // move the center towards the point, so that the new sphere still contains the previous one
+            float newRadius = 0.5f * (_radius + dist);
+            _center += d * ((newRadius - _radius) / dist);
+            _radius = newRadius;
+        }
+    }
+}
+
+
+/*
+ * Bounding sphere and normal cone of a meshlet
+ */
+static void computeMeshletBounds(std::span<const glm::vec3> _positions, std::span<const uint32_t> _triangles, std::span<const uint32_t> _vertices, Meshlet& _meshlet)
+{
+    computeBoundingSphere(_positions, _vertices, _meshlet.center, _meshlet.radius);
+
+    // cone around the average unit normal, cutoff = sine of the widest angle to the axis
+    std::vector<glm::vec3> normals;
+    normals.reserve(_triangles.size() / 3);
+    glm::vec3 axis(0.0f);
+    for (size_t i = 0; i < _triangles.size(); i += 3)
+    {
+        const glm::vec3& p0 = _positions[_triangles[i]];
+        glm::vec3 n = glm::cross(_positions[_triangles[i + 1]] - p0, _positions[_triangles[i + 2]] - p0);
+        float length = std::sqrt(glm::dot(n, n));
+        if (length > 0.0f)
+        {
+            normals.push_back(n / length);
+            axis += normals.back();
+        }
+    }
+
+    _meshlet.coneAxis = glm::vec3(0.0f);
+    _meshlet.coneCutoff = 1.0f;
+    float axisLength = std::sqrt(glm::dot(axis, axis));
+    if (axisLength <= 0.0f)
+        return;
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals)
+        minDot = std::min(minDot, glm::dot(n, axis));
+    _meshlet.coneAxis = axis;
+    if (minDot > MIN_CONE_DOT)
+        _meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+
+bool buildMeshlets(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, unsigned _maxVertices, unsigned _maxTriangles,
+                   unsigned _nbThreads, std::vector<uint32_t>& _meshletIndices, std::vector<Meshlet>& _meshlets,
+                   const std::function<bool(float)>& _progress)
+{
+    _meshletIndices.clear();
+    _meshlets.clear();
+    size_t nbTriangles = _indices.size() / 3;
+    if (nbTriangles == 0)
+        return true;
+    _maxVertices = std::max(_maxVertices, 3u);
+    _maxTriangles = std::max(_maxTriangles, 1u);
+
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_positions.size(), _indices, _nbThreads, adjacency);
+
+    std::vector<glm::vec3> centroids(nbTriangles);
+    for (size_t t = 0; t < nbTriangles; t++)
+        centroids[t] = (_positions[_indices[3 * t]] + _positions[_indices[3 * t + 1]] + _positions[_indices[3 * t + 2]]) / 3.0f;
+
+    _meshletIndices.reserve(_indices.size());
+    std::vector<uint8_t> used(nbTriangles, 0);
+    std::vector<uint32_t> vertexMeshlet(_positions.size(), INVALID_INDEX);   // last meshlet using each vertex
+    std::vector<uint32_t> liveTriangles(_positions.size());                 // number of unused triangles around each vertex
+    for (size_t v = 0; v < _positions.size(); v++)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<uint32_t> vertices;                                         // vertices of the current cluster
+    vertices.reserve(_maxVertices);
+    std::vector<uint32_t> pendingVertices;                                  // vertices of the last meshlet
+    pendingVertices.reserve(_maxVertices);
+    Meshlet pending;                                                        // last meshlet, still open to merges
+    uint32_t clusterId = 0;
+    size_t nextUnused = 0;
+
+    // bounds of the last meshlet, once it cannot grow anymore
+    auto flushPending = [&]()
+    {
+        if (pending.nbTriangles == 0)
+            return;
+        pending.nbVertices = (uint32_t)pendingVertices.size();
+        std::span<const uint32_t> triangles = std::span<const uint32_t>(_meshletIndices).subspan(pending.firstIndex, 3 * (size_t)pending.nbTriangles);
+        computeMeshletBounds(_positions, triangles, pendingVertices, pending);
+        _meshlets.push_back(pending);
+    };
+
+    while (true)
+    {
+        if (_progress && (clusterId & 0xFF) == 0 && !_progress((float)(_meshletIndices.size() / 3) / (float)nbTriangles))
+        {
+            _meshletIndices.clear();
+            _meshlets.clear();
+            return false;
+        }
+
+        // seed: unused triangle around the previous meshlet with the fewest unused neighbours (picks up the holes
+        // left by the previous meshlet first), or the next unused triangle of the index buffer
+        size_t seed = INVALID_INDEX;
+        uint32_t seedLive = 0;
+        for (uint32_t v : vertices)
+        {
+            for (uint32_t c = adjacency.offsets[v]; c < adjacency.offsets[v + 1]; c++)
+            {
+                size_t t = adjacency.corners[c] / 3;
+                if (used[t])
+                    continue;
+                uint32_t live = liveTriangles[_indices[3 * t]] + liveTriangles[_indices[3 * t + 1]] + liveTriangles[_indices[3 * t + 2]];
+                if (seed == INVALID_INDEX || live < seedLive || (live == seedLive && t < seed))
+                {
+                    seed = t;
+                    seedLive = live;
+                }
+            }
+        }
+        if (seed == INVALID_INDEX)
+        {
+            while (nextUnused < nbTriangles && used[nextUnused])
+                nextUnused++;
+            if (nextUnused == nbTriangles)
+                break;
+            seed = nextUnused;
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = (uint32_t)_meshletIndices.size();
+        uint32_t meshletId = clusterId++;
+        vertices.clear();
+        glm::vec3 centroidSum(0.0f);
+
+        auto newVertices = [&](size_t _t)
+        {
+            unsigned n = 0;
+            for (int k = 0; k < 3; k++)
+                n += (vertexMeshlet[_indices[3 * _t + k]] != meshletId) ? 1 : 0;
+            return n;
+        };
+        auto addTriangle = [&](size_t _t)
+        {
+            used[_t] = 1;
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = _indices[3 * _t + k];
+                _meshletIndices.push_back(v);
+                liveTriangles[v]--;
+                if (vertexMeshlet[v] != meshletId)
+                {
+                    vertexMeshlet[v] = meshletId;
+                    vertices.push_back(v);
+                }
+            }
+            centroidSum += centroids[_t];
+            meshlet.nbTriangles++;
+        };
+
+        // best unused triangle around some vertices: fewest new vertices, then the last unused triangle of one of its vertices
+        // (not to leave it alone in a meshlet of its own), then closest to the meshlet centroid
+        size_t best = INVALID_INDEX;
+        unsigned bestNew = 0;
+        bool bestStranded = false;
+        float bestDist2 = 0.0f;
+        auto scanAround = [&](std::span<const uint32_t> _vertices)
+        {
+            glm::vec3 center = centroidSum / (float)meshlet.nbTriangles;
+            for (uint32_t v : _vertices)
+            {
+                for (uint32_t c = adjacency.offsets[v]; c < adjacency.offsets[v + 1]; c++)
+                {
+                    size_t t = adjacency.corners[c] / 3;
+                    if (used[t])
+                        continue;
+                    unsigned n = newVertices(t);
+                    if (vertices.size() + n > _maxVertices)
+                        continue;
+                    glm::vec3 d = centroids[t] - center;
+                    float dist2 = glm::dot(d, d);
+                    bool stranded = std::min({ liveTriangles[_indices[3 * t]], liveTriangles[_indices[3 * t + 1]], liveTriangles[_indices[3 * t + 2]] }) <= 1;
+                    if (best == INVALID_INDEX || n < bestNew || (n == bestNew && (stranded > bestStranded || (stranded == bestStranded && (dist2 < bestDist2 || (dist2 == bestDist2 && t < best))))))
+                    {
+                        best = t;
+                        bestNew = n;
+                        bestStranded = stranded;
+                        bestDist2 = dist2;
+                    }
+                }
+            }
+        };
+
+        size_t last = seed;
+        addTriangle(seed);
+        while (meshlet.nbTriangles < _maxTriangles)
+        {
+            // neighbours of the last triangle (cheap, and keeps the meshlet growing as a front), or of the whole
+            // meshlet when the front is stuck
+            best = INVALID_INDEX;
+            uint32_t lastVertices[3] = { _indices[3 * last], _indices[3 * last + 1], _indices[3 * last + 2] };
+            scanAround(lastVertices);
+            if (best == INVALID_INDEX)
+                scanAround(vertices);
+            if (best == INVALID_INDEX)
+                break;
+            addTriangle(best);
+            last = best;
+        }
+
+        // clusters closed early (holes and strips left between full meshlets) are merged with the previous meshlet
+        // when both fit in the limits: they are next to each other in the index buffer, and close in space
+        if (pending.nbTriangles + meshlet.nbTriangles <= _maxTriangles)
+        {
+            size_t nbShared = 0;
+            for (uint32_t v : vertices)
+                nbShared += (std::find(pendingVertices.begin(), pendingVertices.end(), v) != pendingVertices.end()) ? 1 : 0;
+            if (pendingVertices.size() + vertices.size() - nbShared <= _maxVertices)
+            {
+                for (uint32_t v : vertices)
+                {
+                    if (std::find(pendingVertices.begin(), pendingVertices.end(), v) == pendingVertices.end())
+                        pendingVertices.push_back(v);
+                }
+                if (pending.nbTriangles == 0)
+                    pending.firstIndex = meshlet.firstIndex;
+                pending.nbTriangles += meshlet.nbTriangles;
+                continue;
+            }
+        }
+        flushPending();
+        pending = meshlet;
+        pendingVertices = vertices;
+    }
+    flushPending();
+
+    // degenerate trailing indices (less than a triangle) are kept at the end
+    _meshletIndices.insert(_meshletIndices.end(), _indices.begin() + 3 * nbTriangles, _indices.end());
+    return true;
+}
+
+
+void optimizeMeshletVertexCache(std::span<uint32_t> _meshletIndices, std::span<const Meshlet> _meshlets, size_t _nbVertices, unsigned _cacheSize, unsigned _nbThreads)
+{
+    parallelFor(0, _meshlets.size(), _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        // Tipsify on local vertex indices, so that its per-vertex arrays have the size of a meshlet
+        std::vector<uint32_t> localIndex(_nbVertices, INVALID_INDEX);
+        std::vector<uint32_t> vertices, localIndices, reordered;
+        for (size_t m = _first; m < _last; m++)
+        {
+            std::span<uint32_t> indices = _meshletIndices.subspan(_meshlets[m].firstIndex, 3 * (size_t)_meshlets[m].nbTriangles);
+            vertices.clear();
+            localIndices.resize(indices.size());
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                uint32_t& local = localIndex[indices[i]];
+                if (local == INVALID_INDEX)
+                {
+                    local = (uint32_t)vertices.size();
+                    vertices.push_back(indices[i]);
+                }
+                localIndices[i] = local;
+            }
+
+            reordered.resize(indices.size());
+            optimizeVertexCache(localIndices, vertices.size(), _cacheSize, reordered);
+            for (size_t i = 0; i < indices.size(); i++)
+                indices[i] = vertices[reordered[i]];
+            for (uint32_t v : vertices)
+                localIndex[v] = INVALID_INDEX;
+        }
+    });
+}
+
+
+MeshletStats computeMeshletStats(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::span<const Meshlet> _meshlets)
+{
+    MeshletStats stats;
+    stats.nbMeshlets = _meshlets.size();
+    if (_meshlets.empty())
+        return stats;
+
+    double nbVertices = 0.0, nbTriangles = 0.0, radius = 0.0, compactness = 0.0;
+    size_t nbCullable = 0;
+    for (const Meshlet& meshlet : _meshlets)
+    {
+        nbVertices += meshlet.nbVertices;
+        nbTriangles += meshlet.nbTriangles;
+        radius += meshlet.radius;
+        nbCullable += (meshlet.coneCutoff < 1.0f) ? 1 : 0;
+
+        double area = 0.0;
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + 3 * meshlet.nbTriangles; i += 3)
+        {
+            const glm::vec3& p0 = _positions[_indices[i]];
+            area += 0.5 * glm::length(glm::cross(_positions[_indices[i + 1]] - p0, _positions[_indices[i + 2]] - p0));
+        }
+        double diskArea = PI * (double)meshlet.radius * (double)meshlet.radius;
+        compactness += (diskArea > 0.0) ? area / diskArea : 0.0;
+    }
+
+    double nbMeshlets = (double)_meshlets.size();
+    stats.avgVertices = (float)(nbVertices / nbMeshlets);
+    stats.avgTriangles = (float)(nbTriangles / nbMeshlets);
+    stats.verticesPerTriangle = (float)(nbVertices / nbTriangles);
+    stats.avgRadius = (float)(radius / nbMeshlets);
+    stats.compactness = (float)(compactness / nbMeshlets);
+    stats.cullableRatio = (float)((double)nbCullable / nbMeshlets);
+    return stats;
+}
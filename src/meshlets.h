@@ -0,0 +1,103 @@
+/*********************************************************************************************************************
+ *
+ * meshlets.h
+ *
+ * Partition of a triangle mesh in small clusters of triangles (meshlets), with bounds for per-cluster culling
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+#include <span>
+#include <functional>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct Meshlet
+* \brief Cluster of triangles: contiguous range of the index buffer, bounding sphere and normal cone
+* All the triangles of a meshlet face away from a camera at position c when
+* dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius
+* (coneCutoff = 1 when the normals are too spread for the cone to be useful).
+*/
+struct Meshlet
+{
+    uint32_t firstIndex = 0;                /*!< first index of the meshlet in the index buffer */
+    uint32_t nbTriangles = 0;               /*!< number of triangles */
+    uint32_t nbVertices = 0;                /*!< number of distinct vertices */
+    float radius = 0.0f;                    /*!< bounding sphere radius */
+    glm::vec3 center = glm::vec3(0.0f);     /*!< bounding sphere center */
+    float coneCutoff = 1.0f;                /*!< sine of the half-angle of the normal cone */
+    glm::vec3 coneAxis = glm::vec3(0.0f);   /*!< normal cone axis (unit) */
+};
+
+
+/*!
+* \struct MeshletStats
+* \brief Quality of a meshlet partition
+*/
+struct MeshletStats
+{
+    size_t nbMeshlets = 0;
+    float avgVertices = 0.0f;           /*!< average number of vertices per meshlet */
+    float avgTriangles = 0.0f;          /*!< average number of triangles per meshlet */
+    float verticesPerTriangle = 0.0f;   /*!< vertices transformed per triangle (0.5 for a regular grid, 3 at worst) */
+    float avgRadius = 0.0f;             /*!< average bounding sphere radius */
+    float compactness = 0.0f;           /*!< average area of the triangles over the area of the bounding sphere disk */
+    float cullableRatio = 0.0f;         /*!< ratio of meshlets with a usable normal cone (coneCutoff < 1) */
+};
+
+
+/*!
+* \fn buildMeshlets
+* \brief partition triangles in meshlets, grown greedily from a seed triangle: the next triangle is a neighbour of the
+* meshlet adding the fewest new vertices, then the closest to the meshlet centroid. A meshlet is closed when it is full
+* or has no neighbour left; the next one starts next to it (or from the first unused triangle of the index buffer), and
+* small meshlets are merged with the previous one when both fit in the limits.
+* Triangle order within a meshlet follows the growth front: vertex cache efficiency is better than an unoptimized
+* index buffer, but not as good as after TriMesh::optimizeVertexCache() (see optimizeMeshletVertexCache).
+* \param _positions : vertex coords
+* \param _indices : triangles
+* \param _maxVertices : max number of vertices per meshlet (at least 3)
+* \param _maxTriangles : max number of triangles per meshlet (at least 1)
+* \param _nbThreads : number of threads for the vertex adjacency (0 = all hardware threads)
+* \param _meshletIndices : triangles reordered meshlet by meshlet (same size as _indices)
+* \param _meshlets : resulting meshlets, ranges of _meshletIndices
+* \param _progress : called regularly with the ratio of triangles partitioned, returns false to cancel (optional)
+* \return false if cancelled (outputs are then empty)
+*/
+bool buildMeshlets(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, unsigned _maxVertices, unsigned _maxTriangles,
+                   unsigned _nbThreads, std::vector<uint32_t>& _meshletIndices, std::vector<Meshlet>& _meshlets,
+                   const std::function<bool(float)>& _progress = nullptr);
+
+/*!
+* \fn optimizeMeshletVertexCache
+* \brief reorder the triangles of each meshlet for post-transform cache locality (see ::optimizeVertexCache), in place.
+* Triangles stay in their meshlet, so that meshlet contents and bounds are unchanged.
+* \param _meshletIndices : triangles in meshlet order (see buildMeshlets)
+* \param _meshlets : meshlets, ranges of _meshletIndices
+* \param _nbVertices : number of vertices
+* \param _cacheSize : number of entries of the targeted cache
+* \param _nbThreads : number of threads (0 = all hardware threads)
+*/
+void optimizeMeshletVertexCache(std::span<uint32_t> _meshletIndices, std::span<const Meshlet> _meshlets, size_t _nbVertices, unsigned _cacheSize, unsigned _nbThreads);
+
+/*!
+* \fn computeMeshletStats
+* \brief measure the quality of a partition
+* \param _positions : vertex coords
+* \param _indices : triangles in meshlet order (see buildMeshlets)
+* \param _meshlets : meshlets
+*/
+MeshletStats computeMeshletStats(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::span<const Meshlet> _meshlets);
+
+
+#endif // MESHLETS_H
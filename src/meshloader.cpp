@@ -0,0 +1,118 @@
+/*********************************************************************************************************************
+ *
+ * meshloader.cpp
+ * 
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshloader.h"
+
+
+AsyncMeshLoader::AsyncMeshLoader()
+    : m_state(IDLE),
+      m_progress(0.0f),
+      m_cancel(false)
+{ }
+
+
+AsyncMeshLoader::~AsyncMeshLoader()
+{
+    cancel();
+    join();
+}
+
+
+void AsyncMeshLoader::start(const std::string& _filename, unsigned _nbThreads, bool _useCache, bool _optimizeVertexCache, bool _generateLODs,
+                            bool _buildMeshlets)
+{
+    cancel();
+    join();
+
+    m_filename = _filename;
+    m_mesh.reset();
+    m_progress = 0.0f;
+    m_cancel = false;
+    m_state.store(LOADING, std::memory_order_release);
+
+    m_thread = std::thread([this, _filename, _nbThreads, _useCache, _optimizeVertexCache, _generateLODs, _buildMeshlets]()
+    {
+        // share of the load taken by each stage (import, levels of detail, meshlets): the progress of the current
+        // stage is mapped to its share
+        float lodShare = _generateLODs ? 0.25f : 0.0f, meshletShare = _buildMeshlets ? 0.15f : 0.0f;
+        float importShare = 1.0f - lodShare - meshletShare;
+        float stageStart = 0.0f, stageShare = importShare;
+
+        std::unique_ptr<TriMesh> mesh = std::make_unique<TriMesh>();
+        mesh->setUseCache(_useCache);
+        mesh->setOptimizeVertexCache(_optimizeVertexCache);
+        mesh->setProgressCallback([this, &stageStart, &stageShare](float _progress)
+        {
+            m_progress.store(stageStart + _progress * stageShare, std::memory_order_relaxed);
+            return !m_cancel.load(std::memory_order_relaxed);
+        });
+
+        // move to the next stage, false if the load has been cancelled (state is then CANCELLED)
+        auto nextStage = [&](float _share)
+        {
+            if (m_cancel.load(std::memory_order_relaxed))
+            {
+                m_state.store(CANCELLED, std::memory_order_release);
+                return false;
+            }
+            stageStart += stageShare;
+            stageShare = _share;
+            m_progress.store(stageStart, std::memory_order_relaxed);
+            return true;
+        };
+
+        bool success = mesh->readFile(_filename, _nbThreads);
+        if (!nextStage(lodShare))
+            return;
+        if (!success)
+        {
+            m_state.store(FAILED, std::memory_order_release);
+            return;
+        }
+
+        mesh->computeAABB();
+        if (_generateLODs)
+            mesh->generateLODs({ 0.5f, 0.25f, 0.125f, 0.0625f }, 0.02f, _nbThreads);
+        if (!nextStage(meshletShare))
+            return;
+        if (_buildMeshlets)
+            mesh->buildMeshlets(64, 124, _nbThreads);
+        if (!nextStage(0.0f))
+            return;
+        mesh->setProgressCallback(nullptr);
+        m_progress = 1.0f;
+        m_mesh = std::move(mesh);
+        m_state.store(READY, std::memory_order_release);
+    });
+}
+
+
+void AsyncMeshLoader::cancel()
+{
+    if (getState() == LOADING)
+        m_cancel = true;
+}
+
+
+std::unique_ptr<TriMesh> AsyncMeshLoader::takeMesh()
+{
+    if (getState() != READY)
+        return nullptr;
+
+    join();
+    m_state.store(IDLE, std::memory_order_release);
+    return std::move(m_mesh);
+}
+
+
+void AsyncMeshLoader::join()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
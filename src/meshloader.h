@@ -0,0 +1,133 @@
+/*********************************************************************************************************************
+ *
+ * meshloader.h
+ *
+ * Background mesh loading
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+
+#include "trimesh.h"
+
+
+
+/*!
+* \class AsyncMeshLoader
+* \brief Import a TriMesh on a worker thread (parse, weld, normals, AABB, then levels of detail and meshlets if requested)
+* The render thread polls getState() and takes the mesh once it is ready. Progress covers all the stages, and a
+* cancellation is checked within and between them.
+*/
+class AsyncMeshLoader
+{
+    public:
+
+        /*!
+        * \enum State
+        * \brief Loading state
+        */
+        enum State
+        {
+            IDLE = 0,       /*!< no load in progress (or mesh already taken) */
+            LOADING,        /*!< worker thread is importing the mesh */
+            READY,          /*!< mesh is ready to be taken */
+            FAILED,         /*!< import failed */
+            CANCELLED       /*!< import has been cancelled */
+        };
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn AsyncMeshLoader
+        * \brief Default constructor of AsyncMeshLoader
+        */
+        AsyncMeshLoader();
+
+        /*!
+        * \fn ~AsyncMeshLoader
+        * \brief Destructor of AsyncMeshLoader (cancels the current load and waits for the worker thread)
+        */
+        ~AsyncMeshLoader();
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getState */
+        State getState() const { return (State)m_state.load(std::memory_order_acquire); }
+        /*! \fn getProgress */
+        float getProgress() const { return m_progress.load(std::memory_order_relaxed); }
+        /*! \fn getFilename */
+        const std::string& getFilename() const { return m_filename; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn start
+        * \brief start loading a mesh in background (cancels the previous load, if any)
+        * \param _filename : name of the file to read
+        * \param _nbThreads : number of threads used for parsing (1 = sequential, 0 = all hardware threads)
+        * \param _useCache : use binary mesh cache
+        * \param _optimizeVertexCache : reorder triangles and vertices for GPU vertex cache / fetch locality
+        * \param _generateLODs : generate levels of detail once the mesh is imported (see TriMesh::generateLODs)
+        * \param _buildMeshlets : partition the mesh in meshlets once the mesh is imported (see TriMesh::buildMeshlets)
+        */
+        void start(const std::string& _filename, unsigned _nbThreads = 1, bool _useCache = true, bool _optimizeVertexCache = false,
+                   bool _generateLODs = false, bool _buildMeshlets = false);
+
+        /*!
+        * \fn cancel
+        * \brief request cancellation of the current load (returns immediately)
+        */
+        void cancel();
+
+        /*!
+        * \fn takeMesh
+        * \brief get the loaded mesh, when state is READY (state goes back to IDLE)
+        * \return loaded mesh, nullptr if not ready
+        */
+        std::unique_ptr<TriMesh> takeMesh();
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        std::thread m_thread;               /*!< worker thread */
+        std::atomic<int> m_state;           /*!< current State */
+        std::atomic<float> m_progress;      /*!< import progress in [0,1] */
+        std::atomic<bool> m_cancel;         /*!< cancellation request */
+
+        std::string m_filename;             /*!< name of the file being loaded */
+        std::unique_ptr<TriMesh> m_mesh;    /*!< loaded mesh (owned by the worker until state is READY) */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn join
+        * \brief wait for the worker thread to end
+        */
+        void join();
+
+};
+#endif // MESHLOADER_H
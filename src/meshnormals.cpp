@@ -0,0 +1,180 @@
+/*********************************************************************************************************************
+ *
+ * meshnormals.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshnormals.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+/*
+ * Counting sort of the corners of vertices [_vBegin, _vEnd), listed in increasing order by _getCorner(0 .. _nbCorners-1),
+ * into _corners starting at _base. Only offsets of these vertices are written.
+ */
+template<typename GetCorner>
+static void sortCorners(std::span<const uint32_t> _indices, size_t _nbCorners, GetCorner&& _getCorner, size_t _vBegin, size_t _vEnd,
+                        uint32_t _base, uint32_t* _offsets, uint32_t* _corners)
+{
+    // Count, then inclusive scan: offsets[v] = end of the corners of v
+    for (size_t i = 0; i < _nbCorners; i++)
+        _offsets[_indices[_getCorner(i)]]++;
+    uint32_t sum = _base;
+    for (size_t v = _vBegin; v < _vEnd; v++)
+    {
+        sum += _offsets[v];
+        _offsets[v] = sum;
+    }
+
+    // Fill backwards, so that corners of a vertex stay in increasing order and offsets[v] ends on the first one
+    for (size_t i = _nbCorners; i-- > 0; )
+    {
+        uint32_t corner = _getCorner(i);
+        _corners[--_offsets[_indices[corner]]] = corner;
+    }
+}
+
+
+void buildVertexAdjacency(size_t _nbVertices, std::span<const uint32_t> _indices, unsigned _nbThreads, VertexAdjacency& _adjacency)
+{
+    size_t nbCorners = _indices.size() - _indices.size() % 3;
+    _adjacency.offsets.assign(_nbVertices + 1, 0);
+    _adjacency.corners.resize(nbCorners);
+    _adjacency.offsets[_nbVertices] = (uint32_t)nbCorners;
+    uint32_t* offsets = _adjacency.offsets.data();
+    uint32_t* corners = _adjacency.corners.data();
+
+    unsigned nbBuckets = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), std::max<size_t>(std::min(_nbVertices, nbCorners), 1));
+    if (nbBuckets == 1)
+    {
+        sortCorners(_indices, nbCorners, [](size_t _i) { return (uint32_t)_i; }, 0, _nbVertices, 0, offsets, corners);
+        return;
+    }
+
+    // Vertices are split in one contiguous range (bucket) per thread: bucket of v ~= v * N / V, in 32.32 fixed point
+    uint64_t bucketScale = ((uint64_t)nbBuckets << 32) / _nbVertices;
+    auto bucketOf = [bucketScale](uint32_t _v) { return (unsigned)(((uint64_t)_v * bucketScale) >> 32); };
+    std::vector<size_t> bucketBegins(nbBuckets + 1, _nbVertices);
+    for (unsigned b = 0; b < nbBuckets; b++)
+    {
+        // first vertex of bucket b (binary search, bucketOf is monotonic)
+        size_t low = 0, high = _nbVertices;
+        while (low < high)
+        {
+            size_t middle = (low + high) / 2;
+            if (bucketOf((uint32_t)middle) < b)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        bucketBegins[b] = low;
+    }
+
+    // Partition corners by bucket, keeping their order (stable, so no atomics nor sort are needed):
+    // count corners of each (block of corners, bucket), then each block writes its corners at its own cursor
+    std::vector<size_t> cursors(nbBuckets * nbBuckets, 0);     // [block * nbBuckets + bucket]
+    parallelFor(0, nbCorners, nbBuckets, [&](size_t _first, size_t _last, unsigned _block)
+    {
+        size_t* counts = cursors.data() + _block * nbBuckets;
+        for (size_t c = _first; c < _last; c++)
+            counts[bucketOf(_indices[c])]++;
+    });
+
+    std::vector<size_t> bucketStarts(nbBuckets + 1, 0);
+    size_t position = 0;
+    for (unsigned b = 0; b < nbBuckets; b++)
+    {
+        bucketStarts[b] = position;
+        for (unsigned block = 0; block < nbBuckets; block++)
+        {
+            size_t count = cursors[block * nbBuckets + b];
+            cursors[block * nbBuckets + b] = position;
+            position += count;
+        }
+    }
+    bucketStarts[nbBuckets] = position;
+
+    std::vector<uint32_t> partition(nbCorners);
+    parallelFor(0, nbCorners, nbBuckets, [&](size_t _first, size_t _last, unsigned _block)
+    {
+        size_t* blockCursors = cursors.data() + _block * nbBuckets;
+        for (size_t c = _first; c < _last; c++)
+            partition[blockCursors[bucketOf(_indices[c])]++] = (uint32_t)c;
+    });
+
+    // Each thread sorts the corners of its own vertices
+    parallelFor(0, nbBuckets, nbBuckets, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t b = _first; b < _last; b++)
+        {
+            const uint32_t* bucket = partition.data() + bucketStarts[b];
+            sortCorners(_indices, bucketStarts[b + 1] - bucketStarts[b], [bucket](size_t _i) { return bucket[_i]; },
+                        bucketBegins[b], bucketBegins[b + 1], (uint32_t)bucketStarts[b], offsets, corners);
+        }
+    });
+}
+
+
+void computeVertexNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, const VertexAdjacency& _adjacency,
+                          NormalWeighting _weighting, unsigned _nbThreads, std::span<glm::vec3> _normals)
+{
+    // Unnormalized face normals (same operations as the sequential scatter)
+    std::vector<glm::vec3> faceNormals(_indices.size() / 3);
+    parallelFor(0, faceNormals.size(), _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t t = _first; t < _last; t++)
+        {
+            uint32_t i0 = _indices[3 * t], i1 = _indices[3 * t + 1], i2 = _indices[3 * t + 2];
+            faceNormals[t] = glm::cross(_positions[i1] - _positions[i0], _positions[i2] - _positions[i0]);
+        }
+    });
+
+    // Gather around each vertex, in increasing corner order
+    const uint32_t* offsets = _adjacency.offsets.data();
+    const uint32_t* corners = _adjacency.corners.data();
+    parallelFor(0, _normals.size(), _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t v = _first; v < _last; v++)
+        {
+            glm::vec3 normal(0.0f);
+            if (_weighting == NormalWeighting::AREA)
+            {
+                for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+                    normal += faceNormals[corners[i] / 3];
+            }
+            else
+            {
+                for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+                {
+                    uint32_t corner = corners[i];
+                    uint32_t t = corner / 3, k = corner % 3;
+                    float length = glm::length(faceNormals[t]);
+                    if (length == 0.0f)
+                        continue;
+
+                    // angle between the two edges leaving the vertex: atan2(|e1 x e2|, e1 . e2)
+                    glm::vec3 p = _positions[_indices[3 * t + k]];
+                    glm::vec3 e1 = _positions[_indices[3 * t + (k + 1) % 3]] - p;
+                    glm::vec3 e2 = _positions[_indices[3 * t + (k + 2) % 3]] - p;
+                    normal += faceNormals[t] * (std::atan2(length, glm::dot(e1, e2)) / length);
+                }
+            }
+            _normals[v] = glm::normalize(normal);
+        }
+    });
+}
+
+
+void computeVertexNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices,
+                          NormalWeighting _weighting, unsigned _nbThreads, std::span<glm::vec3> _normals)
+{
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_positions.size(), _indices, _nbThreads, adjacency);
+    computeVertexNormals(_positions, _indices, adjacency, _weighting, _nbThreads, _normals);
+}
@@ -0,0 +1,80 @@
+/*********************************************************************************************************************
+ *
+ * meshnormals.h
+ *
+ * Multi-threaded vertex normals, gathered from a vertex-to-triangle adjacency
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHNORMALS_H
+#define MESHNORMALS_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \enum NormalWeighting
+* \brief Weight of each triangle in the normal of its vertices
+*/
+enum class NormalWeighting
+{
+    AREA = 0,   /*!< unnormalized face normal (proportional to the triangle area) */
+    ANGLE       /*!< unit face normal times the triangle angle at the vertex */
+};
+
+
+/*!
+* \struct VertexAdjacency
+* \brief Triangle corners around each vertex, in compressed sparse row format
+* Corners of vertex v are corners[offsets[v]] ... corners[offsets[v+1] - 1], sorted in increasing order.
+* A corner c is the c-th entry of the index buffer: triangle c / 3, position c % 3 in the triangle.
+*/
+struct VertexAdjacency
+{
+    std::vector<uint32_t> offsets;  /*!< first corner of each vertex (nbVertices + 1 entries) */
+    std::vector<uint32_t> corners;  /*!< corners, grouped by vertex */
+};
+
+
+/*!
+* \fn buildVertexAdjacency
+* \brief build the vertex-to-corner adjacency of a triangle mesh (result does not depend on the number of threads)
+* \param _nbVertices : number of vertices
+* \param _indices : triangles (valid indices, less than 2^32 / 3 triangles)
+* \param _nbThreads : number of threads (0 = all hardware threads)
+* \param _adjacency : resulting adjacency
+*/
+void buildVertexAdjacency(size_t _nbVertices, std::span<const uint32_t> _indices, unsigned _nbThreads, VertexAdjacency& _adjacency);
+
+/*!
+* \fn computeVertexNormals
+* \brief compute vertex normals by gathering the weighted face normals around each vertex
+* Face normals are summed in increasing triangle order, so results are deterministic whatever the number of threads,
+* and AREA weighting is bit-identical to the sequential scatter (ArrayLayout::computeNormals).
+* \param _positions : vertices positions
+* \param _indices : triangles
+* \param _adjacency : adjacency built from _indices
+* \param _weighting : weight of each triangle
+* \param _nbThreads : number of threads (0 = all hardware threads)
+* \param _normals : vertices normals (same size as _positions)
+*/
+void computeVertexNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, const VertexAdjacency& _adjacency,
+                          NormalWeighting _weighting, unsigned _nbThreads, std::span<glm::vec3> _normals);
+
+/*!
+* \fn computeVertexNormals
+* \brief build the adjacency, then compute vertex normals (see above)
+*/
+void computeVertexNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices,
+                          NormalWeighting _weighting, unsigned _nbThreads, std::span<glm::vec3> _normals);
+
+
+#endif // MESHNORMALS_H
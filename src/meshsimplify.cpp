@@ -0,0 +1,558 @@
+/*********************************************************************************************************************
+ *
+ * meshsimplify.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "meshsimplify.h"
+#include "meshnormals.h"
+#include "spatialsort.h"
+#include "flathashmap.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <numeric>
+#include <bit>
+#include <cmath>
+#include <cfloat>
+
+
+static const uint32_t INVALID_INDEX = UINT32_MAX;
+static const uint32_t SHARED_VERTEX = UINT32_MAX - 1;  // owner of vertices referenced by several partitions
+static const uint8_t COMPLEX_VERTEX = 0xff;            // boundary count of vertices on non-manifold edges
+static const double BORDER_WEIGHT = 10.0;              // weight of the planes holding boundary edges in place
+static const double MIN_NORMAL_COSINE = 0.25;          // max rotation of the triangles around a collapsed vertex
+
+
+/*
+ * Sum of weighted squared distances to planes, as a symmetric 4x4 matrix: Q(p) = p.A.p + 2 b.p + c
+ */
+struct Quadric
+{
+    double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    void addPlane(const glm::dvec3& _n, double _d, double _weight)
+    {
+        a00 += _weight * _n.x * _n.x;
+        a11 += _weight * _n.y * _n.y;
+        a22 += _weight * _n.z * _n.z;
+        a01 += _weight * _n.x * _n.y;
+        a02 += _weight * _n.x * _n.z;
+        a12 += _weight * _n.y * _n.z;
+        b0 += _weight * _n.x * _d;
+        b1 += _weight * _n.y * _d;
+        b2 += _weight * _n.z * _d;
+        c += _weight * _d * _d;
+        weight += _weight;
+    }
+
+    void add(const Quadric& _q)
+    {
+        a00 += _q.a00; a11 += _q.a11; a22 += _q.a22;
+        a01 += _q.a01; a02 += _q.a02; a12 += _q.a12;
+        b0 += _q.b0; b1 += _q.b1; b2 += _q.b2;
+        c += _q.c;
+        weight += _q.weight;
+    }
+
+    double evaluate(const glm::dvec3& _p) const
+    {
+        double r = a00 * _p.x * _p.x + a11 * _p.y * _p.y + a22 * _p.z * _p.z
+                 + 2.0 * (a01 * _p.x * _p.y + a02 * _p.x * _p.z + a12 * _p.y * _p.z)
+                 + 2.0 * (b0 * _p.x + b1 * _p.y + b2 * _p.z) + c;
+        return std::max(r, 0.0);
+    }
+};
+
+
+/*
+ * Edge collapse candidate: vertex src is replaced by vertex dst in all its triangles
+ */
+struct Collapse
+{
+    double cost;        // squared error
+    uint32_t src;
+    uint32_t dst;
+
+    bool operator<(const Collapse& _other) const
+    {
+        if (cost != _other.cost)
+            return cost < _other.cost;
+        return (src != _other.src) ? src < _other.src : dst < _other.dst;
+    }
+};
+
+
+/*
+ * Triangles simplified together, with local vertex indices
+ */
+struct SimplifyPatch
+{
+    std::vector<uint32_t> vertices;     // global index of each local vertex
+    std::vector<glm::vec3> positions;   // coords of each local vertex
+    std::vector<uint32_t> groups;       // first local vertex with the same position, per local vertex
+    std::vector<uint8_t> locked;        // per group: vertices that can not be removed
+    std::vector<uint32_t> indices;      // triangles
+};
+
+
+static uint32_t nextCorner(uint32_t _c) { return (_c % 3 == 2) ? _c - 2 : _c + 1; }
+static uint32_t prevCorner(uint32_t _c) { return (_c % 3 == 0) ? _c + 2 : _c - 1; }
+
+
+/*
+ * Gather triangles with local vertex indices.
+ * Scratch arrays have one entry per vertex of the mesh, set to INVALID_INDEX (they are reset on exit).
+ */
+static void buildPatch(std::span<const glm::vec3> _positions, std::span<const uint32_t> _positionRemap, std::span<const uint8_t> _seams,
+                       std::span<const uint32_t> _owners, std::span<const uint32_t> _indices, std::span<const uint32_t> _triangles,
+                       std::vector<uint32_t>& _localVertices, std::vector<uint32_t>& _localGroups, SimplifyPatch& _patch)
+{
+    _patch.vertices.clear();
+    _patch.indices.resize(_triangles.size() * 3);
+    for (size_t i = 0; i < _triangles.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = _indices[3 * (size_t)_triangles[i] + k];
+            if (_localVertices[v] == INVALID_INDEX)
+            {
+                _localVertices[v] = (uint32_t)_patch.vertices.size();
+                _patch.vertices.push_back(v);
+            }
+            _patch.indices[3 * i + k] = _localVertices[v];
+        }
+    }
+
+    size_t nbVertices = _patch.vertices.size();
+    _patch.positions.resize(nbVertices);
+    _patch.groups.resize(nbVertices);
+    _patch.locked.assign(nbVertices, 0);
+    for (size_t l = 0; l < nbVertices; l++)
+    {
+        uint32_t v = _patch.vertices[l];
+        uint32_t& group = _localGroups[_positionRemap[v]];
+        if (group == INVALID_INDEX)
+            group = (uint32_t)l;
+        _patch.groups[l] = group;
+        _patch.positions[l] = _positions[v];
+    }
+    for (size_t l = 0; l < nbVertices; l++)
+    {
+        uint32_t v = _patch.vertices[l];
+        if (_seams[v] || (!_owners.empty() && _owners[v] == SHARED_VERTEX))
+            _patch.locked[_patch.groups[l]] = 1;
+        _localVertices[v] = INVALID_INDEX;
+        _localGroups[_positionRemap[v]] = INVALID_INDEX;
+    }
+}
+
+
+/*
+ * Simplify the triangles of a patch (in place), by passes of independent collapses in increasing cost order.
+ * Topology is that of position groups, so that the wedges of a seam vertex are seen as a single vertex.
+ * Returns the max error of the collapses (RMS distance to the planes of the merged triangles).
+ */
+static double simplifyPatch(SimplifyPatch& _patch, size_t _targetNbIndices, double _maxError)
+{
+    std::vector<uint32_t>& indices = _patch.indices;
+    const std::vector<uint32_t>& groups = _patch.groups;
+    const std::vector<uint8_t>& locked = _patch.locked;
+    const size_t nbVertices = _patch.vertices.size();
+    if (indices.size() <= _targetNbIndices)
+        return 0.0;
+
+    auto position = [&](uint32_t _v) { return glm::dvec3(_patch.positions[_v]); };
+    auto triangleNormal = [&](uint32_t _t)
+    {
+        glm::dvec3 p0 = position(indices[3 * _t]);
+        return glm::cross(position(indices[3 * _t + 1]) - p0, position(indices[3 * _t + 2]) - p0);
+    };
+
+    // Quadric of each position group: planes of its triangles, weighted by their area
+    std::vector<Quadric> quadrics(nbVertices);
+    for (uint32_t t = 0; t < indices.size() / 3; t++)
+    {
+        glm::dvec3 n = triangleNormal(t);
+        double length = glm::length(n);
+        if (length == 0.0)
+            continue;
+        n /= length;
+        double d = -glm::dot(n, position(indices[3 * t]));
+        for (int k = 0; k < 3; k++)
+            quadrics[groups[indices[3 * t + k]]].addPlane(n, d, 0.5 * length);
+    }
+
+    std::vector<uint32_t> groupIndices;
+    std::vector<uint64_t> edgeKeys;
+    std::vector<uint32_t> edgeCorners;
+    std::vector<uint8_t> borderCounts(nbVertices);
+    std::vector<Collapse> collapses;
+    VertexAdjacency adjacency;
+    std::vector<uint32_t> remap(nbVertices);
+    std::vector<uint8_t> touched(nbVertices);
+    std::vector<uint32_t> marks(nbVertices, 0);
+    uint32_t mark = 0;
+
+    const double maxCost = _maxError * _maxError;
+    double maxCollapseCost = 0.0;
+
+    for (int pass = 0; indices.size() > _targetNbIndices; pass++)
+    {
+        const size_t nbIndices = indices.size();
+        groupIndices.resize(nbIndices);
+        for (size_t c = 0; c < nbIndices; c++)
+            groupIndices[c] = groups[indices[c]];
+
+        // Undirected edges, sorted so that the corners of each edge are contiguous
+        edgeKeys.resize(nbIndices);
+        edgeCorners.resize(nbIndices);
+        for (uint32_t c = 0; c < nbIndices; c++)
+        {
+            uint64_t a = groupIndices[c], b = groupIndices[nextCorner(c)];
+            edgeKeys[c] = (std::min(a, b) << 32) | std::max(a, b);
+            edgeCorners[c] = c;
+        }
+        radixSort(edgeKeys, edgeCorners, 1);
+
+        // Boundary edges (single triangle) and non-manifold edges (more than 2 triangles)
+        std::fill(borderCounts.begin(), borderCounts.end(), 0);
+        for (size_t i = 0, j = 0; i < nbIndices; i = j)
+        {
+            for (j = i + 1; j < nbIndices && edgeKeys[j] == edgeKeys[i]; j++) {}
+            uint32_t a = (uint32_t)(edgeKeys[i] >> 32), b = (uint32_t)edgeKeys[i];
+            if (j - i > 2)
+            {
+                borderCounts[a] = COMPLEX_VERTEX;
+                borderCounts[b] = COMPLEX_VERTEX;
+            }
+            else if (j - i == 1)
+            {
+                for (uint32_t g : { a, b })
+                {
+                    if (borderCounts[g] != COMPLEX_VERTEX)
+                        borderCounts[g] = (uint8_t)std::min(borderCounts[g] + 1, 3);
+                }
+
+                // keep boundaries in place with a plane through the edge, orthogonal to the triangle
+                if (pass == 0)
+                {
+                    uint32_t c = edgeCorners[i];
+                    glm::dvec3 p0 = position(indices[c]);
+                    glm::dvec3 edge = position(indices[nextCorner(c)]) - p0;
+                    glm::dvec3 n = glm::cross(edge, triangleNormal(c / 3));
+                    double length = glm::length(n);
+                    if (length == 0.0)
+                        continue;
+                    n /= length;
+                    double d = -glm::dot(n, p0);
+                    quadrics[a].addPlane(n, d, BORDER_WEIGHT * glm::dot(edge, edge));
+                    quadrics[b].addPlane(n, d, BORDER_WEIGHT * glm::dot(edge, edge));
+                }
+            }
+        }
+
+        // Cheapest direction of each edge: interior vertices collapse on any neighbour, boundary ones along the boundary
+        auto canCollapse = [&](uint32_t _group, bool _boundaryEdge)
+        {
+            return !locked[_group] && (borderCounts[_group] == 0 || (borderCounts[_group] == 2 && _boundaryEdge));
+        };
+        collapses.clear();
+        for (size_t i = 0, j = 0; i < nbIndices; i = j)
+        {
+            for (j = i + 1; j < nbIndices && edgeKeys[j] == edgeKeys[i]; j++) {}
+            uint32_t c = edgeCorners[i];
+            uint32_t u = indices[c], w = indices[nextCorner(c)];
+            bool boundaryEdge = (j - i == 1);
+            bool collapseU = canCollapse(groups[u], boundaryEdge);
+            bool collapseW = canCollapse(groups[w], boundaryEdge);
+            if (!collapseU && !collapseW)
+                continue;
+
+            Quadric q = quadrics[groups[u]];
+            q.add(quadrics[groups[w]]);
+            double weight = std::max(q.weight, 1e-30);
+            double costU = collapseU ? q.evaluate(position(w)) / weight : DBL_MAX;
+            double costW = collapseW ? q.evaluate(position(u)) / weight : DBL_MAX;
+            if (costU <= costW)
+                collapses.push_back({ costU, u, w });
+            else
+                collapses.push_back({ costW, w, u });
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        // Triangles around each position group
+        buildVertexAdjacency(nbVertices, groupIndices, 1, adjacency);
+        const uint32_t* offsets = adjacency.offsets.data();
+        const uint32_t* corners = adjacency.corners.data();
+
+        // Collapse, skipping the vertices whose neighbourhood has already changed in this pass
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), 0);
+        const size_t nbTrianglesToRemove = (nbIndices - _targetNbIndices + 2) / 3;
+        size_t nbRemoved = 0, nbCollapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.cost > maxCost || nbRemoved >= nbTrianglesToRemove)
+                break;
+            uint32_t src = collapse.src, dst = collapse.dst;
+            uint32_t srcGroup = groups[src], dstGroup = groups[dst];
+            if (touched[srcGroup] || touched[dstGroup])
+                continue;
+
+            // Triangles around src: removed ones must all use the same wedge of dst, others must not flip
+            glm::dvec3 srcPos = position(src), dstPos = position(dst);
+            mark += 2;
+            uint32_t nbShared = 0;
+            bool valid = true;
+            for (uint32_t i = offsets[srcGroup]; i < offsets[srcGroup + 1] && valid; i++)
+            {
+                uint32_t c1 = nextCorner(corners[i]), c2 = prevCorner(corners[i]);
+                uint32_t g1 = groupIndices[c1], g2 = groupIndices[c2];
+                marks[g1] = mark;
+                marks[g2] = mark;
+                if (g1 == dstGroup || g2 == dstGroup)
+                {
+                    valid = (g1 != dstGroup || indices[c1] == dst) && (g2 != dstGroup || indices[c2] == dst);
+                    nbShared++;
+                    continue;
+                }
+                glm::dvec3 p1 = position(indices[c1]), p2 = position(indices[c2]);
+                glm::dvec3 oldNormal = glm::cross(p1 - srcPos, p2 - srcPos);
+                glm::dvec3 newNormal = glm::cross(p1 - dstPos, p2 - dstPos);
+                double oldLength = glm::length(oldNormal);
+                if (oldLength > 0.0 && glm::dot(oldNormal, newNormal) <= MIN_NORMAL_COSINE * oldLength * glm::length(newNormal))
+                    valid = false;
+            }
+
+            // Link condition: the only neighbours shared by src and dst are the opposite vertices of the removed triangles
+            uint32_t nbCommon = 0;
+            for (uint32_t i = offsets[dstGroup]; i < offsets[dstGroup + 1] && valid; i++)
+            {
+                for (uint32_t c : { nextCorner(corners[i]), prevCorner(corners[i]) })
+                {
+                    uint32_t g = groupIndices[c];
+                    if (g != srcGroup && marks[g] == mark)
+                    {
+                        marks[g] = mark + 1;
+                        nbCommon++;
+                    }
+                }
+            }
+            if (!valid || nbCommon > nbShared)
+                continue;
+
+            remap[src] = dst;
+            quadrics[dstGroup].add(quadrics[srcGroup]);
+            touched[srcGroup] = 1;
+            touched[dstGroup] = 1;
+            for (uint32_t i = offsets[srcGroup]; i < offsets[srcGroup + 1]; i++)
+            {
+                touched[groupIndices[nextCorner(corners[i])]] = 1;
+                touched[groupIndices[prevCorner(corners[i])]] = 1;
+            }
+            nbRemoved += nbShared;
+            nbCollapsed++;
+            maxCollapseCost = std::max(maxCollapseCost, collapse.cost);
+        }
+        if (nbCollapsed == 0)
+            break;
+
+        // Apply collapses and remove degenerate triangles
+        size_t nbKept = 0;
+        for (size_t i = 0; i < nbIndices; i += 3)
+        {
+            uint32_t v0 = remap[indices[i]], v1 = remap[indices[i + 1]], v2 = remap[indices[i + 2]];
+            if (groups[v0] == groups[v1] || groups[v1] == groups[v2] || groups[v2] == groups[v0])
+                continue;
+            indices[nbKept++] = v0;
+            indices[nbKept++] = v1;
+            indices[nbKept++] = v2;
+        }
+        indices.resize(nbKept);
+    }
+
+    return std::sqrt(maxCollapseCost);
+}
+
+
+void MeshSimplifier::setVertices(std::span<const glm::vec3> _positions, unsigned _nbThreads)
+{
+    m_positions = _positions;
+    m_nbThreads = getNbThreads(_nbThreads);
+    const size_t nbVertices = _positions.size();
+
+    m_bBoxMin = glm::vec3(0.0f);
+    m_bBoxMax = glm::vec3(0.0f);
+    if (nbVertices > 0)
+    {
+        m_bBoxMin = _positions[0];
+        m_bBoxMax = _positions[0];
+        for (const glm::vec3& p : _positions)
+        {
+            m_bBoxMin = glm::min(m_bBoxMin, p);
+            m_bBoxMax = glm::max(m_bBoxMax, p);
+        }
+    }
+    m_extent = glm::length(m_bBoxMax - m_bBoxMin);
+
+    // Vertices with bitwise identical coords (-0 and +0 merged)
+    FlatHashMap<glm::uvec3, UVec3Hash> firstVertices(nbVertices);
+    m_positionRemap.resize(nbVertices);
+    m_seams.assign(nbVertices, 0);
+    for (uint32_t v = 0; v < nbVertices; v++)
+    {
+        glm::vec3 p = _positions[v] + glm::vec3(0.0f);
+        glm::uvec3 key(std::bit_cast<uint32_t>(p.x), std::bit_cast<uint32_t>(p.y), std::bit_cast<uint32_t>(p.z));
+        auto [first, inserted] = firstVertices.findOrInsert(key, v);
+        m_positionRemap[v] = first;
+        if (!inserted)
+        {
+            m_seams[v] = 1;
+            m_seams[first] = 1;
+        }
+    }
+}
+
+
+float MeshSimplifier::simplify(std::span<const uint32_t> _indices, size_t _targetNbIndices, float _maxError, std::vector<uint32_t>& _result) const
+{
+    const size_t nbVertices = m_positions.size();
+    _result.assign(_indices.begin(), _indices.begin() + (_indices.size() - _indices.size() % 3));
+    _targetNbIndices -= _targetNbIndices % 3;
+    if (_result.size() <= _targetNbIndices)
+        return 0.0f;
+
+    const double maxError = (double)_maxError * (double)m_extent;
+    double error = 0.0;
+
+    // Spatial partitions simplified in parallel, then the same with partitions shifted by half their size
+    for (int round = 0; round < 2 && _result.size() > _targetNbIndices; round++)
+    {
+        const size_t nbTriangles = _result.size() / 3;
+        const size_t nbPartitions = nbTriangles / PARTITION_SIZE;
+        if (nbPartitions < 2)
+            break;
+
+        // Triangles in Morton order of their centroid
+        std::vector<glm::vec3> centroids(nbTriangles);
+        parallelFor(0, nbTriangles, m_nbThreads, [&](size_t _first, size_t _last, unsigned)
+        {
+            for (size_t t = _first; t < _last; t++)
+                centroids[t] = (m_positions[_result[3 * t]] + m_positions[_result[3 * t + 1]] + m_positions[_result[3 * t + 2]]) / 3.0f;
+        });
+        std::vector<uint32_t> codes(nbTriangles), order(nbTriangles);
+        computeMortonCodes<uint32_t>(centroids, m_bBoxMin, m_bBoxMax, m_nbThreads, codes);
+        std::iota(order.begin(), order.end(), 0);
+        radixSort(codes, order, m_nbThreads);
+
+        std::vector<size_t> bounds(1, 0);
+        for (size_t p = (round == 0) ? 1 : 0; p < nbPartitions; p++)
+            bounds.push_back((round == 0) ? nbTriangles * p / nbPartitions : nbTriangles * (2 * p + 1) / (2 * nbPartitions));
+        bounds.push_back(nbTriangles);
+        const size_t nbPatches = bounds.size() - 1;
+
+        // Lock the vertices of triangles in different partitions
+        std::vector<uint32_t> owners(nbVertices, INVALID_INDEX);
+        for (uint32_t p = 0; p < nbPatches; p++)
+        {
+            for (size_t i = bounds[p]; i < bounds[p + 1]; i++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t& owner = owners[_result[3 * (size_t)order[i] + k]];
+                    owner = (owner == INVALID_INDEX || owner == p) ? p : SHARED_VERTEX;
+                }
+            }
+        }
+
+        // Each partition is simplified to the same ratio
+        const double ratio = (double)_targetNbIndices / (double)_result.size();
+        std::vector<std::vector<uint32_t>> patchIndices(nbPatches);
+        std::vector<double> patchErrors(nbPatches, 0.0);
+        parallelFor(0, nbPatches, m_nbThreads, [&](size_t _first, size_t _last, unsigned)
+        {
+            std::vector<uint32_t> localVertices(nbVertices, INVALID_INDEX), localGroups(nbVertices, INVALID_INDEX);
+            SimplifyPatch patch;
+            for (size_t p = _first; p < _last; p++)
+            {
+                std::span<const uint32_t> triangles(order.data() + bounds[p], bounds[p + 1] - bounds[p]);
+                buildPatch(m_positions, m_positionRemap, m_seams, owners, _result, triangles, localVertices, localGroups, patch);
+                size_t target = (size_t)(ratio * (double)(patch.indices.size() / 3)) * 3;
+                patchErrors[p] = simplifyPatch(patch, target, maxError);
+
+                patchIndices[p].resize(patch.indices.size());
+                for (size_t i = 0; i < patch.indices.size(); i++)
+                    patchIndices[p][i] = patch.vertices[patch.indices[i]];
+            }
+        });
+
+        _result.clear();
+        for (size_t p = 0; p < nbPatches; p++)
+        {
+            _result.insert(_result.end(), patchIndices[p].begin(), patchIndices[p].end());
+            error = std::max(error, patchErrors[p]);
+        }
+    }
+
+    // Whole mesh, to release the vertices locked on partition boundaries
+    if (_result.size() > _targetNbIndices)
+    {
+        std::vector<uint32_t> localVertices(nbVertices, INVALID_INDEX), localGroups(nbVertices, INVALID_INDEX);
+        std::vector<uint32_t> triangles(_result.size() / 3);
+        std::iota(triangles.begin(), triangles.end(), 0);
+        SimplifyPatch patch;
+        buildPatch(m_positions, m_positionRemap, m_seams, {}, _result, triangles, localVertices, localGroups, patch);
+        error = std::max(error, simplifyPatch(patch, _targetNbIndices, maxError));
+
+        _result.resize(patch.indices.size());
+        for (size_t i = 0; i < patch.indices.size(); i++)
+            _result[i] = patch.vertices[patch.indices[i]];
+    }
+
+    return (float)error;
+}
+
+
+bool MeshSimplifier::generateLODs(std::span<const uint32_t> _indices, std::span<const float> _ratios, float _maxError, std::vector<MeshLOD>& _lods,
+                                  const std::function<bool(float)>& _progress) const
+{
+    _lods.clear();
+    _lods.reserve(_ratios.size());      // previous levels are read through spans
+    const size_t nbTriangles = _indices.size() / 3;
+
+    std::span<const uint32_t> previous = _indices.first(nbTriangles * 3);
+    float error = 0.0f;
+    for (size_t level = 0; level < _ratios.size(); level++)
+    {
+        if (_progress && !_progress((float)level / (float)_ratios.size()))
+        {
+            _lods.clear();
+            return false;
+        }
+
+        size_t target = (size_t)((double)_ratios[level] * (double)nbTriangles) * 3;
+        if (target >= previous.size())
+            continue;
+
+        MeshLOD lod;
+        float stepError = simplify(previous, target, _maxError, lod.indices);
+
+        // stop when the max error prevents any significant reduction
+        if (lod.indices.size() * 10 > previous.size() * 9)
+            break;
+
+        // errors of successive steps add up (estimate of the distance to the full-detail mesh, see LOD_ERROR_MARGIN)
+        error += stepError;
+        lod.error = error;
+        _lods.push_back(std::move(lod));
+        previous = _lods.back().indices;
+    }
+    return true;
+}
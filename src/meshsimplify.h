@@ -0,0 +1,126 @@
+/*********************************************************************************************************************
+ *
+ * meshsimplify.h
+ *
+ * Quadric error metric simplification and level of detail chains, over a shared vertex buffer
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHSIMPLIFY_H
+#define MESHSIMPLIFY_H
+
+#include <vector>
+#include <span>
+#include <functional>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct MeshLOD
+* \brief One level of detail: triangles indexing the vertices of the full-detail mesh
+*/
+struct MeshLOD
+{
+    std::vector<uint32_t> indices;  /*!< triangles */
+    float error = 0.0f;             /*!< estimated geometric error relative to the full-detail mesh (in mesh units), not a
+                                         bound: see LOD_ERROR_MARGIN */
+};
+
+
+/*!
+* \brief Factor applied to MeshLOD::error where a bound of the distance to the full-detail mesh is needed (level of
+* detail selection, occluder depth offset). The error of a collapse is sqrt(Q / weight), the area-weighted RMS distance
+* of the kept vertex to the planes of the merged triangles, summed over the simplification steps: the max distance can
+* exceed it (x1.09 measured on the teapot model for the first level).
+*/
+static const float LOD_ERROR_MARGIN = 2.0f;
+
+
+/*!
+* \class MeshSimplifier
+* \brief Edge-collapse simplification driven by quadric error metrics (Garland & Heckbert)
+* Vertices are collapsed onto one of their neighbours instead of an optimal position, so that simplified index
+* buffers keep indexing the original vertex buffer (no new vertex, no re-upload).
+* Vertices sharing the same position (attribute seams split by the OBJ importer) are never removed, and boundary
+* vertices only collapse along the boundary. Large meshes are split in spatial partitions (Morton order of triangle
+* centroids) simplified in parallel, with the vertices shared by several partitions locked; partitions are then
+* shifted to release these vertices, before a last pass on the whole mesh.
+* Result does not depend on the number of threads.
+*/
+class MeshSimplifier
+{
+    public:
+
+        static constexpr size_t PARTITION_SIZE = 32768;    /*!< number of triangles per partition */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getExtent \brief diagonal of the bounding box of the vertices */
+        float getExtent() const { return m_extent; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn setVertices
+        * \brief set the vertex buffer of the meshes to simplify, and find vertices sharing the same position
+        * \param _positions : vertex coords (not copied: must stay alive and unchanged while simplifying)
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        */
+        void setVertices(std::span<const glm::vec3> _positions, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn simplify
+        * \brief collapse edges by increasing quadric error, until the target number of indices is reached or the
+        * next collapse would exceed the max error
+        * \param _indices : triangles to simplify
+        * \param _targetNbIndices : target number of indices
+        * \param _maxError : max quadric error of a collapse, relative to the bounding box diagonal
+        * \param _result : resulting triangles (same vertex buffer)
+        * \return max quadric error of the collapses (RMS distance to the planes of the merged triangles, in mesh units)
+        */
+        float simplify(std::span<const uint32_t> _indices, size_t _targetNbIndices, float _maxError, std::vector<uint32_t>& _result) const;
+
+        /*!
+        * \fn generateLODs
+        * \brief generate a chain of levels of detail, each one simplified from the previous one.
+        * The chain stops early when a level cannot be reduced significantly within the max error.
+        * \param _indices : full-detail triangles (level 0, not included in the result)
+        * \param _ratios : target number of triangles of each level, relative to the full-detail mesh (decreasing)
+        * \param _maxError : max quadric error of each simplification step, relative to the bounding box diagonal
+        * \param _lods : resulting levels of detail
+        * \param _progress : called before each level with the progress in [0,1], returns false to cancel (optional)
+        * \return false if cancelled (_lods is then empty)
+        */
+        bool generateLODs(std::span<const uint32_t> _indices, std::span<const float> _ratios, float _maxError, std::vector<MeshLOD>& _lods,
+                          const std::function<bool(float)>& _progress = nullptr) const;
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        std::span<const glm::vec3> m_positions;     /*!< vertex coords (not owned) */
+        std::vector<uint32_t> m_positionRemap;      /*!< first vertex with the same position, per vertex */
+        std::vector<uint8_t> m_seams;               /*!< flag of vertices sharing their position with another one */
+        glm::vec3 m_bBoxMin = glm::vec3(0.0f);      /*!< min corner of the bounding box of the vertices */
+        glm::vec3 m_bBoxMax = glm::vec3(0.0f);      /*!< max corner of the bounding box of the vertices */
+        float m_extent = 0.0f;                      /*!< diagonal of the bounding box */
+        unsigned m_nbThreads = 1;                   /*!< number of threads */
+
+};
+
+
+#endif // MESHSIMPLIFY_H
@@ -0,0 +1,481 @@
+/*********************************************************************************************************************
+ *
+ * occlusionbuffer.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "occlusionbuffer.h"
+#include "simdkernels.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+#endif
+
+// per-function instruction sets, as in simdkernels.cpp
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define SIMD_TARGET(_isa) __attribute__((target(_isa)))
+#else
+    #define SIMD_TARGET(_isa)
+#endif
+
+
+static const float EMPTY_DEPTH = 1.0f;  // far plane
+
+
+/*
+ * Triangle clipped to a tile. Edge functions are split in a column term a * x and a row term b * y + c, computed once
+ * here, so that kernels only add and compare: coverage is the same for every instruction set.
+ */
+struct TileTriangle
+{
+    alignas(64) float columnTerms[3][OcclusionBuffer::TILE_WIDTH];  // a * x for the columns [x0, x1)
+    float rowTerms[3][OcclusionBuffer::TILE_HEIGHT];                // b * y + c for the rows [y0, y1)
+    unsigned x0, x1, y0, y1;                                        // range of the tile, x0 and x1 multiple of 16
+    float depth;
+};
+
+
+// depth test of the pixels of a tile covered by a triangle (_depth points to the first pixel of the tile)
+typedef void (*RasterKernel)(const TileTriangle& _t, float* _depth, unsigned _stride);
+
+
+/*
+ * Reference kernel, one pixel at a time
+ */
+static void rasterizeScalar(const TileTriangle& _t, float* _depth, unsigned _stride)
+{
+    for (unsigned y = _t.y0; y < _t.y1; y++)
+    {
+        float* row = _depth + (size_t)y * _stride;
+        for (unsigned x = _t.x0; x < _t.x1; x++)
+        {
+            bool inside = (_t.columnTerms[0][x] + _t.rowTerms[0][y] >= 0.0f) && (_t.columnTerms[1][x] + _t.rowTerms[1][y] >= 0.0f)
+                       && (_t.columnTerms[2][x] + _t.rowTerms[2][y] >= 0.0f);
+            if (inside)
+                row[x] = std::min(row[x], _t.depth);
+        }
+    }
+}
+
+
+#ifdef SIMD_X86
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 SSE4.2                                                      |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// Same operations as rasterizeScalar(), 4 / 8 / 16 pixels of a row at a time
+
+
+SIMD_TARGET("sse4.2")
+static void rasterizeSSE(const TileTriangle& _t, float* _depth, unsigned _stride)
+{
+    __m128 depth = _mm_set1_ps(_t.depth), zero = _mm_setzero_ps();
+    for (unsigned y = _t.y0; y < _t.y1; y++)
+    {
+        float* row = _depth + (size_t)y * _stride;
+        __m128 row0 = _mm_set1_ps(_t.rowTerms[0][y]), row1 = _mm_set1_ps(_t.rowTerms[1][y]), row2 = _mm_set1_ps(_t.rowTerms[2][y]);
+        for (unsigned x = _t.x0; x < _t.x1; x += 4)
+        {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_load_ps(_t.columnTerms[0] + x), row0), zero),
+                                                  _mm_cmpge_ps(_mm_add_ps(_mm_load_ps(_t.columnTerms[1] + x), row1), zero)),
+                                       _mm_cmpge_ps(_mm_add_ps(_mm_load_ps(_t.columnTerms[2] + x), row2), zero));
+            __m128 current = _mm_loadu_ps(row + x);
+            _mm_storeu_ps(row + x, _mm_blendv_ps(current, _mm_min_ps(current, depth), inside));
+        }
+    }
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                  AVX2                                                       |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+SIMD_TARGET("avx2")
+static void rasterizeAVX2(const TileTriangle& _t, float* _depth, unsigned _stride)
+{
+    __m256 depth = _mm256_set1_ps(_t.depth), zero = _mm256_setzero_ps();
+    for (unsigned y = _t.y0; y < _t.y1; y++)
+    {
+        float* row = _depth + (size_t)y * _stride;
+        __m256 row0 = _mm256_set1_ps(_t.rowTerms[0][y]), row1 = _mm256_set1_ps(_t.rowTerms[1][y]), row2 = _mm256_set1_ps(_t.rowTerms[2][y]);
+        for (unsigned x = _t.x0; x < _t.x1; x += 8)
+        {
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(_mm256_load_ps(_t.columnTerms[0] + x), row0), zero, _CMP_GE_OQ),
+                                                        _mm256_cmp_ps(_mm256_add_ps(_mm256_load_ps(_t.columnTerms[1] + x), row1), zero, _CMP_GE_OQ)),
+                                          _mm256_cmp_ps(_mm256_add_ps(_mm256_load_ps(_t.columnTerms[2] + x), row2), zero, _CMP_GE_OQ));
+            __m256 current = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, depth), inside));
+        }
+    }
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 AVX-512                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+SIMD_TARGET("avx512f")
+static void rasterizeAVX512(const TileTriangle& _t, float* _depth, unsigned _stride)
+{
+    __m512 depth = _mm512_set1_ps(_t.depth), zero = _mm512_setzero_ps();
+    for (unsigned y = _t.y0; y < _t.y1; y++)
+    {
+        float* row = _depth + (size_t)y * _stride;
+        __m512 row0 = _mm512_set1_ps(_t.rowTerms[0][y]), row1 = _mm512_set1_ps(_t.rowTerms[1][y]), row2 = _mm512_set1_ps(_t.rowTerms[2][y]);
+        for (unsigned x = _t.x0; x < _t.x1; x += 16)
+        {
+            __mmask16 inside = _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_load_ps(_t.columnTerms[0] + x), row0), zero, _CMP_GE_OQ)
+                             & _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_load_ps(_t.columnTerms[1] + x), row1), zero, _CMP_GE_OQ)
+                             & _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_load_ps(_t.columnTerms[2] + x), row2), zero, _CMP_GE_OQ);
+            __m512 current = _mm512_loadu_ps(row + x);
+            _mm512_storeu_ps(row + x, _mm512_mask_min_ps(current, inside, current, depth));
+        }
+    }
+}
+
+
+#endif // SIMD_X86
+
+
+/*
+ * Pixels whose center is in [_min, _max]: [ceil(_min - 0.5), floor(_max - 0.5)], clamped to [0, _size - 1]
+ * (without std::ceil / std::floor, which are function calls without SSE4.1)
+ */
+static inline void getPixelRange(float _min, float _max, unsigned _size, int& _first, int& _last)
+{
+    float first = std::clamp(_min - 0.5f, -1.0f, (float)_size), last = std::clamp(_max - 0.5f, -1.0f, (float)_size);
+    _first = (int)first;
+    _first += ((float)_first < first) ? 1 : 0;
+    _last = (int)last;
+    _last -= ((float)_last > last) ? 1 : 0;
+    _first = std::max(_first, 0);
+    _last = std::min(_last, (int)_size - 1);
+}
+
+
+void extractOccluder(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::vector<glm::vec3>& _occluderPositions,
+                     std::vector<uint32_t>& _occluderIndices)
+{
+    std::vector<uint32_t> remap(_positions.size(), UINT32_MAX);
+    _occluderPositions.clear();
+    _occluderIndices.resize(_indices.size());
+    for (size_t i = 0; i < _indices.size(); i++)
+    {
+        uint32_t& vertex = remap[_indices[i]];
+        if (vertex == UINT32_MAX)
+        {
+            vertex = (uint32_t)_occluderPositions.size();
+            _occluderPositions.push_back(_positions[_indices[i]]);
+        }
+        _occluderIndices[i] = vertex;
+    }
+}
+
+
+static RasterKernel getRasterKernel()
+{
+    switch (getSimdISA())
+    {
+#ifdef SIMD_X86
+        case SimdISA::AVX512: return rasterizeAVX512;
+        case SimdISA::AVX2:   return rasterizeAVX2;
+        case SimdISA::SSE42:  return rasterizeSSE;
+#endif
+        default:              return rasterizeScalar;
+    }
+}
+
+
+void OcclusionBuffer::resize(unsigned _width, unsigned _height)
+{
+    _width = std::max(_width, 1u);
+    _height = std::max(_height, 1u);
+    if (_width == m_width && _height == m_height)
+        return;
+
+    m_width = _width;
+    m_height = _height;
+    m_nbTilesX = (_width + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_nbTilesY = (_height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_stride = m_nbTilesX * TILE_WIDTH;
+    m_depth.assign((size_t)m_stride * m_nbTilesY * TILE_HEIGHT, EMPTY_DEPTH);
+
+    // halved (rounded up) down to 1x1
+    m_levelSizes.assign(1, glm::uvec2(_width, _height));
+    while (m_levelSizes.back().x > 1 || m_levelSizes.back().y > 1)
+        m_levelSizes.push_back((m_levelSizes.back() + 1u) / 2u);
+    m_levels.resize(m_levelSizes.size());
+    for (size_t level = 0; level < m_levels.size(); level++)
+        m_levels[level].assign((size_t)m_levelSizes[level].x * m_levelSizes[level].y, EMPTY_DEPTH);
+}
+
+
+void OcclusionBuffer::render(std::span<const Occluder> _occluders, const glm::mat4& _viewMat, const glm::mat4& _projMat, float _timeBudget,
+                             unsigned _nbThreads, OcclusionStats& _stats)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto getDeadline = [&](float _ms) { return startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(_ms)); };
+    auto binningDeadline = getDeadline(0.5f * _timeBudget), deadline = getDeadline(_timeBudget);
+    auto isLate = [&](const auto& _deadline) { return _timeBudget > 0.0f && std::chrono::steady_clock::now() > _deadline; };
+
+    _stats = OcclusionStats();
+    size_t nbTiles = (size_t)m_nbTilesX * m_nbTilesY;
+    _stats.nbTiles = nbTiles;
+    std::fill(m_depth.begin(), m_depth.end(), EMPTY_DEPTH);
+
+    // occluders are taken in turn by the threads (in order, so that the first ones are rendered when the budget is
+    // short): vertices are brought to screen space (pixels, depth and clip w), then triangles are set up and binned in
+    // the tiles they overlap, with triangles and bins for each occluder. Occluders not started within half the budget are
+    // skipped, and so are the ones still being binned then (checked every DEADLINE_CHECK_INTERVAL triangles): the
+    // buffer is still conservative without them.
+    std::vector<size_t> firstVertices(_occluders.size() + 1, 0);
+    for (size_t o = 0; o < _occluders.size(); o++)
+    {
+        firstVertices[o + 1] = firstVertices[o] + _occluders[o].positions.size();
+        _stats.nbOccluderTriangles += _occluders[o].indices.size() / 3;
+    }
+    m_screenVertices.resize(firstVertices.back());
+    if (m_triangles.size() < _occluders.size())
+        m_triangles.resize(_occluders.size());
+    if (m_bins.size() < _occluders.size() * nbTiles)
+        m_bins.resize(_occluders.size() * nbTiles);
+    for (size_t b = 0; b < _occluders.size() * nbTiles; b++)
+        m_bins[b].clear();
+
+    float halfWidth = 0.5f * (float)m_width, halfHeight = 0.5f * (float)m_height;
+    std::atomic<size_t> nextOccluder(0), nbRasterized(0), nbSkippedTriangles(0);
+    unsigned nbBinningThreads = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), _occluders.size());
+    parallelFor(0, nbBinningThreads, nbBinningThreads, [&](size_t, size_t, unsigned)
+    {
+        for (size_t o = nextOccluder++; o < _occluders.size(); o = nextOccluder++)
+        {
+            const Occluder& occluder = _occluders[o];
+            std::vector<ScreenTriangle>& triangles = m_triangles[o];
+            std::vector<uint32_t>* bins = m_bins.data() + o * nbTiles;
+            triangles.clear();
+            if (isLate(binningDeadline))
+            {
+                nbSkippedTriangles += occluder.indices.size() / 3;
+                continue;
+            }
+
+            // a geometric error e moves the vertices e units away from the camera (view space), i.e.
+            // clip = mvp * p - e * projMat[2], so that a simplified occluder stays behind the surface it stands for
+            glm::mat4 modelViewMat = _viewMat * occluder.modelMat;
+            glm::mat4 mvp = _projMat * modelViewMat;
+            float scale = std::max({ glm::length(glm::vec3(modelViewMat[0])), glm::length(glm::vec3(modelViewMat[1])), glm::length(glm::vec3(modelViewMat[2])) });
+            glm::vec4 offset = occluder.error * scale * _projMat[2];
+            glm::vec4* screenVertices = m_screenVertices.data() + firstVertices[o];
+            for (size_t v = 0; v < occluder.positions.size(); v++)
+            {
+                glm::vec4 clip = mvp * glm::vec4(occluder.positions[v], 1.0f) - offset;
+                float invW = 1.0f / clip.w;
+                screenVertices[v] = glm::vec4((clip.x * invW + 1.0f) * halfWidth, (clip.y * invW + 1.0f) * halfHeight, clip.z * invW, clip.w);
+            }
+
+            size_t count = 0;
+            bool isAbandoned = false;
+            for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+            {
+                if ((i / 3) % DEADLINE_CHECK_INTERVAL == DEADLINE_CHECK_INTERVAL - 1 && isLate(binningDeadline))
+                {
+                    isAbandoned = true;
+                    break;
+                }
+
+                // not rasterized if a vertex is in front of the near plane (or behind the camera)
+                const glm::vec4& v0 = screenVertices[occluder.indices[i]];
+                const glm::vec4& v1 = screenVertices[occluder.indices[i + 1]];
+                const glm::vec4& v2 = screenVertices[occluder.indices[i + 2]];
+                if (v0.w <= 0.0f || v1.w <= 0.0f || v2.w <= 0.0f || v0.z < -1.0f || v1.z < -1.0f || v2.z < -1.0f)
+                    continue;
+
+                // counter-clockwise front faces only
+                float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+                if (!(area > 0.0f))
+                    continue;
+
+                // pixels whose center (x + 0.5, y + 0.5) is in the bounding box
+                int minX, maxX, minY, maxY;
+                getPixelRange(std::min({ v0.x, v1.x, v2.x }), std::max({ v0.x, v1.x, v2.x }), m_width, minX, maxX);
+                getPixelRange(std::min({ v0.y, v1.y, v2.y }), std::max({ v0.y, v1.y, v2.y }), m_height, minY, maxY);
+                if (minX > maxX || minY > maxY)
+                    continue;
+
+                // edge k goes from vertex k to vertex k + 1, positive inside. Inner-conservative coverage: the edge
+                // function is tested at the pixel center minus its max variation over the pixel, 0.5 * (|a| + |b|),
+                // so that only pixels entirely inside the triangle are written
+                ScreenTriangle triangle;
+                const glm::vec4* vertices[3] = { &v0, &v1, &v2 };
+                for (int k = 0; k < 3; k++)
+                {
+                    const glm::vec4& a = *vertices[k];
+                    const glm::vec4& b = *vertices[(k + 1) % 3];
+                    triangle.edgeA[k] = a.y - b.y;
+                    triangle.edgeB[k] = b.x - a.x;
+                    triangle.edgeC[k] = a.x * b.y - a.y * b.x - 0.5f * (std::abs(triangle.edgeA[k]) + std::abs(triangle.edgeB[k]));
+                }
+                triangle.depth = std::max({ v0.z, v1.z, v2.z });
+                triangle.minX = minX;
+                triangle.maxX = maxX;
+                triangle.minY = minY;
+                triangle.maxY = maxY;
+
+                uint32_t id = (uint32_t)triangles.size();
+                triangles.push_back(triangle);
+                for (int ty = minY / (int)TILE_HEIGHT; ty <= maxY / (int)TILE_HEIGHT; ty++)
+                    for (int tx = minX / (int)TILE_WIDTH; tx <= maxX / (int)TILE_WIDTH; tx++)
+                        bins[(size_t)ty * m_nbTilesX + tx].push_back(id);
+                count++;
+            }
+
+            if (isAbandoned)
+            {
+                triangles.clear();
+                for (size_t t = 0; t < nbTiles; t++)
+                    bins[t].clear();
+                nbSkippedTriangles += occluder.indices.size() / 3;
+                continue;
+            }
+            nbRasterized += count;
+        }
+    });
+    _stats.nbRasterizedTriangles = nbRasterized;
+    _stats.nbSkippedTriangles = nbSkippedTriangles;
+
+    // tiles are taken in turn by the threads; a tile started before the deadline is completed, the others stay empty
+    RasterKernel kernel = getRasterKernel();
+    std::atomic<size_t> nextTile(0), nbSkippedTiles(0);
+    unsigned nbRasterThreads = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), nbTiles);
+    parallelFor(0, nbRasterThreads, nbRasterThreads, [&](size_t, size_t, unsigned)
+    {
+        TileTriangle tileTriangle;
+        for (size_t tile = nextTile++; tile < nbTiles; tile = nextTile++)
+        {
+            if (isLate(deadline))
+            {
+                nbSkippedTiles++;
+                continue;
+            }
+
+            unsigned tileX = (unsigned)(tile % m_nbTilesX) * TILE_WIDTH, tileY = (unsigned)(tile / m_nbTilesX) * TILE_HEIGHT;
+            float* tileDepth = m_depth.data() + (size_t)tileY * m_stride + tileX;
+            for (size_t o = 0; o < _occluders.size(); o++)
+            {
+                for (uint32_t t : m_bins[o * nbTiles + tile])
+                {
+                    const ScreenTriangle& triangle = m_triangles[o][t];
+                    unsigned minX = (unsigned)std::max(triangle.minX - (int)tileX, 0), maxX = (unsigned)std::min(triangle.maxX - (int)tileX, (int)TILE_WIDTH - 1);
+                    tileTriangle.x0 = minX / 16 * 16;
+                    tileTriangle.x1 = (maxX / 16 + 1) * 16;
+                    tileTriangle.y0 = (unsigned)std::max(triangle.minY - (int)tileY, 0);
+                    tileTriangle.y1 = (unsigned)std::min(triangle.maxY - (int)tileY, (int)TILE_HEIGHT - 1) + 1;
+                    tileTriangle.depth = triangle.depth;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        for (unsigned x = tileTriangle.x0; x < tileTriangle.x1; x++)
+                            tileTriangle.columnTerms[k][x] = triangle.edgeA[k] * ((float)(tileX + x) + 0.5f);
+                        for (unsigned y = tileTriangle.y0; y < tileTriangle.y1; y++)
+                            tileTriangle.rowTerms[k][y] = triangle.edgeB[k] * ((float)(tileY + y) + 0.5f) + triangle.edgeC[k];
+                    }
+                    kernel(tileTriangle, tileDepth, m_stride);
+                }
+            }
+        }
+    });
+    _stats.nbSkippedTiles = nbSkippedTiles;
+    auto rasterEndTime = std::chrono::steady_clock::now();
+    _stats.rasterTime = std::chrono::duration<float, std::milli>(rasterEndTime - startTime).count();
+
+    buildPyramid();
+    _stats.pyramidTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - rasterEndTime).count();
+}
+
+
+void OcclusionBuffer::buildPyramid()
+{
+    if (m_levels.empty())
+        return;
+
+    for (unsigned y = 0; y < m_height; y++)
+        std::copy_n(m_depth.data() + (size_t)y * m_stride, m_width, m_levels[0].data() + (size_t)y * m_width);
+
+    // max of 2x2 texels (the last row / column of odd sizes is reduced with itself)
+    for (size_t level = 1; level < m_levels.size(); level++)
+    {
+        glm::uvec2 size = m_levelSizes[level], previousSize = m_levelSizes[level - 1];
+        const float* previous = m_levels[level - 1].data();
+        float* current = m_levels[level].data();
+        for (unsigned y = 0; y < size.y; y++)
+        {
+            const float* row0 = previous + (size_t)(2 * y) * previousSize.x;
+            const float* row1 = previous + (size_t)std::min(2 * y + 1, previousSize.y - 1) * previousSize.x;
+            for (unsigned x = 0; x < size.x; x++)
+            {
+                unsigned x0 = 2 * x, x1 = std::min(2 * x + 1, previousSize.x - 1);
+                current[(size_t)y * size.x + x] = std::max({ row0[x0], row0[x1], row1[x0], row1[x1] });
+            }
+        }
+    }
+}
+
+
+bool OcclusionBuffer::isBoxOccluded(const glm::vec3& _bBoxMin, const glm::vec3& _bBoxMax, const glm::mat4& _mvp) const
+{
+    if (m_levels.empty())
+        return false;
+
+    // screen rectangle and nearest depth of the corners (center and half axes of the box in clip space)
+    glm::vec4 center = _mvp * glm::vec4(0.5f * (_bBoxMin + _bBoxMax), 1.0f);
+    glm::vec3 halfSize = 0.5f * (_bBoxMax - _bBoxMin);
+    glm::vec4 axes[3] = { _mvp[0] * halfSize.x, _mvp[1] * halfSize.y, _mvp[2] * halfSize.z };
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = center + ((i & 1) ? axes[0] : -axes[0]) + ((i & 2) ? axes[1] : -axes[1]) + ((i & 4) ? axes[2] : -axes[2]);
+        if (clip.w <= 0.0f || clip.z < -clip.w)
+            return false;
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW + 1.0f) * 0.5f * (float)m_width, y = (clip.y * invW + 1.0f) * 0.5f * (float)m_height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip.z * invW);
+    }
+
+    // pixels touched by the rectangle (off-screen parts are not visible anyway)
+    if (maxX < 0.0f || maxY < 0.0f || minX > (float)m_width || minY > (float)m_height)
+        return false;
+    unsigned x0 = (unsigned)std::clamp(std::floor(minX), 0.0f, (float)m_width - 1.0f), x1 = (unsigned)std::clamp(std::floor(maxX), 0.0f, (float)m_width - 1.0f);
+    unsigned y0 = (unsigned)std::clamp(std::floor(minY), 0.0f, (float)m_height - 1.0f), y1 = (unsigned)std::clamp(std::floor(maxY), 0.0f, (float)m_height - 1.0f);
+
+    // finest level where the rectangle spans at most 2x2 texels
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        level++;
+
+    const std::vector<float>& depth = m_levels[level];
+    unsigned width = m_levelSizes[level].x;
+    for (unsigned y = y0 >> level; y <= (y1 >> level); y++)
+        for (unsigned x = x0 >> level; x <= (x1 >> level); x++)
+            if (depth[(size_t)y * width + x] >= minZ)
+                return false;
+    return true;
+}
@@ -0,0 +1,192 @@
+/*********************************************************************************************************************
+ *
+ * occlusionbuffer.h
+ *
+ * Software occlusion culling: occluders rasterized in a low-resolution depth buffer on the CPU, boxes tested against
+ * its hierarchical depth (max depth mip pyramid), no OpenGL call
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct Occluder
+* \brief Mesh rasterized in the occlusion buffer (usually a coarse level of detail of a large mesh)
+*/
+struct Occluder
+{
+    std::span<const glm::vec3> positions;   /*!< vertex coords (model space, all transformed: see ::extractOccluder) */
+    std::span<const uint32_t> indices;      /*!< triangles (front faces are counter-clockwise) */
+    glm::mat4 modelMat = glm::mat4(1.0f);   /*!< model matrix */
+    float error = 0.0f;                     /*!< max distance to the mesh it stands for (model space): pushes its depth back */
+};
+
+
+/*!
+* \fn extractOccluder
+* \brief copy the vertices used by a set of triangles (e.g., a coarse level of detail), in order of first use, so that
+* the occluder does not transform the vertices of the full mesh
+* \param _positions : vertex coords of the mesh
+* \param _indices : triangles
+* \param _occluderPositions : used vertices
+* \param _occluderIndices : triangles, indexing _occluderPositions
+*/
+void extractOccluder(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::vector<glm::vec3>& _occluderPositions,
+                     std::vector<uint32_t>& _occluderIndices);
+
+
+/*!
+* \struct OcclusionStats
+* \brief Result of the last OcclusionBuffer::render()
+*/
+struct OcclusionStats
+{
+    size_t nbOccluderTriangles = 0;     /*!< triangles of the occluders */
+    size_t nbRasterizedTriangles = 0;   /*!< front-facing triangles in front of the near plane and covering a pixel */
+    size_t nbSkippedTriangles = 0;      /*!< triangles of the occluders dropped because half the time budget was exceeded */
+    size_t nbTiles = 0;                 /*!< tiles of the depth buffer */
+    size_t nbSkippedTiles = 0;          /*!< tiles left empty because the time budget was exceeded */
+    float rasterTime = 0.0f;            /*!< transform, binning and rasterization time (ms) */
+    float pyramidTime = 0.0f;           /*!< depth pyramid time (ms) */
+};
+
+
+/*!
+* \class OcclusionBuffer
+* \brief Low-resolution depth buffer filled with occluders on the CPU, then queried with bounding boxes.
+* Occluders are transformed and their triangles binned in tiles of TILE_WIDTH x TILE_HEIGHT pixels by the threads, one
+* occluder at a time, then tiles are rasterized by the threads with 4 / 8 / 16 pixels at a time for SSE4.2 / AVX2 /
+* AVX-512 (see getSimdISA()).
+* Depth is conservative: coverage is inner-conservative (a pixel is written only if it is entirely inside a triangle),
+* and a covered pixel gets the farthest depth of the triangle, so a box is occluded only if it is behind every occluder
+* covering it. Pixels straddling the edges shared by two triangles of an occluder are left empty: occluders should have
+* triangles several pixels wide at the resolution of the buffer, or they occlude little. Triangles crossing the near
+* plane are not rasterized. The depth of a simplified occluder is pushed back by its error (see Occluder::error): it
+* stays behind the surface it stands for only as far as that error bounds the simplification.
+* The depth buffer only depends on the occluders and the matrices, not on the number of threads nor on the instruction
+* set, unless the time budget is exceeded: occluders not binned within half the budget are dropped (so the most
+* important ones should come first), and tiles not started within the budget are left empty (they occlude nothing).
+*/
+class OcclusionBuffer
+{
+    public:
+
+        static constexpr unsigned TILE_WIDTH = 32;          /*!< tile width in pixels (multiple of the widest SIMD kernel) */
+        static constexpr unsigned TILE_HEIGHT = 16;         /*!< tile height in pixels */
+        static constexpr unsigned DEFAULT_WIDTH = 256;      /*!< suggested width of the buffer (height follows the viewport) */
+        static constexpr size_t DEADLINE_CHECK_INTERVAL = 256;  /*!< triangles binned between two checks of the time budget */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getWidth */
+        unsigned getWidth() const { return m_width; }
+        /*! \fn getHeight */
+        unsigned getHeight() const { return m_height; }
+        /*! \fn getNbLevels */
+        size_t getNbLevels() const { return m_levelSizes.size(); }
+
+        /*!
+        * \fn getLevel
+        * \brief depth of a level of the pyramid (level 0 is the depth buffer), row by row from the bottom of the screen,
+        * in normalized device coords (1 = far plane or empty)
+        */
+        std::span<const float> getLevel(size_t _level) const { return m_levels[_level]; }
+        /*! \fn getLevelSize */
+        glm::uvec2 getLevelSize(size_t _level) const { return m_levelSizes[_level]; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn resize
+        * \brief set the resolution of the buffer (nothing is done if it does not change)
+        */
+        void resize(unsigned _width, unsigned _height);
+
+        /*!
+        * \fn render
+        * \brief clear the buffer, rasterize the occluders and build the depth pyramid
+        * \param _occluders : meshes to rasterize
+        * \param _viewMat : camera view matrix
+        * \param _projMat : camera projection matrix (perspective or orthographic)
+        * \param _timeBudget : max time of the rasterization in ms (0 = no limit), exceeded by at most the transform of
+        * one occluder and DEADLINE_CHECK_INTERVAL triangles or one tile per thread, and by the depth pyramid
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        * \param _stats : triangles rasterized, tiles skipped and time spent
+        */
+        void render(std::span<const Occluder> _occluders, const glm::mat4& _viewMat, const glm::mat4& _projMat, float _timeBudget,
+                    unsigned _nbThreads, OcclusionStats& _stats);
+
+        /*!
+        * \fn isBoxOccluded
+        * \brief test a box against the depth pyramid: its screen rectangle is covered by at most 2x2 texels of a level,
+        * whose max depth is compared to the nearest corner of the box
+        * \param _bBoxMin : min corner of the box (model space)
+        * \param _bBoxMax : max corner of the box (model space)
+        * \param _mvp : model-view-projection matrix of the box (same view and projection as render())
+        * \return true if the box is hidden behind the occluders, false if it may be visible (or crosses the near plane)
+        */
+        bool isBoxOccluded(const glm::vec3& _bBoxMin, const glm::vec3& _bBoxMax, const glm::mat4& _mvp) const;
+
+
+    protected:
+
+        /*!
+        * \struct ScreenTriangle
+        * \brief Edge functions (inside when a * x + b * y + c >= 0 for the 3 edges), pixel bounds and depth of a triangle
+        */
+        struct ScreenTriangle
+        {
+            float edgeA[3], edgeB[3], edgeC[3];     /*!< c is offset so that the test holds on the whole pixel */
+            float depth;                        /*!< farthest vertex depth */
+            int minX, maxX, minY, maxY;         /*!< pixels whose center is in the bounding box (superset of the covered ones) */
+        };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        unsigned m_width = 0;                           /*!< width in pixels */
+        unsigned m_height = 0;                          /*!< height in pixels */
+        unsigned m_stride = 0;                          /*!< row length of the depth buffer (padded to whole tiles) */
+        unsigned m_nbTilesX = 0, m_nbTilesY = 0;        /*!< number of tiles */
+        std::vector<float> m_depth;                     /*!< depth buffer (padded to whole tiles) */
+        std::vector<std::vector<float>> m_levels;       /*!< depth pyramid, level 0 being the depth buffer without padding */
+        std::vector<glm::uvec2> m_levelSizes;           /*!< size of each level */
+
+        std::vector<glm::vec4> m_screenVertices;        /*!< occluder vertices: pixel coords, depth and clip w */
+        std::vector<std::vector<ScreenTriangle>> m_triangles;   /*!< setup of the triangles to rasterize, for each occluder */
+        std::vector<std::vector<uint32_t>> m_bins;              /*!< triangles overlapping each tile, for each occluder */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn buildPyramid
+        * \brief copy the depth buffer in level 0, and reduce it by 2x2 texels (max depth) down to 1x1
+        */
+        void buildPyramid();
+
+};
+
+
+#endif // OCCLUSIONBUFFER_H
@@ -0,0 +1,103 @@
+/*********************************************************************************************************************
+ *
+ * parallel.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "parallel.h"
+
+
+WorkerPool& WorkerPool::getInstance()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+
+bool WorkerPool::run(unsigned _nbBlocks, const std::function<void(unsigned)>& _block)
+{
+    // one job at a time (a job nested in a block of the current one is refused too, instead of deadlocking)
+    bool busy = false;
+    if (!m_busy.compare_exchange_strong(busy, true))
+        return false;
+
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_threads.size() + 1 < _nbBlocks)
+            m_threads.emplace_back(&WorkerPool::workerLoop, this, m_generation);
+
+        generation = ++m_generation;
+        m_block = &_block;
+        m_nbBlocks = _nbBlocks;
+        m_nbRemaining = _nbBlocks;
+        m_nextBlock = (uint64_t)generation << 32;
+    }
+    m_wakeUp.notify_all();
+
+    takeBlocks(generation, _nbBlocks, _block);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_nbRemaining == 0; });
+        m_block = nullptr;
+    }
+
+    m_busy = false;
+    return true;
+}
+
+
+void WorkerPool::workerLoop(uint32_t _generation)
+{
+    while (true)
+    {
+        const std::function<void(unsigned)>* block;
+        unsigned nbBlocks;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]() { return m_stop || (m_block != nullptr && m_generation != _generation); });
+            if (m_stop)
+                return;
+            _generation = m_generation;
+            block = m_block;
+            nbBlocks = m_nbBlocks;
+        }
+        takeBlocks(_generation, nbBlocks, *block);
+    }
+}
+
+
+void WorkerPool::takeBlocks(uint32_t _generation, unsigned _nbBlocks, const std::function<void(unsigned)>& _block)
+{
+    // a block is taken only while the counter still belongs to this job, so a late thread never runs a block of
+    // the next job with the function of this one
+    uint64_t next = m_nextBlock.load();
+    while ((uint32_t)(next >> 32) == _generation && (uint32_t)next < _nbBlocks)
+    {
+        if (!m_nextBlock.compare_exchange_weak(next, next + 1))
+            continue;
+
+        _block((unsigned)(uint32_t)next);
+        if (--m_nbRemaining == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+        next = m_nextBlock.load();
+    }
+}
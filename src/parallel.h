@@ -0,0 +1,150 @@
+/*********************************************************************************************************************
+ *
+ * parallel.h
+ *
+ * Minimal helpers to split CPU work over several threads
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+
+/*!
+* \fn getNbThreads
+* \brief get the number of threads to use
+* \param _requested : requested number of threads (0 = all hardware threads)
+* \return number of threads (at least 1)
+*/
+inline unsigned getNbThreads(unsigned _requested)
+{
+    if (_requested == 0)
+        _requested = std::thread::hardware_concurrency();
+    return std::max(_requested, 1u);
+}
+
+
+/*!
+* \class WorkerPool
+* \brief Threads created once and kept waiting for blocks of work, so that short jobs run every frame (e.g., culling)
+* do not pay for creating and joining threads. The pool runs one job at a time: run() returns false while it is busy
+* (a job from another thread such as a background load, or a job nested in a block), and the caller then falls back
+* to its own threads.
+*/
+class WorkerPool
+{
+    public:
+
+        /*!
+        * \fn getInstance
+        * \brief pool shared by the whole application (threads are created on first use, as needed)
+        */
+        static WorkerPool& getInstance();
+
+        /*!
+        * \fn ~WorkerPool
+        * \brief Destructor: stop and join the threads
+        */
+        ~WorkerPool();
+
+        /*!
+        * \fn run
+        * \brief call _block(b) for b in [0, _nbBlocks): the calling thread takes blocks too, and returns once all of them
+        * are done
+        * \param _nbBlocks : number of blocks (the pool grows to _nbBlocks - 1 threads)
+        * \param _block : function called as _block(blockId)
+        * \return false if the pool is busy with another job (nothing was called)
+        */
+        bool run(unsigned _nbBlocks, const std::function<void(unsigned)>& _block);
+
+    private:
+
+        /*!
+        * \fn WorkerPool
+        * \brief Constructor (see getInstance())
+        */
+        WorkerPool() = default;
+
+        /*!
+        * \fn workerLoop
+        * \brief wait for jobs and take their blocks until the pool is destroyed
+        * \param _generation : job generation when the thread was created (older jobs are ignored)
+        */
+        void workerLoop(uint32_t _generation);
+
+        /*!
+        * \fn takeBlocks
+        * \brief run the blocks of job _generation not taken yet by another thread
+        */
+        void takeBlocks(uint32_t _generation, unsigned _nbBlocks, const std::function<void(unsigned)>& _block);
+
+
+        std::vector<std::thread> m_threads;                     /*!< workers (the calling thread is not one of them) */
+        std::atomic<bool> m_busy = false;                       /*!< true while a job is running */
+
+        std::mutex m_mutex;                                     /*!< protects the job below and the wake-up/done signals */
+        std::condition_variable m_wakeUp;                       /*!< signalled when a job is posted or the pool stops */
+        std::condition_variable m_done;                         /*!< signalled when the last block of a job is done */
+        const std::function<void(unsigned)>* m_block = nullptr; /*!< function of the current job */
+        unsigned m_nbBlocks = 0;                                /*!< number of blocks of the current job */
+        uint32_t m_generation = 0;                              /*!< incremented for each job */
+        bool m_stop = false;                                    /*!< true when the pool is destroyed */
+
+        std::atomic<uint64_t> m_nextBlock = 0;                  /*!< generation << 32 | next block to take */
+        std::atomic<unsigned> m_nbRemaining = 0;                /*!< blocks of the current job not done yet */
+};
+
+
+/*!
+* \fn parallelFor
+* \brief split a range of items in contiguous blocks and process each block on its own thread
+* Blocks run on the threads of WorkerPool and on the calling thread, or on threads created for the call if the pool
+* is busy. Block boundaries only depend on the range and the number of threads, so per-block results can be merged
+* deterministically.
+* \param _begin : first item
+* \param _end : last item + 1
+* \param _nbThreads : number of threads (0 = all hardware threads)
+* \param _func : function called as _func(blockBegin, blockEnd, blockId)
+*/
+template<typename Func>
+void parallelFor(size_t _begin, size_t _end, unsigned _nbThreads, Func&& _func)
+{
+    if (_end <= _begin)
+        return;
+
+    size_t count = _end - _begin;
+    unsigned nbBlocks = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), count);
+    if (nbBlocks == 1)
+    {
+        _func(_begin, _end, 0u);
+        return;
+    }
+
+    auto block = [&](unsigned _b) { _func(_begin + count * _b / nbBlocks, _begin + count * (_b + 1) / nbBlocks, _b); };
+    if (WorkerPool::getInstance().run(nbBlocks, block))
+        return;
+
+    std::vector<std::thread> threads;
+    threads.reserve(nbBlocks - 1);
+    for (unsigned b = 1; b < nbBlocks; b++)
+        threads.emplace_back([&block, b]() { block(b); });
+    block(0u);
+
+    for (std::thread& t : threads)
+        t.join();
+}
+
+
+#endif // PARALLEL_H
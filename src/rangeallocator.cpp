@@ -0,0 +1,142 @@
+/*********************************************************************************************************************
+ *
+ * rangeallocator.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "rangeallocator.h"
+
+#include <algorithm>
+
+
+uint32_t RangeAllocator::getSize(uint32_t _offset) const
+{
+    auto it = m_allocations.find(_offset);
+    return (it != m_allocations.end()) ? it->second : 0;
+}
+
+
+void RangeAllocator::reset(uint32_t _capacity)
+{
+    m_capacity = _capacity;
+    m_used = 0;
+    m_allocations.clear();
+    m_freeBlocks.clear();
+    m_freeBySize.clear();
+    if (_capacity > 0)
+        addFreeBlock(0, _capacity);
+}
+
+
+void RangeAllocator::grow(uint32_t _capacity)
+{
+    if (_capacity <= m_capacity)
+        return;
+
+    // extend the free block ending at the current capacity, if any
+    uint32_t offset = m_capacity;
+    if (!m_freeBlocks.empty())
+    {
+        auto last = std::prev(m_freeBlocks.end());
+        if (last->first + last->second == m_capacity)
+        {
+            offset = last->first;
+            removeFreeBlock(last);
+        }
+    }
+    addFreeBlock(offset, _capacity - offset);
+    m_capacity = _capacity;
+}
+
+
+uint32_t RangeAllocator::allocate(uint32_t _size)
+{
+    if (_size == 0)
+        return INVALID_OFFSET;
+
+    // best fit: smallest block of at least _size (lowest offset for equal sizes)
+    auto fit = m_freeBySize.lower_bound({ _size, 0 });
+    if (fit == m_freeBySize.end())
+        return INVALID_OFFSET;
+
+    uint32_t offset = fit->second, blockSize = fit->first;
+    removeFreeBlock(m_freeBlocks.find(offset));
+    if (blockSize > _size)
+        addFreeBlock(offset + _size, blockSize - _size);
+
+    m_allocations.emplace(offset, _size);
+    m_used += _size;
+    return offset;
+}
+
+
+bool RangeAllocator::free(uint32_t _offset)
+{
+    auto allocation = m_allocations.find(_offset);
+    if (allocation == m_allocations.end())
+        return false;
+
+    uint32_t offset = _offset, size = allocation->second;
+    m_used -= size;
+    m_allocations.erase(allocation);
+
+    // merge with the next free block, then with the previous one
+    auto next = m_freeBlocks.lower_bound(offset);
+    if (next != m_freeBlocks.end() && next->first == offset + size)
+    {
+        size += next->second;
+        next = std::next(next);
+        removeFreeBlock(std::prev(next));
+    }
+    if (next != m_freeBlocks.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            removeFreeBlock(previous);
+        }
+    }
+    addFreeBlock(offset, size);
+    return true;
+}
+
+
+void RangeAllocator::compact(std::vector<Relocation>& _relocations)
+{
+    _relocations.clear();
+
+    std::map<uint32_t, uint32_t> allocations;
+    uint32_t offset = 0;
+    for (const auto& [oldOffset, size] : m_allocations)
+    {
+        if (oldOffset != offset)
+            _relocations.push_back({ oldOffset, offset, size });
+        allocations.emplace_hint(allocations.end(), offset, size);
+        offset += size;
+    }
+    m_allocations.swap(allocations);
+
+    m_freeBlocks.clear();
+    m_freeBySize.clear();
+    if (offset < m_capacity)
+        addFreeBlock(offset, m_capacity - offset);
+}
+
+
+void RangeAllocator::addFreeBlock(uint32_t _offset, uint32_t _size)
+{
+    m_freeBlocks.emplace(_offset, _size);
+    m_freeBySize.emplace(_size, _offset);
+}
+
+
+void RangeAllocator::removeFreeBlock(std::map<uint32_t, uint32_t>::iterator _block)
+{
+    m_freeBySize.erase({ _block->second, _block->first });
+    m_freeBlocks.erase(_block);
+}
@@ -0,0 +1,148 @@
+/*********************************************************************************************************************
+ *
+ * rangeallocator.h
+ *
+ * Sub-allocation of ranges of a large buffer (free list with best fit and coalescing, compaction), no OpenGL call
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+
+/*!
+* \struct Relocation
+* \brief Allocation moved by RangeAllocator::compact()
+*/
+struct Relocation
+{
+    uint32_t oldOffset;
+    uint32_t newOffset;
+    uint32_t size;
+};
+
+
+/*!
+* \class RangeAllocator
+* \brief Allocator of ranges in [0, capacity) (units are elements of the buffer, e.g. vertices or indices).
+* Free blocks are kept sorted by offset, to merge a freed range with its neighbours, and by size, to allocate from the
+* smallest block large enough (lowest offset among equal sizes). Both lookups are logarithmic in the number of blocks.
+* Fragmentation is measured as 1 - largest free block / free space: 0 when free space is a single block.
+*/
+class RangeAllocator
+{
+    public:
+
+        static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;  /*!< returned when no free block is large enough */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getCapacity */
+        uint32_t getCapacity() const { return m_capacity; }
+        /*! \fn getUsed */
+        uint32_t getUsed() const { return m_used; }
+        /*! \fn getFree */
+        uint32_t getFree() const { return m_capacity - m_used; }
+        /*! \fn getNbAllocations */
+        size_t getNbAllocations() const { return m_allocations.size(); }
+        /*! \fn getNbFreeBlocks */
+        size_t getNbFreeBlocks() const { return m_freeBlocks.size(); }
+        /*! \fn getLargestFreeBlock */
+        uint32_t getLargestFreeBlock() const { return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first; }
+        /*!
+        * \fn getFragmentation
+        * \brief 1 - largest free block / free space (0 if there is no free space)
+        */
+        float getFragmentation() const { return (getFree() == 0) ? 0.0f : 1.0f - (float)getLargestFreeBlock() / (float)getFree(); }
+
+        /*!
+        * \fn getSize
+        * \brief size of the allocation starting at _offset (0 if there is none)
+        */
+        uint32_t getSize(uint32_t _offset) const;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn reset
+        * \brief free all the allocations and set the capacity
+        */
+        void reset(uint32_t _capacity);
+
+        /*!
+        * \fn grow
+        * \brief increase the capacity (allocations keep their offset, the new space extends the last free block)
+        */
+        void grow(uint32_t _capacity);
+
+        /*!
+        * \fn allocate
+        * \brief allocate a range from the smallest free block large enough
+        * \return offset of the range, INVALID_OFFSET if no free block is large enough (or _size is 0)
+        */
+        uint32_t allocate(uint32_t _size);
+
+        /*!
+        * \fn free
+        * \brief release the allocation starting at _offset, merged with the free blocks around it
+        * \return false if there is no allocation at _offset
+        */
+        bool free(uint32_t _offset);
+
+        /*!
+        * \fn compact
+        * \brief move all the allocations to the start of the range, in offset order, leaving a single free block
+        * \param _relocations : moved allocations, by increasing offset (new offset < old offset: they can be copied in
+        * this order, an allocation overlapping its old range when it moves by less than its size)
+        */
+        void compact(std::vector<Relocation>& _relocations);
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        uint32_t m_capacity = 0;                                /*!< size of the range */
+        uint32_t m_used = 0;                                    /*!< sum of the allocation sizes */
+        std::map<uint32_t, uint32_t> m_allocations;             /*!< offset -> size of each allocation */
+        std::map<uint32_t, uint32_t> m_freeBlocks;              /*!< offset -> size of each free block */
+        std::set<std::pair<uint32_t, uint32_t>> m_freeBySize;   /*!< (size, offset) of each free block */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn addFreeBlock
+        * \brief insert a free block (not merged)
+        */
+        void addFreeBlock(uint32_t _offset, uint32_t _size);
+
+        /*!
+        * \fn removeFreeBlock
+        * \brief erase a free block
+        */
+        void removeFreeBlock(std::map<uint32_t, uint32_t>::iterator _block);
+
+};
+
+
+#endif // RANGEALLOCATOR_H
@@ -1,18 +1,35 @@
 // Fragment header
 #version 330
 
-// UNIFORMS
-uniform vec3 u_lightColor;
+// UNIFORMS (std140 blocks, see uniformbuffers.h)
+layout(std140) uniform FrameBlock
+{
+    mat4 u_matV;
+    mat4 u_matP;
+    vec4 u_lightPos;
+    vec4 u_lightColor;
+    vec4 u_camPos;
+    vec4 u_viewport;
+};
+
+struct Material
+{
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    vec4 specularColor;
+    float specularPower;
+};
 
-uniform vec3 u_ambientColor;
-uniform vec3 u_diffuseColor;
-uniform vec3 u_specularColor;
-uniform float u_specularPower;
+layout(std140) uniform MaterialBlock
+{
+    Material u_materials[16];   // MAX_MATERIALS
+};
     
 // INPUT
 in vec3 vecN;
 in vec3 vecV;
 in vec3 vecL;
+flat in uint materialIndex;
 
 
 // OUTPUT
@@ -40,21 +57,22 @@ void main()
     // final color
     vec4 color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
     
-    vec3 diff_col = u_diffuseColor;
+    Material material = u_materials[min(materialIndex, 15u)];
+    vec3 diff_col = material.diffuseColor.rgb;
         
     // -- Render Blinn-Phong shading --
     vec3 vecH = normalize(vecL + vecV);
     
     //DIFFUSE
     float diffuse = diffuse(vecN, vecL);
-    color.rgb += diff_col * u_lightColor * diffuse;
+    color.rgb += diff_col * u_lightColor.rgb * diffuse;
 
     //SPECULAR
-    float specular = specular_normalized(vecN, vecH, u_specularPower);
-    color.rgb += u_specularColor * u_lightColor * specular;
+    float specular = specular_normalized(vecN, vecH, material.specularPower);
+    color.rgb += material.specularColor.rgb * u_lightColor.rgb * specular;
 
     //AMBIENT
-    color.rgb += u_ambientColor;
+    color.rgb += material.ambientColor.rgb;
 
 
     frag_color = color;
@@ -6,25 +6,40 @@
 layout(location = 0) in vec4 a_position;
 layout(location = 1) in vec3 a_normal;
 
+// INSTANCE ATTRIBUTES (one per instance, see DrawableMesh::setInstances)
+layout(location = 2) in mat4 a_instanceMat;     // locations 2 to 5
+layout(location = 6) in uint a_materialIndex;
 
 
-// UNIFORMS
-uniform mat4 u_matM;
-uniform mat4 u_matV;
-uniform mat4 u_matP;
-uniform vec3 u_lightPos;
+
+// UNIFORMS (std140 blocks, see uniformbuffers.h)
+layout(std140) uniform FrameBlock
+{
+    mat4 u_matV;
+    mat4 u_matP;
+    vec4 u_lightPos;
+    vec4 u_lightColor;
+    vec4 u_camPos;
+    vec4 u_viewport;
+};
+
+layout(std140) uniform ObjectBlock
+{
+    mat4 u_matM;
+};
 
 // OUTPUT
 out vec3 vecN;
 out vec3 vecV;
 out vec3 vecL;
+flat out uint materialIndex;
 
 
 
 void main()
 {
-    // ModelView matrix
-    mat4 matMV = u_matV * u_matM;
+    // ModelView matrix (instance placed in the object)
+    mat4 matMV = u_matV * u_matM * a_instanceMat;
     // ModelViewProjection matrix
     mat4 matMVP = u_matP * matMV;
 
@@ -34,10 +49,12 @@ void main()
     vecN = normalize(mat3(matMV) * a_normal);
 
     // Calculate the view-space light direction
-    vec3 l_vecLight = mat3(u_matV) * u_lightPos;
+    vec3 l_vecLight = mat3(u_matV) * u_lightPos.xyz;
     vecL = normalize(l_vecLight - v_pos);
 
     vecV = -normalize(v_pos);
+
+    materialIndex = a_materialIndex;
     
     gl_Position = matMVP * a_position;
 }
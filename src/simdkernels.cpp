@@ -0,0 +1,605 @@
+/*********************************************************************************************************************
+ *
+ * simdkernels.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "simdkernels.h"
+#include "meshlayout.h"
+
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// Kernels for each instruction set live in the same translation unit: GCC/Clang need a per-function target,
+// MSVC accepts all intrinsics without it
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define SIMD_TARGET(_isa) __attribute__((target(_isa)))
+#else
+    #define SIMD_TARGET(_isa)
+#endif
+
+// Scalar tails must not be inlined in kernels whose target enables FMA (results would differ from the scalar path)
+#if defined(_MSC_VER)
+    #define SIMD_NOINLINE __declspec(noinline)
+#else
+    #define SIMD_NOINLINE __attribute__((noinline))
+#endif
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              CPU DETECTION                                                  |
+        +------------------------------------------------------------------------------------------------------------*/
+
+#ifdef SIMD_X86
+
+static void cpuid(int _info[4], int _leaf, int _subLeaf)
+{
+#if defined(_MSC_VER)
+    __cpuidex(_info, _leaf, _subLeaf);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(_leaf, _subLeaf, a, b, c, d);
+    _info[0] = (int)a; _info[1] = (int)b; _info[2] = (int)c; _info[3] = (int)d;
+#endif
+}
+
+
+/*
+ * Register state enabled by the OS (XCR0)
+ */
+static uint64_t getEnabledXState()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int a, d;
+    __asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return ((uint64_t)d << 32) | a;
+#endif
+}
+
+#endif // SIMD_X86
+
+
+static SimdISA detectSimdISA()
+{
+#ifdef SIMD_X86
+    int info[4];
+    cpuid(info, 0, 0);
+    int maxLeaf = info[0];
+
+    cpuid(info, 1, 0);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!sse42)
+        return SimdISA::SCALAR;
+
+    // AVX needs the OS to save YMM registers, AVX-512 also opmask and ZMM registers
+    uint64_t xstate = osxsave ? getEnabledXState() : 0;
+    bool ymmEnabled = (xstate & 0x6) == 0x6;
+    bool zmmEnabled = (xstate & 0xE6) == 0xE6;
+    if (!avx || !ymmEnabled || maxLeaf < 7)
+        return SimdISA::SSE42;
+
+    cpuid(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    if (!avx2)
+        return SimdISA::SSE42;
+    if (avx512f && zmmEnabled)
+        return SimdISA::AVX512;
+    return SimdISA::AVX2;
+#else
+    return SimdISA::SCALAR;
+#endif
+}
+
+
+static std::atomic<int> s_activeISA(-1);   // -1 = not initialized
+
+
+SimdISA getSupportedSimdISA()
+{
+    static const SimdISA supportedISA = detectSimdISA();
+    return supportedISA;
+}
+
+
+SimdISA getSimdISA()
+{
+    int isa = s_activeISA.load(std::memory_order_relaxed);
+    if (isa < 0)
+    {
+        isa = (int)getSupportedSimdISA();
+        s_activeISA.store(isa, std::memory_order_relaxed);
+    }
+    return (SimdISA)isa;
+}
+
+
+SimdISA setSimdISA(SimdISA _isa)
+{
+    SimdISA isa = (SimdISA)std::min((int)_isa, (int)getSupportedSimdISA());
+    s_activeISA.store((int)isa, std::memory_order_relaxed);
+    return isa;
+}
+
+
+const char* getSimdISAName(SimdISA _isa)
+{
+    switch (_isa)
+    {
+        case SimdISA::SSE42:  return "SSE4.2";
+        case SimdISA::AVX2:   return "AVX2";
+        case SimdISA::AVX512: return "AVX-512";
+        default:              return "scalar";
+    }
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                             SCALAR HELPERS                                                  |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+/*
+ * Fold the lanes of interleaved min/max registers (lane k holds component k % 3)
+ */
+[[maybe_unused]] static void foldAABBLanes(const float* _mins, const float* _maxs, int _nbFloats, glm::vec3& _min, glm::vec3& _max)
+{
+    for (int k = 0; k < _nbFloats; k++)
+    {
+        _min[k % 3] = std::min(_min[k % 3], _mins[k]);
+        _max[k % 3] = std::max(_max[k % 3], _maxs[k]);
+    }
+}
+
+
+/*
+ * Scalar AABB of vertices [_begin, _end), merged in _min / _max
+ */
+[[maybe_unused]] static void accumulateAABB(const float* _p, size_t _begin, size_t _end, glm::vec3& _min, glm::vec3& _max)
+{
+    for (size_t v = _begin; v < _end; v++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            _min[c] = std::min(_min[c], _p[3 * v + c]);
+            _max[c] = std::max(_max[c], _p[3 * v + c]);
+        }
+    }
+}
+
+
+/*
+ * Add the unnormalized face normals of triangles [_begin, _end) to their vertices (same operations as glm::cross)
+ */
+[[maybe_unused]] SIMD_NOINLINE static void accumulateFaceNormals(const float* _p, const uint32_t* _indices, size_t _begin, size_t _end, float* _n)
+{
+    for (size_t t = _begin; t < _end; t++)
+    {
+        const float* p0 = _p + 3 * (size_t)_indices[3 * t];
+        const float* p1 = _p + 3 * (size_t)_indices[3 * t + 1];
+        const float* p2 = _p + 3 * (size_t)_indices[3 * t + 2];
+        float e1x = p1[0] - p0[0], e1y = p1[1] - p0[1], e1z = p1[2] - p0[2];
+        float e2x = p2[0] - p0[0], e2y = p2[1] - p0[1], e2z = p2[2] - p0[2];
+        float cx = e1y * e2z - e2y * e1z;
+        float cy = e1z * e2x - e2z * e1x;
+        float cz = e1x * e2y - e2x * e1y;
+        for (int k = 0; k < 3; k++)
+        {
+            float* n = _n + 3 * (size_t)_indices[3 * t + k];
+            n[0] += cx;
+            n[1] += cy;
+            n[2] += cz;
+        }
+    }
+}
+
+
+/*
+ * Add a batch of precomputed face normals to their vertices, in triangle order
+ */
+[[maybe_unused]] static inline void scatterFaceNormals(const uint32_t* _triangles, int _count, const float* _fx, const float* _fy, const float* _fz, float* _n)
+{
+    for (int k = 0; k < _count; k++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float* n = _n + 3 * (size_t)_triangles[3 * k + c];
+            n[0] += _fx[k];
+            n[1] += _fy[k];
+            n[2] += _fz[k];
+        }
+    }
+}
+
+
+/*
+ * Normalize vertices [_begin, _end) (same operations as glm::normalize)
+ */
+[[maybe_unused]] SIMD_NOINLINE static void normalizeRange(float* _n, size_t _begin, size_t _end)
+{
+    for (size_t v = _begin; v < _end; v++)
+    {
+        float* n = _n + 3 * v;
+        float invLength = 1.0f / std::sqrt((n[0] * n[0] + n[1] * n[1]) + n[2] * n[2]);
+        n[0] *= invLength;
+        n[1] *= invLength;
+        n[2] *= invLength;
+    }
+}
+
+
+#ifdef SIMD_X86
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 SSE4.2                                                      |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// 4 vertices = 12 floats = 3 registers
+
+
+SIMD_TARGET("sse4.2")
+static void computeAABBSSE(const float* _p, size_t _n, glm::vec3& _min, glm::vec3& _max)
+{
+    float pattern[12];
+    for (int k = 0; k < 12; k++)
+        pattern[k] = _p[k % 3];
+    __m128 min0 = _mm_loadu_ps(pattern), min1 = _mm_loadu_ps(pattern + 4), min2 = _mm_loadu_ps(pattern + 8);
+    __m128 max0 = min0, max1 = min1, max2 = min2;
+
+    size_t v = 0;
+    for (; v + 4 <= _n; v += 4)
+    {
+        const float* p = _p + 3 * v;
+        __m128 r0 = _mm_loadu_ps(p), r1 = _mm_loadu_ps(p + 4), r2 = _mm_loadu_ps(p + 8);
+        min0 = _mm_min_ps(r0, min0); max0 = _mm_max_ps(r0, max0);
+        min1 = _mm_min_ps(r1, min1); max1 = _mm_max_ps(r1, max1);
+        min2 = _mm_min_ps(r2, min2); max2 = _mm_max_ps(r2, max2);
+    }
+
+    float mins[12], maxs[12];
+    _mm_storeu_ps(mins, min0); _mm_storeu_ps(mins + 4, min1); _mm_storeu_ps(mins + 8, min2);
+    _mm_storeu_ps(maxs, max0); _mm_storeu_ps(maxs + 4, max1); _mm_storeu_ps(maxs + 8, max2);
+    _min = _max = glm::vec3(_p[0], _p[1], _p[2]);
+    foldAABBLanes(mins, maxs, 12, _min, _max);
+    accumulateAABB(_p, v, _n, _min, _max);
+}
+
+
+SIMD_TARGET("sse4.2")
+static void accumulateFaceNormalsSSE(const float* _p, const uint32_t* _indices, size_t _nbTriangles, float* _n)
+{
+    alignas(16) float fx[4], fy[4], fz[4];
+    size_t t = 0;
+    for (; t + 4 <= _nbTriangles; t += 4)
+    {
+        const uint32_t* tri = _indices + 3 * t;
+        const float* p0[4] = { _p + 3 * (size_t)tri[0], _p + 3 * (size_t)tri[3], _p + 3 * (size_t)tri[6], _p + 3 * (size_t)tri[9] };
+        const float* p1[4] = { _p + 3 * (size_t)tri[1], _p + 3 * (size_t)tri[4], _p + 3 * (size_t)tri[7], _p + 3 * (size_t)tri[10] };
+        const float* p2[4] = { _p + 3 * (size_t)tri[2], _p + 3 * (size_t)tri[5], _p + 3 * (size_t)tri[8], _p + 3 * (size_t)tri[11] };
+
+        __m128 x0 = _mm_setr_ps(p0[0][0], p0[1][0], p0[2][0], p0[3][0]);
+        __m128 y0 = _mm_setr_ps(p0[0][1], p0[1][1], p0[2][1], p0[3][1]);
+        __m128 z0 = _mm_setr_ps(p0[0][2], p0[1][2], p0[2][2], p0[3][2]);
+        __m128 e1x = _mm_sub_ps(_mm_setr_ps(p1[0][0], p1[1][0], p1[2][0], p1[3][0]), x0);
+        __m128 e1y = _mm_sub_ps(_mm_setr_ps(p1[0][1], p1[1][1], p1[2][1], p1[3][1]), y0);
+        __m128 e1z = _mm_sub_ps(_mm_setr_ps(p1[0][2], p1[1][2], p1[2][2], p1[3][2]), z0);
+        __m128 e2x = _mm_sub_ps(_mm_setr_ps(p2[0][0], p2[1][0], p2[2][0], p2[3][0]), x0);
+        __m128 e2y = _mm_sub_ps(_mm_setr_ps(p2[0][1], p2[1][1], p2[2][1], p2[3][1]), y0);
+        __m128 e2z = _mm_sub_ps(_mm_setr_ps(p2[0][2], p2[1][2], p2[2][2], p2[3][2]), z0);
+
+        _mm_store_ps(fx, _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e2y, e1z)));
+        _mm_store_ps(fy, _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e2z, e1x)));
+        _mm_store_ps(fz, _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e2x, e1y)));
+        scatterFaceNormals(tri, 4, fx, fy, fz, _n);
+    }
+    accumulateFaceNormals(_p, _indices, t, _nbTriangles, _n);
+}
+
+
+SIMD_TARGET("sse4.2")
+static void normalizeSSE(float* _n, size_t _nbVertices)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t v = 0;
+    for (; v + 4 <= _nbVertices; v += 4)
+    {
+        // r0 = x0 y0 z0 x1, r1 = y1 z1 x2 y2, r2 = z2 x3 y3 z3
+        float* p = _n + 3 * v;
+        __m128 r0 = _mm_loadu_ps(p), r1 = _mm_loadu_ps(p + 4), r2 = _mm_loadu_ps(p + 8);
+
+        // transpose to x0..x3, y0..y3, z0..z3
+        __m128 x = _mm_blend_ps(_mm_blend_ps(r0, r1, 0x4), r2, 0x2);        // x0 x3 x2 x1
+        __m128 y = _mm_blend_ps(_mm_blend_ps(r0, r1, 0x9), r2, 0x4);        // y1 y0 y3 y2
+        __m128 z = _mm_blend_ps(_mm_blend_ps(r0, r1, 0x2), r2, 0x9);        // z2 z1 z0 z3
+        x = _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 2, 3, 0));
+        y = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 3, 0, 1));
+        z = _mm_shuffle_ps(z, z, _MM_SHUFFLE(3, 0, 1, 2));
+
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(dot));
+
+        // expand inverse lengths back to the interleaved layout
+        _mm_storeu_ps(p, _mm_mul_ps(r0, _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(1, 0, 0, 0))));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(r1, _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(2, 2, 1, 1))));
+        _mm_storeu_ps(p + 8, _mm_mul_ps(r2, _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(3, 3, 3, 2))));
+    }
+    normalizeRange(_n, v, _nbVertices);
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                  AVX2                                                       |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// 8 vertices = 24 floats = 3 registers, de-interleaving is done with gathers
+
+
+SIMD_TARGET("avx2")
+static void computeAABBAVX2(const float* _p, size_t _n, glm::vec3& _min, glm::vec3& _max)
+{
+    float pattern[24];
+    for (int k = 0; k < 24; k++)
+        pattern[k] = _p[k % 3];
+    __m256 min0 = _mm256_loadu_ps(pattern), min1 = _mm256_loadu_ps(pattern + 8), min2 = _mm256_loadu_ps(pattern + 16);
+    __m256 max0 = min0, max1 = min1, max2 = min2;
+
+    size_t v = 0;
+    for (; v + 8 <= _n; v += 8)
+    {
+        const float* p = _p + 3 * v;
+        __m256 r0 = _mm256_loadu_ps(p), r1 = _mm256_loadu_ps(p + 8), r2 = _mm256_loadu_ps(p + 16);
+        min0 = _mm256_min_ps(r0, min0); max0 = _mm256_max_ps(r0, max0);
+        min1 = _mm256_min_ps(r1, min1); max1 = _mm256_max_ps(r1, max1);
+        min2 = _mm256_min_ps(r2, min2); max2 = _mm256_max_ps(r2, max2);
+    }
+
+    float mins[24], maxs[24];
+    _mm256_storeu_ps(mins, min0); _mm256_storeu_ps(mins + 8, min1); _mm256_storeu_ps(mins + 16, min2);
+    _mm256_storeu_ps(maxs, max0); _mm256_storeu_ps(maxs + 8, max1); _mm256_storeu_ps(maxs + 16, max2);
+    _min = _max = glm::vec3(_p[0], _p[1], _p[2]);
+    foldAABBLanes(mins, maxs, 24, _min, _max);
+    accumulateAABB(_p, v, _n, _min, _max);
+}
+
+
+SIMD_TARGET("avx2")
+static void accumulateFaceNormalsAVX2(const float* _p, const uint32_t* _indices, size_t _nbTriangles, float* _n)
+{
+    const __m256i stride3 = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i three = _mm256_set1_epi32(3);
+    alignas(32) float fx[8], fy[8], fz[8];
+    size_t t = 0;
+    for (; t + 8 <= _nbTriangles; t += 8)
+    {
+        const uint32_t* tri = _indices + 3 * t;
+        __m256i o0 = _mm256_mullo_epi32(_mm256_i32gather_epi32((const int*)tri, stride3, 4), three);
+        __m256i o1 = _mm256_mullo_epi32(_mm256_i32gather_epi32((const int*)tri + 1, stride3, 4), three);
+        __m256i o2 = _mm256_mullo_epi32(_mm256_i32gather_epi32((const int*)tri + 2, stride3, 4), three);
+
+        __m256 x0 = _mm256_i32gather_ps(_p, o0, 4), y0 = _mm256_i32gather_ps(_p + 1, o0, 4), z0 = _mm256_i32gather_ps(_p + 2, o0, 4);
+        __m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(_p, o1, 4), x0);
+        __m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(_p + 1, o1, 4), y0);
+        __m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(_p + 2, o1, 4), z0);
+        __m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(_p, o2, 4), x0);
+        __m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(_p + 1, o2, 4), y0);
+        __m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(_p + 2, o2, 4), z0);
+
+        _mm256_store_ps(fx, _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e2y, e1z)));
+        _mm256_store_ps(fy, _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e2z, e1x)));
+        _mm256_store_ps(fz, _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e2x, e1y)));
+        scatterFaceNormals(tri, 8, fx, fy, fz, _n);
+    }
+    accumulateFaceNormals(_p, _indices, t, _nbTriangles, _n);
+}
+
+
+SIMD_TARGET("avx2")
+static void normalizeAVX2(float* _n, size_t _nbVertices)
+{
+    const __m256i stride3 = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i expand0 = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+    const __m256i expand1 = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+    const __m256i expand2 = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t v = 0;
+    for (; v + 8 <= _nbVertices; v += 8)
+    {
+        float* p = _n + 3 * v;
+        __m256 x = _mm256_i32gather_ps(p, stride3, 4), y = _mm256_i32gather_ps(p + 1, stride3, 4), z = _mm256_i32gather_ps(p + 2, stride3, 4);
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(dot));
+
+        // expand inverse lengths back to the interleaved layout
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), _mm256_permutevar8x32_ps(inv, expand0)));
+        _mm256_storeu_ps(p + 8, _mm256_mul_ps(_mm256_loadu_ps(p + 8), _mm256_permutevar8x32_ps(inv, expand1)));
+        _mm256_storeu_ps(p + 16, _mm256_mul_ps(_mm256_loadu_ps(p + 16), _mm256_permutevar8x32_ps(inv, expand2)));
+    }
+    normalizeRange(_n, v, _nbVertices);
+}
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                AVX-512                                                      |
+        +------------------------------------------------------------------------------------------------------------*/
+
+// 16 vertices = 48 floats = 3 registers
+// AVX-512 implies FMA: arithmetic uses the explicit rounding intrinsics, which the compiler never contracts into FMA
+
+#define EXACT_ROUNDING (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+
+SIMD_TARGET("avx512f")
+static void computeAABBAVX512(const float* _p, size_t _n, glm::vec3& _min, glm::vec3& _max)
+{
+    float pattern[48];
+    for (int k = 0; k < 48; k++)
+        pattern[k] = _p[k % 3];
+    __m512 min0 = _mm512_loadu_ps(pattern), min1 = _mm512_loadu_ps(pattern + 16), min2 = _mm512_loadu_ps(pattern + 32);
+    __m512 max0 = min0, max1 = min1, max2 = min2;
+
+    size_t v = 0;
+    for (; v + 16 <= _n; v += 16)
+    {
+        const float* p = _p + 3 * v;
+        __m512 r0 = _mm512_loadu_ps(p), r1 = _mm512_loadu_ps(p + 16), r2 = _mm512_loadu_ps(p + 32);
+        min0 = _mm512_min_ps(r0, min0); max0 = _mm512_max_ps(r0, max0);
+        min1 = _mm512_min_ps(r1, min1); max1 = _mm512_max_ps(r1, max1);
+        min2 = _mm512_min_ps(r2, min2); max2 = _mm512_max_ps(r2, max2);
+    }
+
+    float mins[48], maxs[48];
+    _mm512_storeu_ps(mins, min0); _mm512_storeu_ps(mins + 16, min1); _mm512_storeu_ps(mins + 32, min2);
+    _mm512_storeu_ps(maxs, max0); _mm512_storeu_ps(maxs + 16, max1); _mm512_storeu_ps(maxs + 32, max2);
+    _min = _max = glm::vec3(_p[0], _p[1], _p[2]);
+    foldAABBLanes(mins, maxs, 48, _min, _max);
+    accumulateAABB(_p, v, _n, _min, _max);
+}
+
+
+SIMD_TARGET("avx512f")
+static void accumulateFaceNormalsAVX512(const float* _p, const uint32_t* _indices, size_t _nbTriangles, float* _n)
+{
+    const __m512i stride3 = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    const __m512i three = _mm512_set1_epi32(3);
+    alignas(64) float fx[16], fy[16], fz[16];
+    size_t t = 0;
+    for (; t + 16 <= _nbTriangles; t += 16)
+    {
+        const uint32_t* tri = _indices + 3 * t;
+        __m512i o0 = _mm512_mullo_epi32(_mm512_i32gather_epi32(stride3, tri, 4), three);
+        __m512i o1 = _mm512_mullo_epi32(_mm512_i32gather_epi32(stride3, tri + 1, 4), three);
+        __m512i o2 = _mm512_mullo_epi32(_mm512_i32gather_epi32(stride3, tri + 2, 4), three);
+
+        __m512 x0 = _mm512_i32gather_ps(o0, _p, 4), y0 = _mm512_i32gather_ps(o0, _p + 1, 4), z0 = _mm512_i32gather_ps(o0, _p + 2, 4);
+        __m512 e1x = _mm512_sub_round_ps(_mm512_i32gather_ps(o1, _p, 4), x0, EXACT_ROUNDING);
+        __m512 e1y = _mm512_sub_round_ps(_mm512_i32gather_ps(o1, _p + 1, 4), y0, EXACT_ROUNDING);
+        __m512 e1z = _mm512_sub_round_ps(_mm512_i32gather_ps(o1, _p + 2, 4), z0, EXACT_ROUNDING);
+        __m512 e2x = _mm512_sub_round_ps(_mm512_i32gather_ps(o2, _p, 4), x0, EXACT_ROUNDING);
+        __m512 e2y = _mm512_sub_round_ps(_mm512_i32gather_ps(o2, _p + 1, 4), y0, EXACT_ROUNDING);
+        __m512 e2z = _mm512_sub_round_ps(_mm512_i32gather_ps(o2, _p + 2, 4), z0, EXACT_ROUNDING);
+
+        _mm512_store_ps(fx, _mm512_sub_round_ps(_mm512_mul_round_ps(e1y, e2z, EXACT_ROUNDING), _mm512_mul_round_ps(e2y, e1z, EXACT_ROUNDING), EXACT_ROUNDING));
+        _mm512_store_ps(fy, _mm512_sub_round_ps(_mm512_mul_round_ps(e1z, e2x, EXACT_ROUNDING), _mm512_mul_round_ps(e2z, e1x, EXACT_ROUNDING), EXACT_ROUNDING));
+        _mm512_store_ps(fz, _mm512_sub_round_ps(_mm512_mul_round_ps(e1x, e2y, EXACT_ROUNDING), _mm512_mul_round_ps(e2x, e1y, EXACT_ROUNDING), EXACT_ROUNDING));
+        scatterFaceNormals(tri, 16, fx, fy, fz, _n);
+    }
+    accumulateFaceNormals(_p, _indices, t, _nbTriangles, _n);
+}
+
+
+SIMD_TARGET("avx512f")
+static void normalizeAVX512(float* _n, size_t _nbVertices)
+{
+    const __m512i stride3 = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    const __m512i expand0 = _mm512_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m512i expand1 = _mm512_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m512i expand2 = _mm512_setr_epi32(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    size_t v = 0;
+    for (; v + 16 <= _nbVertices; v += 16)
+    {
+        float* p = _n + 3 * v;
+        __m512 x = _mm512_i32gather_ps(stride3, p, 4), y = _mm512_i32gather_ps(stride3, p + 1, 4), z = _mm512_i32gather_ps(stride3, p + 2, 4);
+        __m512 xx = _mm512_mul_round_ps(x, x, EXACT_ROUNDING);
+        __m512 yy = _mm512_mul_round_ps(y, y, EXACT_ROUNDING);
+        __m512 zz = _mm512_mul_round_ps(z, z, EXACT_ROUNDING);
+        __m512 dot = _mm512_add_round_ps(_mm512_add_round_ps(xx, yy, EXACT_ROUNDING), zz, EXACT_ROUNDING);
+        __m512 inv = _mm512_div_ps(one, _mm512_sqrt_ps(dot));
+
+        // expand inverse lengths back to the interleaved layout
+        _mm512_storeu_ps(p, _mm512_mul_round_ps(_mm512_loadu_ps(p), _mm512_permutexvar_ps(expand0, inv), EXACT_ROUNDING));
+        _mm512_storeu_ps(p + 16, _mm512_mul_round_ps(_mm512_loadu_ps(p + 16), _mm512_permutexvar_ps(expand1, inv), EXACT_ROUNDING));
+        _mm512_storeu_ps(p + 32, _mm512_mul_round_ps(_mm512_loadu_ps(p + 32), _mm512_permutexvar_ps(expand2, inv), EXACT_ROUNDING));
+    }
+    normalizeRange(_n, v, _nbVertices);
+}
+
+#undef EXACT_ROUNDING
+
+#endif // SIMD_X86
+
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                DISPATCH                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+
+void simdComputeAABB(std::span<const glm::vec3> _positions, glm::vec3& _min, glm::vec3& _max)
+{
+    const float* p = (const float*)_positions.data();
+    size_t n = _positions.size();
+    if (n == 0)
+        return;
+
+    switch (getSimdISA())
+    {
+#ifdef SIMD_X86
+        case SimdISA::AVX512: computeAABBAVX512(p, n, _min, _max); break;
+        case SimdISA::AVX2:   computeAABBAVX2(p, n, _min, _max); break;
+        case SimdISA::SSE42:  computeAABBSSE(p, n, _min, _max); break;
+#endif
+        default:              (void)p; ArrayLayout::computeAABB(_positions, _min, _max); break;
+    }
+}
+
+
+void simdComputeNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::span<glm::vec3> _normals)
+{
+    SimdISA isa = getSimdISA();
+    // gathers use 32-bit float offsets
+    if (isa > SimdISA::SSE42 && _positions.size() * 3 > (size_t)INT_MAX)
+        isa = SimdISA::SSE42;
+
+    if (isa == SimdISA::SCALAR)
+    {
+        ArrayLayout::computeNormals(_positions, _indices, _normals);
+        return;
+    }
+
+#ifdef SIMD_X86
+    const float* p = (const float*)_positions.data();
+    float* n = (float*)_normals.data();
+    size_t nbTriangles = _indices.size() / 3;
+    std::fill(_normals.begin(), _normals.end(), glm::vec3(0.0f));
+
+    switch (isa)
+    {
+        case SimdISA::AVX512:
+            accumulateFaceNormalsAVX512(p, _indices.data(), nbTriangles, n);
+            normalizeAVX512(n, _normals.size());
+            break;
+        case SimdISA::AVX2:
+            accumulateFaceNormalsAVX2(p, _indices.data(), nbTriangles, n);
+            normalizeAVX2(n, _normals.size());
+            break;
+        default:
+            accumulateFaceNormalsSSE(p, _indices.data(), nbTriangles, n);
+            normalizeSSE(n, _normals.size());
+            break;
+    }
+#endif
+}
@@ -0,0 +1,86 @@
+/*********************************************************************************************************************
+ *
+ * simdkernels.h
+ *
+ * SIMD mesh kernels (SSE4.2 / AVX2 / AVX-512) with runtime CPU dispatch and scalar fallback
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \enum SimdISA
+* \brief Instruction sets of the SIMD kernels, in increasing order
+*/
+enum class SimdISA
+{
+    SCALAR = 0,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+
+/*!
+* \fn getSupportedSimdISA
+* \brief get the best instruction set supported by the CPU and the OS (detected once)
+*/
+SimdISA getSupportedSimdISA();
+
+/*!
+* \fn getSimdISA
+* \brief get the instruction set used by the kernels (default: best supported one)
+*/
+SimdISA getSimdISA();
+
+/*!
+* \fn setSimdISA
+* \brief force the instruction set used by the kernels (e.g., for benchmarks), clamped to the supported one
+* \return instruction set actually used
+*/
+SimdISA setSimdISA(SimdISA _isa);
+
+/*!
+* \fn getSimdISAName
+* \brief get printable name of an instruction set
+*/
+const char* getSimdISAName(SimdISA _isa);
+
+
+/*!
+* \fn simdComputeAABB
+* \brief compute the bounding box of a non-empty array of points with vector min/max reductions
+* Result is identical to the scalar loop, except for the sign of zero when -0 and +0 are both extremal,
+* and when coords contain NaNs.
+* \param _positions : points (at least one)
+* \param _min : min corner
+* \param _max : max corner
+*/
+void simdComputeAABB(std::span<const glm::vec3> _positions, glm::vec3& _min, glm::vec3& _max);
+
+/*!
+* \fn simdComputeNormals
+* \brief compute vertex normals as the normalized sum of unnormalized face normals
+* Face normals are computed by batches of triangles and accumulated in triangle order, then normals are
+* normalized by batches of vertices. Operations are the same as glm::cross / glm::normalize in the same order,
+* so results are bit-identical to the scalar path, as long as the compiler does not contract a*b-c into FMA
+* (e.g., -march=native or -ffp-contract=fast with FMA enabled); in that case they differ by a few ulps.
+* \param _positions : vertices positions
+* \param _indices : triangles
+* \param _normals : vertices normals (same size as _positions)
+*/
+void simdComputeNormals(std::span<const glm::vec3> _positions, std::span<const uint32_t> _indices, std::span<glm::vec3> _normals);
+
+
+#endif // SIMDKERNELS_H
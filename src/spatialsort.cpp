@@ -0,0 +1,155 @@
+/*********************************************************************************************************************
+ *
+ * spatialsort.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "spatialsort.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+
+/*
+ * Insert 2 zero bits between each of the 10 lowest bits
+ */
+static uint32_t expandBits10(uint32_t _v)
+{
+    _v &= 0x3ff;
+    _v = (_v | (_v << 16)) & 0x030000ff;
+    _v = (_v | (_v << 8)) & 0x0300f00f;
+    _v = (_v | (_v << 4)) & 0x030c30c3;
+    _v = (_v | (_v << 2)) & 0x09249249;
+    return _v;
+}
+
+
+/*
+ * Insert 2 zero bits between each of the 21 lowest bits
+ */
+static uint64_t expandBits21(uint64_t _v)
+{
+    _v &= 0x1fffff;
+    _v = (_v | (_v << 32)) & 0x001f00000000ffffull;
+    _v = (_v | (_v << 16)) & 0x001f0000ff0000ffull;
+    _v = (_v | (_v << 8)) & 0x100f00f00f00f00full;
+    _v = (_v | (_v << 4)) & 0x10c30c30c30c30c3ull;
+    _v = (_v | (_v << 2)) & 0x1249249249249249ull;
+    return _v;
+}
+
+
+uint32_t mortonCode30(glm::vec3 _p)
+{
+    glm::uvec3 q = glm::uvec3(glm::clamp(_p, 0.0f, 1.0f) * 1023.0f);
+    return expandBits10(q.x) | (expandBits10(q.y) << 1) | (expandBits10(q.z) << 2);
+}
+
+
+uint64_t mortonCode63(glm::vec3 _p)
+{
+    // 21 bits exceed the float mantissa, quantize in double
+    glm::dvec3 q = glm::dvec3(glm::clamp(_p, 0.0f, 1.0f)) * 2097151.0;
+    return expandBits21((uint64_t)q.x) | (expandBits21((uint64_t)q.y) << 1) | (expandBits21((uint64_t)q.z) << 2);
+}
+
+
+template<typename Key>
+void computeMortonCodes(std::span<const glm::vec3> _points, glm::vec3 _bBoxMin, glm::vec3 _bBoxMax, unsigned _nbThreads, std::span<Key> _codes)
+{
+    // flat boxes (e.g., planar meshes) are mapped to 0 on their flat axes
+    glm::vec3 extent = _bBoxMax - _bBoxMin;
+    glm::vec3 scale(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    parallelFor(0, _points.size(), _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t i = _first; i < _last; i++)
+        {
+            glm::vec3 p = (_points[i] - _bBoxMin) * scale;
+            if constexpr (sizeof(Key) == 4)
+                _codes[i] = mortonCode30(p);
+            else
+                _codes[i] = mortonCode63(p);
+        }
+    });
+}
+
+
+template<typename Key>
+void radixSort(std::vector<Key>& _keys, std::vector<uint32_t>& _values, unsigned _nbThreads)
+{
+    const size_t n = _keys.size();
+    if (n < 2)
+        return;
+    const unsigned nbBlocks = (unsigned)std::min<size_t>(getNbThreads(_nbThreads), std::max<size_t>(n / 65536, 1));
+
+    // Bits that differ between keys (passes on other digits would not move anything)
+    std::vector<Key> blockBits(nbBlocks, 0);
+    parallelFor(0, n, nbBlocks, [&](size_t _first, size_t _last, unsigned _block)
+    {
+        Key bits = 0;
+        for (size_t i = _first; i < _last; i++)
+            bits |= _keys[i] ^ _keys[0];
+        blockBits[_block] = bits;
+    });
+    Key varyingBits = 0;
+    for (Key bits : blockBits)
+        varyingBits |= bits;
+
+    std::vector<Key> tmpKeys(n);
+    std::vector<uint32_t> tmpValues(n);
+    std::vector<size_t> offsets(nbBlocks * 256);     // [block * 256 + digit]
+
+    for (unsigned shift = 0; shift < sizeof(Key) * 8; shift += 8)
+    {
+        if (((varyingBits >> shift) & 0xff) == 0)
+            continue;
+
+        // Histogram of each block
+        const Key* keys = _keys.data();
+        const uint32_t* values = _values.data();
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallelFor(0, n, nbBlocks, [&](size_t _first, size_t _last, unsigned _block)
+        {
+            size_t* histogram = offsets.data() + _block * 256;
+            for (size_t i = _first; i < _last; i++)
+                histogram[(keys[i] >> shift) & 0xff]++;
+        });
+
+        // Output position of each (digit, block): digits in order, then blocks in order (stable)
+        size_t position = 0;
+        for (unsigned digit = 0; digit < 256; digit++)
+        {
+            for (unsigned block = 0; block < nbBlocks; block++)
+            {
+                size_t count = offsets[block * 256 + digit];
+                offsets[block * 256 + digit] = position;
+                position += count;
+            }
+        }
+
+        Key* dstKeys = tmpKeys.data();
+        uint32_t* dstValues = tmpValues.data();
+        parallelFor(0, n, nbBlocks, [&](size_t _first, size_t _last, unsigned _block)
+        {
+            size_t* cursors = offsets.data() + _block * 256;
+            for (size_t i = _first; i < _last; i++)
+            {
+                size_t dst = cursors[(keys[i] >> shift) & 0xff]++;
+                dstKeys[dst] = keys[i];
+                dstValues[dst] = values[i];
+            }
+        });
+        _keys.swap(tmpKeys);
+        _values.swap(tmpValues);
+    }
+}
+
+
+template void computeMortonCodes<uint32_t>(std::span<const glm::vec3>, glm::vec3, glm::vec3, unsigned, std::span<uint32_t>);
+template void computeMortonCodes<uint64_t>(std::span<const glm::vec3>, glm::vec3, glm::vec3, unsigned, std::span<uint64_t>);
+template void radixSort<uint32_t>(std::vector<uint32_t>&, std::vector<uint32_t>&, unsigned);
+template void radixSort<uint64_t>(std::vector<uint64_t>&, std::vector<uint32_t>&, unsigned);
@@ -0,0 +1,62 @@
+/*********************************************************************************************************************
+ *
+ * spatialsort.h
+ *
+ * Morton codes and parallel radix sort, to store vertices and triangles along a Z-order curve
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef SPATIALSORT_H
+#define SPATIALSORT_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \fn mortonCode30
+* \brief interleave the bits of 3 coords quantized on 10 bits (x in the lowest bit)
+* \param _p : point in [0,1]^3 (clamped)
+*/
+uint32_t mortonCode30(glm::vec3 _p);
+
+/*!
+* \fn mortonCode63
+* \brief interleave the bits of 3 coords quantized on 21 bits (x in the lowest bit)
+* \param _p : point in [0,1]^3 (clamped)
+*/
+uint64_t mortonCode63(glm::vec3 _p);
+
+/*!
+* \fn computeMortonCodes
+* \brief compute the Morton codes of points relative to a bounding box (30-bit codes for uint32_t, 63-bit for uint64_t)
+* \param _points : points
+* \param _bBoxMin : min corner of the bounding box
+* \param _bBoxMax : max corner of the bounding box
+* \param _nbThreads : number of threads (0 = all hardware threads)
+* \param _codes : resulting codes (same size as _points)
+*/
+template<typename Key>
+void computeMortonCodes(std::span<const glm::vec3> _points, glm::vec3 _bBoxMin, glm::vec3 _bBoxMax, unsigned _nbThreads, std::span<Key> _codes);
+
+/*!
+* \fn radixSort
+* \brief stable LSD radix sort of keys (uint32_t or uint64_t) and their values, 8 bits per pass.
+* Each pass builds per-thread histograms and scatters blocks in parallel; passes on digits shared by all
+* keys are skipped. Result does not depend on the number of threads.
+* \param _keys : keys to sort
+* \param _values : values moved along with the keys (same size as _keys, e.g., original positions)
+* \param _nbThreads : number of threads (0 = all hardware threads)
+*/
+template<typename Key>
+void radixSort(std::vector<Key>& _keys, std::vector<uint32_t>& _values, unsigned _nbThreads);
+
+
+#endif // SPATIALSORT_H
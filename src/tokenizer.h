@@ -0,0 +1,135 @@
+/*********************************************************************************************************************
+ *
+ * tokenizer.h
+ *
+ * Allocation-free helpers to parse ASCII mesh files directly from a raw byte buffer
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+
+/*!
+* \fn isBlank
+* \brief check if a character is a space or a tab
+*/
+inline bool isBlank(char _c) { return _c == ' ' || _c == '\t'; }
+
+
+/*!
+* \fn skipBlanks
+* \brief move cursor to the first non-blank character (stops at end of line)
+* \param _ptr : current position in buffer
+* \param _end : end of buffer
+* \return new position in buffer
+*/
+inline const char* skipBlanks(const char* _ptr, const char* _end)
+{
+    while (_ptr < _end && isBlank(*_ptr))
+        ++_ptr;
+    return _ptr;
+}
+
+
+/*!
+* \fn skipLine
+* \brief move cursor to the beginning of next line
+* \param _ptr : current position in buffer
+* \param _end : end of buffer
+* \return new position in buffer
+*/
+inline const char* skipLine(const char* _ptr, const char* _end)
+{
+    const char* eol = (const char*)std::memchr(_ptr, '\n', _end - _ptr);
+    return eol ? eol + 1 : _end;
+}
+
+
+/*!
+* \fn skipToken
+* \brief move cursor after the current whitespace-separated token
+* \param _ptr : current position in buffer
+* \param _end : end of buffer
+* \return new position in buffer
+*/
+inline const char* skipToken(const char* _ptr, const char* _end)
+{
+    while (_ptr < _end && !isBlank(*_ptr) && *_ptr != '\n' && *_ptr != '\r')
+        ++_ptr;
+    return _ptr;
+}
+
+
+/*!
+* \fn matchKeyword
+* \brief check if the buffer starts with a given keyword followed by a blank
+* \param _ptr : current position in buffer
+* \param _end : end of buffer
+* \param _keyword : null-terminated keyword (e.g. "vn")
+* \return true if keyword matches
+*/
+inline bool matchKeyword(const char* _ptr, const char* _end, const char* _keyword)
+{
+    while (*_keyword)
+    {
+        if (_ptr >= _end || *_ptr != *_keyword)
+            return false;
+        ++_ptr;
+        ++_keyword;
+    }
+    return _ptr < _end && isBlank(*_ptr);
+}
+
+
+/*!
+* \fn parseFloat
+* \brief parse a float after optional blanks
+* \param _ptr : current position in buffer (updated after the number on success)
+* \param _end : end of buffer
+* \param _value : parsed value
+* \return false if no number could be parsed
+*/
+inline bool parseFloat(const char*& _ptr, const char* _end, float& _value)
+{
+    const char* p = skipBlanks(_ptr, _end);
+    // from_chars does not accept an explicit '+' sign
+    if (p < _end && *p == '+')
+        ++p;
+    std::from_chars_result res = std::from_chars(p, _end, _value);
+    if (res.ec != std::errc())
+        return false;
+    _ptr = res.ptr;
+    return true;
+}
+
+
+/*!
+* \fn parseInt
+* \brief parse a signed integer after optional blanks
+* \param _ptr : current position in buffer (updated after the number on success)
+* \param _end : end of buffer
+* \param _value : parsed value
+* \return false if no number could be parsed
+*/
+inline bool parseInt(const char*& _ptr, const char* _end, int64_t& _value)
+{
+    const char* p = skipBlanks(_ptr, _end);
+    if (p < _end && *p == '+')
+        ++p;
+    std::from_chars_result res = std::from_chars(p, _end, _value);
+    if (res.ec != std::errc())
+        return false;
+    _ptr = res.ptr;
+    return true;
+}
+
+
+#endif // TOKENIZER_H
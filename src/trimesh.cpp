@@ -10,171 +10,1578 @@
 #include "trimesh.h"
 
 #include "GLtools.h"
+#include "tokenizer.h"
+#include "flathashmap.h"
+#include "parallel.h"
+#include "mappedfile.h"
+#include "meshcache.h"
+#include "simdkernels.h"
+#include "meshnormals.h"
+#include "vertexcache.h"
+#include "spatialsort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <cfloat>
 
 
 TriMesh::TriMesh()
-    : m_bBoxMin(0.0f, 0.0f, 0.0f),
-      m_bBoxMax(0.0f, 0.0f, 0.0f)
+    : m_mappedArrays(0),
+      m_bBoxMin(0.0f, 0.0f, 0.0f),
+      m_bBoxMax(0.0f, 0.0f, 0.0f),
+      m_legacyOBJParser(false),
+      m_useCache(false),
+      m_optimizeVertexCache(false)
 { }
 
 
 
-TriMesh::~TriMesh()
-{
+TriMesh::~TriMesh()
+{
+    clear();
+}
+
+
+void TriMesh::getVertices(std::vector<glm::vec3>& _vertices)
+{
+    if(_vertices.size() != 0)
+        _vertices.clear();
+
+    if(getVertexView().size() != 0)
+    {
+        _vertices.assign(getVertexView().begin(), getVertexView().end());
+    }
+    else
+    {
+        warningLog() << "TriMesh::getVertices(): Empty vertices array";
+    }
+}
+
+
+void TriMesh::getNormals(std::vector<glm::vec3>& _normals)
+{
+    if(_normals.size() != 0)
+        _normals.clear();
+
+    if(getNormalView().size() != 0)
+    {
+        _normals.assign(getNormalView().begin(), getNormalView().end());
+    }
+    else
+    {
+        warningLog() << "TriMesh::getNormals(): Empty normals array";
+    }
+}
+
+
+void TriMesh::getIndices(std::vector<uint32_t>& _indices)
+{
+    if(_indices.size() != 0)
+        _indices.clear();
+
+    if(getIndexView().size() != 0)
+    {
+        _indices.assign(getIndexView().begin(), getIndexView().end());
+    }
+    else
+    {
+        warningLog() << "TriMesh::getIndices(): Empty indices array";
+    }
+}
+
+
+void TriMesh::getColors(std::vector<glm::vec3>& _colors)
+{
+    if(_colors.size() != 0)
+        _colors.clear();
+
+    if(getColorView().size() != 0)
+    {
+        _colors.assign(getColorView().begin(), getColorView().end());
+    }
+}
+
+
+void TriMesh::getTexCoords(std::vector<glm::vec2>& _texcoords)
+{
+    if(_texcoords.size() != 0)
+        _texcoords.clear();
+
+    if(getTexCoordView().size() != 0)
+    {
+        _texcoords.assign(getTexCoordView().begin(), getTexCoordView().end());
+    }
+}
+
+
+bool TriMesh::readFile(std::string _filename, unsigned _nbThreads)
+{
+    clear();
+
+    // Try to reload the mesh from its binary cache (size and write time of the source are checked before its content)
+    std::string cacheFilename = _filename + ".meshcache";
+    uint64_t sourceSize = 0, sourceTime = 0;
+    bool hasSource = MeshCache::statFile(_filename, sourceSize, sourceTime);
+    if (m_useCache && hasSource && readCache(cacheFilename, _filename, sourceSize, sourceTime))
+        return true;
+
+    std::string extension = _filename.substr(_filename.find_last_of(".") + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c) { return (char)std::tolower(_c); });
+
+    bool success = false;
+    if(extension == "obj")
+    {
+        if (m_legacyOBJParser)
+            success = importOBJLegacy(_filename);
+        else if (getNbThreads(_nbThreads) > 1)
+            success = importOBJParallel(_filename, _nbThreads);
+        else
+            success = importOBJ(_filename);
+    }
+    else if(extension == "stl")
+    {
+        success = importSTL(_filename);
+    }
+    else if(extension == "ply")
+    {
+        success = importPLY(_filename);
+    }
+    else if(extension == "cmesh")
+    {
+        success = importCompressed(_filename);
+    }
+    else
+    {
+        errorLog() << "TriMesh::readFile(): Invalid file extension: only .obj, .stl, .ply and .cmesh are supported";
+    }
+
+    if (success && m_optimizeVertexCache)
+    {
+        optimizeVertexCache();
+        optimizeVertexFetch();
+    }
+
+    // (Re)build the binary cache
+    if (success && m_useCache && hasSource && sourceSize != 0)
+    {
+        computeAABB();
+        writeCache(cacheFilename, _filename, sourceSize, sourceTime);
+    }
+    return success;
+}
+
+
+bool TriMesh::readCache(const std::string& _cacheFilename, const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime)
+{
+    clear();
+
+    std::shared_ptr<MeshCache> cache = std::make_shared<MeshCache>();
+    if (!cache->open(_cacheFilename))
+        return false;
+    if (!cache->isValidFor(_sourceFilename, _sourceSize, _sourceTime))
+    {
+        infoLog() << "TriMesh::readCache(): " << _cacheFilename << " is outdated";
+        return false;
+    }
+    if (m_optimizeVertexCache && !(cache->getHeader().flags & MeshCache::VERTEX_CACHE_OPTIMIZED))
+    {
+        infoLog() << "TriMesh::readCache(): " << _cacheFilename << " is not optimized for the vertex cache";
+        return false;
+    }
+
+    // arrays are read from the mapped file (zero-copy) until they are modified, see detachCache()
+    const MeshCacheHeader& header = cache->getHeader();
+    m_cache = cache;
+    m_mappedArrays = ALL_ARRAYS;
+    m_bBoxMin = glm::vec3(header.bBoxMin[0], header.bBoxMin[1], header.bBoxMin[2]);
+    m_bBoxMax = glm::vec3(header.bBoxMax[0], header.bBoxMax[1], header.bBoxMax[2]);
+
+    infoLog() << "TriMesh::readCache(): mesh loaded from " << _cacheFilename;
+    return true;
+}
+
+
+bool TriMesh::writeCache(const std::string& _cacheFilename, const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime)
+{
+    MeshCacheHeader header = {};
+    uint64_t hashedSize = 0;
+    if (!MeshCache::hashFile(_sourceFilename, header.sourceHash, hashedSize) || hashedSize != _sourceSize)
+    {
+        warningLog() << "TriMesh::writeCache(): " << _sourceFilename << " changed while loading, no cache written";
+        return false;
+    }
+    header.sourceSize = _sourceSize;
+    header.sourceTime = _sourceTime;
+    header.nbVertices = getVertexView().size();
+    header.nbNormals = getNormalView().size();
+    header.nbTexcoords = getTexCoordView().size();
+    header.nbColors = getColorView().size();
+    header.nbIndices = getIndexView().size();
+    header.flags = m_optimizeVertexCache ? MeshCache::VERTEX_CACHE_OPTIMIZED : 0;
+    for (int i = 0; i < 3; i++)
+    {
+        header.bBoxMin[i] = m_bBoxMin[i];
+        header.bBoxMax[i] = m_bBoxMax[i];
+    }
+
+    if (!MeshCache::write(_cacheFilename, header, getVertexView().data(), getNormalView().data(), getTexCoordView().data(), getColorView().data(),
+                          getIndexView().data()))
+    {
+        warningLog() << "TriMesh::writeCache(): Could not write " << _cacheFilename;
+        return false;
+    }
+    return true;
+}
+
+
+
+void TriMesh::computeAABB()
+{
+    if(getVertexView().size() != 0)
+    {
+        simdComputeAABB(getVertexView(), m_bBoxMin, m_bBoxMax);
+    }
+    else
+    {
+        warningLog() << "TriMesh::computeAABB(): Empty vertices array";
+        m_bBoxMin = glm::vec3(0.0f, 0.0f, 0.0f);
+        m_bBoxMax = glm::vec3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+
+void TriMesh::computeNormals(NormalWeighting _weighting, unsigned _nbThreads)
+{
+    unmapArrays(NORMAL_ARRAY);
+    m_normals.resize(getVertexView().size());
+
+    // Sequential area weighting: scatter face normals in triangle order (same sums as the parallel gather)
+    if (_weighting == NormalWeighting::AREA && getNbThreads(_nbThreads) == 1)
+        simdComputeNormals(getVertexView(), getIndexView(), m_normals);
+    else
+        computeVertexNormals(getVertexView(), getIndexView(), _weighting, _nbThreads, m_normals);
+}
+
+
+void TriMesh::optimizeVertexCache(unsigned _cacheSize)
+{
+    size_t nbVertices = getVertexView().size();
+    VertexCacheStats before = simulateVertexCache(getIndexView(), nbVertices, _cacheSize, VertexCacheModel::FIFO);
+
+    std::vector<uint32_t> indices(getIndexView().size());
+    ::optimizeVertexCache(getIndexView(), nbVertices, _cacheSize, indices);
+    unmapArrays(INDEX_ARRAY);
+    m_indices.swap(indices);
+    m_meshlets.clear();
+
+    VertexCacheStats after = simulateVertexCache(m_indices, nbVertices, _cacheSize, VertexCacheModel::FIFO);
+    infoLog() << "TriMesh::optimizeVertexCache(): ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << " (FIFO " << _cacheSize << ")";
+}
+
+
+void TriMesh::optimizeVertexFetch()
+{
+    detachCache();
+    std::vector<uint32_t> remap;
+    computeVertexFetchRemap(m_indices, m_vertices.size(), remap);
+
+    for (uint32_t& index : m_indices)
+        index = remap[index];
+    for (MeshLOD& lod : m_lods)
+    {
+        for (uint32_t& index : lod.indices)
+            index = remap[index];
+    }
+    remapVertexArray(m_vertices, remap);
+    remapVertexArray(m_normals, remap);
+    remapVertexArray(m_texcoords, remap);
+    remapVertexArray(m_colors, remap);
+}
+
+
+/*
+ * Order of points along the Z-order curve of a bounding box
+ */
+template<typename Key>
+static void computeMortonOrder(std::span<const glm::vec3> _points, glm::vec3 _bBoxMin, glm::vec3 _bBoxMax, unsigned _nbThreads, std::vector<uint32_t>& _order)
+{
+    std::vector<Key> codes(_points.size());
+    computeMortonCodes<Key>(_points, _bBoxMin, _bBoxMax, _nbThreads, codes);
+    _order.resize(_points.size());
+    for (size_t i = 0; i < _order.size(); i++)
+        _order[i] = (uint32_t)i;
+    radixSort(codes, _order, _nbThreads);
+}
+
+
+void TriMesh::sortSpatially(unsigned _mortonBits, unsigned _nbThreads)
+{
+    detachCache();
+    if (m_vertices.empty())
+        return;
+    computeAABB();
+    auto computeOrder = [&](std::span<const glm::vec3> _points, std::vector<uint32_t>& _order)
+    {
+        if (_mortonBits > 30)
+            computeMortonOrder<uint64_t>(_points, m_bBoxMin, m_bBoxMax, _nbThreads, _order);
+        else
+            computeMortonOrder<uint32_t>(_points, m_bBoxMin, m_bBoxMax, _nbThreads, _order);
+    };
+
+    // Vertices
+    std::vector<uint32_t> order, remap(m_vertices.size());
+    computeOrder(m_vertices, order);
+    for (size_t i = 0; i < order.size(); i++)
+        remap[order[i]] = (uint32_t)i;
+    remapVertexArray(m_vertices, remap);
+    remapVertexArray(m_normals, remap);
+    remapVertexArray(m_texcoords, remap);
+    remapVertexArray(m_colors, remap);
+    for (MeshLOD& lod : m_lods)
+    {
+        for (uint32_t& index : lod.indices)
+            index = remap[index];
+    }
+
+    // Triangles (by centroid), with remapped indices
+    size_t nbTriangles = m_indices.size() / 3;
+    std::vector<glm::vec3> centroids(nbTriangles);
+    parallelFor(0, nbTriangles, _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t t = _first; t < _last; t++)
+        {
+            for (int k = 0; k < 3; k++)
+                m_indices[3 * t + k] = remap[m_indices[3 * t + k]];
+            centroids[t] = (m_vertices[m_indices[3 * t]] + m_vertices[m_indices[3 * t + 1]] + m_vertices[m_indices[3 * t + 2]]) / 3.0f;
+        }
+    });
+    computeOrder(centroids, order);
+
+    std::vector<uint32_t> indices(m_indices.size());
+    parallelFor(0, nbTriangles, _nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t t = _first; t < _last; t++)
+            std::copy_n(m_indices.begin() + 3 * (size_t)order[t], 3, indices.begin() + 3 * t);
+    });
+    std::copy(m_indices.begin() + 3 * nbTriangles, m_indices.end(), indices.begin() + 3 * nbTriangles);
+    m_indices.swap(indices);
+    m_meshlets.clear();
+}
+
+
+bool TriMesh::generateLODs(const std::vector<float>& _ratios, float _maxError, unsigned _nbThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    MeshSimplifier simplifier;
+    simplifier.setVertices(getVertexView(), _nbThreads);
+    if (!simplifier.generateLODs(getIndexView(), _ratios, _maxError, m_lods, [this](float _progress) { return reportProgress(_progress); }))
+    {
+        infoLog() << "TriMesh::generateLODs(): cancelled";
+        return false;
+    }
+
+    // same post-transform cache locality as the full-detail mesh
+    for (MeshLOD& lod : m_lods)
+    {
+        std::vector<uint32_t> indices(lod.indices.size());
+        ::optimizeVertexCache(lod.indices, getVertexView().size(), 16, indices);
+        lod.indices.swap(indices);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    infoLog() << "TriMesh::generateLODs(): " << m_lods.size() << " levels generated in " << seconds * 1000.0 << " ms";
+    for (size_t level = 1; level < getNbLODs(); level++)
+    {
+        infoLog() << "    LOD " << level << ": " << getLODIndexView(level).size() / 3 << " triangles, error "
+                  << getLODError(level) << " (" << getLODError(level) / std::max(simplifier.getExtent(), FLT_MIN) * 100.0f << "% of AABB diagonal)";
+    }
+    return true;
+}
+
+
+bool TriMesh::buildMeshlets(unsigned _maxVertices, unsigned _maxTriangles, unsigned _nbThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> indices;
+    if (!::buildMeshlets(getVertexView(), getIndexView(), _maxVertices, _maxTriangles, _nbThreads, indices, m_meshlets,
+                         [this](float _progress) { return reportProgress(_progress); }))
+    {
+        infoLog() << "TriMesh::buildMeshlets(): cancelled";
+        return false;
+    }
+    ::optimizeMeshletVertexCache(indices, m_meshlets, getVertexView().size(), 16, _nbThreads);
+    unmapArrays(INDEX_ARRAY);
+    m_indices.swap(indices);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    MeshletStats stats = computeMeshletStats(getVertexView(), m_indices, m_meshlets);
+    VertexCacheStats cache = simulateVertexCache(m_indices, getVertexView().size(), 16, VertexCacheModel::FIFO);
+    infoLog() << "TriMesh::buildMeshlets(): " << stats.nbMeshlets << " meshlets built in " << seconds * 1000.0 << " ms, "
+              << stats.avgVertices << " vertices / " << stats.avgTriangles << " triangles on average ("
+              << stats.verticesPerTriangle << " vertices per triangle), ACMR " << cache.acmr;
+    return true;
+}
+
+
+static const size_t PROGRESS_STEP = 1 << 20;   // number of bytes read between two progress reports
+
+
+/*
+ * Log the throughput of a mesh import (MB/s and triangles/s).
+ */
+static void logImportStats(const char* _funcName, size_t _nbBytes, size_t _nbTriangles, std::chrono::steady_clock::time_point _startTime)
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+    double megaBytes = (double)_nbBytes / (1024.0 * 1024.0);
+    seconds = std::max(seconds, 1e-9);
+    infoLog() << _funcName << ": " << megaBytes << " MB, " << _nbTriangles << " triangles read in " << seconds * 1000.0 << " ms ("
+              << megaBytes / seconds << " MB/s, " << (double)_nbTriangles / seconds << " triangles/s)";
+}
+
+
+/*
+ * Parse one face corner ("v", "v/t", "v//n" or "v/t/n") of an OBJ face line.
+ * Indices are returned as read in the file (1-based, negative if relative), 0 if absent.
+ */
+static bool parseOBJCorner(const char*& _ptr, const char* _end, int64_t& _v, int64_t& _t, int64_t& _n)
+{
+    _t = 0;
+    _n = 0;
+    if (!parseInt(_ptr, _end, _v))
+        return false;
+
+    if (_ptr < _end && *_ptr == '/')
+    {
+        ++_ptr;
+        if (_ptr < _end && *_ptr != '/')
+        {
+            if (!parseInt(_ptr, _end, _t))
+                return false;
+        }
+        if (_ptr < _end && *_ptr == '/')
+        {
+            ++_ptr;
+            if (!parseInt(_ptr, _end, _n))
+                return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Convert an OBJ index (1-based, or negative for relative indexing) into a 1-based absolute index.
+ * Returns 0 if the index is absent or out of range.
+ */
+static uint32_t resolveOBJIndex(int64_t _index, size_t _count)
+{
+    if (_index > 0)
+        return (_index <= (int64_t)_count) ? (uint32_t)_index : 0;
+    if (_index < 0)
+        return (-_index <= (int64_t)_count) ? (uint32_t)((int64_t)_count + _index + 1) : 0;
+    return 0;
+}
+
+
+/*
+ * Parse all the corners of an OBJ face line and resolve them into 1-based absolute (v, vt, vn) tuples (0 if absent).
+ * Returns false if the face has less than 3 corners or references undefined attributes.
+ */
+static bool parseOBJFace(const char*& _ptr, const char* _end, size_t _nbVertices, size_t _nbTexcoords, size_t _nbNormals, std::vector<glm::uvec3>& _corners)
+{
+    _corners.clear();
+    int64_t v, t, n;
+    while (parseOBJCorner(_ptr, _end, v, t, n))
+    {
+        glm::uvec3 key(resolveOBJIndex(v, _nbVertices), resolveOBJIndex(t, _nbTexcoords), resolveOBJIndex(n, _nbNormals));
+        if (key.x == 0 || (t != 0 && key.y == 0) || (n != 0 && key.z == 0))
+            return false;
+        _corners.push_back(key);
+    }
+    return _corners.size() >= 3;
+}
+
+
+/*
+ * Parse the _nbCoords coordinates of an OBJ attribute line ("v", "vt" or "vn").
+ * Returns false if a coordinate cannot be read: all the coordinates are then set to 0, so that the attribute keeps its
+ * index (faces reference attributes by position in the file) and both OBJ importers read the same mesh.
+ */
+static bool parseOBJAttribute(const char*& _ptr, const char* _end, float* _coords, int _nbCoords)
+{
+    for (int i = 0; i < _nbCoords; i++)
+    {
+        if (!parseFloat(_ptr, _end, _coords[i]))
+        {
+            std::fill(_coords, _coords + _nbCoords, 0.0f);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Read an Mesh from an .obj file. This function can read texture
+ * coordinates and/or normals, in addition to vertex positions.
+ * The file is memory-mapped and parsed in one pass, without per-line allocation.
+ * Polygonal faces are fan-triangulated.
+ */
+bool TriMesh::importOBJ(const std::string& _filename)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Map the whole OBJ file in memory
+    MappedFile file;
+    if (!file.open(_filename))
+    {
+        errorLog() << "TriMesh::importOBJ(): Could not open " << _filename;
+        return false;
+    }
+    size_t fileSize = file.size();
+
+    const char* ptr = file.data();
+    const char* end = ptr + fileSize;
+
+    // Vertex data as listed in the file
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+
+    // Clear old mesh (including its levels of detail and meshlets)
+    clear();
+
+    // Set up dictionary for mapping unique tuples to indices
+    FlatHashMap<glm::uvec3, UVec3Hash> visited;
+    std::vector<glm::uvec3> corners;
+    size_t nbInvalidFaces = 0, nbInvalidAttributes = 0;
+
+    // Single pass: OBJ attributes are always defined before being referenced by a face,
+    // so faces can be welded as soon as they are read
+    const char* nextProgress = ptr;
+    while (ptr < end)
+    {
+        if (ptr >= nextProgress)
+        {
+            if (!reportProgress((float)(ptr - file.data()) / (float)fileSize))
+                return cancelImport("TriMesh::importOBJ()");
+            nextProgress = ptr + PROGRESS_STEP;
+        }
+
+        ptr = skipBlanks(ptr, end);
+
+        if (matchKeyword(ptr, end, "v")) 
+        {
+            ptr += 1;
+            glm::vec3 vertex;
+            if (!parseOBJAttribute(ptr, end, &vertex[0], 3))
+                nbInvalidAttributes++;
+            vertices.push_back(vertex);
+        }
+        else if (matchKeyword(ptr, end, "vt")) 
+        {
+            ptr += 2;
+            glm::vec2 texcoord;
+            if (!parseOBJAttribute(ptr, end, &texcoord[0], 2))
+                nbInvalidAttributes++;
+            texcoords.push_back(texcoord);
+        }
+        else if (matchKeyword(ptr, end, "vn")) 
+        {
+            ptr += 2;
+            glm::vec3 normal;
+            if (!parseOBJAttribute(ptr, end, &normal[0], 3))
+                nbInvalidAttributes++;
+            normals.push_back(normal);
+        }
+        else if (matchKeyword(ptr, end, "f")) 
+        {
+            ptr += 1;
+            if (visited.size() == 0)
+            {
+                // attributes usually all precede the faces: pre-size the welding table and arrays from their counts
+                size_t expectedSize = std::max(vertices.size(), std::max(texcoords.size(), normals.size()));
+                visited.reserve(expectedSize);
+                m_vertices.reserve(expectedSize);
+                m_texcoords.reserve(texcoords.empty() ? 0 : expectedSize);
+                m_normals.reserve(normals.empty() ? 0 : expectedSize);
+            }
+
+            // Note: OBJ-indices start at one, so we need to subtract indices by one.
+            if (!parseOBJFace(ptr, end, vertices.size(), texcoords.size(), normals.size(), corners))
+            {
+                // drop incomplete or invalid face
+                nbInvalidFaces++;
+            }
+            else
+            {
+                uint32_t firstIndex = 0, prevIndex = 0;
+                for (size_t c = 0; c < corners.size(); c++)
+                {
+                    const glm::uvec3& key = corners[c];
+                    std::pair<uint32_t, bool> entry = visited.findOrInsert(key, (uint32_t)m_vertices.size());
+                    if (entry.second) 
+                    {
+                        m_vertices.push_back(vertices[key.x - 1]);
+                        if (key.y != 0)
+                            m_texcoords.push_back(texcoords[key.y - 1]);
+                        if (key.z != 0)
+                            m_normals.push_back(normals[key.z - 1]);
+                    }
+
+                    // fan triangulation of polygonal faces
+                    if (c == 0)
+                        firstIndex = entry.first;
+                    else if (c >= 2)
+                    {
+                        m_indices.push_back(firstIndex);
+                        m_indices.push_back(prevIndex);
+                        m_indices.push_back(entry.first);
+                    }
+                    prevIndex = entry.first;
+                }
+            }
+        }
+        else 
+        {
+            // Ignore line
+        }
+
+        ptr = skipLine(ptr, end);
+    }
+
+    if (nbInvalidAttributes != 0)
+        warningLog() << "TriMesh::importOBJ(): " << nbInvalidAttributes << " invalid v/vt/vn lines read as 0";
+    if (nbInvalidFaces != 0)
+        warningLog() << "TriMesh::importOBJ(): " << nbInvalidFaces << " invalid faces ignored";
+
+    // Compute normals (if OBJ-file did not contain normals)
+    if(m_normals.size() == 0) 
+    {
+        infoLog() << "TriMesh::importOBJ(): Normals not provided, compute them";
+        computeNormals();
+    }
+
+    if(m_texcoords.size() == 0) 
+        infoLog() << "TriMesh::importOBJ(): UV coords not provided";
+
+    logImportStats("TriMesh::importOBJ()", fileSize, m_indices.size() / 3, startTime);
+
+    return true;
+}
+
+
+/*
+ * Read an Mesh from an .obj file using several threads.
+ * The file is split in chunks at line boundaries. A first parallel pass counts the attributes of each chunk,
+ * a second one parses the chunks (attributes are written directly at their final position) and welds the faces
+ * of each chunk locally. Local vertices are then merged in chunk order, so that the result is identical to importOBJ().
+ */
+bool TriMesh::importOBJParallel(const std::string& _filename, unsigned _nbThreads)
+{
+    /*
+     * Attribute counts, welded vertices and triangles of a chunk of the file
+     */
+    struct OBJChunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        size_t nbVertices = 0, nbTexcoords = 0, nbNormals = 0;
+        size_t vertexOffset = 0, texcoordOffset = 0, normalOffset = 0;
+        size_t nbInvalidFaces = 0, nbInvalidAttributes = 0;
+        std::vector<glm::uvec3> keys;       // unique (v, vt, vn) tuples, in order of first use
+        std::vector<uint32_t> indices;      // triangles, indexing keys
+        std::vector<uint32_t> localToGlobal;
+    };
+
+    auto startTime = std::chrono::steady_clock::now();
+    unsigned nbThreads = getNbThreads(_nbThreads);
+
+    // Map the whole OBJ file in memory
+    MappedFile file;
+    if (!file.open(_filename))
+    {
+        errorLog() << "TriMesh::importOBJParallel(): Could not open " << _filename;
+        return false;
+    }
+    size_t fileSize = file.size();
+    const char* fileBegin = file.data();
+    const char* fileEnd = fileBegin + fileSize;
+
+    // Split file in chunks at line boundaries
+    std::vector<OBJChunk> chunks(std::max<size_t>(1, std::min<size_t>(nbThreads, fileSize / 4096)));
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        chunks[c].begin = (c == 0) ? fileBegin : chunks[c - 1].end;
+        if (c + 1 == chunks.size())
+            chunks[c].end = fileEnd;
+        else
+            chunks[c].end = std::max(chunks[c].begin, skipLine(fileBegin + fileSize * (c + 1) / chunks.size(), fileEnd));
+    }
+
+    // First pass: count attributes of each chunk
+    parallelFor(0, chunks.size(), nbThreads, [&chunks](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t c = _first; c < _last; c++)
+        {
+            OBJChunk& chunk = chunks[c];
+            for (const char* ptr = chunk.begin; ptr < chunk.end; ptr = skipLine(ptr, chunk.end))
+            {
+                ptr = skipBlanks(ptr, chunk.end);
+                if (matchKeyword(ptr, chunk.end, "v"))
+                    chunk.nbVertices++;
+                else if (matchKeyword(ptr, chunk.end, "vt"))
+                    chunk.nbTexcoords++;
+                else if (matchKeyword(ptr, chunk.end, "vn"))
+                    chunk.nbNormals++;
+            }
+        }
+    });
+
+    if (!reportProgress(0.2f))
+        return cancelImport("TriMesh::importOBJParallel()");
+
+    size_t nbVertices = 0, nbTexcoords = 0, nbNormals = 0;
+    for (OBJChunk& chunk : chunks)
+    {
+        chunk.vertexOffset = nbVertices;
+        chunk.texcoordOffset = nbTexcoords;
+        chunk.normalOffset = nbNormals;
+        nbVertices += chunk.nbVertices;
+        nbTexcoords += chunk.nbTexcoords;
+        nbNormals += chunk.nbNormals;
+    }
+
+    // Vertex data as listed in the file
+    std::vector<glm::vec3> vertices(nbVertices);
+    std::vector<glm::vec2> texcoords(nbTexcoords);
+    std::vector<glm::vec3> normals(nbNormals);
+
+    // Second pass: parse attributes and weld faces locally in each chunk
+    parallelFor(0, chunks.size(), nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        std::vector<glm::uvec3> corners;
+        for (size_t c = _first; c < _last; c++)
+        {
+            OBJChunk& chunk = chunks[c];
+            size_t v = chunk.vertexOffset, t = chunk.texcoordOffset, n = chunk.normalOffset;
+            FlatHashMap<glm::uvec3, UVec3Hash> visited;
+
+            for (const char* ptr = chunk.begin; ptr < chunk.end; ptr = skipLine(ptr, chunk.end))
+            {
+                ptr = skipBlanks(ptr, chunk.end);
+                if (matchKeyword(ptr, chunk.end, "v"))
+                {
+                    ptr += 1;
+                    if (!parseOBJAttribute(ptr, chunk.end, &vertices[v][0], 3))
+                        chunk.nbInvalidAttributes++;
+                    v++;
+                }
+                else if (matchKeyword(ptr, chunk.end, "vt"))
+                {
+                    ptr += 2;
+                    if (!parseOBJAttribute(ptr, chunk.end, &texcoords[t][0], 2))
+                        chunk.nbInvalidAttributes++;
+                    t++;
+                }
+                else if (matchKeyword(ptr, chunk.end, "vn"))
+                {
+                    ptr += 2;
+                    if (!parseOBJAttribute(ptr, chunk.end, &normals[n][0], 3))
+                        chunk.nbInvalidAttributes++;
+                    n++;
+                }
+                else if (matchKeyword(ptr, chunk.end, "f"))
+                {
+                    ptr += 1;
+                    // attributes defined so far (including previous chunks) can be referenced
+                    if (!parseOBJFace(ptr, chunk.end, v, t, n, corners))
+                    {
+                        chunk.nbInvalidFaces++;
+                        continue;
+                    }
+
+                    uint32_t firstIndex = 0, prevIndex = 0;
+                    for (size_t k = 0; k < corners.size(); k++)
+                    {
+                        std::pair<uint32_t, bool> entry = visited.findOrInsert(corners[k], (uint32_t)chunk.keys.size());
+                        if (entry.second)
+                            chunk.keys.push_back(corners[k]);
+
+                        // fan triangulation of polygonal faces
+                        if (k == 0)
+                            firstIndex = entry.first;
+                        else if (k >= 2)
+                        {
+                            chunk.indices.push_back(firstIndex);
+                            chunk.indices.push_back(prevIndex);
+                            chunk.indices.push_back(entry.first);
+                        }
+                        prevIndex = entry.first;
+                    }
+                }
+            }
+        }
+    });
+
+    if (!reportProgress(0.8f))
+        return cancelImport("TriMesh::importOBJParallel()");
+
+    // Merge: weld local vertices of each chunk, in chunk order (deterministic)
+    size_t nbLocalKeys = 0, nbIndices = 0, nbInvalidFaces = 0, nbInvalidAttributes = 0;
+    for (const OBJChunk& chunk : chunks)
+    {
+        nbLocalKeys += chunk.keys.size();
+        nbIndices += chunk.indices.size();
+        nbInvalidFaces += chunk.nbInvalidFaces;
+        nbInvalidAttributes += chunk.nbInvalidAttributes;
+    }
+
+    FlatHashMap<glm::uvec3, UVec3Hash> visited(nbLocalKeys);
+    std::vector<glm::uvec3> keys;
+    keys.reserve(nbLocalKeys);
+    for (OBJChunk& chunk : chunks)
+    {
+        chunk.localToGlobal.resize(chunk.keys.size());
+        for (size_t k = 0; k < chunk.keys.size(); k++)
+        {
+            std::pair<uint32_t, bool> entry = visited.findOrInsert(chunk.keys[k], (uint32_t)keys.size());
+            if (entry.second)
+                keys.push_back(chunk.keys[k]);
+            chunk.localToGlobal[k] = entry.first;
+        }
+        std::vector<glm::uvec3>().swap(chunk.keys);
+    }
+    visited.clear();
+
+    // Clear old mesh (including its levels of detail and meshlets)
+    clear();
+    m_indices.resize(nbIndices);
+
+    // Remap indices of each chunk
+    std::vector<size_t> indexOffsets(chunks.size(), 0);
+    for (size_t c = 1; c < chunks.size(); c++)
+        indexOffsets[c] = indexOffsets[c - 1] + chunks[c - 1].indices.size();
+
+    parallelFor(0, chunks.size(), nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t c = _first; c < _last; c++)
+        {
+            uint32_t* dst = m_indices.data() + indexOffsets[c];
+            for (uint32_t localIndex : chunks[c].indices)
+                *(dst++) = chunks[c].localToGlobal[localIndex];
+        }
+    });
+
+    // Gather per-vertex attributes
+    m_vertices.resize(keys.size());
+    parallelFor(0, keys.size(), nbThreads, [&](size_t _first, size_t _last, unsigned)
+    {
+        for (size_t k = _first; k < _last; k++)
+            m_vertices[k] = vertices[keys[k].x - 1];
+    });
+    for (const glm::uvec3& key : keys)
+    {
+        if (key.y != 0)
+            m_texcoords.push_back(texcoords[key.y - 1]);
+        if (key.z != 0)
+            m_normals.push_back(normals[key.z - 1]);
+    }
+
+    if (nbInvalidAttributes != 0)
+        warningLog() << "TriMesh::importOBJParallel(): " << nbInvalidAttributes << " invalid v/vt/vn lines read as 0";
+    if (nbInvalidFaces != 0)
+        warningLog() << "TriMesh::importOBJParallel(): " << nbInvalidFaces << " invalid faces ignored";
+
+    // Compute normals (if OBJ-file did not contain normals)
+    if(m_normals.size() == 0) 
+    {
+        infoLog() << "TriMesh::importOBJParallel(): Normals not provided, compute them";
+        computeNormals(NormalWeighting::AREA, nbThreads);
+    }
+
+    if(m_texcoords.size() == 0) 
+        infoLog() << "TriMesh::importOBJParallel(): UV coords not provided";
+
+    logImportStats("TriMesh::importOBJParallel()", fileSize, m_indices.size() / 3, startTime);
+    infoLog() << "TriMesh::importOBJParallel(): " << nbThreads << " threads, " << chunks.size() << " chunks";
+
+    return true;
+}
+
+
+/*
+ * Welding key of a vertex position: bit pattern of its coordinates (with -0.0 mapped to +0.0).
+ */
+static glm::uvec3 positionKey(const glm::vec3& _position)
+{
+    glm::uvec3 key;
+    for (int i = 0; i < 3; i++)
+    {
+        float coord = _position[i] + 0.0f;
+        std::memcpy(&key[i], &coord, sizeof(float));
+    }
+    return key;
+}
+
+
+/*
+ * Read a Mesh from a binary or ASCII .stl file.
+ * Binary facets are read directly from the memory-mapped file, identical positions are welded
+ * so that the mesh is indexed. Facet normals are ignored: smooth vertex normals are recomputed.
+ */
+bool TriMesh::importSTL(const std::string& _filename)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!file.open(_filename))
+    {
+        errorLog() << "TriMesh::importSTL(): Could not open " << _filename;
+        return false;
+    }
+    size_t fileSize = file.size();
+    const char* data = file.data();
+
+    // A binary STL is an 80 bytes header, a facet count and 50 bytes per facet
+    // (some binary files also start with "solid", so the size is checked first)
+    uint32_t nbFacets = 0;
+    bool isBinary = false;
+    if (fileSize >= 84)
+    {
+        std::memcpy(&nbFacets, data + 80, sizeof(uint32_t));
+        isBinary = (84 + 50 * (uint64_t)nbFacets == fileSize);
+    }
+    if (!isBinary)
+    {
+        if (fileSize < 5 || std::strncmp(data, "solid", 5) != 0)
+        {
+            errorLog() << "TriMesh::importSTL(): " << _filename << " is not a valid STL file";
+            return false;
+        }
+        // rough estimate, an ASCII facet takes about 250 bytes
+        nbFacets = (uint32_t)std::min<size_t>(fileSize / 256, 0xFFFFFFFFu);
+    }
+
+    // Clear old mesh (including its levels of detail and meshlets)
     clear();
-}
 
+    // Closed meshes have about twice as many triangles as vertices
+    FlatHashMap<glm::uvec3, UVec3Hash> visited(nbFacets / 2);
+    m_vertices.reserve(nbFacets / 2);
+    m_indices.reserve((size_t)nbFacets * 3);
 
-void TriMesh::getVertices(std::vector<glm::vec3>& _vertices)
-{
-    if(_vertices.size() != 0)
-        _vertices.clear();
+    auto weldVertex = [&](const glm::vec3& _position)
+    {
+        std::pair<uint32_t, bool> entry = visited.findOrInsert(positionKey(_position), (uint32_t)m_vertices.size());
+        if (entry.second)
+            m_vertices.push_back(_position);
+        m_indices.push_back(entry.first);
+    };
 
-    if(m_vertices.size() != 0)
+    if (isBinary)
     {
-        _vertices.assign(m_vertices.begin(), m_vertices.end());
+        // facet: normal (3 floats), 3 vertices (9 floats), attribute byte count (uint16)
+        const char* facet = data + 84;
+        float coords[12];
+        for (uint32_t f = 0; f < nbFacets; f++, facet += 50)
+        {
+            if ((f & 0xFFFF) == 0 && !reportProgress((float)f / (float)nbFacets))
+                return cancelImport("TriMesh::importSTL()");
+
+            std::memcpy(coords, facet, sizeof(coords));
+            weldVertex(glm::vec3(coords[3], coords[4], coords[5]));
+            weldVertex(glm::vec3(coords[6], coords[7], coords[8]));
+            weldVertex(glm::vec3(coords[9], coords[10], coords[11]));
+        }
     }
     else
     {
-        warningLog() << "TriMesh::getVertices(): Empty vertices array";
+        // only "facet" and "vertex x y z" lines are needed, 3 consecutive vertices form a facet
+        const char* end = data + fileSize;
+        const char* nextProgress = data;
+        glm::vec3 corners[3];
+        unsigned nbCorners = 0;
+        bool validFacet = true;
+        size_t nbInvalidFacets = 0;
+        for (const char* ptr = data; ptr < end; ptr = skipLine(ptr, end))
+        {
+            if (ptr >= nextProgress)
+            {
+                if (!reportProgress((float)(ptr - data) / (float)fileSize))
+                    return cancelImport("TriMesh::importSTL()");
+                nextProgress = ptr + PROGRESS_STEP;
+            }
+
+            ptr = skipBlanks(ptr, end);
+            if (matchKeyword(ptr, end, "facet"))
+            {
+                // incomplete previous facet
+                if (nbCorners != 0)
+                    nbInvalidFacets++;
+                nbCorners = 0;
+                validFacet = true;
+            }
+            else if (matchKeyword(ptr, end, "vertex"))
+            {
+                ptr += 6;
+                glm::vec3& position = corners[nbCorners++];
+                validFacet &= parseFloat(ptr, end, position.x) && parseFloat(ptr, end, position.y) && parseFloat(ptr, end, position.z);
+                if (nbCorners == 3)
+                {
+                    // facets with a coordinate that cannot be read are dropped
+                    if (validFacet)
+                    {
+                        weldVertex(corners[0]);
+                        weldVertex(corners[1]);
+                        weldVertex(corners[2]);
+                    }
+                    else
+                        nbInvalidFacets++;
+                    nbCorners = 0;
+                    validFacet = true;
+                }
+            }
+        }
+        if (nbCorners != 0)
+            nbInvalidFacets++;
+
+        if (nbInvalidFacets != 0)
+            warningLog() << "TriMesh::importSTL(): " << nbInvalidFacets << " invalid facets ignored";
     }
+
+    computeNormals();
+
+    infoLog() << "TriMesh::importSTL(): " << (isBinary ? "binary" : "ASCII") << " STL, " << m_indices.size() << " facet vertices welded into "
+              << m_vertices.size() << " vertices (x" << (double)m_indices.size() / (double)std::max<size_t>(m_vertices.size(), 1) << " less)";
+    logImportStats("TriMesh::importSTL()", fileSize, m_indices.size() / 3, startTime);
+
+    return true;
 }
 
 
-void TriMesh::getNormals(std::vector<glm::vec3>& _normals)
+/*
+ * Scalar types of PLY properties
+ */
+enum PLYType { PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+
+/*
+ * Get a PLY type from its name in the header.
+ */
+static PLYType getPLYType(const std::string& _name)
 {
-    if(_normals.size() != 0)
-        _normals.clear();
+    if (_name == "char" || _name == "int8") return PLY_INT8;
+    if (_name == "uchar" || _name == "uint8") return PLY_UINT8;
+    if (_name == "short" || _name == "int16") return PLY_INT16;
+    if (_name == "ushort" || _name == "uint16") return PLY_UINT16;
+    if (_name == "int" || _name == "int32") return PLY_INT32;
+    if (_name == "uint" || _name == "uint32") return PLY_UINT32;
+    if (_name == "float" || _name == "float32") return PLY_FLOAT32;
+    if (_name == "double" || _name == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+}
 
-    if(m_normals.size() != 0)
-    {
-        _normals.assign(m_normals.begin(), m_normals.end());
-    }
-    else
-    {
-        warningLog() << "TriMesh::getNormals(): Empty normals array";
-    }
+
+/*
+ * Size in bytes of a PLY type.
+ */
+static size_t getPLYTypeSize(PLYType _type)
+{
+    static const size_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[_type];
 }
 
 
-void TriMesh::getIndices(std::vector<uint32_t>& _indices)
+/*
+ * Decode a binary PLY value (swapping bytes for big-endian files).
+ */
+static double readPLYValue(const char* _ptr, PLYType _type, bool _swap)
 {
-    if(_indices.size() != 0)
-        _indices.clear();
+    unsigned char bytes[8];
+    size_t size = getPLYTypeSize(_type);
+    for (size_t i = 0; i < size; i++)
+        bytes[i] = (unsigned char)_ptr[_swap ? size - 1 - i : i];
 
-    if(m_indices.size() != 0)
-    {
-        _indices.assign(m_indices.begin(), m_indices.end());
-    }
-    else
+    switch (_type)
     {
-        warningLog() << "TriMesh::getIndices(): Empty indices array";
+        case PLY_INT8:    { int8_t v;   std::memcpy(&v, bytes, 1); return v; }
+        case PLY_UINT8:   { uint8_t v;  std::memcpy(&v, bytes, 1); return v; }
+        case PLY_INT16:   { int16_t v;  std::memcpy(&v, bytes, 2); return v; }
+        case PLY_UINT16:  { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case PLY_INT32:   { int32_t v;  std::memcpy(&v, bytes, 4); return v; }
+        case PLY_UINT32:  { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case PLY_FLOAT32: { float v;    std::memcpy(&v, bytes, 4); return v; }
+        case PLY_FLOAT64: { double v;   std::memcpy(&v, bytes, 8); return v; }
+        default: return 0.0;
     }
 }
 
 
-void TriMesh::getColors(std::vector<glm::vec3>& _colors)
+/*
+ * Property of a PLY element, as declared in the header
+ */
+struct PLYProperty
 {
-    if(_colors.size() != 0)
-        _colors.clear();
+    std::string name;
+    PLYType type = PLY_INVALID;
+    PLYType countType = PLY_INVALID;    // list properties only
+    bool isList = false;
+    size_t offset = 0;                  // offset in the record (fixed-size elements only)
+};
+
+/*
+ * Read the item count of a PLY list property (false if it is negative, i.e. the file is corrupt)
+ */
+static bool readPLYListCount(const char* _ptr, PLYType _type, bool _swap, size_t& _count)
+{
+    double count = readPLYValue(_ptr, _type, _swap);
+    if (!(count >= 0.0))
+        return false;
+    _count = (size_t)count;
+    return true;
+}
+
+
+/*
+ * PLY element (vertex, face, ...) as declared in the header
+ */
+struct PLYElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PLYProperty> properties;
+    bool isFixedSize = true;
+    size_t recordSize = 0;
 
-    if(m_colors.size() != 0)
+    const PLYProperty* find(const char* _name) const
     {
-        _colors.assign(m_colors.begin(), m_colors.end());
+        for (const PLYProperty& property : properties)
+            if (property.name == _name)
+                return &property;
+        return nullptr;
     }
-}
+};
 
 
-void TriMesh::getTexCoords(std::vector<glm::vec2>& _texcoords)
+/*
+ * Decode plan of a group of PLY properties (e.g. x y z) read into a vector attribute
+ */
+struct PLYAttributeDecoder
 {
-    if(_texcoords.size() != 0)
-        _texcoords.clear();
+    const PLYProperty* props[3] = { nullptr, nullptr, nullptr };
+    int nbProps = 0;
+    float scale = 1.0f;
+    bool isPacked = false;  // 3 consecutive float32 properties
 
-    if(m_texcoords.size() != 0)
+    void init(const PLYElement& _element, const char* _n0, const char* _n1, const char* _n2, int _nbProps)
     {
-        _texcoords.assign(m_texcoords.begin(), m_texcoords.end());
+        const char* names[3] = { _n0, _n1, _n2 };
+        nbProps = _nbProps;
+        for (int i = 0; i < nbProps; i++)
+            if ((props[i] = _element.find(names[i])) == nullptr)
+                nbProps = 0;
+        isPacked = (nbProps == 3);
+        for (int i = 0; i < nbProps; i++)
+            isPacked = isPacked && props[i]->type == PLY_FLOAT32 && props[i]->offset == props[0]->offset + 4 * i;
     }
-}
+
+    void decode(const char* _record, bool _swap, float* _dst) const
+    {
+        for (int i = 0; i < nbProps; i++)
+            _dst[i] = (float)readPLYValue(_record + props[i]->offset, props[i]->type, _swap) * scale;
+    }
+};
 
 
-bool TriMesh::readFile(std::string _filename)
+/*
+ * Read a Mesh from a binary .ply file.
+ * The header is parsed once into a decode plan (type and offset of each used property), then the vertex and face
+ * elements are streamed from the memory-mapped file directly into the mesh arrays. Groups of 3 packed float32
+ * properties (e.g., x y z) are copied as a block, and the whole vertex element is copied at once if it only holds
+ * packed positions. Polygonal faces are fan-triangulated.
+ */
+bool TriMesh::importPLY(const std::string& _filename)
 {
-    if(_filename.substr(_filename.find_last_of(".") + 1) == "obj")
+    auto startTime = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!file.open(_filename))
     {
-        importOBJ(_filename);
-        return true;
+        errorLog() << "TriMesh::importPLY(): Could not open " << _filename;
+        return false;
     }
-    else
+    const char* ptr = file.data();
+    const char* end = ptr + file.size();
+
+    // Parse header
+    std::vector<PLYElement> elements;
+    bool isBinary = false, swapBytes = false, headerEnded = false;
+    if (file.size() < 4 || std::strncmp(ptr, "ply", 3) != 0)
     {
-        errorLog() << "TriMesh::readFile(): Invalid file extension: only .obj are supported";
+        errorLog() << "TriMesh::importPLY(): " << _filename << " is not a PLY file";
+        return false;
+    }
+    while (ptr < end && !headerEnded)
+    {
+        const char* lineEnd = skipLine(ptr, end);
+        std::istringstream line(std::string(ptr, lineEnd));
+        std::string keyword;
+        line >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format;
+            line >> format;
+            isBinary = (format == "binary_little_endian" || format == "binary_big_endian");
+            swapBytes = (format == "binary_big_endian");
+        }
+        else if (keyword == "element")
+        {
+            elements.emplace_back();
+            line >> elements.back().name >> elements.back().count;
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            PLYProperty property;
+            std::string typeName;
+            line >> typeName;
+            if (typeName == "list")
+            {
+                std::string countTypeName;
+                line >> countTypeName >> typeName;
+                property.isList = true;
+                property.countType = getPLYType(countTypeName);
+            }
+            property.type = getPLYType(typeName);
+            line >> property.name;
+            if (property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID))
+            {
+                errorLog() << "TriMesh::importPLY(): Invalid property type in " << _filename;
+                return false;
+            }
+
+            PLYElement& element = elements.back();
+            property.offset = element.recordSize;
+            element.isFixedSize = element.isFixedSize && !property.isList;
+            element.recordSize += getPLYTypeSize(property.type);
+            element.properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            headerEnded = true;
+        }
+        ptr = lineEnd;
+    }
+
+    if (!headerEnded || !isBinary)
+    {
+        errorLog() << "TriMesh::importPLY(): only binary PLY files are supported";
+        return false;
     }
-    return false;
-}
 
+    // Clear old mesh (including its levels of detail and meshlets)
+    clear();
 
+    size_t nbInvalidFaces = 0;
+    bool truncated = false, corrupt = false;
 
-void TriMesh::computeAABB()
-{
-    if(m_vertices.size() != 0)
+    for (const PLYElement& element : elements)
     {
-        // init values
-        glm::vec3 min = m_vertices[0];
-        glm::vec3 max = m_vertices[0];
+        if (element.name == "vertex" && !element.isFixedSize)
+        {
+            errorLog() << "TriMesh::importPLY(): list properties of vertices are not supported in " << _filename;
+            clear();
+            return false;
+        }
+        else if (element.name == "vertex")
+        {
+            if ((size_t)(end - ptr) / std::max<size_t>(element.recordSize, 1) < element.count)
+            {
+                truncated = true;
+                break;
+            }
 
-        for (unsigned int i = 0; i <m_vertices.size(); i++) 
+            PLYAttributeDecoder position, normal, color, texcoord;
+            position.init(element, "x", "y", "z", 3);
+            normal.init(element, "nx", "ny", "nz", 3);
+            color.init(element, "red", "green", "blue", 3);
+            texcoord.init(element, "u", "v", nullptr, 2);
+            if (texcoord.nbProps == 0)
+                texcoord.init(element, "s", "t", nullptr, 2);
+            if (texcoord.nbProps == 0)
+                texcoord.init(element, "texture_u", "texture_v", nullptr, 2);
+            if (color.nbProps != 0 && color.props[0]->type == PLY_UINT8)
+                color.scale = 1.0f / 255.0f;
+            if (position.nbProps == 0)
+            {
+                errorLog() << "TriMesh::importPLY(): vertex positions not found in " << _filename;
+                return false;
+            }
+
+            m_vertices.resize(element.count);
+            m_normals.resize(normal.nbProps ? element.count : 0);
+            m_colors.resize(color.nbProps ? element.count : 0);
+            m_texcoords.resize(texcoord.nbProps ? element.count : 0);
+
+            if (!swapBytes && position.isPacked && position.props[0]->offset == 0 && element.recordSize == sizeof(glm::vec3))
+            {
+                // positions only: copy the whole element block
+                std::memcpy(m_vertices.data(), ptr, element.count * sizeof(glm::vec3));
+            }
+            else
+            {
+                const char* record = ptr;
+                for (size_t i = 0; i < element.count; i++, record += element.recordSize)
+                {
+                    if ((i & 0xFFFF) == 0 && !reportProgress((float)(record - file.data()) / (float)file.size()))
+                        return cancelImport("TriMesh::importPLY()");
+
+                    if (!swapBytes && position.isPacked)
+                        std::memcpy(&m_vertices[i], record + position.props[0]->offset, sizeof(glm::vec3));
+                    else
+                        position.decode(record, swapBytes, &m_vertices[i].x);
+
+                    if (!swapBytes && normal.isPacked)
+                        std::memcpy(&m_normals[i], record + normal.props[0]->offset, sizeof(glm::vec3));
+                    else if (normal.nbProps)
+                        normal.decode(record, swapBytes, &m_normals[i].x);
+
+                    if (!swapBytes && color.isPacked)
+                        std::memcpy(&m_colors[i], record + color.props[0]->offset, sizeof(glm::vec3));
+                    else if (color.nbProps)
+                        color.decode(record, swapBytes, &m_colors[i].x);
+
+                    if (texcoord.nbProps)
+                        texcoord.decode(record, swapBytes, &m_texcoords[i].x);
+                }
+            }
+            ptr += element.count * element.recordSize;
+        }
+        else if (element.name == "face")
+        {
+            m_indices.reserve(element.count * 3);
+            uint32_t nbVertices = (uint32_t)m_vertices.size();
+
+            for (size_t f = 0; f < element.count && !truncated && !corrupt; f++)
+            {
+                if ((f & 0xFFFF) == 0 && !reportProgress((float)(ptr - file.data()) / (float)file.size()))
+                    return cancelImport("TriMesh::importPLY()");
+
+                for (const PLYProperty& property : element.properties)
+                {
+                    size_t countSize = property.isList ? getPLYTypeSize(property.countType) : 0;
+                    size_t itemSize = getPLYTypeSize(property.type);
+                    if ((size_t)(end - ptr) < countSize + itemSize)
+                    {
+                        truncated = true;
+                        break;
+                    }
+                    if (!property.isList)
+                    {
+                        ptr += itemSize;
+                        continue;
+                    }
+
+                    size_t count = 0;
+                    if (!readPLYListCount(ptr, property.countType, swapBytes, count))
+                    {
+                        corrupt = true;
+                        break;
+                    }
+                    ptr += countSize;
+                    if ((size_t)(end - ptr) / itemSize < count)
+                    {
+                        truncated = true;
+                        break;
+                    }
+                    if (property.name != "vertex_indices" && property.name != "vertex_index")
+                    {
+                        ptr += count * itemSize;
+                        continue;
+                    }
+
+                    size_t faceStart = m_indices.size();
+                    bool isValid = (count >= 3);
+                    if (count == 3 && !swapBytes && (property.type == PLY_INT32 || property.type == PLY_UINT32))
+                    {
+                        // triangle: copy the 3 indices at once (negative int32 indices have their sign bit set)
+                        m_indices.resize(faceStart + 3);
+                        std::memcpy(&m_indices[faceStart], ptr, 3 * sizeof(uint32_t));
+                        for (size_t i = faceStart; i < faceStart + 3; i++)
+                        {
+                            corrupt = corrupt || (property.type == PLY_INT32 && m_indices[i] >= 0x80000000u);
+                            isValid = isValid && m_indices[i] < nbVertices;
+                        }
+                    }
+                    else
+                    {
+                        // check the indices before converting them (a negative value has no unsigned conversion)
+                        for (size_t c = 0; c < count; c++)
+                        {
+                            double index = readPLYValue(ptr + c * itemSize, property.type, swapBytes);
+                            corrupt = corrupt || index < 0.0;
+                            isValid = isValid && index < (double)nbVertices;
+                        }
+
+                        // fan triangulation of polygonal faces
+                        for (size_t c = 2; c < count && isValid && !corrupt; c++)
+                        {
+                            m_indices.push_back((uint32_t)readPLYValue(ptr, property.type, swapBytes));
+                            m_indices.push_back((uint32_t)readPLYValue(ptr + (c - 1) * itemSize, property.type, swapBytes));
+                            m_indices.push_back((uint32_t)readPLYValue(ptr + c * itemSize, property.type, swapBytes));
+                        }
+                    }
+                    ptr += count * itemSize;
+
+                    if (corrupt)
+                        break;
+                    if (!isValid)
+                    {
+                        m_indices.resize(faceStart);
+                        nbInvalidFaces++;
+                    }
+                }
+            }
+        }
+        else if (element.isFixedSize)
+        {
+            // skip unused element
+            if ((size_t)(end - ptr) / std::max<size_t>(element.recordSize, 1) < element.count)
+            {
+                truncated = true;
+                break;
+            }
+            ptr += element.count * element.recordSize;
+        }
+        else
         {
-            if(m_vertices[i].x < min.x) { min.x = m_vertices[i].x; }
-            if(m_vertices[i].y < min.y) { min.y = m_vertices[i].y; }
-            if(m_vertices[i].z < min.z) { min.z = m_vertices[i].z; }
-            if(m_vertices[i].x > max.x) { max.x = m_vertices[i].x; }
-            if(m_vertices[i].y > max.y) { max.y = m_vertices[i].y; }
-            if(m_vertices[i].z > max.z) { max.z = m_vertices[i].z; }
+            // skip unused variable-size element
+            for (size_t e = 0; e < element.count && !truncated && !corrupt; e++)
+            {
+                for (const PLYProperty& property : element.properties)
+                {
+                    size_t countSize = property.isList ? getPLYTypeSize(property.countType) : 0;
+                    if ((size_t)(end - ptr) < countSize)
+                    {
+                        truncated = true;
+                        break;
+                    }
+                    size_t count = 1;
+                    if (property.isList && !readPLYListCount(ptr, property.countType, swapBytes, count))
+                    {
+                        corrupt = true;
+                        break;
+                    }
+                    ptr += countSize;
+                    if ((size_t)(end - ptr) / getPLYTypeSize(property.type) < count)
+                    {
+                        truncated = true;
+                        break;
+                    }
+                    ptr += count * getPLYTypeSize(property.type);
+                }
+            }
         }
-        m_bBoxMin = min;
-        m_bBoxMax = max;
+
+        if (truncated || corrupt)
+            break;
     }
-    else
+
+    // a partial mesh is not returned (it would also be written in the mesh cache)
+    if (truncated || corrupt)
     {
-        warningLog() << "TriMesh::computeAABB(): Empty vertices array";
-        m_bBoxMin = glm::vec3(0.0f, 0.0f, 0.0f);
-        m_bBoxMax = glm::vec3(0.0f, 0.0f, 0.0f);
+        errorLog() << "TriMesh::importPLY(): " << _filename << (truncated ? " is truncated" : " has a negative list count or vertex index");
+        clear();
+        return false;
     }
+    if (nbInvalidFaces != 0)
+        warningLog() << "TriMesh::importPLY(): " << nbInvalidFaces << " invalid faces ignored";
+
+    // Compute normals (if PLY-file did not contain normals)
+    if(m_normals.size() == 0) 
+    {
+        infoLog() << "TriMesh::importPLY(): Normals not provided, compute them";
+        computeNormals();
+    }
+
+    logImportStats("TriMesh::importPLY()", file.size(), m_indices.size() / 3, startTime);
+
+    return true;
 }
 
 
-void TriMesh::computeNormals()
+/*
+ * Read a compressed mesh (.cmesh) through a memory mapping
+ */
+bool TriMesh::importCompressed(const std::string& _filename)
 {
-    m_normals.clear();
-    m_normals.resize(m_vertices.size(), glm::vec3(0.0f, 0.0f, 0.0f));
+    auto startTime = std::chrono::steady_clock::now();
 
-    // Compute per-vertex normals by averaging the unnormalized face normals
-    std::int32_t vertexIndex0, vertexIndex1, vertexIndex2;
-    glm::vec3 normal;
-    int numIndices = m_indices.size();
-    for (int i = 0; i < numIndices; i += 3) 
+    MappedFile file;
+    if (!file.open(_filename))
+    {
+        errorLog() << "TriMesh::importCompressed(): Could not open " << _filename;
+        return false;
+    }
+
+    clear();
+    MeshCodecHeader header;
+    if (!MeshCodec::decode((const uint8_t*)file.data(), file.size(), header, m_vertices, m_normals, m_texcoords, m_colors, m_indices))
+    {
+        errorLog() << "TriMesh::importCompressed(): " << _filename << " is not a valid compressed mesh";
+        clear();
+        return false;
+    }
+    m_bBoxMin = glm::vec3(header.bBoxMin[0], header.bBoxMin[1], header.bBoxMin[2]);
+    m_bBoxMax = glm::vec3(header.bBoxMax[0], header.bBoxMax[1], header.bBoxMax[2]);
+
+    if (m_normals.size() == 0)
+    {
+        infoLog() << "TriMesh::importCompressed(): Normals not provided, compute them";
+        computeNormals();
+    }
+
+    logImportStats("TriMesh::importCompressed()", file.size(), m_indices.size() / 3, startTime);
+
+    return true;
+}
+
+
+bool TriMesh::writeCompressed(const std::string& _filename, const MeshCodecParams& _params)
+{
+    std::vector<uint8_t> data;
+    if (!MeshCodec::encode(getVertexView(), getNormalView(), getTexCoordView(), getColorView(), getIndexView(), _params, data))
     {
-        vertexIndex0 = m_indices[i];
-        vertexIndex1 = m_indices[i + 1];
-        vertexIndex2 = m_indices[i + 2];
-        normal = glm::cross(m_vertices[vertexIndex1] - m_vertices[vertexIndex0],  m_vertices[vertexIndex2] - m_vertices[vertexIndex0]);
-        m_normals[vertexIndex0] += normal;
-        m_normals[vertexIndex1] += normal;
-        m_normals[vertexIndex2] += normal;
+        errorLog() << "TriMesh::writeCompressed(): Invalid mesh, or max position error " << _params.maxPositionError
+                   << " below what " << MeshCodec::MAX_POSITION_BITS << " bits per axis can hold";
+        return false;
     }
 
-    int numNormals = (int)m_normals.size();
-    for (int i = 0; i < numNormals; i++) 
+    std::ofstream file(_filename, std::ios::binary | std::ios::trunc);
+    if (!file.write((const char*)data.data(), (std::streamsize)data.size()))
     {
-        m_normals[i] = glm::normalize(m_normals[i]);
+        errorLog() << "TriMesh::writeCompressed(): Could not write " << _filename;
+        return false;
     }
+
+    size_t rawSize = getVertexView().size_bytes() + getNormalView().size_bytes() + getTexCoordView().size_bytes() + getColorView().size_bytes()
+                   + getIndexView().size_bytes();
+    infoLog() << "TriMesh::writeCompressed(): " << _filename << ": " << data.size() << " bytes (ratio " << (double)rawSize / (double)std::max<size_t>(data.size(), 1) << ")";
+    return true;
 }
 
 
 /*
- * Read an Mesh from an .obj file. This function can read texture
- * coordinates and/or normals, in addition to vertex positions.
+ * Read an Mesh from an .obj file (reference implementation, kept for comparison).
+ * This function can read texture coordinates and/or normals, in addition to vertex positions.
  */
-bool TriMesh::importOBJ(const std::string& _filename)
+bool TriMesh::importOBJLegacy(const std::string& _filename)
 {
     struct uvec3Less 
     {
@@ -199,11 +1606,13 @@ bool TriMesh::importOBJ(const std::string& _filename)
     std::uint32_t tindex[3];
     std::uint32_t nindex[3];
 
+    auto startTime = std::chrono::steady_clock::now();
+
     // Open OBJ file
     std::ifstream f(_filename.c_str());
     if(!f.is_open()) 
     {
-        errorLog() << "TriMesh::importOBJ(): Could not open " << _filename;
+        errorLog() << "TriMesh::importOBJLegacy(): Could not open " << _filename;
         return false;
     }
 
@@ -326,17 +1735,35 @@ bool TriMesh::importOBJ(const std::string& _filename)
     // Compute normals (if OBJ-file did not contain normals)
     if(m_normals.size() == 0) 
     {
-        infoLog() << "TriMesh::importOBJ(): Normals not provided, compute them";
+        infoLog() << "TriMesh::importOBJLegacy(): Normals not provided, compute them";
         computeNormals();
     }
 
     if(m_texcoords.size() == 0) 
-        infoLog() << "TriMesh::importOBJ(): UV coords not provided";
+        infoLog() << "TriMesh::importOBJLegacy(): UV coords not provided";
+
+    f.clear();
+    f.seekg(0, std::ios::end);
+    logImportStats("TriMesh::importOBJLegacy()", (size_t)f.tellg(), m_indices.size() / 3, startTime);
 
     return true;
 }
 
 
+bool TriMesh::reportProgress(float _progress)
+{
+    return !m_progressCallback || m_progressCallback(_progress);
+}
+
+
+bool TriMesh::cancelImport(const char* _funcName)
+{
+    infoLog() << _funcName << ": import cancelled";
+    clear();
+    return false;
+}
+
+
 void TriMesh::clear()
 {
     m_vertices.clear();
@@ -345,5 +1772,36 @@ void TriMesh::clear()
 
     m_colors.clear();
     m_texcoords.clear();
+
+    m_lods.clear();
+    m_meshlets.clear();
+
+    m_cache.reset();
+    m_mappedArrays = 0;
+}
+
+
+void TriMesh::detachCache(unsigned _arrays)
+{
+    _arrays &= m_mappedArrays;
+    if (_arrays & VERTEX_ARRAY)
+        m_vertices.assign(m_cache->getVertexView().begin(), m_cache->getVertexView().end());
+    if (_arrays & NORMAL_ARRAY)
+        m_normals.assign(m_cache->getNormalView().begin(), m_cache->getNormalView().end());
+    if (_arrays & INDEX_ARRAY)
+        m_indices.assign(m_cache->getIndexView().begin(), m_cache->getIndexView().end());
+    if (_arrays & COLOR_ARRAY)
+        m_colors.assign(m_cache->getColorView().begin(), m_cache->getColorView().end());
+    if (_arrays & TEXCOORD_ARRAY)
+        m_texcoords.assign(m_cache->getTexCoordView().begin(), m_cache->getTexCoordView().end());
+    unmapArrays(_arrays);
+}
+
+
+void TriMesh::unmapArrays(unsigned _arrays)
+{
+    m_mappedArrays &= ~_arrays;
+    if (m_mappedArrays == 0)
+        m_cache.reset();
 }
 
@@ -17,16 +17,25 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 
+#include "meshcodec.h"
+#include "meshcache.h"
+#include "meshnormals.h"
+#include "meshsimplify.h"
+#include "meshlets.h"
 
 
 /*!
 * \class TriMesh
 * \brief Triangle soup mesh (i.e. no adjacency information)
-* Read and write STL and OBJ files and store data in dynamic arrays
+* Read STL, OBJ and PLY files and store data in dynamic arrays
 * Duplicate vertices data to handle multiple UV coords and/or normals
 */
 class TriMesh
@@ -54,6 +63,7 @@ class TriMesh
         |                                              GETTERS/SETTERS                                                |
         +-------------------------------------------------------------------------------------------------------------*/
 
+        // copy-out getters (use the views below to avoid copies)
         /*! \fn getVertices */
         void getVertices(std::vector<glm::vec3>& _vertices);
         /*! \fn getNormals */
@@ -66,19 +76,107 @@ class TriMesh
         /*! \fn getTexCoords */
         void getTexCoords(std::vector<glm::vec2>& _texcoords);
 
+        /*!
+        * \fn getVertexView
+        * \brief read-only view of the vertices array (no copy, valid until the mesh is modified)
+        * Arrays of a mesh read from its binary cache point into the mapped cache file until they are modified.
+        */
+        std::span<const glm::vec3> getVertexView() const { return (m_mappedArrays & VERTEX_ARRAY) ? m_cache->getVertexView() : std::span<const glm::vec3>(m_vertices); }
+        /*! \fn getNormalView */
+        std::span<const glm::vec3> getNormalView() const { return (m_mappedArrays & NORMAL_ARRAY) ? m_cache->getNormalView() : std::span<const glm::vec3>(m_normals); }
+        /*! \fn getIndexView */
+        std::span<const uint32_t> getIndexView() const { return (m_mappedArrays & INDEX_ARRAY) ? m_cache->getIndexView() : std::span<const uint32_t>(m_indices); }
+        /*! \fn getColorView */
+        std::span<const glm::vec3> getColorView() const { return (m_mappedArrays & COLOR_ARRAY) ? m_cache->getColorView() : std::span<const glm::vec3>(m_colors); }
+        /*! \fn getTexCoordView */
+        std::span<const glm::vec2> getTexCoordView() const { return (m_mappedArrays & TEXCOORD_ARRAY) ? m_cache->getTexCoordView() : std::span<const glm::vec2>(m_texcoords); }
+        /*!
+        * \fn isMapped
+        * \brief true if some arrays are still read from the memory-mapped binary cache (zero-copy)
+        */
+        bool isMapped() const { return m_mappedArrays != 0; }
+
+        /*!
+        * \fn getNbLODs
+        * \brief number of levels of detail, including the full-detail mesh (level 0)
+        */
+        size_t getNbLODs() const { return m_lods.size() + 1; }
+        /*!
+        * \fn getLODIndexView
+        * \brief read-only view of the triangles of a level of detail (level 0 is the full-detail index array)
+        */
+        std::span<const uint32_t> getLODIndexView(size_t _level) const { return (_level == 0) ? getIndexView() : std::span<const uint32_t>(m_lods[_level - 1].indices); }
+        /*!
+        * \fn getLODError
+        * \brief estimated geometric error of a level of detail, in mesh units (0 for level 0)
+        */
+        float getLODError(size_t _level) const { return (_level == 0) ? 0.0f : m_lods[_level - 1].error; }
+        /*!
+        * \fn getLODErrorBound
+        * \brief geometric error of a level of detail with a safety margin (see LOD_ERROR_MARGIN), for level of detail
+        * selection and occluder depth offsets
+        */
+        float getLODErrorBound(size_t _level) const { return getLODError(_level) * LOD_ERROR_MARGIN; }
+        /*!
+        * \fn getMeshlets
+        * \brief read-only view of the meshlets (ranges of the full-detail index array, empty if not built)
+        */
+        std::span<const Meshlet> getMeshlets() const { return m_meshlets; }
+
+        /*!
+        * \fn takeVertices
+        * \brief move the vertices array out of the mesh (no copy, the mesh array is left empty)
+        */
+        std::vector<glm::vec3> takeVertices() { detachCache(VERTEX_ARRAY); return std::exchange(m_vertices, {}); }
+        /*! \fn takeNormals */
+        std::vector<glm::vec3> takeNormals() { detachCache(NORMAL_ARRAY); return std::exchange(m_normals, {}); }
+        /*! \fn takeIndices */
+        std::vector<uint32_t> takeIndices() { detachCache(INDEX_ARRAY); return std::exchange(m_indices, {}); }
+        /*! \fn takeColors */
+        std::vector<glm::vec3> takeColors() { detachCache(COLOR_ARRAY); return std::exchange(m_colors, {}); }
+        /*! \fn takeTexCoords */
+        std::vector<glm::vec2> takeTexCoords() { detachCache(TEXCOORD_ARRAY); return std::exchange(m_texcoords, {}); }
+
 
         /*!
         * \fn getBBoxMin
         * \brief get min point of the bounding box
         * \return 3D coords of the min point of the BBox
         */
-        glm::vec3 getBBoxMin() { return m_bBoxMin; }
+        glm::vec3 getBBoxMin() const { return m_bBoxMin; }
         /*!
         * \fn getBBoxMax
         * \brief get max point of the bounding box
         * \return 3D coords of the max point of the BBox
         */
-        glm::vec3 getBBoxMax() { return m_bBoxMax; }
+        glm::vec3 getBBoxMax() const { return m_bBoxMax; }
+
+        /*!
+        * \fn setLegacyOBJParser
+        * \brief use the reference (getline/istringstream) OBJ parser instead of the single-pass one, for comparison
+        */
+        void setLegacyOBJParser(bool _legacy) { m_legacyOBJParser = _legacy; }
+
+        /*!
+        * \fn setUseCache
+        * \brief read meshes from (and write them to) a binary cache file next to the source file (<filename>.meshcache)
+        */
+        void setUseCache(bool _useCache) { m_useCache = _useCache; }
+
+        /*!
+        * \fn setOptimizeVertexCache
+        * \brief reorder triangles and vertices for GPU vertex cache / fetch locality after import (before the cache is built)
+        */
+        void setOptimizeVertexCache(bool _optimize) { m_optimizeVertexCache = _optimize; }
+
+        /*!
+        * \fn setProgressCallback
+        * \brief set a function called regularly during import, level of detail generation and meshlet building, with
+        * the progress of the current operation in [0,1]
+        * The operation is cancelled (and readFile, generateLODs or buildMeshlets returns false) as soon as the callback
+        * returns false.
+        */
+        void setProgressCallback(std::function<bool(float)> _callback) { m_progressCallback = _callback; }
 
 
         /*------------------------------------------------------------------------------------------------------------+
@@ -89,9 +187,19 @@ class TriMesh
         * \fn readFile
         * \brief read a mesh from a file
         * \param _filename : name of the file to read
-        * \return false if file extension is not supported, true if it is
+        * \param _nbThreads : number of threads used for parsing (1 = sequential, 0 = all hardware threads)
+        * \return false if file extension is not supported or file could not be read, true otherwise
         */
-        bool readFile(std::string _filename);
+        bool readFile(std::string _filename, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn writeCompressed
+        * \brief write mesh in the quantized and entropy-coded format (.cmesh, see MeshCodec)
+        * \param _filename : name of the file to write
+        * \param _params : quantization error bounds
+        * \return false if file could not be written
+        */
+        bool writeCompressed(const std::string& _filename, const MeshCodecParams& _params);
 
         /*!
         * \fn computeAABB
@@ -102,13 +210,84 @@ class TriMesh
         /*!
         * \fn computeNormals
         * \brief recompute the triangle normals and update vertex normals
+        * Result is deterministic: it does not depend on the number of threads (nor on the SIMD instruction set).
+        * \param _weighting : weight of each triangle (area or angle at the vertex)
+        * \param _nbThreads : number of threads (1 = sequential, 0 = all hardware threads)
+        */
+        void computeNormals(NormalWeighting _weighting = NormalWeighting::AREA, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn optimizeVertexCache
+        * \brief reorder triangles for post-transform vertex cache locality (see ::optimizeVertexCache)
+        * \param _cacheSize : number of entries of the targeted cache
+        */
+        void optimizeVertexCache(unsigned _cacheSize = 16);
+
+        /*!
+        * \fn optimizeVertexFetch
+        * \brief reorder vertices (and their attributes) in first-use order of the index buffer
+        */
+        void optimizeVertexFetch();
+
+        /*!
+        * \fn sortSpatially
+        * \brief reorder vertices and triangles along a Z-order curve of the AABB, for the locality of CPU-side passes
+        * (normals, neighbourhood queries, ...). Triangles are sorted by the Morton code of their centroid.
+        * \param _mortonBits : 30 (10 bits per axis, 4 sort passes) or 63 (21 bits per axis, 8 sort passes)
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        */
+        void sortSpatially(unsigned _mortonBits = 30, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn generateLODs
+        * \brief generate levels of detail by quadric error simplification (see MeshSimplifier): index arrays over the
+        * vertices of the mesh, each one simplified from the previous one and reordered for the vertex cache.
+        * Vertices duplicated on texcoord / normal seams are preserved.
+        * \param _ratios : target number of triangles of each level, relative to the full-detail mesh (decreasing)
+        * \param _maxError : max geometric error of each simplification step, relative to the AABB diagonal
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        * \return false if cancelled by the progress callback (no level of detail is kept)
+        */
+        bool generateLODs(const std::vector<float>& _ratios = { 0.5f, 0.25f, 0.125f, 0.0625f }, float _maxError = 0.02f, unsigned _nbThreads = 1);
+
+        /*!
+        * \fn clearLODs
+        * \brief release levels of detail (level 0 is kept)
         */
-        void computeNormals();
+        void clearLODs() { m_lods.clear(); }
+
+        /*!
+        * \fn buildMeshlets
+        * \brief partition the full-detail triangles in meshlets (see ::buildMeshlets) and reorder the index array so
+        * that each meshlet is a contiguous range, with triangles in vertex cache order within each meshlet (see
+        * ::optimizeMeshletVertexCache, for a cache of 16 entries). Meshlets are released by the methods reordering
+        * triangles.
+        * \param _maxVertices : max number of vertices per meshlet
+        * \param _maxTriangles : max number of triangles per meshlet
+        * \param _nbThreads : number of threads (0 = all hardware threads)
+        * \return false if cancelled by the progress callback (the mesh is left unchanged, without meshlets)
+        */
+        bool buildMeshlets(unsigned _maxVertices = 64, unsigned _maxTriangles = 124, unsigned _nbThreads = 1);
 
 
 
     protected:
 
+        /*!
+        * \enum MeshArray
+        * \brief Flags of the vertex and index arrays (see m_mappedArrays)
+        */
+        enum MeshArray : unsigned
+        {
+            VERTEX_ARRAY = 1,
+            NORMAL_ARRAY = 2,
+            INDEX_ARRAY = 4,
+            COLOR_ARRAY = 8,
+            TEXCOORD_ARRAY = 16,
+            ALL_ARRAYS = 31
+        };
+
+
         /*------------------------------------------------------------------------------------------------------------+
         |                                                ATTRIBUTES                                                   |
         +-------------------------------------------------------------------------------------------------------------*/
@@ -120,9 +299,21 @@ class TriMesh
         std::vector<glm::vec3> m_colors;        /*!< vertices RGB colors array (3D coords) */
         std::vector<glm::vec2> m_texcoords;     /*!< vertices uvs array (2D coords) */
 
+        std::vector<MeshLOD> m_lods;            /*!< levels of detail 1..n (simplified triangles over m_vertices) */
+        std::vector<Meshlet> m_meshlets;        /*!< clusters of triangles (ranges of m_indices) */
+
+        std::shared_ptr<const MeshCache> m_cache;   /*!< binary cache the mesh was read from, mapped while arrays are read from it (shared by copies) */
+        unsigned m_mappedArrays;                /*!< MeshArray flags of the arrays read from m_cache instead of the vectors */
+
         glm::vec3 m_bBoxMin;                    /*!< 3D coordinates of the min corner of the bounding box */
         glm::vec3 m_bBoxMax;                    /*!< 3D coordinates of the max corner of the bounding box */
 
+        bool m_legacyOBJParser;                 /*!< flag to use the reference OBJ parser instead of the single-pass one */
+        bool m_useCache;                        /*!< flag to use binary mesh cache files */
+        bool m_optimizeVertexCache;             /*!< flag to reorder triangles and vertices after import */
+
+        std::function<bool(float)> m_progressCallback;  /*!< import progress callback (returns false to cancel) */
+
 
         /*------------------------------------------------------------------------------------------------------------+
         |                                               OTHER METHODS                                                 |
@@ -130,14 +321,102 @@ class TriMesh
 
         /*!
         * \fn importOBJ
-        * \brief read OBJ file
+        * \brief read OBJ file in a single pass over a raw byte buffer
         * \param _filename: name of file
         */
         bool importOBJ(const std::string& _filename);
 
+        /*!
+        * \fn importOBJParallel
+        * \brief read OBJ file split in chunks parsed by several threads (same result as importOBJ)
+        * \param _filename: name of file
+        * \param _nbThreads: number of threads (0 = all hardware threads)
+        */
+        bool importOBJParallel(const std::string& _filename, unsigned _nbThreads);
+
+        /*!
+        * \fn importSTL
+        * \brief read binary or ASCII STL file, welding identical positions
+        * \param _filename: name of file
+        */
+        bool importSTL(const std::string& _filename);
+
+        /*!
+        * \fn importPLY
+        * \brief read binary PLY file (positions, normals, colors, uvs and polygonal faces)
+        * \param _filename: name of file
+        */
+        bool importPLY(const std::string& _filename);
+
+        /*!
+        * \fn importCompressed
+        * \brief read a compressed mesh file (.cmesh, see MeshCodec)
+        * \param _filename: name of file
+        */
+        bool importCompressed(const std::string& _filename);
+
+        /*!
+        * \fn importOBJLegacy
+        * \brief read OBJ file with the reference two-pass getline/istringstream parser
+        * \param _filename: name of file
+        */
+        bool importOBJLegacy(const std::string& _filename);
+
+        /*!
+        * \fn readCache
+        * \brief read mesh from a binary cache file, if it has been built from the given source file
+        * \param _cacheFilename: name of cache file
+        * \param _sourceFilename: name of the source file (hashed only if its write time changed)
+        * \param _sourceSize: size of the source file
+        * \param _sourceTime: last write time of the source file
+        * \return false if the cache does not exist or is outdated
+        */
+        bool readCache(const std::string& _cacheFilename, const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime);
+
+        /*!
+        * \fn writeCache
+        * \brief write mesh (and its AABB) in a binary cache file
+        * \param _cacheFilename: name of cache file
+        * \param _sourceFilename: name of the source file (hashed)
+        * \param _sourceSize: size of the source file
+        * \param _sourceTime: last write time of the source file
+        */
+        bool writeCache(const std::string& _cacheFilename, const std::string& _sourceFilename, uint64_t _sourceSize, uint64_t _sourceTime);
+
+        /*!
+        * \fn detachCache
+        * \brief copy arrays read from the mapped binary cache into the vectors, before they are modified
+        * The cache file is unmapped once no array is read from it.
+        * \param _arrays: MeshArray flags of the arrays to copy
+        */
+        void detachCache(unsigned _arrays = ALL_ARRAYS);
+
+        /*!
+        * \fn unmapArrays
+        * \brief stop reading arrays from the mapped binary cache without copying them (they are about to be replaced)
+        * \param _arrays: MeshArray flags of the arrays
+        */
+        void unmapArrays(unsigned _arrays);
+
+        /*!
+        * \fn reportProgress
+        * \brief report the progress of the current operation to the progress callback
+        * \param _progress: progress in [0,1]
+        * \return false if import must be cancelled
+        */
+        bool reportProgress(float _progress);
+
+        /*!
+        * \fn cancelImport
+        * \brief clear partially imported data after a cancellation
+        * \param _funcName: name of the cancelled import function (for log)
+        * \return false
+        */
+        bool cancelImport(const char* _funcName);
+
         /*!
         * \fn clear
-        * \brief Clear the content of all the attribute vectors
+        * \brief Clear the content of all the attribute vectors, levels of detail and meshlets (and unmap the cache)
         */
         void clear();
 
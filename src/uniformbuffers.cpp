@@ -0,0 +1,154 @@
+/*********************************************************************************************************************
+ *
+ * uniformbuffers.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "uniformbuffers.h"
+#include "GLtools.h"
+
+#include <algorithm>
+
+
+// block names in the shaders and size of their std140 struct, by binding point
+static const char* const BLOCK_NAMES[NB_UNIFORM_BLOCKS] = { "FrameBlock", "MaterialBlock", "ObjectBlock" };
+static const size_t BLOCK_SIZES[NB_UNIFORM_BLOCKS] = { sizeof(FrameUniforms), MAX_MATERIALS * sizeof(MaterialUniforms), sizeof(ObjectUniforms) };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                            PROGRAM REFLECTION                                               |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+GLint ProgramReflection::getUniformLocation(std::string_view _name) const
+{
+    auto it = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), _name,
+                               [](const UniformInfo& _uniform, std::string_view _key) { return _uniform.name < _key; });
+    return (it != m_uniforms.end() && it->name == _name) ? it->location : -1;
+}
+
+
+void ProgramReflection::reflect(GLuint _program)
+{
+    m_program = _program;
+    m_uniforms.clear();
+    m_blockMask = 0;
+    if (_program == 0)
+        return;
+
+    // active uniforms (members of blocks have no location)
+    GLint nbUniforms = 0, maxLength = 0;
+    glGetProgramiv(_program, GL_ACTIVE_UNIFORMS, &nbUniforms);
+    glGetProgramiv(_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < nbUniforms; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(_program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        GLint location = glGetUniformLocation(_program, name.data());
+        if (location < 0)
+            continue;
+
+        // arrays are listed as "name[0]", looked up as "name"
+        std::string uniformName(name.data(), (size_t)length);
+        if (uniformName.size() > 3 && uniformName.ends_with("[0]"))
+            uniformName.resize(uniformName.size() - 3);
+        m_uniforms.push_back({ std::move(uniformName), location });
+    }
+    std::sort(m_uniforms.begin(), m_uniforms.end(), [](const UniformInfo& _a, const UniformInfo& _b) { return _a.name < _b.name; });
+
+    // known blocks, bound to their binding point
+    for (unsigned binding = 0; binding < NB_UNIFORM_BLOCKS; binding++)
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(_program, BLOCK_NAMES[binding]);
+        if (blockIndex == GL_INVALID_INDEX)
+            continue;
+
+        GLint blockSize = 0;
+        glGetActiveUniformBlockiv(_program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        if ((size_t)blockSize != BLOCK_SIZES[binding])
+            warningLog() << "ProgramReflection::reflect(): " << BLOCK_NAMES[binding] << " is " << blockSize << " bytes, "
+                         << BLOCK_SIZES[binding] << " expected (std140 layout)";
+
+        glUniformBlockBinding(_program, blockIndex, binding);
+        m_blockMask |= 1u << binding;
+    }
+}
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               UNIFORM RING                                                  |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+UniformRing::~UniformRing()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+
+void UniformRing::create(size_t _segmentSize)
+{
+    glDeleteBuffers(1, &m_buffer);
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = (size_t)std::max(alignment, 1);
+    m_segmentSize = alignOffset(_segmentSize);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, NB_SEGMENTS * m_segmentSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_segment = 0;
+    m_usedBytes = 0;
+    m_nbGLCalls = 0;
+    m_overflowReported = false;
+    std::fill(std::begin(m_boundOffsets), std::end(m_boundOffsets), -1);
+}
+
+
+void UniformRing::beginFrame()
+{
+    m_segment = (m_segment + 1) % NB_SEGMENTS;
+    m_frame++;
+    m_usedBytes = 0;
+
+    // updated by push(), glBindBufferRange() keeps it bound to the generic binding point
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    m_nbGLCalls = 1;
+}
+
+
+GLintptr UniformRing::push(const void* _data, size_t _size)
+{
+    if (m_usedBytes + _size > m_segmentSize)
+    {
+        if (!m_overflowReported)
+            warningLog() << "UniformRing::push(): segment of " << m_segmentSize << " bytes is full, blocks are dropped";
+        m_overflowReported = true;
+        return -1;
+    }
+
+    GLintptr offset = (GLintptr)(m_segment * m_segmentSize + m_usedBytes);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, (GLsizeiptr)_size, _data);
+    m_usedBytes += alignOffset(_size);
+    m_nbGLCalls++;
+    return offset;
+}
+
+
+void UniformRing::bind(UniformBlockBinding _binding, GLintptr _offset, size_t _size)
+{
+    if (m_boundOffsets[_binding] == _offset && m_boundSizes[_binding] == _size)
+        return;
+
+    m_boundOffsets[_binding] = _offset;
+    m_boundSizes[_binding] = _size;
+    glBindBufferRange(GL_UNIFORM_BUFFER, (GLuint)_binding, m_buffer, _offset, (GLsizeiptr)_size);
+    m_nbGLCalls++;
+}
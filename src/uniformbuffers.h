@@ -0,0 +1,265 @@
+/*********************************************************************************************************************
+ *
+ * uniformbuffers.h
+ *
+ * Program reflection (uniform locations and uniform block bindings resolved at link time) and std140 uniform buffer
+ * blocks streamed through a ring buffer
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef UNIFORMBUFFERS_H
+#define UNIFORMBUFFERS_H
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \enum UniformBlockBinding
+* \brief Binding points of the uniform blocks shared by the shaders (see ProgramReflection::reflect)
+*/
+enum UniformBlockBinding
+{
+    FRAME_BLOCK = 0,        /*!< FrameUniforms, bound once per frame */
+    MATERIAL_BLOCK = 1,     /*!< MAX_MATERIALS MaterialUniforms, bound per draw */
+    OBJECT_BLOCK = 2,       /*!< ObjectUniforms, bound per draw */
+    NB_UNIFORM_BLOCKS
+};
+
+
+/*!
+* \struct FrameUniforms
+* \brief Per-frame uniform block "FrameBlock" (std140 layout: vec3 are padded to vec4)
+*/
+struct FrameUniforms
+{
+    glm::mat4 viewMat = glm::mat4(1.0f);        /*!< camera view matrix */
+    glm::mat4 projMat = glm::mat4(1.0f);        /*!< camera projection matrix */
+    glm::vec4 lightPos = glm::vec4(0.0f);       /*!< 3D coords of light position (w unused) */
+    glm::vec4 lightColor = glm::vec4(1.0f);     /*!< RGB color of the light (w unused) */
+    glm::vec4 camPos = glm::vec4(0.0f);         /*!< 3D coords of camera position (w unused) */
+    glm::vec4 viewport = glm::vec4(0.0f);       /*!< x, y, width and height of the viewport in pixels */
+};
+
+static constexpr unsigned MAX_MATERIALS = 16;  /*!< size of the material array of "MaterialBlock" */
+
+/*!
+* \struct MaterialUniforms
+* \brief Material of the per-material uniform block "MaterialBlock", an array of MAX_MATERIALS materials indexed by
+* the material index of each instance (std140 layout)
+*/
+struct MaterialUniforms
+{
+    glm::vec4 ambientColor = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);       /*!< ambient color (w unused) */
+    glm::vec4 diffuseColor = glm::vec4(0.8f, 0.6f, 0.5f, 1.0f);       /*!< diffuse color (w unused) */
+    glm::vec4 specularColor = glm::vec4(0.95f, 0.95f, 0.95f, 1.0f);   /*!< specular color (w unused) */
+    float specularPower = 128.0f;                                       /*!< specular power */
+    float padding[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+/*!
+* \struct ObjectUniforms
+* \brief Per-object uniform block "ObjectBlock" (std140 layout)
+*/
+struct ObjectUniforms
+{
+    glm::mat4 modelMat = glm::mat4(1.0f);       /*!< model matrix */
+};
+
+static_assert(sizeof(FrameUniforms) == 192 && sizeof(MaterialUniforms) == 64 && sizeof(ObjectUniforms) == 64,
+              "uniform blocks must match their std140 layout");
+
+
+/*!
+* \class ProgramReflection
+* \brief Shader program with its active uniforms and uniform blocks, resolved once after linking: locations are looked
+* up without calling the driver, and the known blocks (see UniformBlockBinding) are bound to their binding points
+* (GLSL 330 cannot declare them in the shader).
+*/
+class ProgramReflection
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getProgram */
+        GLuint getProgram() const { return m_program; }
+        /*! \fn getNbUniforms */
+        size_t getNbUniforms() const { return m_uniforms.size(); }
+        /*!
+        * \fn hasBlock
+        * \brief true if the program uses the uniform block bound to _binding
+        */
+        bool hasBlock(UniformBlockBinding _binding) const { return (m_blockMask & (1u << _binding)) != 0; }
+
+        /*!
+        * \fn getUniformLocation
+        * \brief cached location of a uniform outside of the blocks (-1 if the program has no such active uniform)
+        */
+        GLint getUniformLocation(std::string_view _name) const;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn reflect
+        * \brief list the active uniforms of a linked program and bind its uniform blocks to their binding points (a
+        * warning is printed if a block does not have the size of its std140 struct)
+        * \param _program : linked program (not owned)
+        */
+        void reflect(GLuint _program);
+
+
+    protected:
+
+        /*!
+        * \struct UniformInfo
+        * \brief Name and location of an active uniform
+        */
+        struct UniformInfo
+        {
+            std::string name;
+            GLint location;
+        };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        GLuint m_program = 0;                   /*!< program object */
+        std::vector<UniformInfo> m_uniforms;    /*!< active uniforms outside of the blocks, sorted by name */
+        unsigned m_blockMask = 0;               /*!< bit i is set if the program uses the block bound to i */
+
+};
+
+
+/*!
+* \class UniformRing
+* \brief Uniform buffer split in NB_SEGMENTS per-frame segments used in turn: blocks written during a frame are
+* appended to its segment (at the offset alignment of the driver) and bound by range, so a range read by the draws of
+* the previous frames is never overwritten and updates do not wait for the GPU. A range already bound to a binding
+* point is not bound again, so blocks shared by several draws of a frame cost a single push() and bind().
+* GL calls are counted frame by frame (see getNbGLCalls()).
+*/
+class UniformRing
+{
+    public:
+
+        static constexpr unsigned NB_SEGMENTS = 3;      /*!< frames in flight */
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn UniformRing
+        * \brief Default constructor of UniformRing (no buffer is allocated before create())
+        */
+        UniformRing() = default;
+
+        /*!
+        * \fn ~UniformRing
+        * \brief Destructor of UniformRing
+        */
+        ~UniformRing();
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing& operator=(const UniformRing&) = delete;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn getBuffer */
+        GLuint getBuffer() const { return m_buffer; }
+        /*! \fn getSegmentSize */
+        size_t getSegmentSize() const { return m_segmentSize; }
+        /*! \fn getUsedBytes */
+        size_t getUsedBytes() const { return m_usedBytes; }
+        /*!
+        * \fn getFrame
+        * \brief number of beginFrame() calls (offsets returned by push() are valid until the next one)
+        */
+        uint64_t getFrame() const { return m_frame; }
+        /*!
+        * \fn getNbGLCalls
+        * \brief number of GL calls issued by beginFrame(), push() and bind() since the last beginFrame()
+        */
+        unsigned getNbGLCalls() const { return m_nbGLCalls; }
+
+        /*!
+        * \fn alignOffset
+        * \brief round a size up to the offset alignment of uniform buffer ranges (to pack several blocks in one push())
+        */
+        size_t alignOffset(size_t _size) const { return (_size + m_alignment - 1) / m_alignment * m_alignment; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               OTHER METHODS                                                 |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn create
+        * \brief allocate the buffer (released first if already allocated)
+        * \param _segmentSize : bytes available to the blocks of a frame
+        */
+        void create(size_t _segmentSize);
+
+        /*!
+        * \fn beginFrame
+        * \brief move to the next segment, bind the buffer and reset the per-frame counters
+        */
+        void beginFrame();
+
+        /*!
+        * \fn push
+        * \brief append data to the segment of the current frame (single glBufferSubData())
+        * \return offset of the data in the buffer, -1 if the segment is full
+        */
+        GLintptr push(const void* _data, size_t _size);
+
+        /*!
+        * \fn bind
+        * \brief bind a range of the buffer returned by push() to a uniform block binding point (nothing is done if
+        * this range is already bound to it)
+        */
+        void bind(UniformBlockBinding _binding, GLintptr _offset, size_t _size);
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        GLuint m_buffer = 0;                /*!< uniform buffer (NB_SEGMENTS segments) */
+        size_t m_segmentSize = 0;           /*!< size of a segment (multiple of the alignment) */
+        size_t m_alignment = 256;           /*!< GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
+        unsigned m_segment = 0;             /*!< segment of the current frame */
+        uint64_t m_frame = 0;               /*!< number of frames begun */
+        GLintptr m_boundOffsets[NB_UNIFORM_BLOCKS] = { -1, -1, -1 };   /*!< range bound to each binding point (-1 if none) */
+        size_t m_boundSizes[NB_UNIFORM_BLOCKS] = { 0, 0, 0 };          /*!< range bound to each binding point */
+        size_t m_usedBytes = 0;             /*!< bytes pushed in the current segment */
+        unsigned m_nbGLCalls = 0;           /*!< GL calls since the last beginFrame() */
+        bool m_overflowReported = false;    /*!< flag to print the overflow warning once */
+
+};
+
+
+#endif // UNIFORMBUFFERS_H
@@ -27,6 +27,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "GLtools.h"
+#include "uniformbuffers.h"
 
 
         /*------------------------------------------------------------------------------------------------------------+
@@ -479,5 +480,27 @@ GLuint loadShaderProgram(const std::string& _vertShaderFilename, const std::stri
 
 
 
+/*!
+* \fn loadShaderProgram
+* \brief load shader program from shader files and resolve its uniforms and uniform blocks once (see ProgramReflection).
+* If loading fails, the previous program is kept (e.g., when shaders are reloaded at runtime), otherwise it is deleted.
+* \param _program : program to replace
+* \param _vertShaderFilename : vertex shader filename
+* \param _fragShaderFilename : fragment shader filename
+* \return true if the program is replaced
+*/
+bool loadShaderProgram(ProgramReflection& _program, const std::string& _vertShaderFilename, const std::string& _fragShaderFilename)
+{
+    GLuint program = loadShaderProgram(_vertShaderFilename, _fragShaderFilename);
+    if (program == 0)
+        return false;
+
+    glDeleteProgram(_program.getProgram());
+    _program.reflect(program);
+    return true;
+}
+
+
+
 
 #endif // TOOLS_H
@@ -0,0 +1,164 @@
+/*********************************************************************************************************************
+ *
+ * vertexcache.cpp
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include "vertexcache.h"
+#include "meshnormals.h"
+
+#include <algorithm>
+
+
+VertexCacheStats simulateVertexCache(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _cacheSize, VertexCacheModel _model)
+{
+    VertexCacheStats stats;
+    size_t nbIndices = _indices.size() - _indices.size() % 3;
+    if (nbIndices == 0 || _cacheSize == 0)
+        return stats;
+
+    // Cache entries, most recent first
+    std::vector<uint32_t> cache;
+    cache.reserve(_cacheSize + 1);
+    std::vector<bool> referenced(_nbVertices, false);
+    size_t nbReferenced = 0;
+
+    for (size_t i = 0; i < nbIndices; i++)
+    {
+        uint32_t v = _indices[i];
+        if (!referenced[v])
+        {
+            referenced[v] = true;
+            nbReferenced++;
+        }
+
+        auto it = std::find(cache.begin(), cache.end(), v);
+        if (it == cache.end())
+        {
+            stats.nbTransforms++;
+            cache.insert(cache.begin(), v);
+            if (cache.size() > _cacheSize)
+                cache.pop_back();
+        }
+        else if (_model == VertexCacheModel::LRU)
+        {
+            std::rotate(cache.begin(), it, it + 1);
+        }
+    }
+
+    stats.acmr = (float)stats.nbTransforms / (float)(nbIndices / 3);
+    stats.atvr = (float)stats.nbTransforms / (float)nbReferenced;
+    return stats;
+}
+
+
+void optimizeVertexCache(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _cacheSize, std::span<uint32_t> _result)
+{
+    size_t nbTriangles = _indices.size() / 3;
+    std::copy(_indices.begin() + nbTriangles * 3, _indices.end(), _result.begin() + nbTriangles * 3);
+    if (nbTriangles == 0)
+        return;
+
+    // Triangles around each vertex, in increasing order
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_nbVertices, _indices, 1, adjacency);
+
+    std::vector<uint32_t> liveTriangles(_nbVertices);       // number of triangles not emitted yet, per vertex
+    for (size_t v = 0; v < _nbVertices; v++)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    // A vertex is in the cache if it entered it less than _cacheSize insertions ago
+    const int64_t cacheSize = _cacheSize;
+    std::vector<int64_t> cacheTimes(_nbVertices, 0);
+    int64_t time = cacheSize + 1;
+
+    std::vector<bool> emitted(nbTriangles, false);
+    std::vector<uint32_t> deadEnds;                         // recently used vertices, to restart when a fan has no candidate
+    std::vector<uint32_t> candidates;
+    size_t nextVertex = 0;                                  // scan cursor, for when the dead-end stack is empty
+    uint32_t* output = _result.data();
+
+    int64_t fanVertex = 0;
+    while (fanVertex >= 0)
+    {
+        // Emit all remaining triangles around the fan vertex
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanVertex]; i < adjacency.offsets[fanVertex + 1]; i++)
+        {
+            uint32_t t = adjacency.corners[i] / 3;
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = _indices[3 * t + k];
+                *output++ = v;
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTimes[v] > cacheSize)
+                {
+                    cacheTimes[v] = time;
+                    time++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays in the cache after emitting its remaining triangles, and entered it first
+        fanVertex = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if (time - cacheTimes[v] + 2 * (int64_t)liveTriangles[v] <= cacheSize)
+                priority = time - cacheTimes[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanVertex = v;
+            }
+        }
+
+        // Dead end: restart from a recently used vertex, or from the next vertex with remaining triangles
+        while (fanVertex < 0 && !deadEnds.empty())
+        {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0)
+                fanVertex = v;
+        }
+        for (; fanVertex < 0 && nextVertex < _nbVertices; nextVertex++)
+        {
+            if (liveTriangles[nextVertex] > 0)
+                fanVertex = (int64_t)nextVertex;
+        }
+    }
+}
+
+
+size_t computeVertexFetchRemap(std::span<const uint32_t> _indices, size_t _nbVertices, std::vector<uint32_t>& _remap)
+{
+    const uint32_t UNUSED = UINT32_MAX;
+    _remap.assign(_nbVertices, UNUSED);
+
+    uint32_t nbUsed = 0;
+    for (uint32_t v : _indices)
+    {
+        if (_remap[v] == UNUSED)
+            _remap[v] = nbUsed++;
+    }
+
+    uint32_t next = nbUsed;
+    for (uint32_t& index : _remap)
+    {
+        if (index == UNUSED)
+            index = next++;
+    }
+    return nbUsed;
+}
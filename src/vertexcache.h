@@ -0,0 +1,95 @@
+/*********************************************************************************************************************
+ *
+ * vertexcache.h
+ *
+ * Post-transform vertex cache optimization (Tipsify) and vertex fetch reordering of index buffers
+ *
+ * OpenGL_demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef VERTEXCACHE_H
+#define VERTEXCACHE_H
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+
+/*!
+* \enum VertexCacheModel
+* \brief Replacement policy of the simulated post-transform cache
+*/
+enum class VertexCacheModel
+{
+    FIFO = 0,   /*!< first in first out (a hit does not refresh the entry) */
+    LRU         /*!< least recently used */
+};
+
+
+/*!
+* \struct VertexCacheStats
+* \brief Result of a vertex cache simulation
+*/
+struct VertexCacheStats
+{
+    size_t nbTransforms = 0;    /*!< number of cache misses (vertex shader invocations) */
+    float acmr = 0.0f;          /*!< average cache miss ratio: transforms per triangle (0.5 is the best possible on large grids, 3 the worst) */
+    float atvr = 0.0f;          /*!< average transform to vertex ratio: transforms per referenced vertex (1 is optimal) */
+};
+
+
+/*!
+* \fn simulateVertexCache
+* \brief replay an index buffer through a simulated post-transform vertex cache
+* \param _indices : triangles
+* \param _nbVertices : number of vertices
+* \param _cacheSize : number of entries of the cache
+* \param _model : replacement policy
+*/
+VertexCacheStats simulateVertexCache(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _cacheSize, VertexCacheModel _model);
+
+/*!
+* \fn optimizeVertexCache
+* \brief reorder triangles for post-transform cache locality (Tipsify: Sander et al., "Fast Triangle Reordering
+* for Vertex Locality and Reduced Overdraw", 2007). Triangles are emitted as fans around vertices, the next fan
+* being chosen among the vertices still in the cache. Winding of each triangle is kept.
+* \param _indices : triangles
+* \param _nbVertices : number of vertices
+* \param _cacheSize : number of entries of the targeted cache (about 16 to 32 on current GPUs)
+* \param _result : reordered triangles (same size as _indices, must not alias it)
+*/
+void optimizeVertexCache(std::span<const uint32_t> _indices, size_t _nbVertices, unsigned _cacheSize, std::span<uint32_t> _result);
+
+/*!
+* \fn computeVertexFetchRemap
+* \brief number vertices in first-use order of the index buffer, so that vertex fetches are (mostly) sequential.
+* Unreferenced vertices are kept after the referenced ones, in their original order.
+* \param _indices : triangles
+* \param _nbVertices : number of vertices
+* \param _remap : new index of each vertex (_nbVertices entries)
+* \return number of referenced vertices
+*/
+size_t computeVertexFetchRemap(std::span<const uint32_t> _indices, size_t _nbVertices, std::vector<uint32_t>& _remap);
+
+/*!
+* \fn remapVertexArray
+* \brief move the elements of a per-vertex array to their new index
+* \param _array : per-vertex array (left unchanged if its size does not match _remap)
+* \param _remap : new index of each vertex
+*/
+template<typename T>
+void remapVertexArray(std::vector<T>& _array, const std::vector<uint32_t>& _remap)
+{
+    if (_array.size() != _remap.size())
+        return;
+
+    std::vector<T> remapped(_array.size());
+    for (size_t v = 0; v < _array.size(); v++)
+        remapped[_remap[v]] = _array[v];
+    _array.swap(remapped);
+}
+
+
+#endif // VERTEXCACHE_H